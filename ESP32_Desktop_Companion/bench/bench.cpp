@@ -0,0 +1,117 @@
+#include <Arduino.h>
+#include <Adafruit_SSD1306.h>
+#include <NativeBench.h>
+#include <TopicDispatch.h>
+
+// Host-only benchmark runner, built by the native_bench environment.
+// Prints JSON results; see NativeShim/NativeBench/NativeBench.h.
+
+extern PubSubClient client;
+extern Adafruit_SSD1306 display;
+extern bool needUpdate;
+extern bool inItem;
+void callback(char *topic, byte *payload, unsigned int length);
+void applyUpdates();
+void displayItems();
+
+volatile int dispatchSink; // Keeps the lookups from being optimised away
+
+/**
+ * @brief Dispatch cost per message with `N` subscribed topics.
+ *
+ * Messages cycle through every topic. The String variant is the callback
+ * as it was before TopicTable: the payload copied into a String, then a
+ * String(topic) comparison per table entry until one matches.
+ */
+template <size_t N>
+void benchDispatch(NativeBench &bench, const char *stringName, const char *tableName)
+{
+    static char names[N][32];
+    static const char *pointers[N];
+    for (size_t i = 0; i < N; i++)
+    {
+        snprintf(names[i], sizeof(names[i]), "home/room%u/item%u", (unsigned)(i / 8), (unsigned)(i % 8));
+        pointers[i] = names[i];
+    }
+    static TopicTable<N> table(pointers);
+    byte payload[] = "75";
+    size_t next = 0;
+
+    bench.run(stringName, 200000, [&]() {
+        const char *topic = names[next];
+        next = (next + 1) % N;
+        String message;
+        for (unsigned int i = 0; i < sizeof(payload) - 1; i++)
+        {
+            message += (char)payload[i];
+        }
+        int index = -1;
+        for (size_t i = 0; i < N; i++)
+        {
+            if (String(topic) == names[i])
+            {
+                index = i;
+                break;
+            }
+        }
+        dispatchSink = index + message.toInt();
+    });
+    bench.run(tableName, 200000, [&]() {
+        const char *topic = names[next];
+        next = (next + 1) % N;
+        long value = 0;
+        parsePayloadInt(payload, sizeof(payload) - 1, value);
+        dispatchSink = table.find(topic) + value;
+    });
+}
+
+int main()
+{
+    NativeBench bench("ESP32_Desktop_Companion");
+    BenchClient sink;
+    bench.connect(client, sink);
+    display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
+
+    // hall/light1 is an alert item: its 500 ms beep would swamp the timing
+    char toggleTopic[] = "hall/switchboard";
+    char valueTopic[] = "hall/fan";
+    char songTopic[] = "c/Song";
+    char otherTopic[] = "lawn/light1";
+    byte on[] = "1";
+    byte speed[] = "75";
+    byte song[] = "Bohemian Rhapsody";
+
+    // Updates are applied as loop() would, so the queue never fills up
+    bench.run("callback/toggle", 200000, [&]() {
+        callback(toggleTopic, on, 1);
+        applyUpdates();
+    });
+    bench.run("callback/value", 200000, [&]() {
+        callback(valueTopic, speed, 2);
+        applyUpdates();
+    });
+    bench.run("callback/mode2_text", 200000, [&]() {
+        callback(songTopic, song, sizeof(song) - 1);
+        applyUpdates();
+    });
+    bench.run("callback/unmatched", 200000, [&]() { callback(otherTopic, on, 1); });
+
+    inItem = false;
+    bench.run("displayItems/list", 20000, [&]() {
+        needUpdate = true;
+        displayItems();
+    });
+    inItem = true;
+    bench.run("displayItems/item", 20000, [&]() {
+        needUpdate = true;
+        displayItems();
+    });
+    inItem = false;
+
+    benchDispatch<6>(bench, "dispatch/string_6", "dispatch/table_6");
+    benchDispatch<16>(bench, "dispatch/string_16", "dispatch/table_16");
+    benchDispatch<32>(bench, "dispatch/string_32", "dispatch/table_32");
+    benchDispatch<64>(bench, "dispatch/string_64", "dispatch/table_64");
+
+    return bench.finish();
+}
@@ -7,6 +7,12 @@
 #include <Adafruit_SSD1306.h>
 #include <DHTesp.h>
 #include <WiFi.h>
+#include <TopicDispatch.h>
+#include <ConnectionManager.h>
+#include <SpscRing.h>
+#include <LogQueue.h>
+#include <TaskMetrics.h>
+#include <atomic>
 
 #define OLED_RESET 4
 
@@ -17,9 +23,25 @@ Adafruit_SSD1306 display(128, 64, &Wire, -1);
 
 WiFiClient wifi;
 PubSubClient client(wifi);
+ConnectionManager net(client, wifi);
 /* CONFIGURATION Parameters */
 #define MAX_ITEMS 6
 #define DEBUG_MODE true
+/* CONNECTION: retries back off from NET_BACKOFF_MIN_MS to NET_BACKOFF_MAX_MS,
+   a broker attempt holds up the network task for at most NET_CONNECT_TIMEOUT_MS */
+#define NET_JOIN_TIMEOUT_MS 15000
+#define NET_CONNECT_TIMEOUT_MS 2000
+#define NET_BACKOFF_MIN_MS 1000
+#define NET_BACKOFF_MAX_MS 60000
+#define NET_STATS_INTERVAL_MS 60000
+/* TASKS: WiFi and MQTT run in their own task on core 0, the buttons,
+   buzzer and display stay in loop() on core 1 */
+#define NET_TASK_CORE 0
+#define NET_TASK_PRIORITY 1
+#define NET_TASK_STACK_SIZE 6144
+#define NET_IDLE_MS 10
+#define LOOP_IDLE_MS 10
+#define CORE_QUEUE_SIZE 8 // Messages in flight between the tasks, each way (power of two)
 /* OLED */
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
@@ -82,6 +104,8 @@ const char selectableItems[MAX_ITEMS][15] = {
     "Humidity",
 };
 const char *mediaTopic = "c/playbackcontrol";
+const char *statsTopic = "hall/node/stats";
+const char *tasksTopic = "hall/node/tasks";
 const bool toggleItems[MAX_ITEMS] = {
     true,
     true,
@@ -96,7 +120,7 @@ int currentValue[MAX_ITEMS] = {
     0,
     0,
 };
-const char topics[MAX_ITEMS][30] = {"hall/light1", "hall/fan", "hall/switchboard", "hall/brightness", "hall/temperature", "hall/humidity"};
+constexpr char topics[MAX_ITEMS][30] = {"hall/light1", "hall/fan", "hall/switchboard", "hall/brightness", "hall/temperature", "hall/humidity"};
 
 const bool isSensors[MAX_ITEMS] = {false, false, false, false, true, true};
 const bool isAlert[MAX_ITEMS] = {true, false, false, false, false, false};
@@ -106,24 +130,56 @@ bool needUpdate = true;
 char SSID[32] = "ConForNode1";  // Increased size for SSID
 char PASSWORD[32] = "12345678"; // Increased size for Password
 
-const char mode2Topics[2][30] = {"c/Song", "c/Artist"};
+constexpr char mode2Topics[2][30] = {"c/Song", "c/Artist"};
 String mode2Strings[2] = {"SongName", "Artist"};
+#define MODE2_TEXT_MAX_LEN 64
+
+// Every subscribed topic: the items first, then the mode 2 topics
+constexpr const char *subscribedTopics[MAX_ITEMS + 2] = {
+    topics[0], topics[1], topics[2], topics[3], topics[4], topics[5],
+    mode2Topics[0], mode2Topics[1]};
+constexpr TopicTable<MAX_ITEMS + 2> topicTable(subscribedTopics);
+
 #define CHANGE_MODE_BUTTON 23
 bool mode1 = true;
 #define BUZZER 15
+
+// A button action for the broker, published by the network task
+struct OutboundMessage
+{
+    const char *topic; // One of the constant topics above
+    char payload[8];
+    bool retained;
+};
+
+// A value or mode 2 text from the broker, applied by loop()
+struct InboundUpdate
+{
+    uint8_t index; // Into subscribedTopics
+    long value;
+    char text[MODE2_TEXT_MAX_LEN];
+};
+
+SpscRing<OutboundMessage, CORE_QUEUE_SIZE> outboundQueue;
+SpscRing<InboundUpdate, CORE_QUEUE_SIZE> inboundQueue;
+std::atomic<uint32_t> coreQueueFull(0); // Messages either task could not hand over
+volatile ConnectionState netState = NET_WIFI_DOWN; // Written by the network task
+LogQueue uiLog(Serial); // loop()'s console lines, printed by the network task
+
+TaskHandle_t netTaskHandle = NULL;
+TaskMetrics netMetrics("net");
+TaskMetrics uiMetrics("ui");
+
 String BottomText()
 {
-    if (WiFi.status() != WL_CONNECTED)
-    {
-        return "Not Connected To WiFi";
-    }
-    else if (client.connected() == false)
-    {
-        return "Not Connected To MQTT";
-    }
-    else
+    switch (netState)
     {
+    case NET_ONLINE:
         return "Connected";
+    case NET_MQTT_DOWN:
+        return "Not Connected To MQTT";
+    default:
+        return "Not Connected To WiFi";
     }
 } /**
    * Function to make the buzzer beep.
@@ -135,7 +191,8 @@ void beepBuzzer()
     digitalWrite(BUZZER, LOW);  // Turn off the buzzer
 }
 /**
- * Callback function that handles incoming messages.
+ * Callback function that handles incoming messages. Runs in the network
+ * task; what it parses is queued for loop() to apply.
  *
  * @param topic The topic of the message.
  * @param payload The payload of the message.
@@ -145,117 +202,126 @@ void beepBuzzer()
  */
 void callback(char *topic, byte *payload, unsigned int length)
 {
-    String message;
-
-    for (unsigned int i = 0; i < length; i++)
-    {
-        message += (char)payload[i];
-    }
 #if DEBUG_MODE
     Serial.print("Message arrived [");
     Serial.print(topic);
     Serial.print("] ");
-    Serial.println(message);
+    Serial.write(payload, length);
+    Serial.println();
 #endif
 
-    bool topicFound = false;
+    int index = topicTable.find(topic);
+    if (index < 0)
+    {
+        return;
+    }
 
-    // Check if the topic is in the main topics array
-    for (int i = 0; i < MAX_ITEMS; i++)
+    InboundUpdate update;
+    update.index = index;
+    update.value = 0;
+    update.text[0] = '\0';
+    if (index < MAX_ITEMS)
     {
-        if (String(topic) == topics[i])
+        if (maxValues[index] == 1)
         {
-            topicFound = true;
-            if (maxValues[i] == 1)
+            // For toggle items that can only have "0" or "1"
+            bool on;
+            if (!parsePayloadBool(payload, length, on))
             {
-                // For toggle items that can only have "0" or "1"
-                if (message == "1" || message == "0")
-                {
-                    currentValue[i] = message.toInt();
-                    needUpdate = true;
-                }
-            }
-            else
-            {
-                // For items that can have other numeric values
-                currentValue[i] = message.toInt();
-                needUpdate = true;
+                return;
             }
+            update.value = on;
+        }
+        else if (!parsePayloadDecimal(payload, length, update.value, 0))
+        {
+            // For items that can have other numeric values
+            return;
+        }
+    }
+    else
+    {
+        // Mode 2 text, copied once here and once into its display string
+        unsigned int textLength = length < sizeof(update.text) - 1 ? length : sizeof(update.text) - 1;
+        memcpy(update.text, payload, textLength);
+        update.text[textLength] = '\0';
+    }
+
+    if (!inboundQueue.push(update))
+    {
+        coreQueueFull++;
+    }
+}
+
+/**
+ * Applies the updates the callback queued and beeps for alert items.
+ *
+ * @return None
+ */
+void applyUpdates()
+{
+    InboundUpdate update;
+    while (inboundQueue.pop(update))
+    {
+        needUpdate = true;
+        if (update.index < MAX_ITEMS)
+        {
+            currentValue[update.index] = update.value;
 
             // Check if the item is an alert and trigger the buzzer
-            if (isAlert[i])
+            if (isAlert[update.index])
             {
                 beepBuzzer();
             }
-            break;
+            continue;
         }
-    }
 
-    // If not found, check in mode2Topics
-    if (!topicFound)
-    {
-        for (int i = 0; i < 2; i++)
-        {
-            if (String(topic) == mode2Topics[i])
-            {
-                mode2Strings[i] = message;
-                needUpdate = true;
+        int i = update.index - MAX_ITEMS;
+        mode2Strings[i] = update.text;
 #if DEBUG_MODE
-                Serial.print("Updated mode2Strings[");
-                Serial.print(i);
-                Serial.print("]: ");
-                Serial.println(mode2Strings[i]);
+        uiLog.printf("Updated mode2Strings[%d]: %s", i, mode2Strings[i].c_str());
 #endif
-                break;
-            }
-        }
     }
 }
 
 /**
- * Initializes the setup for the program.
+ * Queues a publish for the network task.
  *
- * @return void
+ * @param topic One of the constant topics.
+ * @param payload Short value text.
+ * @param retained Whether the broker keeps it for new subscribers.
  *
- * @throws None
+ * @return false if the queue is full.
  */
-void setup()
+bool sendToNet(const char *topic, const char *payload, bool retained)
 {
-    Serial.begin(115200);
-
-    display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(WHITE);
-    WiFi.begin(SSID, PASSWORD);
-    client.setServer(mqtt_server, 1883);
-    client.setCallback(callback);
-    uint8_t i = 0;
-    while (WiFi.status() != WL_CONNECTED)
+    OutboundMessage message;
+    message.topic = topic;
+    snprintf(message.payload, sizeof(message.payload), "%s", payload);
+    message.retained = retained;
+    if (!outboundQueue.push(message))
     {
-
-#if DEBUG_MODE
-        Serial.println("Connecting to WiFi..");
-#endif
-        display.setTextSize(1);
-        display.setCursor(5, 32);
-        display.print("Connecting to WiFi..");
-        display.drawBitmap(58, 14, epd_bitmap_wifi, 16, 16, WHITE);
-        display.display();
-        delay(1000);
-        i++;
-        if (i > 12)
-        {
-            break;
-        }
+        coreQueueFull++;
+        return false;
     }
+    xTaskNotifyGive(netTaskHandle);
+    return true;
+}
 
-    if (client.connect("hallNode"))
+/**
+ * Subscribes once the broker session is up and hands every connection
+ * change to loop() for the status line.
+ *
+ * @param state The new connection state.
+ *
+ * @return None
+ */
+void onConnectionChange(ConnectionState state)
+{
+    netState = state;
+    if (state == NET_ONLINE)
     {
-
 #if DEBUG_MODE
-        Serial.println("connected");
-        beepBuzzer();
+        Serial.println("connected to MQTT");
 #endif
         for (int i = 0; i < MAX_ITEMS; i++)
         {
@@ -274,12 +340,156 @@ void setup()
             client.subscribe(mode2Topics[i]);
         }
     }
-    else
+#if DEBUG_MODE
+    else if (state == NET_MQTT_DOWN)
+    {
+        Serial.println("Connected to WiFi, attempting MQTT connection...");
+    }
+    else if (state == NET_WIFI_DOWN)
+    {
+        Serial.println("WiFi down, retrying with backoff");
+    }
+#endif
+}
+
+/**
+ * Redraws the status line when the connection state changed, beeping
+ * the first time the broker is reached.
+ *
+ * @return None
+ */
+void showConnectionState()
+{
+    static ConnectionState shownState = NET_WIFI_DOWN;
+    static bool everConnected = false;
+    ConnectionState state = netState;
+    if (state == shownState)
+    {
+        return;
+    }
+    shownState = state;
+    needUpdate = true;
+    if (state == NET_ONLINE)
+    {
+#if DEBUG_MODE
+        if (!everConnected)
+        {
+            beepBuzzer();
+        }
+#endif
+        everConnected = true;
+    }
+}
+
+/**
+ * Publishes how long connection attempts held up the network task, and
+ * each task's CPU share and free stack, once per NET_STATS_INTERVAL_MS.
+ *
+ * @return None
+ */
+void publishStats()
+{
+    static unsigned long lastStatsTime = 0;
+    if (millis() - lastStatsTime < NET_STATS_INTERVAL_MS)
+    {
+        return;
+    }
+    lastStatsTime = millis();
+
+    ConnectionStats netStats = net.takeStats();
+    String message = "{\"netBlockedMs\": ";
+    message += netStats.blockedMs;
+    message += ",\"netBlockedMaxMs\": ";
+    message += netStats.blockedMaxMs;
+    message += ",\"netBlockedMsPerHour\": ";
+    message += netStats.blockedMsPerHour();
+    message += ",\"netOfflineMs\": ";
+    message += netStats.offlineMs;
+    message += ",\"wifiJoinMs\": ";
+    message += net.lastJoinMs();
+    message += ",\"fastJoin\": ";
+    message += net.lastJoinFast() ? "true" : "false";
+    message += ",\"bootToOnlineMs\": ";
+    message += net.bootToOnlineMs();
+    message += ",\"coreQueueFull\": ";
+    message += coreQueueFull.load();
+    message += ",\"logDropped\": ";
+    message += uiLog.dropped();
+    message += "}";
+#if DEBUG_MODE
+    Serial.println(message);
+#endif
+    client.publish(statsTopic, message.c_str());
+
+    TaskUsage usage[2] = {netMetrics.take(), uiMetrics.take()};
+    char tasks[200];
+    if (formatTaskUsage(tasks, sizeof(tasks), usage, 2) > 0)
+    {
+        client.publish(tasksTopic, tasks);
+    }
+}
+
+/**
+ * Keeps WiFi and MQTT up and publishes the button actions loop() queued.
+ * Runs pinned to NET_TASK_CORE, so a stalled broker never freezes the
+ * menu.
+ *
+ * @param parameter Unused.
+ *
+ * @return None
+ */
+void netTask(void *parameter)
+{
+    netMetrics.attach();
+    for (;;)
     {
+        netMetrics.beginPass();
+        net.loop();
+
+        OutboundMessage message;
+        while (outboundQueue.pop(message))
+        {
+            client.publish(message.topic, message.payload, message.retained);
 #if DEBUG_MODE
-        Serial.println("failed, rc=" + client.state());
+            Serial.print("Published to ");
+            Serial.print(message.topic);
+            Serial.print(": ");
+            Serial.println(message.payload);
 #endif
+        }
+
+        uiLog.flush();
+        publishStats();
+        netMetrics.endPass();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NET_IDLE_MS));
     }
+}
+
+/**
+ * Initializes the setup for the program.
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void setup()
+{
+    Serial.begin(115200);
+
+    display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
+    display.clearDisplay();
+    display.setTextSize(1);
+    display.setTextColor(WHITE);
+    display.setCursor(5, 32);
+    display.print("Connecting to WiFi..");
+    display.drawBitmap(58, 14, epd_bitmap_wifi, 16, 16, WHITE);
+    display.display();
+
+    // WiFi and MQTT are brought up by the network task, the menu works meanwhile
+    client.setCallback(callback);
+    net.setStateCallback(onConnectionChange);
+    net.begin({SSID, PASSWORD, mqtt_server, 1883, "hallNode", NET_JOIN_TIMEOUT_MS,
+               NET_CONNECT_TIMEOUT_MS, NET_BACKOFF_MIN_MS, NET_BACKOFF_MAX_MS});
 #if MODE_BUTTON_CAP
 #else
     pinMode(NEXT_BUTTON, INPUT_PULLUP);
@@ -289,6 +499,10 @@ void setup()
 
 #endif
     pinMode(BUZZER, OUTPUT);
+
+    uiMetrics.attach();
+    xTaskCreatePinnedToCore(netTask, "netTask", NET_TASK_STACK_SIZE, NULL, NET_TASK_PRIORITY, &netTaskHandle,
+                            NET_TASK_CORE);
 }
 void handleModeChange()
 {
@@ -479,7 +693,7 @@ void checkButtons()
             }
             else
             {
-                client.publish(mediaTopic, "2"); // Next track
+                sendToNet(mediaTopic, "2", false); // Next track
             }
         }
     }
@@ -521,7 +735,7 @@ void checkButtons()
             }
             else
             {
-                client.publish(mediaTopic, "3"); // Previous track
+                sendToNet(mediaTopic, "3", false); // Previous track
             }
         }
     }
@@ -550,96 +764,17 @@ void checkButtons()
                 if (!inItem && !isSensors[selectedItem])
                 {
                     String payload = String(currentValue[selectedItem]);
-                    client.publish(topics[selectedItem], payload.c_str(), true);
-#if DEBUG_MODE
-                    Serial.print("Published to ");
-                    Serial.print(topics[selectedItem]);
-                    Serial.print(": ");
-                    Serial.println(payload);
-#endif
+                    sendToNet(topics[selectedItem], payload.c_str(), true);
                 }
             }
             else
             {
-                client.publish(mediaTopic, "1"); // Play/Pause
+                sendToNet(mediaTopic, "1", false); // Play/Pause
                 delay(300);
             }
         }
     }
 }
-/**
-
-/**
- * Reconnects to MQTT if not connected, and sets needUpdate to true.
- *
- * @param None
- *
- * @return None
- *
- * @throws None
- */
-void reconnectMQTT()
-{
-
-    if (!client.connected())
-    {
-        display.clearDisplay();
-        display.setTextSize(1);
-        display.setTextColor(WHITE);
-        display.setCursor(0, 0);
-        display.println("Attempting MQTT Reconnection...");
-        display.drawBitmap(58, 14, epd_bitmap_wifi, 16, 16, WHITE);
-        display.display();
-        Serial.print("Attempting MQTT connection...");
-        // Attempt to connect
-        if (client.connect("hallNode"))
-        {
-            Serial.println("connected to MQTT");
-            // Subscribe to topics again
-            for (int i = 0; i < MAX_ITEMS; i++)
-            {
-#if DEBUG_MODE
-                Serial.print("Subscribing to: ");
-                Serial.println(topics[i]);
-#endif
-                client.subscribe(topics[i]);
-            }
-
-            for (int i = 0; i < 2; i++)
-            {
-#if DEBUG_MODE
-                Serial.print("Subscribing to mode2 topic: ");
-                Serial.println(mode2Topics[i]);
-#endif
-                client.subscribe(mode2Topics[i]);
-            }
-        }
-        else
-        {
-            Serial.print("failed, rc=");
-            Serial.print(client.state());
-            Serial.println(" try again in 5 seconds");
-            // Wait 5 seconds before retrying
-            delay(2000);
-        }
-    }
-    needUpdate = true;
-}
-
-void reconnectWiFi()
-{
-    // Loop until we're reconnected to WiFi
-    while (WiFi.status() != WL_CONNECTED)
-    {
-        Serial.print("Attempting WiFi connection...");
-        // Attempt to connect to WiFi
-        WiFi.begin(SSID, PASSWORD);
-        // Wait 10 seconds for connection:
-        delay(3000);
-    }
-    Serial.println("Connected to WiFi");
-}
-
 /**
  * Performs the main loop of the program.
  *
@@ -647,17 +782,15 @@ void reconnectWiFi()
  */
 void loop()
 {
-    if (WiFi.status() == WL_CONNECTED)
-    {
-        if (!client.connected())
-        {
-            reconnectMQTT();
-        }
-    }
-
-    client.loop();
+    uiMetrics.beginPass();
+    applyUpdates();
+    showConnectionState();
     fixNumbering();
     displayModeItems(); // Use displayModeItems() instead of displayItems()
     checkButtons();
     handleModeChange(); // Call the new handleModeChange() function
+    uiMetrics.endPass();
+
+    // Buttons are debounced over debounceDelay, polling faster gains nothing
+    vTaskDelay(pdMS_TO_TICKS(LOOP_IDLE_MS));
 }
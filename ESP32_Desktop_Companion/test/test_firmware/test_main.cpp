@@ -0,0 +1,152 @@
+#include <Arduino.h>
+#include <NativeBroker.h>
+#include <NativeHooks.h>
+#include <unity.h>
+
+// Host tests of the whole firmware, built by the native environment:
+//   pio test -e native
+// setup() runs once; each test drives loop() against an in-process broker
+// while the network task runs on its own thread, as on the device.
+
+#define NEXT_BUTTON 13
+#define PREV_BUTTON 12
+#define SELECT_BUTTON 33
+#define CHANGE_MODE_BUTTON 23
+
+extern int currentValue[];
+extern String mode2Strings[2];
+extern bool mode1;
+
+static NativeBroker broker;
+
+static bool subscribed()
+{
+    return broker.subscribed("hall/light1") && broker.subscribed("hall/humidity") && broker.subscribed("c/Artist");
+}
+
+/**
+ * Holds a button down for one loop pass and waits out the debounce.
+ *
+ * @param pin The button's pin.
+ *
+ * @return None
+ */
+static void pressButton(uint8_t pin)
+{
+    nativeSetDigitalInput(pin, LOW);
+    nativeLoopUntil(nullptr, 20);
+    nativeSetDigitalInput(pin, HIGH);
+    nativeLoopUntil(nullptr, 350);
+}
+
+void setUp()
+{
+    broker.clear();
+}
+
+void tearDown()
+{
+}
+
+void test_connects_and_subscribes()
+{
+    TEST_ASSERT_TRUE(nativeLoopUntil(subscribed, 5000));
+    TEST_ASSERT_EQUAL_UINT32(1, broker.connects());
+}
+
+void test_retained_value_shown_after_connect()
+{
+    TEST_ASSERT_TRUE(nativeLoopUntil([]() { return currentValue[1] == 40; }, 2000));
+}
+
+void test_toggle_item_update()
+{
+    broker.publish("hall/switchboard", "1");
+    TEST_ASSERT_TRUE(nativeLoopUntil([]() { return currentValue[2] == 1; }, 2000));
+
+    // Toggle items take only 0 and 1
+    broker.publish("hall/switchboard", "7");
+    nativeLoopUntil(nullptr, 200);
+    TEST_ASSERT_EQUAL_INT(1, currentValue[2]);
+}
+
+void test_alert_item_update()
+{
+    broker.publish("hall/light1", "1");
+    TEST_ASSERT_TRUE(nativeLoopUntil([]() { return currentValue[0] == 1; }, 2000));
+    TEST_ASSERT_EQUAL(LOW, nativeGetPinOutput(15)); // Buzzer off again after the beep
+}
+
+void test_mode2_text()
+{
+    broker.publish("c/Song", "Blue in Green");
+    TEST_ASSERT_TRUE(nativeLoopUntil([]() { return mode2Strings[0] == "Blue in Green"; }, 2000));
+}
+
+void test_menu_edit_publishes_retained()
+{
+    pressButton(NEXT_BUTTON);   // Light 1 -> Fan 1
+    pressButton(SELECT_BUTTON); // Edit
+    pressButton(PREV_BUTTON);   // +10
+    pressButton(SELECT_BUTTON); // Done, publish
+    TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("hall/fan") > 0; }, 2000));
+    TEST_ASSERT_EQUAL_STRING("50", broker.last("hall/fan").c_str());
+    TEST_ASSERT_TRUE(broker.messages().back().retained);
+}
+
+void test_media_mode_buttons()
+{
+    pressButton(CHANGE_MODE_BUTTON);
+    TEST_ASSERT_FALSE(mode1);
+    pressButton(NEXT_BUTTON);
+    TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("c/playbackcontrol") > 0; }, 2000));
+    TEST_ASSERT_EQUAL_STRING("2", broker.last("c/playbackcontrol").c_str());
+
+    pressButton(CHANGE_MODE_BUTTON);
+    TEST_ASSERT_TRUE(mode1);
+}
+
+void test_reconnects_after_broker_restart()
+{
+    broker.stop();
+    nativeLoopUntil(nullptr, 500);
+    TEST_ASSERT_TRUE(broker.start());
+    TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.connects() == 2 && subscribed(); }, 10000));
+
+    broker.publish("hall/brightness", "70");
+    TEST_ASSERT_TRUE(nativeLoopUntil([]() { return currentValue[3] == 70; }, 2000));
+}
+
+void test_oversized_number_ignored()
+{
+    broker.publish("hall/brightness", "70");
+    TEST_ASSERT_TRUE(nativeLoopUntil([]() { return currentValue[3] == 70; }, 2000));
+    broker.publish("hall/brightness", "1234567890123456789012345");
+    nativeLoopUntil(nullptr, 300);
+    TEST_ASSERT_EQUAL_INT(70, currentValue[3]);
+}
+
+int main()
+{
+    nativeSetConsoleOutput(false);
+    if (!broker.start())
+    {
+        return 1;
+    }
+    setenv("NATIVE_BROKER", "127.0.0.1", 1);
+    setenv("NATIVE_BROKER_PORT", String(broker.port()).c_str(), 1);
+    broker.publish("hall/fan", "40", true);
+    setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_connects_and_subscribes);
+    RUN_TEST(test_retained_value_shown_after_connect);
+    RUN_TEST(test_toggle_item_update);
+    RUN_TEST(test_alert_item_update);
+    RUN_TEST(test_mode2_text);
+    RUN_TEST(test_menu_edit_publishes_retained);
+    RUN_TEST(test_media_mode_buttons);
+    RUN_TEST(test_reconnects_after_broker_restart);
+    RUN_TEST(test_oversized_number_ignored);
+    return UNITY_END();
+}
@@ -0,0 +1,113 @@
+#include <Arduino.h>
+#include <TopicDispatch.h>
+#include <limits.h>
+#include <string.h>
+#include <unity.h>
+
+// Topic lookup and payload parsing from SharedLib/TopicDispatch. Payloads
+// come straight off the network, so anything that is not a number that
+// fits must be refused rather than wrap.
+
+constexpr const char *topics[4] = {"hall/light1", "hall/fan", "hall/brightness", "c/Artist"};
+constexpr TopicTable<4> table(topics);
+
+static bool parseInt(const char *text, long &value)
+{
+    return parsePayloadInt((const uint8_t *)text, strlen(text), value);
+}
+
+static bool parseDecimal(const char *text, long &value, uint8_t decimals)
+{
+    return parsePayloadDecimal((const uint8_t *)text, strlen(text), value, decimals);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_table_finds_every_topic()
+{
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(i, table.find(topics[i]));
+    }
+    TEST_ASSERT_EQUAL_INT(-1, table.find("hall/light2"));
+    TEST_ASSERT_EQUAL_INT(-1, table.find(""));
+}
+
+void test_parse_int()
+{
+    long value = 0;
+    TEST_ASSERT_TRUE(parseInt("70", value));
+    TEST_ASSERT_EQUAL_INT32(70, value);
+    TEST_ASSERT_TRUE(parseInt("-12", value));
+    TEST_ASSERT_EQUAL_INT32(-12, value);
+    TEST_ASSERT_FALSE(parseInt("", value));
+    TEST_ASSERT_FALSE(parseInt("-", value));
+    TEST_ASSERT_FALSE(parseInt("7a", value));
+}
+
+void test_parse_int_refuses_oversized_payload()
+{
+    char text[32];
+    long value = 42;
+    snprintf(text, sizeof(text), "%ld", LONG_MAX);
+    TEST_ASSERT_TRUE(parseInt(text, value));
+    TEST_ASSERT_TRUE(value == LONG_MAX);
+
+    // One past the largest long, and a 25-digit payload
+    text[strlen(text) - 1]++;
+    TEST_ASSERT_FALSE(parseInt(text, value));
+    TEST_ASSERT_FALSE(parseInt("1234567890123456789012345", value));
+    TEST_ASSERT_FALSE(parseInt("-1234567890123456789012345", value));
+    TEST_ASSERT_TRUE(value == LONG_MAX); // Untouched on failure
+
+    // Leading zeros are not significant
+    TEST_ASSERT_TRUE(parseInt("0000000000000000000000070", value));
+    TEST_ASSERT_EQUAL_INT32(70, value);
+}
+
+void test_parse_decimal()
+{
+    long value = 0;
+    TEST_ASSERT_TRUE(parseDecimal("23.45", value, 2));
+    TEST_ASSERT_EQUAL_INT32(2345, value);
+    TEST_ASSERT_TRUE(parseDecimal("23.7", value, 0));
+    TEST_ASSERT_EQUAL_INT32(23, value);
+    TEST_ASSERT_TRUE(parseDecimal("-1.5", value, 2));
+    TEST_ASSERT_EQUAL_INT32(-150, value);
+    TEST_ASSERT_FALSE(parseDecimal(".", value, 2));
+    TEST_ASSERT_FALSE(parseDecimal("1.2.3", value, 2));
+}
+
+void test_parse_decimal_refuses_oversized_payload()
+{
+    char text[32];
+    long value = 42;
+    TEST_ASSERT_FALSE(parseDecimal("1234567890123456789012345", value, 0));
+    TEST_ASSERT_FALSE(parseDecimal("1234567890123456789012345.5", value, 2));
+
+    // Fits as digits, but not once scaled by 10^decimals
+    snprintf(text, sizeof(text), "%ld", LONG_MAX / 10);
+    TEST_ASSERT_TRUE(parseDecimal(text, value, 1));
+    TEST_ASSERT_FALSE(parseDecimal(text, value, 2));
+
+    // Extra fraction digits are dropped before they can overflow
+    TEST_ASSERT_TRUE(parseDecimal("1.1234567890123456789012345", value, 2));
+    TEST_ASSERT_EQUAL_INT32(112, value);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_table_finds_every_topic);
+    RUN_TEST(test_parse_int);
+    RUN_TEST(test_parse_int_refuses_oversized_payload);
+    RUN_TEST(test_parse_decimal);
+    RUN_TEST(test_parse_decimal_refuses_oversized_payload);
+    return UNITY_END();
+}
@@ -0,0 +1,36 @@
+#include <Arduino.h>
+#include <CrossingDetector.h>
+#include <NativeBench.h>
+#include <sys/time.h>
+
+// Host-only benchmark runner, built by the native_bench environment.
+// Prints JSON results; see NativeShim/NativeBench/NativeBench.h.
+
+extern PubSubClient client;
+void callback(char *topic, byte *payload, unsigned int length);
+bool publishPresence(const PresenceEvent &event, const struct timeval &time);
+void publishStats();
+
+int main()
+{
+  NativeBench bench("ESP8266_Ultrasonic_Lawn");
+  BenchClient sink;
+  client.setBufferSize(512); // As setup() does
+  bench.connect(client, sink);
+
+  char ledTopic[] = "lawn/light2";
+  char otherTopic[] = "lawn/ultrasonic1";
+  byte on[] = "on";
+
+  bench.run("callback/led", 200000, [&]() { callback(ledTopic, on, 2); });
+  bench.run("callback/unmatched", 200000, [&]() { callback(otherTopic, on, 2); });
+
+  PresenceEvent event = {PRESENCE_ENTER, 840};
+  struct timeval synced = {1760000000, 123456};
+  struct timeval unsynced = {12, 0};
+  bench.run("publishPresence/synced", 100000, [&]() { publishPresence(event, synced); });
+  bench.run("publishPresence/unsynced", 100000, [&]() { publishPresence(event, unsynced); });
+  bench.run("publishStats", 20000, [&]() { publishStats(); });
+
+  return bench.finish();
+}
@@ -0,0 +1,107 @@
+#include "CrossingDetector.h"
+
+CrossingDetector::CrossingDetector(const PresenceConfig &config)
+    : _config(config), _state(IDLE), _blocked{false, false}, _pending{0, 0},
+      _first(CROSSING_OUTER), _firstMs(0), _secondMs(0)
+{
+}
+
+/**
+ * @brief Apply threshold, hysteresis and debounce to one beam.
+ *
+ * @return true if the beam changed state.
+ */
+bool CrossingDetector::debounce(uint8_t sensor, uint16_t cm)
+{
+  bool reading;
+  if (_blocked[sensor])
+  {
+    reading = cm != 0 && cm < _config.thresholdCm + _config.hysteresisCm;
+  }
+  else
+  {
+    reading = cm != 0 && cm < _config.thresholdCm;
+  }
+
+  if (reading == _blocked[sensor])
+  {
+    _pending[sensor] = 0;
+    return false;
+  }
+  if (++_pending[sensor] < (reading ? _config.blockDebounce : _config.clearDebounce))
+  {
+    return false;
+  }
+  _pending[sensor] = 0;
+  _blocked[sensor] = reading;
+  return true;
+}
+
+bool CrossingDetector::update(uint8_t sensor, uint16_t cm, uint32_t nowMs, PresenceEvent &event)
+{
+  if (sensor > CROSSING_INNER)
+  {
+    return false;
+  }
+  bool changed = debounce(sensor, cm);
+  bool anyBlocked = _blocked[CROSSING_OUTER] || _blocked[CROSSING_INNER];
+
+  switch (_state)
+  {
+  case IDLE:
+    if (changed && _blocked[sensor])
+    {
+      _state = ARMED;
+      _first = sensor;
+      _firstMs = nowMs;
+    }
+    return false;
+
+  case ARMED:
+    if (changed && _blocked[sensor] && sensor != _first && nowMs - _firstMs <= _config.crossingWindowMs)
+    {
+      _state = CROSSING;
+      _secondMs = nowMs;
+      return false;
+    }
+    if (!anyBlocked)
+    {
+      // Turned back before reaching the other beam. The first beam can
+      // clear just before the second one has debounced, so the crossing
+      // stays armed for the rest of the window.
+      if (nowMs - _firstMs > _config.crossingWindowMs)
+      {
+        _state = IDLE;
+      }
+      return false;
+    }
+    break;
+
+  case CROSSING:
+    if (!anyBlocked)
+    {
+      _state = IDLE;
+      event.type = _first == CROSSING_OUTER ? PRESENCE_ENTER : PRESENCE_EXIT;
+      event.durationMs = _secondMs - _firstMs;
+      return true;
+    }
+    break;
+
+  case LOITERING:
+    if (!anyBlocked)
+    {
+      _state = IDLE;
+    }
+    return false;
+  }
+
+  // Still blocked in ARMED or CROSSING
+  if (nowMs - _firstMs >= _config.loiterMs)
+  {
+    _state = LOITERING;
+    event.type = PRESENCE_LOITER;
+    event.durationMs = nowMs - _firstMs;
+    return true;
+  }
+  return false;
+}
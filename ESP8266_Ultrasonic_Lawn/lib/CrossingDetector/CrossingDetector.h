@@ -0,0 +1,76 @@
+#ifndef CROSSING_DETECTOR_H
+#define CROSSING_DETECTOR_H
+
+#include <stdint.h>
+
+#define CROSSING_OUTER 0 // Sensor facing the outside of the passage
+#define CROSSING_INNER 1 // Sensor facing the inside
+
+enum PresenceEventType
+{
+  PRESENCE_ENTER,
+  PRESENCE_EXIT,
+  PRESENCE_LOITER
+};
+
+struct PresenceEvent
+{
+  PresenceEventType type;
+  uint32_t durationMs; // Enter/exit: first to second sensor; loiter: time blocked
+};
+
+/**
+ * @brief Tuning for CrossingDetector.
+ */
+struct PresenceConfig
+{
+  uint16_t thresholdCm;      // A reading below this blocks a sensor
+  uint16_t hysteresisCm;     // Extra distance needed to clear it again
+  uint8_t blockDebounce;     // Consecutive readings needed to block a beam
+  uint8_t clearDebounce;     // ...and to clear it again (missed echoes happen)
+  uint32_t crossingWindowMs; // Max time between the two sensors for a crossing
+  uint32_t loiterMs;         // Blocked this long without crossing is loitering
+};
+
+/**
+ * @brief Turns two sonar beams across a passage into enter/exit/loiter events.
+ *
+ * Outer then inner is an enter, inner then outer an exit, reported once
+ * both beams are clear again. Someone who breaks one beam and turns back
+ * produces no event; someone who keeps a beam blocked for loiterMs
+ * produces a single loiter event.
+ */
+class CrossingDetector
+{
+public:
+  explicit CrossingDetector(const PresenceConfig &config);
+
+  /**
+   * @brief Feed one reading of CROSSING_OUTER or CROSSING_INNER.
+   *
+   * @param cm Distance in cm, 0 for no echo.
+   * @return true when `event` was filled.
+   */
+  bool update(uint8_t sensor, uint16_t cm, uint32_t nowMs, PresenceEvent &event);
+
+private:
+  enum State
+  {
+    IDLE,
+    ARMED,     // First beam broken at _firstMs
+    CROSSING,  // Both beams broken in order, waiting for them to clear
+    LOITERING  // Loiter reported, waiting for both beams to clear
+  };
+
+  bool debounce(uint8_t sensor, uint16_t cm);
+
+  PresenceConfig _config;
+  State _state;
+  bool _blocked[2];
+  uint8_t _pending[2]; // Readings disagreeing with _blocked
+  uint8_t _first;      // Beam broken first
+  uint32_t _firstMs;
+  uint32_t _secondMs;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include "DistanceFilter.h"
+
+DistanceFilter::DistanceFilter()
+    : _config({2, 5, 60000}), _count(0), _next(0), _emaQ4(0), _hasValue(false),
+      _published(0), _publishedMs(0), _hasPublished(false)
+{
+}
+
+void DistanceFilter::begin(const DistanceFilterConfig &config)
+{
+  *this = DistanceFilter();
+  _config = config;
+}
+
+uint16_t DistanceFilter::median() const
+{
+  // Insertion sort of a copy; the window is tiny
+  uint16_t sorted[DISTANCE_MEDIAN_WINDOW];
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    uint16_t v = _window[i];
+    uint8_t j = i;
+    for (; j > 0 && sorted[j - 1] > v; j--)
+    {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = v;
+  }
+  return sorted[_count / 2];
+}
+
+uint16_t DistanceFilter::update(uint16_t cm)
+{
+  _window[_next] = cm;
+  _next = (_next + 1) % DISTANCE_MEDIAN_WINDOW;
+  if (_count < DISTANCE_MEDIAN_WINDOW)
+  {
+    _count++;
+  }
+
+  int32_t medianQ4 = (int32_t)median() << 4;
+  if (!_hasValue)
+  {
+    _emaQ4 = medianQ4;
+    _hasValue = true;
+  }
+  else
+  {
+    _emaQ4 += (medianQ4 - _emaQ4) >> _config.emaShift;
+  }
+  return value();
+}
+
+bool DistanceFilter::publishDue(uint32_t nowMs) const
+{
+  if (!_hasValue)
+  {
+    return false;
+  }
+
+  uint16_t current = value();
+  uint16_t change = current > _published ? current - _published : _published - current;
+  return !_hasPublished || change >= _config.deadbandCm || nowMs - _publishedMs >= _config.keepAliveMs;
+}
+
+void DistanceFilter::markPublished(uint32_t nowMs)
+{
+  _hasPublished = true;
+  _published = value();
+  _publishedMs = nowMs;
+}
@@ -0,0 +1,71 @@
+#ifndef DISTANCE_FILTER_H
+#define DISTANCE_FILTER_H
+
+#include <stdint.h>
+
+#define DISTANCE_MEDIAN_WINDOW 5 // Readings per median, odd
+
+/**
+ * @brief Tuning for DistanceFilter.
+ */
+struct DistanceFilterConfig
+{
+  uint8_t emaShift;     // EMA weight of a new median is 1 / 2^emaShift
+  uint16_t deadbandCm;  // Change needed before a new value is reported
+  uint32_t keepAliveMs; // Report at least this often, even without change
+};
+
+/**
+ * @brief Median, EMA and deadband stage for one ultrasonic sensor.
+ *
+ * A missed echo reads as the maximum distance. The median over the last
+ * DISTANCE_MEDIAN_WINDOW readings rejects such single outliers. The EMA
+ * then smooths the small jitter of real echoes. publishDue() decides
+ * whether the filtered value is worth sending.
+ */
+class DistanceFilter
+{
+public:
+  DistanceFilter();
+
+  void begin(const DistanceFilterConfig &config);
+
+  /**
+   * @brief Add a raw reading.
+   *
+   * @return The filtered distance in cm.
+   */
+  uint16_t update(uint16_t cm);
+
+  uint16_t value() const { return (uint16_t)((_emaQ4 + 8) >> 4); }
+
+  /**
+   * @brief Whether value() should be reported now.
+   *
+   * True on the first value, when it moved by at least the deadband since
+   * the last report, or when the keep-alive interval ran out. Only
+   * markPublished() counts as a report, so a value that could not be sent
+   * stays due.
+   */
+  bool publishDue(uint32_t nowMs) const;
+
+  /**
+   * @brief Record that value() was sent at `nowMs`.
+   */
+  void markPublished(uint32_t nowMs);
+
+private:
+  uint16_t median() const;
+
+  DistanceFilterConfig _config;
+  uint16_t _window[DISTANCE_MEDIAN_WINDOW];
+  uint8_t _count;
+  uint8_t _next;
+  int32_t _emaQ4; // Filtered distance in 1/16 cm
+  bool _hasValue;
+  uint16_t _published;
+  uint32_t _publishedMs;
+  bool _hasPublished;
+};
+
+#endif
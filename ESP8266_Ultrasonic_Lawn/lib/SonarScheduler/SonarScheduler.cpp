@@ -0,0 +1,101 @@
+#include "SonarScheduler.h"
+
+SonarScheduler *SonarScheduler::_running = nullptr;
+
+SonarScheduler::SonarScheduler()
+    : _count(0), _config({0, 1, 0}), _onSample(nullptr), _active(-1), _echoCm(0), _echoReceived(false),
+      _state(SLOT_IDLE), _roundStartMs(0), _slotStartMs(0), _started(false), _rounds(0)
+{
+}
+
+bool SonarScheduler::begin(NewPingESP8266 *const *sensors, uint8_t count, const SonarSchedulerConfig &config,
+                           SonarSampleCallback onSample)
+{
+  if (count == 0 || count > SONAR_MAX_SENSORS)
+  {
+    return false;
+  }
+  for (uint8_t i = 0; i < count; i++)
+  {
+    _sensors[i] = sensors[i];
+  }
+  _count = count;
+  _config = config;
+  _onSample = onSample;
+  _active = -1;
+  _state = SLOT_IDLE;
+  _started = false;
+  _rounds = 0;
+  _running = this;
+  return true;
+}
+
+bool SonarScheduler::service(uint32_t nowMs)
+{
+  switch (_state)
+  {
+  case SLOT_IDLE:
+    if (_count == 0 || (_started && nowMs - _roundStartMs < _config.intervalMs))
+    {
+      return false;
+    }
+    _started = true;
+    _roundStartMs = nowMs;
+    startPing(0, nowMs);
+    return false;
+
+  case SLOT_PINGING:
+    if (!_echoReceived && nowMs - _slotStartMs < _config.pingTimeoutMs)
+    {
+      return false;
+    }
+    _sensors[_active]->timer_stop();
+    if (_onSample != nullptr)
+    {
+      _onSample(_active, _echoCm);
+    }
+    _state = SLOT_GUARD;
+    _slotStartMs = nowMs;
+    return false;
+
+  case SLOT_GUARD:
+    if (nowMs - _slotStartMs < _config.guardMs)
+    {
+      return false;
+    }
+    if (_active + 1 < _count)
+    {
+      startPing(_active + 1, nowMs);
+      return false;
+    }
+    _active = -1;
+    _state = SLOT_IDLE;
+    _rounds++;
+    return true;
+  }
+  return false;
+}
+
+void SonarScheduler::startPing(int8_t sensor, uint32_t nowMs)
+{
+  _echoCm = 0;
+  _echoReceived = false;
+  _active = sensor;
+  _state = SLOT_PINGING;
+  _slotStartMs = nowMs;
+  _sensors[sensor]->ping_timer(echoCheck);
+}
+
+/**
+ * @brief Timer interrupt while a ping is in flight.
+ */
+void IRAM_ATTR SonarScheduler::echoCheck()
+{
+  SonarScheduler *scheduler = _running;
+  int8_t sensor = scheduler != nullptr ? scheduler->_active : -1;
+  if (sensor >= 0 && scheduler->_sensors[sensor]->check_timer())
+  {
+    scheduler->_echoCm = scheduler->_sensors[sensor]->ping_result / US_ROUNDTRIP_CM;
+    scheduler->_echoReceived = true;
+  }
+}
@@ -0,0 +1,87 @@
+#ifndef SONAR_SCHEDULER_H
+#define SONAR_SCHEDULER_H
+
+#include <Arduino.h>
+#include <NewPingESP8266.h>
+
+#define SONAR_MAX_SENSORS 8
+
+/**
+ * @brief Timing of a measurement round.
+ */
+struct SonarSchedulerConfig
+{
+  uint32_t intervalMs;    // Minimum time between round starts (0: back to back)
+  uint16_t pingTimeoutMs; // Slot length when no echo comes back
+  uint16_t guardMs;       // Silence after each slot for reflections to die out
+};
+
+/**
+ * @brief Called from service() with each completed reading, 0 cm for no echo.
+ */
+typedef void (*SonarSampleCallback)(uint8_t sensor, unsigned int cm);
+
+/**
+ * @brief Round-robin ping scheduler for an array of ultrasonic sensors.
+ *
+ * Sensors fire one at a time in table order. A slot ends when the echo
+ * timer interrupt catches the echo, or after pingTimeoutMs, and is followed
+ * by guardMs of silence, so a sensor never hears another one's ping. Near
+ * echoes end their slot early, so throughput adapts to the scene; the
+ * worst case is one reading per sensor every
+ * count * (pingTimeoutMs + guardMs).
+ *
+ * service() never waits on an echo. Only one scheduler can run, as the
+ * echo interrupt has no argument.
+ */
+class SonarScheduler
+{
+public:
+  SonarScheduler();
+
+  /**
+   * @return false if `count` is 0 or above SONAR_MAX_SENSORS.
+   */
+  bool begin(NewPingESP8266 *const *sensors, uint8_t count, const SonarSchedulerConfig &config,
+             SonarSampleCallback onSample);
+
+  /**
+   * @brief Advance the round: ping, guard, next sensor.
+   *
+   * @return true when the last sensor's guard time ended a round.
+   */
+  bool service(uint32_t nowMs);
+
+  bool idle() const { return _state == SLOT_IDLE; }
+  int8_t activeSensor() const { return _active; } // -1 between rounds
+  uint32_t roundStartMs() const { return _roundStartMs; }
+  uint32_t rounds() const { return _rounds; }
+
+private:
+  enum SlotState
+  {
+    SLOT_IDLE,    // Between rounds
+    SLOT_PINGING, // Waiting for the echo of _active
+    SLOT_GUARD    // Letting the echo decay before the next sensor fires
+  };
+
+  void startPing(int8_t sensor, uint32_t nowMs);
+  static void echoCheck();
+
+  static SonarScheduler *_running; // Target of the echo interrupt
+
+  NewPingESP8266 *_sensors[SONAR_MAX_SENSORS];
+  uint8_t _count;
+  SonarSchedulerConfig _config;
+  SonarSampleCallback _onSample;
+  volatile int8_t _active;        // Read by the echo interrupt
+  volatile unsigned int _echoCm;  // Set by the echo interrupt, 0 until an echo
+  volatile bool _echoReceived;
+  SlotState _state;
+  uint32_t _roundStartMs;
+  uint32_t _slotStartMs;
+  bool _started;
+  uint32_t _rounds;
+};
+
+#endif
@@ -2,17 +2,65 @@
 #include <NewPingESP8266.h>
 #include <ESP8266WiFi.h>
 #include <PubSubClient.h>
+#include <DistanceFilter.h>
+#include <CrossingDetector.h>
+#include <SonarScheduler.h>
+#include <TopicDispatch.h>
+#include <ConnectionManager.h>
+#include <sys/time.h>
 
 // -------------------------- Definitions --------------------------
 
-// Ultrasonic Sensor 1
-#define TRIGGER_PIN1 D0
-#define ECHO_PIN1 D1
+// Ultrasonic Sensors (pins and topics are listed in the sonar table below)
 #define MAX_DISTANCE 200 // Maximum distance (in cm) to ping
 
-// Ultrasonic Sensor 2
-#define TRIGGER_PIN2 D2
-#define ECHO_PIN2 D3
+// Sampling schedule, independent of how often MQTT is serviced.
+// Sensors fire one at a time; each slot lasts until the echo returns (at
+// most PING_TIMEOUT_MS) plus ECHO_GUARD_MS for reflections to die out, so
+// a sensor never hears another one's ping. With SAMPLE_INTERVAL_MS 0 the
+// array runs back to back, worst case 1 / (sensors * 32 ms) per sensor.
+#define SAMPLE_INTERVAL_MS 0 // Minimum time between measurement rounds (0: back to back)
+#define PING_TIMEOUT_MS (MAX_DISTANCE * US_ROUNDTRIP_CM / 1000 + 1)
+#define ECHO_GUARD_MS 20
+
+// Reporting: distances are median/EMA filtered and only published when
+// they move by DEADBAND_CM, or every KEEPALIVE_MS
+#define FILTER_EMA_SHIFT 2 // New median weighs 1/4
+#define DEADBAND_CM 5
+#define KEEPALIVE_MS 60000
+
+// Presence events from the first two sonars (outer, inner) placed across
+// a passage, a few tens of cm apart
+#define PRESENCE_THRESHOLD_CM 120 // Closer than this breaks a beam
+#define PRESENCE_HYSTERESIS_CM 20
+#define PRESENCE_BLOCK_DEBOUNCE 2 // Readings to break a beam
+#define PRESENCE_CLEAR_DEBOUNCE 4 // Readings to clear it, tolerates missed echoes
+#define CROSSING_WINDOW_MS 1500   // Max time from one beam to the other
+#define LOITER_MS 10000           // Beam broken this long without a crossing
+
+// Time source for event timestamps
+#define NTP_SERVER "pool.ntp.org"
+
+// Power-aware mode: the node samples one round per POWER_SAMPLE_INTERVAL_MS
+// and light-sleeps in between, with the modem only waking for beacons.
+// All messages of a round go out in one flush. LED commands are picked up
+// at least every COMMAND_MAX_LATENCY_MS. Presence events need POWER_SAVE 0.
+#define POWER_SAVE 0
+#define POWER_SAMPLE_INTERVAL_MS 2000
+#define COMMAND_MAX_LATENCY_MS 500
+#define BEACON_INTERVAL_MS 102 // Typical AP beacon interval (100 TU)
+#define POWER_ACTIVE_MA 80     // Current estimate while awake (radio on)
+#define POWER_SLEEP_MA 1       // ...and in light sleep
+#define PRESENCE_QUEUE_SIZE 4  // Events held until the end of the round or reconnect; more are dropped
+
+// Connection handling: failed attempts back off from NET_BACKOFF_MIN_MS to
+// NET_BACKOFF_MAX_MS with jitter, and a broker attempt never stalls the
+// sonar schedule for more than NET_CONNECT_TIMEOUT_MS
+#define NET_JOIN_TIMEOUT_MS 15000
+#define NET_CONNECT_TIMEOUT_MS 2000
+#define NET_BACKOFF_MIN_MS 1000
+#define NET_BACKOFF_MAX_MS 60000
+#define STATS_INTERVAL_MS 60000
 
 // WiFi Credentials
 #define WIFI_SSID "ConForNode1"
@@ -21,37 +69,92 @@
 // MQTT Broker Settings
 #define MQTT_SERVER "ec2-35-170-242-83.compute-1.amazonaws.com"
 #define MQTT_PORT 1883
+#define MQTT_BUFFER_SIZE 512 // lawn/stats does not fit the library's default 256
 
 // LED Pins
 const int led_pin[4] = {D4, D5, D6, D7};
 
 // MQTT Topics for LEDs
-const String Topic_To_Sub[4] = {
+constexpr const char *Topic_To_Sub[4] = {
     "lawn/light1",
     "lawn/light2",
     "lawn/light3",
     "lawn/light4",
 };
+constexpr TopicTable<4> ledTopics(Topic_To_Sub); // Topic -> LED index
 
-// MQTT Topics for Sensors
-const String Topic_Sonar1 = "lawn/ultrasonic1";
-const String Topic_Sonar2 = "lawn/ultrasonic2";
+// MQTT Topic for enter/exit/loiter events
+const String Topic_Presence = "lawn/presence";
+
+// MQTT Topic for node statistics
+const String Topic_Stats = "lawn/stats"; // Scheduler timing and sample rates
 
 // LED Status
 bool pinStatus[4] = {false, false, false, false};
 
 // -------------------------- Objects --------------------------
 
-NewPingESP8266 sonar1(TRIGGER_PIN1, ECHO_PIN1, MAX_DISTANCE);
-NewPingESP8266 sonar2(TRIGGER_PIN2, ECHO_PIN2, MAX_DISTANCE);
+struct Sonar
+{
+  NewPingESP8266 ping;
+  const char *topic;
+  unsigned long samples;          // Pings completed since the last stats report
+  DistanceFilter filter;
+  unsigned long published;        // Values published since boot
+};
+
+// Sonar table: add a line per sensor, in firing order. The first two
+// are the outer and inner presence beams.
+Sonar sonars[] = {
+    {NewPingESP8266(D0, D1, MAX_DISTANCE), "lawn/ultrasonic1"},
+    {NewPingESP8266(D2, D3, MAX_DISTANCE), "lawn/ultrasonic2"},
+};
+const int SONAR_NUM = sizeof(sonars) / sizeof(sonars[0]);
+static_assert(SONAR_NUM <= SONAR_MAX_SENSORS, "Raise SONAR_MAX_SENSORS for a larger sonar table");
+NewPingESP8266 *sonarPings[SONAR_NUM]; // Firing order for the scheduler
+
 WiFiClient espClient;
 PubSubClient client(espClient);
+ConnectionManager net(client, espClient);
+char clientId[24]; // Random per boot
+CrossingDetector presence({PRESENCE_THRESHOLD_CM, PRESENCE_HYSTERESIS_CM, PRESENCE_BLOCK_DEBOUNCE,
+                           PRESENCE_CLEAR_DEBOUNCE, CROSSING_WINDOW_MS, LOITER_MS});
+
+// -------------------------- Scheduler State --------------------------
+
+SonarScheduler scheduler;
+
+// Presence events waiting for the end-of-round flush, or for the broker
+// while offline
+struct QueuedPresence
+{
+  PresenceEvent event;
+  struct timeval time;
+};
+QueuedPresence presenceQueue[PRESENCE_QUEUE_SIZE];
+uint8_t presenceQueued = 0;
+
+// Time spent idle in light sleep, for the current estimate
+unsigned long sleepMs = 0;
+unsigned long samplesTotal = 0;
+
+// Longest time between two client.loop() calls, bounds LED command latency
+unsigned long lastServiceMicros = 0;
+unsigned long serviceGapMaxUs = 0;
+unsigned long lastStatsMillis = 0;
+unsigned long statsWindowStart = 0;
 
 // -------------------------- Function Prototypes --------------------------
 
-void setup_wifi();
-void reconnect();
+void onConnectionChange(ConnectionState state);
 void callback(char *topic, byte *payload, unsigned int length);
+void serviceSonars();
+void recordSample(uint8_t sensor, unsigned int cm);
+void publishDistances();
+void publishStats();
+bool publishPresence(const PresenceEvent &event, const struct timeval &time);
+void flushRound();
+void idleUntilNextRound();
 
 // -------------------------- Setup --------------------------
 
@@ -69,123 +172,319 @@ void setup()
     digitalWrite(led_pin[i], LOW); // Ensure LEDs are off initially
   }
 
-  // Connect to WiFi
-  setup_wifi();
-
-  // Setup MQTT
-  client.setServer(MQTT_SERVER, MQTT_PORT);
+  // Initialize distance filters and the ping schedule
+  for (int i = 0; i < SONAR_NUM; i++)
+  {
+    sonars[i].filter.begin({FILTER_EMA_SHIFT, DEADBAND_CM, KEEPALIVE_MS});
+    sonarPings[i] = &sonars[i].ping;
+  }
+#if POWER_SAVE
+  scheduler.begin(sonarPings, SONAR_NUM, {POWER_SAMPLE_INTERVAL_MS, PING_TIMEOUT_MS, ECHO_GUARD_MS}, recordSample);
+#else
+  scheduler.begin(sonarPings, SONAR_NUM, {SAMPLE_INTERVAL_MS, PING_TIMEOUT_MS, ECHO_GUARD_MS}, recordSample);
+#endif
+
+  // Setup MQTT; WiFi and the broker are brought up from loop()
+  snprintf(clientId, sizeof(clientId), "ESP8266Client-%lx", (unsigned long)random(0xffff));
   client.setCallback(callback);
+  client.setBufferSize(MQTT_BUFFER_SIZE);
+  net.setStateCallback(onConnectionChange);
+  net.begin({WIFI_SSID, WIFI_PASSWORD, MQTT_SERVER, MQTT_PORT, clientId, NET_JOIN_TIMEOUT_MS,
+             NET_CONNECT_TIMEOUT_MS, NET_BACKOFF_MIN_MS, NET_BACKOFF_MAX_MS});
+
+  // Wall clock for event timestamps, synchronised in the background
+  configTime(0, 0, NTP_SERVER);
+
+#if POWER_SAVE
+  // Stay associated but only listen to every n-th beacon while idle
+  int listenInterval = COMMAND_MAX_LATENCY_MS / BEACON_INTERVAL_MS;
+  listenInterval = constrain(listenInterval, 1, 10);
+  WiFi.setSleepMode(WIFI_LIGHT_SLEEP, listenInterval);
+#endif
 }
 
 // -------------------------- Main Loop --------------------------
 
 void loop()
 {
-  // Ensure WiFi is connected
-  if (WiFi.status() != WL_CONNECTED)
+  // Keep MQTT serviced on every pass; nothing below blocks
+  net.loop();
+
+  unsigned long now = micros();
+  if (lastServiceMicros != 0 && now - lastServiceMicros > serviceGapMaxUs)
   {
-    setup_wifi();
+    serviceGapMaxUs = now - lastServiceMicros;
   }
+  lastServiceMicros = now;
+
+  serviceSonars();
 
-  // Ensure MQTT is connected
-  if (!client.connected())
+  if (millis() - lastStatsMillis >= STATS_INTERVAL_MS)
   {
-    reconnect();
+    lastStatsMillis = millis();
+    publishStats();
   }
 
-  // Process MQTT client
-  client.loop();
+#if POWER_SAVE
+  idleUntilNextRound();
+#endif
+}
 
-  // Read distance from Sonar1
-  unsigned int distance1 = sonar1.ping_cm();
-  if (distance1 == 0)
-    distance1 = MAX_DISTANCE; // If no echo, set to MAX_DISTANCE
-  Serial.print("Sonar1 Distance: ");
-  Serial.print(distance1);
-  Serial.println(" cm");
-  client.publish(Topic_Sonar1.c_str(), String(distance1).c_str(), true); // Retained message
+/**
+ * @brief Sleep until the next round or the command latency bound, whichever is first.
+ *
+ * delay() lets the core enter light sleep when WIFI_LIGHT_SLEEP is set.
+ */
+void idleUntilNextRound()
+{
+  if (!scheduler.idle())
+  {
+    return;
+  }
 
-  // Read distance from Sonar2
-  unsigned int distance2 = sonar2.ping_cm();
-  if (distance2 == 0)
-    distance2 = MAX_DISTANCE; // If no echo, set to MAX_DISTANCE
-  Serial.print("Sonar2 Distance: ");
-  Serial.print(distance2);
-  Serial.println(" cm");
-  client.publish(Topic_Sonar2.c_str(), String(distance2).c_str(), true); // Retained message
+  unsigned long sinceRound = millis() - scheduler.roundStartMs();
+  if (sinceRound >= POWER_SAMPLE_INTERVAL_MS)
+  {
+    return;
+  }
+  unsigned long idle = POWER_SAMPLE_INTERVAL_MS - sinceRound;
+  if (idle > COMMAND_MAX_LATENCY_MS)
+  {
+    idle = COMMAND_MAX_LATENCY_MS;
+  }
 
-  // Delay between measurements
-  delay(2000); // 2 seconds
+  delay(idle);
+  sleepMs += idle;
 }
 
-// -------------------------- WiFi Setup Function --------------------------
+// -------------------------- Sonar Scheduler --------------------------
 
-void setup_wifi()
+/**
+ * @brief Advance the measurement round without waiting on any echo.
+ *
+ * The scheduler's timer interrupt catches the echo; recordSample() gets
+ * each reading and the round is flushed once the last sensor's guard time
+ * is over.
+ */
+void serviceSonars()
 {
-  delay(10);
-  Serial.println();
-  Serial.print("Connecting to ");
-  Serial.println(WIFI_SSID);
+  if (scheduler.service(millis()))
+  {
+    flushRound();
+  }
+}
 
-  // Begin WiFi connection
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+void recordSample(uint8_t sensor, unsigned int cm)
+{
+  // No echo means nothing in range; the median drops it if it is a lone miss
+  sonars[sensor].filter.update(cm == 0 ? MAX_DISTANCE : cm);
+  sonars[sensor].samples++;
+  samplesTotal++;
+
+  // Presence uses the raw readings, the filter would smear the crossing order
+  PresenceEvent event;
+  if (sensor <= CROSSING_INNER && presence.update(sensor, cm, millis(), event) &&
+      presenceQueued < PRESENCE_QUEUE_SIZE)
+  {
+    presenceQueue[presenceQueued].event = event;
+    gettimeofday(&presenceQueue[presenceQueued].time, nullptr);
+    presenceQueued++;
+  }
+}
 
-  // Wait until connected
-  while (WiFi.status() != WL_CONNECTED)
+/**
+ * @brief Send everything the round produced in one go.
+ *
+ * Presence events that cannot be published stay queued, in order, for a
+ * later round.
+ */
+void flushRound()
+{
+  uint8_t sent = 0;
+  while (sent < presenceQueued && publishPresence(presenceQueue[sent].event, presenceQueue[sent].time))
+  {
+    sent++;
+  }
+  for (uint8_t i = sent; i < presenceQueued; i++)
   {
-    delay(500);
-    Serial.print(".");
+    presenceQueue[i - sent] = presenceQueue[i];
   }
+  presenceQueued -= sent;
+  publishDistances();
+}
 
-  // Connected
-  Serial.println("");
-  Serial.println("WiFi connected");
-  Serial.print("IP address: ");
-  Serial.println(WiFi.localIP());
+/**
+ * @brief Publish the filtered distances that changed or are due for a keep-alive.
+ */
+void publishDistances()
+{
+  for (int i = 0; i < SONAR_NUM; i++)
+  {
+    if (!sonars[i].filter.publishDue(millis()))
+    {
+      continue;
+    }
+    unsigned int cm = sonars[i].filter.value();
+    if (!client.publish(sonars[i].topic, String(cm).c_str(), true)) // Retained message
+    {
+      continue; // Offline: stays due and goes out once the broker is back
+    }
+    sonars[i].filter.markPublished(millis());
+    sonars[i].published++;
+    Serial.print("Sonar");
+    Serial.print(i + 1);
+    Serial.print(" Distance: ");
+    Serial.print(cm);
+    Serial.println(" cm");
+  }
 }
 
-// -------------------------- MQTT Reconnect Function --------------------------
+/**
+ * @brief Publish an enter/exit/loiter event with its UTC time.
+ *
+ * "time" is 0 until NTP has synchronised.
+ *
+ * @return false if it could not be published.
+ */
+bool publishPresence(const PresenceEvent &event, const struct timeval &time)
+{
+  static const char *const names[] = {"enter", "exit", "loiter"};
+
+  bool synced = time.tv_sec > 1600000000; // Clock starts at 1970 until NTP answers
 
-void reconnect()
+  String payload = "{\"event\": \"";
+  payload += names[event.type];
+  payload += "\",\"time\": ";
+  if (synced)
+  {
+    char ms[5];
+    snprintf(ms, sizeof(ms), ".%03u", (unsigned)((time.tv_usec / 1000) % 1000));
+    payload += (unsigned long)time.tv_sec;
+    payload += ms;
+  }
+  else
+  {
+    payload += "0";
+  }
+  payload += ",\"durationMs\": ";
+  payload += event.durationMs;
+  payload += "}";
+
+  if (!client.publish(Topic_Presence.c_str(), payload.c_str()))
+  {
+    return false;
+  }
+  Serial.print("Presence: ");
+  Serial.println(payload);
+  return true;
+}
+
+/**
+ * @brief Publish scheduler timing, the sample rate each sensor achieved and
+ *        the estimated power cost.
+ */
+void publishStats()
 {
-  // Loop until reconnected
-  while (!client.connected())
+  String payload = "{\"serviceGapMaxUs\": ";
+  payload += serviceGapMaxUs;
+  payload += ",\"rounds\": ";
+  payload += scheduler.rounds();
+
+  // Samples per second per sensor over the window since the last report
+  unsigned long now = millis();
+  unsigned long elapsed = now - statsWindowStart;
+  payload += ",\"rateHz\": [";
+  for (int i = 0; i < SONAR_NUM; i++)
+  {
+    if (i > 0)
+      payload += ",";
+    payload += String(elapsed > 0 ? sonars[i].samples * 1000.0f / elapsed : 0.0f, 2);
+    sonars[i].samples = 0;
+  }
+  payload += "],\"published\": [";
+  for (int i = 0; i < SONAR_NUM; i++)
   {
-    Serial.print("Attempting MQTT connection...");
+    if (i > 0)
+      payload += ",";
+    payload += sonars[i].published;
+  }
+  payload += "]";
+
+  // Current estimated from the time spent awake versus in light sleep,
+  // weighted with POWER_ACTIVE_MA and POWER_SLEEP_MA; nothing is measured
+  unsigned long asleep = sleepMs < elapsed ? sleepMs : elapsed;
+  float estCurrentMa = elapsed > 0 ? (POWER_ACTIVE_MA * (float)(elapsed - asleep) + POWER_SLEEP_MA * (float)asleep) / elapsed : 0.0f;
+  payload += ",\"awakePct\": ";
+  payload += String(elapsed > 0 ? 100.0f * (elapsed - asleep) / elapsed : 0.0f, 1);
+  payload += ",\"estCurrentMa\": ";
+  payload += String(estCurrentMa, 2);
+  payload += ",\"estMAsPerSample\": ";
+  payload += String(samplesTotal > 0 ? estCurrentMa * elapsed / 1000.0f / samplesTotal : 0.0f, 3);
+  payload += ",\"commandLatencyMaxMs\": ";
+  payload += serviceGapMaxUs / 1000;
+
+  // Time the connection manager held up the loop, time offline, and how
+  // fast the last join was (fastJoin: straight to the cached AP and lease)
+  ConnectionStats netStats = net.takeStats();
+  payload += ",\"netBlockedMs\": ";
+  payload += netStats.blockedMs;
+  payload += ",\"netBlockedMaxMs\": ";
+  payload += netStats.blockedMaxMs;
+  payload += ",\"netBlockedMsPerHour\": ";
+  payload += netStats.blockedMsPerHour();
+  payload += ",\"netOfflineMs\": ";
+  payload += netStats.offlineMs;
+  payload += ",\"wifiJoinMs\": ";
+  payload += net.lastJoinMs();
+  payload += ",\"fastJoin\": ";
+  payload += net.lastJoinFast() ? "true" : "false";
+  payload += ",\"bootToOnlineMs\": ";
+  payload += net.bootToOnlineMs();
+  payload += "}";
+  statsWindowStart = now;
+  sleepMs = 0;
+  samplesTotal = 0;
+
+  client.publish(Topic_Stats.c_str(), payload.c_str());
+  serviceGapMaxUs = 0;
+}
 
-    // Create a random client ID
-    String clientId = "ESP8266Client-";
-    clientId += String(random(0xffff), HEX);
+// -------------------------- Connection Events --------------------------
 
-    // Attempt to connect
-    if (client.connect(clientId.c_str()))
+void onConnectionChange(ConnectionState state)
+{
+  switch (state)
+  {
+  case NET_WIFI_JOINING:
+    Serial.print("Connecting to ");
+    Serial.println(WIFI_SSID);
+    break;
+  case NET_MQTT_DOWN:
+    Serial.print("WiFi up, IP address ");
+    Serial.print(WiFi.localIP());
+    Serial.println(", connecting to MQTT");
+    break;
+  case NET_ONLINE:
+    Serial.println("MQTT connected");
+
+    // Subscribe to LED control topics
+    for (int i = 0; i < 4; i++)
     {
-      Serial.println("connected");
-
-      // Subscribe to LED control topics
-      for (int i = 0; i < 4; i++)
+      if (client.subscribe(Topic_To_Sub[i]))
       {
-        if (client.subscribe(Topic_To_Sub[i].c_str()))
-        {
-          Serial.print("Subscribed to ");
-          Serial.println(Topic_To_Sub[i]);
-        }
-        else
-        {
-          Serial.print("Failed to subscribe to ");
-          Serial.println(Topic_To_Sub[i]);
-        }
+        Serial.print("Subscribed to ");
+        Serial.println(Topic_To_Sub[i]);
+      }
+      else
+      {
+        Serial.print("Failed to subscribe to ");
+        Serial.println(Topic_To_Sub[i]);
       }
     }
-    else
-    {
-      Serial.print("failed, rc=");
-      Serial.print(client.state());
-      Serial.println(" try again in 5 seconds");
-
-      // Wait before retrying
-      delay(5000);
-    }
+    break;
+  case NET_WIFI_DOWN:
+    Serial.println("WiFi down, retrying with backoff");
+    break;
   }
 }
 
@@ -196,41 +495,27 @@ void callback(char *topic, byte *payload, unsigned int length)
   Serial.print("Message arrived [");
   Serial.print(topic);
   Serial.print("] ");
+  Serial.write(payload, length);
+  Serial.println();
 
-  // Convert payload to String
-  String message;
-  for (unsigned int i = 0; i < length; i++)
+  // Determine which LED to control
+  int i = ledTopics.find(topic);
+  if (i < 0)
   {
-    message += (char)payload[i];
+    return;
   }
-  Serial.println(message);
 
-  // Determine which LED to control
-  for (int i = 0; i < 4; i++)
+  bool on;
+  if (!parsePayloadBool(payload, length, on))
   {
-    if (String(topic) == Topic_To_Sub[i])
-    {
-      if (message == "1")
-      {
-        digitalWrite(led_pin[i], HIGH);
-        pinStatus[i] = true;
-        Serial.print("LED ");
-        Serial.print(i + 1);
-        Serial.println(" turned ON");
-      }
-      else if (message == "0")
-      {
-        digitalWrite(led_pin[i], LOW);
-        pinStatus[i] = false;
-        Serial.print("LED ");
-        Serial.print(i + 1);
-        Serial.println(" turned OFF");
-      }
-      else
-      {
-        Serial.print("Unknown command for LED ");
-        Serial.println(i + 1);
-      }
-    }
+    Serial.print("Unknown command for LED ");
+    Serial.println(i + 1);
+    return;
   }
+
+  digitalWrite(led_pin[i], on ? HIGH : LOW);
+  pinStatus[i] = on;
+  Serial.print("LED ");
+  Serial.print(i + 1);
+  Serial.println(on ? " turned ON" : " turned OFF");
 }
@@ -0,0 +1,119 @@
+#include <Arduino.h>
+#include <NativeBroker.h>
+#include <NativeHooks.h>
+#include <NewPingESP8266.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <unity.h>
+
+// Command-to-GPIO latency: a lawn/lightN command is published on the
+// in-process broker at a random point of the sonar schedule and timed until
+// digitalWrite() sets the pin. The old loop() pinged both sensors and then
+// slept 2 s before servicing MQTT; with the echo timer the command only
+// waits for the next loop() pass, whatever the sensors are doing.
+
+#define COMMANDS 100
+#define MAX_LATENCY_MS 50 // Host loopback and scheduling, far below one sampling round
+
+static NativeBroker broker;
+static const uint8_t ledPins[4] = {D4, D5, D6, D7};
+static const char *ledTopics[4] = {"lawn/light1", "lawn/light2", "lawn/light3", "lawn/light4"};
+
+static uint8_t expectedPin;
+static int expectedLevel;
+
+static bool subscribed()
+{
+  return broker.subscribed("lawn/light1") && broker.subscribed("lawn/light4");
+}
+
+static bool pinSet()
+{
+  return nativeGetPinOutput(expectedPin) == expectedLevel;
+}
+
+/**
+ * @brief Send `COMMANDS` commands at random phases and report the latency.
+ *
+ * @return Worst latency in milliseconds.
+ */
+static double measure(const char *label)
+{
+  std::vector<double> latencies;
+  for (int i = 0; i < COMMANDS; i++)
+  {
+    // Land somewhere inside a ping slot or between rounds
+    nativeLoopUntil(nullptr, random(0, 60));
+
+    int led = random(0, 4);
+    expectedPin = ledPins[led];
+    expectedLevel = nativeGetPinOutput(expectedPin) == HIGH ? LOW : HIGH;
+    auto start = std::chrono::steady_clock::now();
+    broker.publish(ledTopics[led], expectedLevel == HIGH ? "1" : "0");
+    TEST_ASSERT_TRUE(nativeLoopUntil(pinSet, 2000));
+    latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  char text[160];
+  snprintf(text, sizeof(text), "%s: %d commands, median %.2f ms, p99 %.2f ms, max %.2f ms", label, COMMANDS,
+           latencies[COMMANDS / 2], latencies[COMMANDS * 99 / 100], latencies.back());
+  TEST_MESSAGE(text);
+  return latencies.back();
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_latency_with_echoes()
+{
+  NewPingESP8266::nativeSetDistance(D0, 80);
+  NewPingESP8266::nativeSetDistance(D2, 150);
+  TEST_ASSERT_TRUE(measure("echoes at 80/150 cm") < MAX_LATENCY_MS);
+}
+
+void test_latency_without_echoes()
+{
+  // Nothing in range: every slot runs to the full ping timeout
+  NewPingESP8266::nativeSetDistance(D0, 0);
+  NewPingESP8266::nativeSetDistance(D2, 0);
+  TEST_ASSERT_TRUE(measure("no echo") < MAX_LATENCY_MS);
+}
+
+void test_sampling_continues()
+{
+  // Commands do not hold up the sonars either
+  NewPingESP8266::nativeSetDistance(D0, 30);
+  broker.clear();
+  measure("sampling check");
+  TEST_ASSERT_GREATER_THAN(0, broker.count("lawn/ultrasonic1"));
+}
+
+int main()
+{
+  nativeSetConsoleOutput(false);
+  if (!broker.start())
+  {
+    return 1;
+  }
+  setenv("NATIVE_BROKER", "127.0.0.1", 1);
+  setenv("NATIVE_BROKER_PORT", String(broker.port()).c_str(), 1);
+  randomSeed(11);
+  setup();
+  if (!nativeLoopUntil(subscribed, 5000))
+  {
+    return 1;
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_latency_with_echoes);
+  RUN_TEST(test_latency_without_echoes);
+  RUN_TEST(test_sampling_continues);
+  return UNITY_END();
+}
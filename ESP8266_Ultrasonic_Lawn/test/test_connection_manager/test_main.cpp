@@ -0,0 +1,234 @@
+#include <Arduino.h>
+#include <ConnectionManager.h>
+#include <NativeBroker.h>
+#include <NativeHooks.h>
+#include <unity.h>
+
+// ConnectionManager against an in-process broker that is killed and
+// restarted. The manager is driven on its own, the way a firmware's
+// loop() calls it, and every call is timed: outages must not stall the
+// caller beyond one bounded connect attempt.
+
+#define CONNECT_TIMEOUT_MS 500
+#define BACKOFF_MIN_MS 100
+#define BACKOFF_MAX_MS 1000
+
+static NativeBroker broker;
+static WiFiClient wifiClient;
+static PubSubClient mqtt(wifiClient);
+static ConnectionManager *net;
+static uint32_t onlineEvents;
+static uint32_t loopMaxUs;
+
+static void onState(ConnectionState state)
+{
+  if (state == NET_ONLINE)
+  {
+    onlineEvents++;
+    mqtt.subscribe("test/command");
+  }
+}
+
+static ConnectionConfig config()
+{
+  return {"TestAP", "password", "127.0.0.1", 1883, "cm-test", 2000, CONNECT_TIMEOUT_MS,
+          BACKOFF_MIN_MS, BACKOFF_MAX_MS};
+}
+
+/**
+ * @brief Call loop() until `done` or `timeoutMs`, tracking the longest call.
+ *
+ * With `done` null it runs for the whole `timeoutMs`.
+ */
+static bool runUntil(bool (*done)(), unsigned long timeoutMs)
+{
+  unsigned long start = millis();
+  while (done == nullptr || !done())
+  {
+    if (millis() - start >= timeoutMs)
+    {
+      return done == nullptr;
+    }
+    unsigned long callStart = micros();
+    net->loop();
+    uint32_t elapsed = micros() - callStart;
+    loopMaxUs = elapsed > loopMaxUs ? elapsed : loopMaxUs;
+    delayMicroseconds(200);
+  }
+  return true;
+}
+
+static bool online()
+{
+  return net->connected() && broker.subscribed("test/command");
+}
+
+static bool offline()
+{
+  return !net->connected();
+}
+
+/**
+ * @brief Start a manager as setup() does after a reset.
+ *
+ * The fast-join cache lives in (emulated) RTC memory, so it carries over
+ * from the previous manager.
+ */
+static void boot()
+{
+  net = new ConnectionManager(mqtt, wifiClient);
+  net->setStateCallback(onState);
+  net->begin(config());
+  onlineEvents = 0;
+  loopMaxUs = 0;
+}
+
+static void shutdown()
+{
+  mqtt.disconnect();
+  delete net;
+}
+
+void setUp()
+{
+  if (!broker.running())
+  {
+    TEST_ASSERT_TRUE(broker.start());
+  }
+  boot();
+}
+
+void tearDown()
+{
+  shutdown();
+}
+
+void test_connects()
+{
+  TEST_ASSERT_TRUE(runUntil(online, 3000));
+  TEST_ASSERT_EQUAL_UINT32(1, onlineEvents);
+  TEST_ASSERT_EQUAL(NET_ONLINE, net->state());
+}
+
+void test_broker_killed_and_restarted()
+{
+  TEST_ASSERT_TRUE(runUntil(online, 3000));
+  net->takeStats();
+  uint32_t connectsBefore = broker.connects();
+
+  // The session drops; the caller keeps getting control while it retries
+  broker.stop();
+  TEST_ASSERT_TRUE(runUntil(offline, 2000));
+  loopMaxUs = 0;
+  runUntil(nullptr, 4000);
+  ConnectionStats down = net->takeStats();
+  TEST_ASSERT_FALSE(net->connected());
+  TEST_ASSERT_LESS_THAN_UINT32(CONNECT_TIMEOUT_MS * 1000UL, loopMaxUs);
+
+  // Backed off: far fewer attempts than one per loop pass, but still trying
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(3, down.mqttAttempts);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(4000 / (BACKOFF_MIN_MS / 2), down.mqttAttempts);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(3900, down.offlineMs);
+
+  // Back within one maximum backoff of the restart, subscriptions included
+  TEST_ASSERT_TRUE(broker.start());
+  unsigned long restart = millis();
+  TEST_ASSERT_TRUE(runUntil(online, BACKOFF_MAX_MS + 1000));
+  uint32_t recoveryMs = millis() - restart;
+  TEST_ASSERT_EQUAL_UINT32(connectsBefore + 1, broker.connects());
+  TEST_ASSERT_EQUAL_UINT32(2, onlineEvents);
+
+  ConnectionStats up = net->takeStats();
+  char text[192];
+  snprintf(text, sizeof(text),
+           "outage: %lu broker attempts in 4 s, longest loop() %lu us, blocked %lu ms/h; back %lu ms after restart",
+           (unsigned long)down.mqttAttempts, (unsigned long)loopMaxUs, (unsigned long)down.blockedMsPerHour(),
+           (unsigned long)recoveryMs);
+  TEST_MESSAGE(text);
+  TEST_ASSERT_EQUAL_UINT32(1, up.connects);
+}
+
+void test_backoff_grows_and_caps()
+{
+  TEST_ASSERT_TRUE(runUntil(online, 3000));
+  broker.stop();
+  TEST_ASSERT_TRUE(runUntil(offline, 2000));
+
+  // Attempts thin out as the delay doubles towards BACKOFF_MAX_MS
+  net->takeStats();
+  runUntil(nullptr, 1000);
+  uint32_t early = net->takeStats().mqttAttempts;
+  runUntil(nullptr, 3000);
+  net->takeStats();
+  runUntil(nullptr, 6000);
+  uint32_t late = net->takeStats().mqttAttempts;
+  TEST_ASSERT_GREATER_THAN_UINT32(late, 6 * early); // Per second
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(6000 / (BACKOFF_MAX_MS / 2) + 1, late);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(6000 / BACKOFF_MAX_MS - 1, late);
+
+  TEST_ASSERT_TRUE(broker.start());
+  TEST_ASSERT_TRUE(runUntil(online, BACKOFF_MAX_MS + 1000));
+}
+
+void test_wifi_outage()
+{
+  TEST_ASSERT_TRUE(runUntil(online, 3000));
+  nativeSetWifiAvailable(false);
+  TEST_ASSERT_TRUE(runUntil(offline, 2000));
+  TEST_ASSERT_FALSE(net->wifiConnected());
+  runUntil(nullptr, 1000);
+  nativeSetWifiAvailable(true);
+  TEST_ASSERT_TRUE(runUntil(online, 2 * BACKOFF_MAX_MS + 3000));
+  TEST_ASSERT_LESS_THAN_UINT32(CONNECT_TIMEOUT_MS * 1000UL, loopMaxUs);
+}
+
+void test_fast_join_after_reset()
+{
+  // The earlier tests left a cache behind
+  TEST_ASSERT_TRUE(runUntil(online, 3000));
+  TEST_ASSERT_TRUE(net->lastJoinFast());
+}
+
+void test_stale_lease_rejoins_with_dhcp()
+{
+  TEST_ASSERT_TRUE(runUntil(online, 3000));
+
+  // Reset while the access point hands out a new address: the cached one
+  // associates but reaches neither DNS nor the broker
+  shutdown();
+  nativeSetDhcpAddress("127.0.0.2");
+  boot();
+  unsigned long start = millis();
+  TEST_ASSERT_TRUE(runUntil(online, 3000));
+  uint32_t recoveryMs = millis() - start;
+  TEST_ASSERT_FALSE(net->lastJoinFast());
+  TEST_ASSERT_LESS_THAN_UINT32(BACKOFF_MIN_MS, recoveryMs); // No backoff on the way
+  TEST_ASSERT_EQUAL_STRING("127.0.0.2", WiFi.localIP().toString().c_str());
+
+  // The new lease is cached for the next reset
+  shutdown();
+  boot();
+  TEST_ASSERT_TRUE(runUntil(online, 3000));
+  TEST_ASSERT_TRUE(net->lastJoinFast());
+  nativeSetDhcpAddress("127.0.0.1");
+}
+
+int main()
+{
+  nativeSetConsoleOutput(false);
+  if (!broker.start())
+  {
+    return 1;
+  }
+  setenv("NATIVE_BROKER", "127.0.0.1", 1);
+  setenv("NATIVE_BROKER_PORT", String(broker.port()).c_str(), 1);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_connects);
+  RUN_TEST(test_broker_killed_and_restarted);
+  RUN_TEST(test_backoff_grows_and_caps);
+  RUN_TEST(test_wifi_outage);
+  RUN_TEST(test_fast_join_after_reset);
+  RUN_TEST(test_stale_lease_rejoins_with_dhcp);
+  return UNITY_END();
+}
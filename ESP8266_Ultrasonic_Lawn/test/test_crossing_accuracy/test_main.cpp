@@ -0,0 +1,273 @@
+#include <Arduino.h>
+#include <CrossingDetector.h>
+#include <NewPingESP8266.h>
+#include <random>
+#include <vector>
+#include <unity.h>
+
+// CrossingDetector accuracy on synthetic crossing traces. A walker moves
+// along the passage through the outer and inner beams; the two sonars are
+// sampled on the firmware's slot schedule (echo or timeout, then the guard
+// time) on a simulated clock, with missed echoes and stray short readings.
+// Each scenario is scored against what the walker really did, and the same
+// traces are replayed at the old 2 s sampling period for comparison.
+//
+// The crossings that are still missed are brisk walks where a missed echo
+// splits the three or four readings a beam gets, so it never sees
+// PRESENCE_BLOCK_DEBOUNCE in a row.
+
+#define PRESENCE_THRESHOLD_CM 120 // PRESENCE_* etc. in src/main.cpp
+#define PRESENCE_HYSTERESIS_CM 20
+#define PRESENCE_BLOCK_DEBOUNCE 2
+#define PRESENCE_CLEAR_DEBOUNCE 4
+#define CROSSING_WINDOW_MS 1500
+#define LOITER_MS 10000
+#define PING_TIMEOUT_MS 12
+#define ECHO_GUARD_MS 20
+
+#define BEAM_SPACING_M 0.30 // Outer beam at 0, inner beam at this
+#define BODY_HALF_DEPTH_M 0.15
+#define MISSED_ECHO 0.05 // Chance a blocked beam reads no echo
+#define STRAY_ECHO 0.01  // Chance a clear beam reads a short distance
+#define TRACES 200
+
+/**
+ * @brief Walker position along the passage over time, in meters.
+ */
+struct Waypoint
+{
+  uint32_t ms;
+  double x;
+};
+
+struct Trace
+{
+  std::vector<Waypoint> path;
+  uint16_t acrossCm; // Walker's distance from the sonars
+};
+
+struct Score
+{
+  uint32_t traces;
+  uint32_t correct;         // Exactly the expected events
+  uint32_t falseEvents;     // Events beyond the expected ones
+  double durationErrorMs;   // Sum over enter/exit of |reported - true| transit time
+  uint32_t durationSamples;
+};
+
+static std::mt19937 rng;
+
+static double uniform(double low, double high)
+{
+  return std::uniform_real_distribution<double>(low, high)(rng);
+}
+
+static double positionAt(const Trace &trace, uint32_t ms)
+{
+  const std::vector<Waypoint> &p = trace.path;
+  if (ms <= p.front().ms)
+  {
+    return p.front().x;
+  }
+  for (size_t i = 1; i < p.size(); i++)
+  {
+    if (ms <= p[i].ms)
+    {
+      double t = (double)(ms - p[i - 1].ms) / (p[i].ms - p[i - 1].ms);
+      return p[i - 1].x + t * (p[i].x - p[i - 1].x);
+    }
+  }
+  return p.back().x;
+}
+
+static uint16_t reading(const Trace &trace, uint8_t sensor, uint32_t ms)
+{
+  double beam = sensor == CROSSING_OUTER ? 0.0 : BEAM_SPACING_M;
+  bool blocked = fabs(positionAt(trace, ms) - beam) < BODY_HALF_DEPTH_M;
+  if (blocked)
+  {
+    return uniform(0, 1) < MISSED_ECHO ? 0 : trace.acrossCm + (uint16_t)uniform(0, 4);
+  }
+  return uniform(0, 1) < STRAY_ECHO ? (uint16_t)uniform(30, 110) : 0; // Lawn beyond range
+}
+
+/**
+ * @brief First time the walker blocks `beam`, or 0 if never.
+ */
+static uint32_t firstBlockedMs(const Trace &trace, double beam)
+{
+  for (uint32_t ms = 0; ms <= trace.path.back().ms; ms++)
+  {
+    if (fabs(positionAt(trace, ms) - beam) < BODY_HALF_DEPTH_M)
+    {
+      return ms;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Sample both sonars on the slot schedule and collect the events.
+ *
+ * @param roundMs Minimum time between round starts (0: back to back).
+ */
+static std::vector<PresenceEvent> run(const Trace &trace, uint32_t roundMs)
+{
+  CrossingDetector detector({PRESENCE_THRESHOLD_CM, PRESENCE_HYSTERESIS_CM, PRESENCE_BLOCK_DEBOUNCE,
+                             PRESENCE_CLEAR_DEBOUNCE, CROSSING_WINDOW_MS, LOITER_MS});
+  std::vector<PresenceEvent> events;
+  uint32_t end = trace.path.back().ms + 2000; // Time for the beams to clear
+  uint32_t now = 0;
+  while (now < end)
+  {
+    uint32_t roundStart = now;
+    for (uint8_t sensor = CROSSING_OUTER; sensor <= CROSSING_INNER; sensor++)
+    {
+      uint16_t cm = reading(trace, sensor, now);
+      now += cm != 0 ? cm * US_ROUNDTRIP_CM / 1000 + 1 : PING_TIMEOUT_MS;
+      PresenceEvent event;
+      if (detector.update(sensor, cm, now, event))
+      {
+        events.push_back(event);
+      }
+      now += ECHO_GUARD_MS;
+    }
+    now = roundStart + roundMs > now ? roundStart + roundMs : now;
+  }
+  return events;
+}
+
+/**
+ * @brief A walk through both beams, outside to inside for an enter.
+ */
+static Trace crossing(bool enter)
+{
+  double speed = uniform(0.6, 1.8); // m/s
+  double from = enter ? -1.0 : 1.0 + BEAM_SPACING_M;
+  double to = enter ? 1.0 + BEAM_SPACING_M : -1.0;
+  uint32_t start = (uint32_t)uniform(0, 1000);
+  uint32_t walk = (uint32_t)(fabs(to - from) / speed * 1000);
+  return {{{0, from}, {start, from}, {start + walk, to}}, (uint16_t)uniform(40, 100)};
+}
+
+/**
+ * @brief Into the first beam only, a pause, and back out.
+ */
+static Trace turnBack(bool fromOutside, uint32_t pauseMs)
+{
+  double speed = uniform(0.6, 1.5);
+  double from = fromOutside ? -1.0 : 1.0 + BEAM_SPACING_M;
+  double turn = fromOutside ? 0.05 : BEAM_SPACING_M - 0.05;
+  uint32_t walk = (uint32_t)(fabs(turn - from) / speed * 1000);
+  return {{{0, from}, {walk, turn}, {walk + pauseMs, turn}, {2 * walk + pauseMs, from}},
+          (uint16_t)uniform(40, 100)};
+}
+
+static void score(Score &score, const Trace &trace, const std::vector<PresenceEvent> &events, bool expectEvent,
+                  PresenceEventType expected)
+{
+  score.traces++;
+  size_t wanted = expectEvent ? 1 : 0;
+  bool right = events.size() == wanted && (!expectEvent || events[0].type == expected);
+  score.correct += right ? 1 : 0;
+  score.falseEvents += events.size() > wanted ? events.size() - wanted : 0;
+  if (right && expected != PRESENCE_LOITER && expectEvent)
+  {
+    uint32_t outer = firstBlockedMs(trace, 0.0);
+    uint32_t inner = firstBlockedMs(trace, BEAM_SPACING_M);
+    double truth = fabs((double)inner - outer);
+    score.durationErrorMs += fabs(events[0].durationMs - truth);
+    score.durationSamples++;
+  }
+}
+
+static void report(const char *scenario, const Score &fast, const Score &slow)
+{
+  char text[192];
+  snprintf(text, sizeof(text), "%s: %lu/%lu correct, %lu false events, transit error %.0f ms | 2 s sampling: %lu/%lu",
+           scenario, (unsigned long)fast.correct, (unsigned long)fast.traces, (unsigned long)fast.falseEvents,
+           fast.durationSamples > 0 ? fast.durationErrorMs / fast.durationSamples : 0.0,
+           (unsigned long)slow.correct, (unsigned long)slow.traces);
+  TEST_MESSAGE(text);
+}
+
+static void scoreCrossings(bool enter)
+{
+  Score fast = Score(), slow = Score();
+  PresenceEventType expected = enter ? PRESENCE_ENTER : PRESENCE_EXIT;
+  for (int i = 0; i < TRACES; i++)
+  {
+    Trace trace = crossing(enter);
+    score(fast, trace, run(trace, 0), true, expected);
+    score(slow, trace, run(trace, 2000), true, expected);
+  }
+  report(enter ? "enter" : "exit", fast, slow);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(TRACES * 96 / 100, fast.correct);
+  TEST_ASSERT_EQUAL_UINT32(0, fast.falseEvents);
+  TEST_ASSERT_TRUE(fast.durationErrorMs / fast.durationSamples < 100.0);
+  TEST_ASSERT_LESS_THAN_UINT32(fast.correct / 2, slow.correct);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_enter()
+{
+  rng.seed(1);
+  scoreCrossings(true);
+}
+
+void test_exit()
+{
+  rng.seed(2);
+  scoreCrossings(false);
+}
+
+void test_turn_back()
+{
+  rng.seed(3);
+  Score fast = Score(), slow = Score();
+  for (int i = 0; i < TRACES; i++)
+  {
+    Trace trace = turnBack(i % 2 == 0, (uint32_t)uniform(0, 3000));
+    score(fast, trace, run(trace, 0), false, PRESENCE_ENTER);
+    score(slow, trace, run(trace, 2000), false, PRESENCE_ENTER);
+  }
+  report("turn back", fast, slow);
+  TEST_ASSERT_EQUAL_UINT32(TRACES, fast.correct);
+}
+
+void test_loiter()
+{
+  rng.seed(4);
+  Score fast = Score(), slow = Score();
+  for (int i = 0; i < TRACES / 10; i++)
+  {
+    Trace trace = turnBack(i % 2 == 0, LOITER_MS + (uint32_t)uniform(1000, 5000));
+    std::vector<PresenceEvent> events = run(trace, 0);
+    score(fast, trace, events, true, PRESENCE_LOITER);
+    score(slow, trace, run(trace, 2000), true, PRESENCE_LOITER);
+    if (events.size() == 1)
+    {
+      // Reported once LOITER_MS is up, not when the walker leaves
+      TEST_ASSERT_UINT32_WITHIN(200, LOITER_MS, events[0].durationMs);
+    }
+  }
+  report("loiter", fast, slow);
+  TEST_ASSERT_EQUAL_UINT32(fast.traces, fast.correct);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_enter);
+  RUN_TEST(test_exit);
+  RUN_TEST(test_turn_back);
+  RUN_TEST(test_loiter);
+  return UNITY_END();
+}
@@ -0,0 +1,173 @@
+#include <Arduino.h>
+#include <NativeBroker.h>
+#include <NativeHooks.h>
+#include <NewPingESP8266.h>
+#include <unity.h>
+
+// Host tests of the whole firmware, built by the native environment:
+//   pio test -e native
+// setup() runs once; each test drives loop() against an in-process broker
+// and checks what the node published and which pins it set.
+
+void publishStats();
+
+static NativeBroker broker;
+
+static bool subscribed()
+{
+  return broker.subscribed("lawn/light1") && broker.subscribed("lawn/light4");
+}
+
+static bool distancesPublished()
+{
+  return broker.count("lawn/ultrasonic1") > 0 && broker.count("lawn/ultrasonic2") > 0;
+}
+
+static bool led2On()
+{
+  return nativeGetPinOutput(D5) == HIGH;
+}
+
+static bool led2Off()
+{
+  return nativeGetPinOutput(D5) == LOW;
+}
+
+static bool statsPublished()
+{
+  return broker.count("lawn/stats") > 0;
+}
+
+void setUp()
+{
+  broker.clear();
+}
+
+void tearDown()
+{
+}
+
+void test_connects_and_subscribes()
+{
+  TEST_ASSERT_TRUE(nativeLoopUntil(subscribed, 5000));
+  TEST_ASSERT_EQUAL_UINT32(1, broker.connects());
+}
+
+void test_publishes_filtered_distances_retained()
+{
+  TEST_ASSERT_TRUE(nativeLoopUntil(distancesPublished, 5000));
+  TEST_ASSERT_EQUAL_STRING("80", broker.last("lawn/ultrasonic1").c_str());
+  TEST_ASSERT_EQUAL_STRING("150", broker.last("lawn/ultrasonic2").c_str());
+  TEST_ASSERT_TRUE(broker.messages()[0].retained);
+}
+
+void test_deadband_holds_back_small_moves()
+{
+  NewPingESP8266::nativeSetDistance(D0, 82);
+  nativeLoopUntil(nullptr, 1000);
+  TEST_ASSERT_EQUAL(0, broker.count("lawn/ultrasonic1"));
+
+  NewPingESP8266::nativeSetDistance(D0, 40);
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("lawn/ultrasonic1") > 0; }, 5000));
+}
+
+void test_led_command_drives_pin()
+{
+  broker.publish("lawn/light2", "1");
+  TEST_ASSERT_TRUE(nativeLoopUntil(led2On, 2000));
+  TEST_ASSERT_EQUAL(LOW, nativeGetPinOutput(D4));
+
+  broker.publish("lawn/light2", "0");
+  TEST_ASSERT_TRUE(nativeLoopUntil(led2Off, 2000));
+}
+
+void test_unknown_command_leaves_led()
+{
+  broker.publish("lawn/light2", "1");
+  TEST_ASSERT_TRUE(nativeLoopUntil(led2On, 2000));
+  broker.publish("lawn/light2", "on"); // Only "0" and "1" are commands
+  nativeLoopUntil(nullptr, 300);
+  TEST_ASSERT_EQUAL(HIGH, nativeGetPinOutput(D5));
+}
+
+void test_stats_report()
+{
+  publishStats();
+  TEST_ASSERT_TRUE(nativeLoopUntil(statsPublished, 1000));
+  std::string stats = broker.last("lawn/stats");
+  TEST_ASSERT_TRUE(stats.find("\"rounds\": ") != std::string::npos);
+  TEST_ASSERT_TRUE(stats.find("\"rateHz\": [") != std::string::npos);
+  TEST_ASSERT_TRUE(stats.find("\"fastJoin\": ") != std::string::npos);
+  TEST_ASSERT_TRUE(stats.find("\"estCurrentMa\": ") != std::string::npos);
+}
+
+void test_reconnects_after_broker_restart()
+{
+  broker.stop();
+  nativeLoopUntil(nullptr, 500);
+  TEST_ASSERT_TRUE(broker.start());
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.connects() == 2 && subscribed(); }, 10000));
+
+  // Commands work again on the new session
+  broker.publish("lawn/light2", "0");
+  TEST_ASSERT_TRUE(nativeLoopUntil(led2Off, 2000));
+}
+
+void test_distance_taken_offline_sent_on_reconnect()
+{
+  // The value changes while the broker is down; it must not count as sent
+  broker.stop();
+  NewPingESP8266::nativeSetDistance(D0, 170);
+  nativeLoopUntil(nullptr, 1500);
+  TEST_ASSERT_TRUE(broker.start());
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.connects() == 3 && subscribed(); }, 10000));
+
+  // Well before the keep-alive would resend it
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.last("lawn/ultrasonic1") == "170"; }, 3000));
+}
+
+void test_crossing_taken_offline_sent_on_reconnect()
+{
+  // Someone walks in, outer beam first, while the broker is down
+  broker.stop();
+  nativeLoopUntil(nullptr, 300);
+  NewPingESP8266::nativeSetDistance(D0, 50);
+  nativeLoopUntil(nullptr, 300);
+  NewPingESP8266::nativeSetDistance(D2, 50);
+  nativeLoopUntil(nullptr, 300);
+  NewPingESP8266::nativeSetDistance(D0, 170);
+  nativeLoopUntil(nullptr, 300);
+  NewPingESP8266::nativeSetDistance(D2, 170);
+  nativeLoopUntil(nullptr, 500);
+
+  TEST_ASSERT_TRUE(broker.start());
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("lawn/presence") > 0; }, 10000));
+  TEST_ASSERT_EQUAL(1, broker.count("lawn/presence"));
+  TEST_ASSERT_TRUE(broker.last("lawn/presence").find("\"event\": \"enter\"") != std::string::npos);
+}
+
+int main()
+{
+  nativeSetConsoleOutput(false);
+  if (!broker.start())
+  {
+    return 1;
+  }
+  setenv("NATIVE_BROKER", "127.0.0.1", 1);
+  setenv("NATIVE_BROKER_PORT", String(broker.port()).c_str(), 1);
+  NewPingESP8266::nativeSetDistance(D0, 80);
+  NewPingESP8266::nativeSetDistance(D2, 150);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_connects_and_subscribes);
+  RUN_TEST(test_publishes_filtered_distances_retained);
+  RUN_TEST(test_deadband_holds_back_small_moves);
+  RUN_TEST(test_led_command_drives_pin);
+  RUN_TEST(test_unknown_command_leaves_led);
+  RUN_TEST(test_stats_report);
+  RUN_TEST(test_reconnects_after_broker_restart);
+  RUN_TEST(test_distance_taken_offline_sent_on_reconnect);
+  RUN_TEST(test_crossing_taken_offline_sent_on_reconnect);
+  return UNITY_END();
+}
@@ -0,0 +1,151 @@
+#include <Arduino.h>
+#include <NativeHooks.h>
+#include <SonarScheduler.h>
+#include <unity.h>
+
+// Host simulation of the sonar array with 2, 4 and 8 sensors on the
+// firmware's schedule. Each run reports the rate every sensor achieved
+// against the worst case of count * (timeout + guard) per round, and
+// checks that slots never overlap: a sensor only fires once the previous
+// one's echo is in (or timed out) and the guard time has passed.
+
+#define MAX_DISTANCE 200 // As in src/main.cpp
+#define PING_TIMEOUT_MS (MAX_DISTANCE * US_ROUNDTRIP_CM / 1000 + 1)
+#define ECHO_GUARD_MS 20
+#define RUN_MS 4000
+#define FIRST_TRIGGER_PIN 20 // Host pins, clear of the board's
+
+static NewPingESP8266 *pings[SONAR_MAX_SENSORS];
+static uint32_t samples[SONAR_MAX_SENSORS];
+static uint32_t lastSampleMs;
+static int lastSensor;
+static uint32_t orderErrors;
+
+static void onSample(uint8_t sensor, unsigned int)
+{
+  samples[sensor]++;
+  lastSampleMs = millis();
+  orderErrors += (int)sensor != lastSensor ? 1 : 0;
+}
+
+/**
+ * @brief Run the array for RUN_MS with each sensor seeing `distanceCm(i)`.
+ *
+ * @return Lowest rate of any sensor in Hz.
+ */
+static float simulate(uint8_t count, unsigned int (*distanceCm)(uint8_t sensor), const char *scene)
+{
+  for (uint8_t i = 0; i < count; i++)
+  {
+    pings[i] = new NewPingESP8266(FIRST_TRIGGER_PIN + i, FIRST_TRIGGER_PIN + i, MAX_DISTANCE);
+    NewPingESP8266::nativeSetDistance(FIRST_TRIGGER_PIN + i, distanceCm(i));
+    samples[i] = 0;
+  }
+
+  SonarScheduler scheduler;
+  TEST_ASSERT_TRUE(scheduler.begin(pings, count, {0, PING_TIMEOUT_MS, ECHO_GUARD_MS}, onSample));
+  lastSampleMs = 0;
+  lastSensor = -1;
+  orderErrors = 0;
+  uint32_t guardViolations = 0;
+  int8_t active = -1;
+  uint32_t start = millis();
+  while (millis() - start < RUN_MS)
+  {
+    scheduler.service(millis());
+    if (scheduler.activeSensor() != active && scheduler.activeSensor() >= 0)
+    {
+      // A new slot: the previous sensor must have finished and settled.
+      // The sample is stamped up to 1 ms after the slot really ended.
+      int8_t next = scheduler.activeSensor();
+      guardViolations += lastSampleMs != 0 && millis() - lastSampleMs + 1 < ECHO_GUARD_MS ? 1 : 0;
+      lastSensor = next;
+      TEST_ASSERT_EQUAL(active < 0 ? 0 : active + 1, next);
+    }
+    active = scheduler.activeSensor();
+    nativeRunTickers();
+    delayMicroseconds(100);
+  }
+  uint32_t elapsed = millis() - start;
+  NewPingESP8266::timer_stop(); // A ping may still be in flight
+
+  float worstCaseHz = 1000.0f / (count * (PING_TIMEOUT_MS + ECHO_GUARD_MS));
+  float minHz = 1e9f;
+  char rates[96] = "";
+  for (uint8_t i = 0; i < count; i++)
+  {
+    float hz = samples[i] * 1000.0f / elapsed;
+    minHz = hz < minHz ? hz : minHz;
+    snprintf(rates + strlen(rates), sizeof(rates) - strlen(rates), "%s%.1f", i > 0 ? " " : "", hz);
+    delete pings[i];
+  }
+
+  char text[192];
+  snprintf(text, sizeof(text), "%u sensors, %s: %lu rounds, Hz per sensor [%s], worst case %.1f Hz", count, scene,
+           (unsigned long)scheduler.rounds(), rates, worstCaseHz);
+  TEST_MESSAGE(text);
+  TEST_ASSERT_EQUAL_UINT32(0, guardViolations);
+  TEST_ASSERT_EQUAL_UINT32(0, orderErrors);
+  TEST_ASSERT_TRUE(minHz >= 0.85f * worstCaseHz);
+  return minHz;
+}
+
+static unsigned int noEcho(uint8_t)
+{
+  return 0;
+}
+
+static unsigned int nearEcho(uint8_t)
+{
+  return 40;
+}
+
+static unsigned int mixedEcho(uint8_t sensor)
+{
+  return sensor % 2 == 0 ? 0 : 60 + sensor * 15;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_two_sensors()
+{
+  float worstHz = simulate(2, noEcho, "no echo");
+  TEST_ASSERT_TRUE(simulate(2, nearEcho, "echoes at 40 cm") > worstHz);
+}
+
+void test_four_sensors()
+{
+  float worstHz = simulate(4, noEcho, "no echo");
+  TEST_ASSERT_TRUE(simulate(4, mixedEcho, "mixed") > worstHz);
+}
+
+void test_eight_sensors()
+{
+  float worstHz = simulate(8, noEcho, "no echo");
+  TEST_ASSERT_TRUE(simulate(8, nearEcho, "echoes at 40 cm") > worstHz);
+  simulate(8, mixedEcho, "mixed");
+}
+
+void test_rejects_oversized_table()
+{
+  SonarScheduler scheduler;
+  TEST_ASSERT_FALSE(scheduler.begin(pings, 0, {0, PING_TIMEOUT_MS, ECHO_GUARD_MS}, onSample));
+  TEST_ASSERT_FALSE(scheduler.begin(pings, SONAR_MAX_SENSORS + 1, {0, PING_TIMEOUT_MS, ECHO_GUARD_MS}, onSample));
+}
+
+int main()
+{
+  nativeSetConsoleOutput(false);
+  UNITY_BEGIN();
+  RUN_TEST(test_two_sensors);
+  RUN_TEST(test_four_sensors);
+  RUN_TEST(test_eight_sensors);
+  RUN_TEST(test_rejects_oversized_table);
+  return UNITY_END();
+}
@@ -0,0 +1,253 @@
+#include <Arduino.h>
+#include <Geofence.h>
+#include <GpsFix.h>
+#include <GpsPayload.h>
+#include <TrackBatch.h>
+#include <NativeBench.h>
+
+// Host-only benchmark runner, built by the native_bench environment.
+// Prints JSON results; see NativeShim/NativeBench/NativeBench.h.
+
+#define BENCH_BATCH_FIXES 50 // GPS_BATCH_MAX_FIXES
+#define BENCH_BATCH_AGE_S 10 // GPS_BATCH_MAX_AGE_MS
+#define BENCH_ZONE_AREA_E7 2000000 // Zones spread over 0.2 degrees (~20 km) square
+#define BENCH_TRACK_FIXES 4096     // Fixes driven through the zones, replayed in a loop
+
+extern PubSubClient client;
+extern const char *mqtt_topic_gps;
+void callback(char *topic, byte *payload, unsigned int length);
+bool publishFix(const char *topic, const GpsFix &fix);
+void batchFix(const GpsFix &fix);
+void flushBatch();
+
+/**
+ * @brief The String-based serializer the firmware used before formatGpsPayload().
+ *
+ * Kept here as the baseline for the fixed-buffer path; reads the same
+ * fields as the old code took from TinyGPSPlus.
+ */
+static bool publishFixString(const char *topic, const GpsFix &fix)
+{
+  String payload = "";
+  payload += "{";
+  payload += "\"latitude\": " + String(fix.latE7 / 1e7, 6) + ",";
+  payload += "\"longitude\": " + String(fix.lngE7 / 1e7, 6) + ",";
+  payload += "\"altitude\": " + String(fix.altCm / 100.0) + ",";
+  payload += "\"satellites\": " + String(fix.satellites) + ",";
+  payload += "\"hdop\": " + String(fix.hdop / 100.0);
+  payload += "}";
+
+  Serial.print("Publishing GPS Data: ");
+  Serial.println(payload);
+
+  return client.publish(topic, payload.c_str());
+}
+
+/**
+ * @brief Next fix of a vehicle at ~10 m/s with receiver noise, `hz` fixes a second.
+ */
+static GpsFix nextTrackFix(GpsFix fix, uint32_t &seed, uint8_t hz)
+{
+  seed = seed * 1664525UL + 1013904223UL;
+  int32_t noise = (int32_t)(seed >> 28) - 8; // About +-1 m
+  fix.latE7 += 900 / hz + noise * 9;
+  fix.lngE7 += 100 / hz - noise * 5;
+  fix.altCm += noise;
+  fix.hdop = 85 + (seed >> 30);
+  fix.speedCms = 1000 + noise * 10;
+  fix.courseCd = 600 + noise * 20;
+  fix.timeMs += 1000 / hz;
+  if (fix.timeMs >= 1000)
+  {
+    fix.timeMs -= 1000;
+    fix.time++;
+  }
+  return fix;
+}
+
+/**
+ * @brief Spread `count` zones over the bench area: circles of 50-250 m and
+ * hexagons of 100-300 m.
+ *
+ * @return false if they did not fit in the engine's storage.
+ */
+static bool addBenchZones(GeofenceEngine &engine, uint16_t count)
+{
+  uint32_t seed = count;
+  for (uint16_t id = 0; id < count; id++)
+  {
+    seed = seed * 1664525UL + 1013904223UL;
+    int32_t latE7 = 306000000L + (int32_t)(seed % BENCH_ZONE_AREA_E7);
+    seed = seed * 1664525UL + 1013904223UL;
+    int32_t lngE7 = 766000000L + (int32_t)(seed % BENCH_ZONE_AREA_E7);
+    uint32_t sizeM = 50 + (seed >> 24) % 200;
+    if (id % 2 == 0)
+    {
+      engine.addCircle(id, latE7, lngE7, sizeM * 100);
+      continue;
+    }
+    int32_t lat[6];
+    int32_t lng[6];
+    for (uint8_t k = 0; k < 6; k++)
+    {
+      // ~90 m per 1e-3 degree here; close enough for a bench shape
+      lat[k] = latE7 + (int32_t)((sizeM + 50) * 90 * cosf(k * (float)M_PI / 3));
+      lng[k] = lngE7 + (int32_t)((sizeM + 50) * 105 * sinf(k * (float)M_PI / 3));
+    }
+    engine.addPolygon(id, lat, lng, 6);
+  }
+  if (!engine.build() || engine.zoneCount() != count)
+  {
+    fprintf(stderr, "geofence: %u of %u zones fit, see GEOFENCE_MAX_* in platformio.ini\n",
+            engine.zoneCount(), count);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief A drive at 15 m/s across the bench area, turning now and then.
+ */
+static void makeBenchTrack(GpsFix *track, size_t count)
+{
+  uint32_t seed = 7;
+  int32_t latE7 = 307000000L;
+  int32_t lngE7 = 767000000L;
+  int32_t stepLat = 1350; // ~15 m
+  int32_t stepLng = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    seed = seed * 1664525UL + 1013904223UL;
+    if (seed % 60 == 0)
+    {
+      int32_t turned = stepLat;
+      stepLat = (seed & 0x100) ? -stepLng : stepLng;
+      stepLng = (seed & 0x100) ? turned : -turned;
+    }
+    // Stay inside the zone area
+    if (latE7 + stepLat < 306000000L || latE7 + stepLat > 306000000L + BENCH_ZONE_AREA_E7)
+      stepLat = -stepLat;
+    if (lngE7 + stepLng < 766000000L || lngE7 + stepLng > 766000000L + BENCH_ZONE_AREA_E7)
+      stepLng = -stepLng;
+    latE7 += stepLat;
+    lngE7 += stepLng;
+
+    track[i] = GpsFix();
+    track[i].latE7 = latE7;
+    track[i].lngE7 = lngE7;
+    track[i].time = 1760000000UL + i;
+  }
+}
+
+// Each engine holds its zones in static arrays; too big for the stack
+static GeofenceEngine zones10(60000);
+static GeofenceEngine zones100(60000);
+static GeofenceEngine zones1000(60000);
+
+int main()
+{
+  NativeBench bench("GPS_NEO6");
+  BenchClient sink;
+  client.setBufferSize(1024); // As setup() does
+  bench.connect(client, sink);
+
+  GpsFix fix = {};
+  fix.latE7 = 306573420;
+  fix.lngE7 = 767853210;
+  fix.altCm = 35120;
+  fix.hdop = 92;
+  fix.satellites = 9;
+  fix.time = 1760000000;
+  fix.timeMs = 400;
+  fix.speedCms = 137;
+  fix.courseCd = 27450;
+  GpsFix filtered = fix;
+  filtered.flags = GPS_FIX_FILTERED;
+  filtered.velNCms = -12;
+  filtered.velECms = 135;
+
+  char payload[GPS_PAYLOAD_MAX_LEN];
+  bench.run("formatGpsPayload/raw", 200000, [&]() { formatGpsPayload(payload, sizeof(payload), fix); });
+  bench.run("formatGpsPayload/filtered", 200000, [&]() { formatGpsPayload(payload, sizeof(payload), filtered); });
+  bench.run("publishFix", 100000, [&]() { publishFix(mqtt_topic_gps, filtered); });
+
+  // Baseline: same fields through String temporaries
+  bench.run("publishFix/raw", 100000, [&]() { publishFix(mqtt_topic_gps, fix); });
+  bench.run("publishFix/string_baseline", 100000, [&]() { publishFixString(mqtt_topic_gps, fix); });
+
+  TrackBatchEncoder batch;
+  bench.run("trackBatch/frame", 10000, [&]() {
+    batch.reset();
+    GpsFix next = filtered;
+    for (uint8_t i = 0; i < BENCH_BATCH_FIXES; i++)
+    {
+      next.latE7 += 37;
+      next.lngE7 -= 21;
+      next.time++;
+      batch.add(next);
+    }
+  });
+
+  // Uplink cost per fix: JSON on gps/fix against frames on gps/batch. One
+  // op is one fix; a 1 Hz batch goes out on its age limit, a 5 Hz one
+  // when full.
+  uint32_t seed = 1;
+  GpsFix track = fix;
+  bench.run("uplink/json_1hz", 20000, [&]() {
+    track = nextTrackFix(track, seed, 1);
+    publishFix(mqtt_topic_gps, track);
+  });
+  bench.perMinute(60);
+
+  uint32_t fixes = 0;
+  bench.run("uplink/batch_1hz", 20000, [&]() {
+    track = nextTrackFix(track, seed, 1);
+    batchFix(track);
+    if (++fixes % BENCH_BATCH_AGE_S == 0)
+    {
+      flushBatch();
+    }
+  });
+  bench.perMinute(60);
+
+  flushBatch();
+  bench.run("uplink/batch_5hz", 20000, [&]() {
+    track = nextTrackFix(track, seed, 5);
+    batchFix(track);
+  });
+  bench.perMinute(300);
+
+  // Per-fix zone evaluation as the zone count grows; the grid index should
+  // keep it nearly flat
+  static GpsFix drive[BENCH_TRACK_FIXES];
+  makeBenchTrack(drive, BENCH_TRACK_FIXES);
+  GeofenceEvent events[GEOFENCE_MAX_EVENTS];
+  uint32_t step = 0;
+  if (addBenchZones(zones10, 10))
+  {
+    bench.run("geofence/10_zones", 200000, [&]() {
+      const GpsFix &at = drive[step++ % BENCH_TRACK_FIXES];
+      zones10.evaluate(at, step * 1000, events);
+    });
+  }
+  if (addBenchZones(zones100, 100))
+  {
+    bench.run("geofence/100_zones", 200000, [&]() {
+      const GpsFix &at = drive[step++ % BENCH_TRACK_FIXES];
+      zones100.evaluate(at, step * 1000, events);
+    });
+  }
+  if (addBenchZones(zones1000, 1000))
+  {
+    bench.run("geofence/1000_zones", 200000, [&]() {
+      const GpsFix &at = drive[step++ % BENCH_TRACK_FIXES];
+      zones1000.evaluate(at, step * 1000, events);
+    });
+  }
+
+  char topic[] = "gps/command";
+  byte command[] = "status";
+  bench.run("callback", 200000, [&]() { callback(topic, command, sizeof(command) - 1); });
+
+  return bench.finish();
+}
@@ -0,0 +1,294 @@
+#include "FixJournal.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ------------------- Record Encoding -------------------
+
+static uint16_t crc16(const uint8_t *data, size_t length)
+{
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static uint16_t recordCrc(const JournalRecord &record)
+{
+  return crc16((const uint8_t *)&record, offsetof(JournalRecord, crc));
+}
+
+// ------------------- FixJournal -------------------
+
+FixJournal::FixJournal(fs::FS &fs, const char *directory)
+    : _fs(fs), _directory(directory), _headSegment(0), _headRecords(0),
+      _tailSegment(0), _tailOffset(0), _pending(0), _unflushed(0),
+      _appended(0), _overwritten(0), _corrupted(0)
+{
+}
+
+void FixJournal::segmentPath(uint32_t segment, char *path) const
+{
+  snprintf(path, JOURNAL_PATH_MAX, "%s/%lu.bin", _directory, (unsigned long)segment);
+}
+
+uint32_t FixJournal::segmentRecords(uint32_t segment)
+{
+  if (segment == _headSegment)
+  {
+    return _headRecords;
+  }
+
+  char path[JOURNAL_PATH_MAX];
+  segmentPath(segment, path);
+  File file = _fs.open(path, "r");
+  if (!file)
+  {
+    return 0;
+  }
+  uint32_t records = file.size() / sizeof(JournalRecord);
+  file.close();
+  return records;
+}
+
+bool FixJournal::begin()
+{
+  if (!_fs.exists(_directory) && !_fs.mkdir(_directory))
+  {
+    return false;
+  }
+
+  // Find the range of segment numbers on flash
+  bool found = false;
+  uint32_t first = 0;
+  uint32_t last = 0;
+  File root = _fs.open(_directory);
+  File file = root.openNextFile();
+  while (file)
+  {
+    const char *name = file.name();
+    const char *slash = strrchr(name, '/');
+    if (slash != NULL)
+      name = slash + 1;
+
+    char *end;
+    uint32_t segment = strtoul(name, &end, 10);
+    if (end != name && strcmp(end, ".bin") == 0)
+    {
+      first = (!found || segment < first) ? segment : first;
+      last = (!found || segment > last) ? segment : last;
+      found = true;
+    }
+    file = root.openNextFile();
+  }
+  root.close();
+
+  // Restore the delivered position
+  char path[JOURNAL_PATH_MAX];
+  snprintf(path, JOURNAL_PATH_MAX, "%s/cursor", _directory);
+  File cursor = _fs.open(path, "r");
+  uint32_t saved[2] = {0, 0};
+  bool haveCursor = cursor && cursor.read((uint8_t *)saved, sizeof(saved)) == sizeof(saved);
+  if (cursor)
+    cursor.close();
+
+  _tailSegment = first;
+  _tailOffset = 0;
+  if (haveCursor && (!found || saved[0] >= first))
+  {
+    _tailSegment = saved[0];
+    _tailOffset = saved[1];
+  }
+
+  // Continue in a fresh segment rather than appending to a possibly torn one
+  _headSegment = found && last + 1 > _tailSegment ? last + 1 : _tailSegment;
+  _headRecords = 0;
+
+  // Remove delivered segments left behind by a reset and count the rest
+  _pending = 0;
+  for (uint32_t segment = first; found && segment <= last; segment++)
+  {
+    if (segment < _tailSegment)
+    {
+      segmentPath(segment, path);
+      _fs.remove(path);
+      continue;
+    }
+    _pending += segmentRecords(segment);
+  }
+  _pending = _pending > _tailOffset ? _pending - _tailOffset : 0;
+  return true;
+}
+
+bool FixJournal::openHead()
+{
+  char path[JOURNAL_PATH_MAX];
+  segmentPath(_headSegment, path);
+  _head = _fs.open(path, "a");
+  return (bool)_head;
+}
+
+void FixJournal::dropTail()
+{
+  uint32_t records = segmentRecords(_tailSegment);
+  uint32_t lost = records > _tailOffset ? records - _tailOffset : 0;
+
+  char path[JOURNAL_PATH_MAX];
+  segmentPath(_tailSegment, path);
+  _fs.remove(path);
+
+  _pending = _pending > lost ? _pending - lost : 0;
+  _overwritten += lost;
+  _tailSegment++;
+  _tailOffset = 0;
+  saveCursor();
+}
+
+bool FixJournal::append(const GpsFix &fix)
+{
+  if (_headRecords >= JOURNAL_SEGMENT_RECORDS)
+  {
+    // Roll over to the next segment, evicting the oldest if the ring is full
+    flush();
+    _head.close();
+    _headSegment++;
+    _headRecords = 0;
+    while (_headSegment - _tailSegment + 1 > JOURNAL_MAX_SEGMENTS)
+    {
+      dropTail();
+    }
+  }
+
+  if (!_head && !openHead())
+  {
+    return false;
+  }
+
+  JournalRecord record;
+  record.time = fix.time;
+  record.timeMs = fix.timeMs;
+  record.hdop = fix.hdop;
+  record.latE7 = fix.latE7;
+  record.lngE7 = fix.lngE7;
+  record.altCm = fix.altCm;
+  record.satellites = fix.satellites;
+  record.reserved = 0;
+  record.crc = recordCrc(record);
+
+  if (_head.write((const uint8_t *)&record, sizeof(record)) != sizeof(record))
+  {
+    return false;
+  }
+
+  _headRecords++;
+  _pending++;
+  _appended++;
+  if (++_unflushed >= JOURNAL_FLUSH_EVERY)
+  {
+    flush();
+  }
+  return true;
+}
+
+void FixJournal::flush()
+{
+  if (_head && _unflushed > 0)
+  {
+    _head.flush();
+  }
+  _unflushed = 0;
+}
+
+size_t FixJournal::read(GpsFix *fixes, size_t max, size_t &fixCount)
+{
+  // Make buffered appends visible to the reader
+  flush();
+
+  size_t records = 0;
+  fixCount = 0;
+  uint32_t segment = _tailSegment;
+  uint32_t offset = _tailOffset;
+
+  while (records < max && records < _pending && segment <= _headSegment)
+  {
+    char path[JOURNAL_PATH_MAX];
+    segmentPath(segment, path);
+    File file = _fs.open(path, "r");
+    if (file && file.seek(offset * sizeof(JournalRecord)))
+    {
+      JournalRecord record;
+      while (records < max && records < _pending &&
+             file.read((uint8_t *)&record, sizeof(record)) == sizeof(record))
+      {
+        records++;
+        if (record.crc != recordCrc(record))
+        {
+          _corrupted++;
+          continue;
+        }
+
+        // Speed, course and filter state are not journaled
+        GpsFix &fix = fixes[fixCount++];
+        fix = GpsFix();
+        fix.time = record.time;
+        fix.timeMs = record.timeMs;
+        fix.hdop = record.hdop;
+        fix.latE7 = record.latE7;
+        fix.lngE7 = record.lngE7;
+        fix.altCm = record.altCm;
+        fix.satellites = record.satellites;
+      }
+    }
+    if (file)
+      file.close();
+
+    segment++;
+    offset = 0;
+  }
+  return records;
+}
+
+void FixJournal::consume(size_t count)
+{
+  if (count > _pending)
+  {
+    count = _pending;
+  }
+  _pending -= count;
+  _tailOffset += count;
+
+  // Delete segments that have been fully delivered
+  while (_tailSegment < _headSegment)
+  {
+    uint32_t records = segmentRecords(_tailSegment);
+    if (_tailOffset < records)
+      break;
+
+    char path[JOURNAL_PATH_MAX];
+    segmentPath(_tailSegment, path);
+    _fs.remove(path);
+    _tailOffset -= records;
+    _tailSegment++;
+  }
+  saveCursor();
+}
+
+void FixJournal::saveCursor()
+{
+  char path[JOURNAL_PATH_MAX];
+  snprintf(path, JOURNAL_PATH_MAX, "%s/cursor", _directory);
+  File cursor = _fs.open(path, "w");
+  if (cursor)
+  {
+    uint32_t saved[2] = {_tailSegment, _tailOffset};
+    cursor.write((const uint8_t *)saved, sizeof(saved));
+    cursor.close();
+  }
+}
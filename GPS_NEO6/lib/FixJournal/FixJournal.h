@@ -0,0 +1,100 @@
+#ifndef FIX_JOURNAL_H
+#define FIX_JOURNAL_H
+
+#include <FS.h>
+#include <GpsFix.h>
+
+#define JOURNAL_SEGMENT_RECORDS 512 // Records per segment file (12 KB)
+#define JOURNAL_MAX_SEGMENTS 48     // Oldest segment is overwritten beyond this
+#define JOURNAL_FLUSH_EVERY 8       // Records buffered before a flash commit
+#define JOURNAL_PATH_MAX 32
+
+/**
+ * @brief Compact on-flash representation of a GpsFix.
+ */
+struct JournalRecord
+{
+  uint32_t time;
+  uint16_t timeMs;
+  uint16_t hdop;
+  int32_t latE7;
+  int32_t lngE7;
+  int32_t altCm;
+  uint8_t satellites;
+  uint8_t reserved;
+  uint16_t crc; // CRC-16/CCITT over the preceding bytes
+};
+
+/**
+ * @brief Append-only ring journal of GPS fixes on a flash filesystem.
+ *
+ * Records are appended to numbered segment files in a directory. Segment
+ * numbers only ever grow, so writes move across the filesystem instead of
+ * rewriting one file, and LittleFS spreads the blocks underneath. When
+ * JOURNAL_MAX_SEGMENTS is reached the oldest segment is deleted.
+ *
+ * Reading is two-phase: read() returns the oldest records without removing
+ * them and consume() drops them once they have been delivered, giving
+ * at-least-once delivery. The read position is persisted so a reboot does
+ * not replay delivered fixes.
+ */
+class FixJournal
+{
+public:
+  FixJournal(fs::FS &fs, const char *directory = "/journal");
+
+  /**
+   * @brief Recover segment numbers and the read position from flash.
+   */
+  bool begin();
+
+  bool append(const GpsFix &fix);
+
+  /**
+   * @brief Scan up to `max` of the oldest pending records.
+   *
+   * Valid records are copied to `fixes` and counted in `fixCount`; records
+   * failing their CRC are skipped.
+   *
+   * @return Number of records scanned, to be passed to consume().
+   */
+  size_t read(GpsFix *fixes, size_t max, size_t &fixCount);
+
+  /**
+   * @brief Drop `count` records previously scanned by read().
+   */
+  void consume(size_t count);
+
+  /**
+   * @brief Commit buffered appends to flash.
+   */
+  void flush();
+
+  uint32_t pending() const { return _pending; }
+  uint32_t capacity() const { return (uint32_t)JOURNAL_SEGMENT_RECORDS * JOURNAL_MAX_SEGMENTS; }
+  uint32_t appended() const { return _appended; }
+  uint32_t overwritten() const { return _overwritten; } // Lost to the ring wrapping
+  uint32_t corrupted() const { return _corrupted; }     // Skipped on CRC mismatch
+
+private:
+  void segmentPath(uint32_t segment, char *path) const;
+  uint32_t segmentRecords(uint32_t segment);
+  bool openHead();
+  void dropTail();
+  void saveCursor();
+
+  fs::FS &_fs;
+  const char *_directory;
+  File _head;
+  uint32_t _headSegment;   // Segment currently appended to
+  uint32_t _headRecords;   // Records in the head segment
+  uint32_t _tailSegment;   // Oldest segment with undelivered records
+  uint32_t _tailOffset;    // Records already delivered from the tail segment
+  uint32_t _pending;
+  uint32_t _unflushed;
+  uint32_t _appended;
+  uint32_t _overwritten;
+  uint32_t _corrupted;
+};
+
+#endif
@@ -0,0 +1,489 @@
+#include "Geofence.h"
+#include <math.h>
+
+// Centimeters per 1e-7 degree of latitude, in Q16
+#define GEOFENCE_LAT_SCALE_Q16 72955
+
+// ------------------- Text Parsing -------------------
+
+static void skipSpaces(const char *&p)
+{
+  while (*p == ' ' || *p == '\t')
+  {
+    p++;
+  }
+}
+
+static bool atEnd(const char *p)
+{
+  skipSpaces(p);
+  return *p == '\0' || *p == '\r' || *p == '\n' || *p == '#';
+}
+
+static bool matchWord(const char *&p, const char *word)
+{
+  skipSpaces(p);
+  const char *q = p;
+  while (*word != '\0')
+  {
+    if (*q++ != *word++)
+    {
+      return false;
+    }
+  }
+  if (*q != '\0' && *q != ' ' && *q != '\t' && *q != '\r' && *q != '\n')
+  {
+    return false;
+  }
+  p = q;
+  return true;
+}
+
+static bool parseUnsigned(const char *&p, uint32_t &value)
+{
+  skipSpaces(p);
+  if (*p < '0' || *p > '9')
+  {
+    return false;
+  }
+  value = 0;
+  while (*p >= '0' && *p <= '9')
+  {
+    value = value * 10 + (uint32_t)(*p++ - '0');
+  }
+  return true;
+}
+
+/**
+ * @brief Parse decimal degrees ("-12.3456789") into 1e-7 degrees without floats.
+ */
+static bool parseDegrees(const char *&p, int32_t &valueE7)
+{
+  skipSpaces(p);
+  bool negative = *p == '-';
+  if (*p == '-' || *p == '+')
+  {
+    p++;
+  }
+
+  uint32_t degrees;
+  if (!parseUnsigned(p, degrees) || degrees > 180)
+  {
+    return false;
+  }
+
+  uint32_t fraction = 0;
+  uint32_t scale = 10000000UL;
+  if (*p == '.')
+  {
+    p++;
+    while (*p >= '0' && *p <= '9')
+    {
+      // Digits beyond 1e-7 degrees (~1 cm) are ignored
+      if (scale > 1)
+      {
+        scale /= 10;
+        fraction += (uint32_t)(*p - '0') * scale;
+      }
+      p++;
+    }
+  }
+
+  int32_t magnitude = (int32_t)(degrees * 10000000UL + fraction);
+  valueE7 = negative ? -magnitude : magnitude;
+  return true;
+}
+
+// ------------------- Zone Definition -------------------
+
+GeofenceEngine::GeofenceEngine(uint32_t dwellMs)
+    : _dwellMs(dwellMs), _zoneCount(0), _vertexCount(0),
+      _gridMinLat(0), _gridMinLng(0), _cellLat(1), _cellLng(1), _built(false),
+      _insideCount(0), _stamp(0), _parsingPolygon(false), _parsingId(0), _parsingFirstVertex(0)
+{
+}
+
+GeofenceEngine::Zone *GeofenceEngine::newZone(uint16_t id, ZoneType type)
+{
+  if (_zoneCount >= GEOFENCE_MAX_ZONES)
+  {
+    return nullptr;
+  }
+
+  Zone &zone = _zones[_zoneCount++];
+  zone = Zone();
+  zone.id = id;
+  zone.type = type;
+  _built = false;
+  return &zone;
+}
+
+bool GeofenceEngine::addCircle(uint16_t id, int32_t latE7, int32_t lngE7, uint32_t radiusCm)
+{
+  if (_vertexCount >= GEOFENCE_MAX_VERTICES || radiusCm == 0)
+  {
+    return false;
+  }
+  Zone *zone = newZone(id, ZONE_CIRCLE);
+  if (zone == nullptr)
+  {
+    return false;
+  }
+
+  // Longitude lines converge towards the poles, computed once per zone
+  float cosLat = cosf((float)latE7 * 1e-7f * (float)M_PI / 180.0f);
+  int32_t lngScale = (int32_t)(GEOFENCE_LAT_SCALE_Q16 * cosLat);
+  zone->lngScaleQ16 = lngScale > 0 ? lngScale : 1;
+  zone->radiusCm = radiusCm;
+  zone->firstVertex = _vertexCount;
+  zone->vertexCount = 1;
+  _vertexLat[_vertexCount] = latE7;
+  _vertexLng[_vertexCount] = lngE7;
+  _vertexCount++;
+
+  int64_t spanLat = ((int64_t)radiusCm << 16) / GEOFENCE_LAT_SCALE_Q16 + 1;
+  int64_t spanLng = ((int64_t)radiusCm << 16) / zone->lngScaleQ16 + 1;
+  zone->minLat = (int32_t)(latE7 - spanLat);
+  zone->maxLat = (int32_t)(latE7 + spanLat);
+  zone->minLng = (int32_t)(lngE7 - spanLng < -1800000000LL ? -1800000000LL : lngE7 - spanLng);
+  zone->maxLng = (int32_t)(lngE7 + spanLng > 1800000000LL ? 1800000000LL : lngE7 + spanLng);
+  return true;
+}
+
+bool GeofenceEngine::addPolygon(uint16_t id, const int32_t *latE7, const int32_t *lngE7, uint16_t count)
+{
+  if (count < 3 || (uint32_t)_vertexCount + count > GEOFENCE_MAX_VERTICES)
+  {
+    return false;
+  }
+
+  uint16_t first = _vertexCount;
+  for (uint16_t i = 0; i < count; i++)
+  {
+    _vertexLat[first + i] = latE7[i];
+    _vertexLng[first + i] = lngE7[i];
+  }
+  _vertexCount += count;
+
+  if (!finishPolygon(id, first, count))
+  {
+    _vertexCount = first;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Create a polygon zone from vertices already stored at `firstVertex`.
+ */
+bool GeofenceEngine::finishPolygon(uint16_t id, uint16_t firstVertex, uint16_t count)
+{
+  if (count < 3)
+  {
+    return false;
+  }
+  Zone *zone = newZone(id, ZONE_POLYGON);
+  if (zone == nullptr)
+  {
+    return false;
+  }
+
+  zone->firstVertex = firstVertex;
+  zone->vertexCount = count;
+  zone->minLat = zone->maxLat = _vertexLat[firstVertex];
+  zone->minLng = zone->maxLng = _vertexLng[firstVertex];
+  for (uint16_t i = firstVertex + 1; i < firstVertex + count; i++)
+  {
+    if (_vertexLat[i] < zone->minLat)
+      zone->minLat = _vertexLat[i];
+    if (_vertexLat[i] > zone->maxLat)
+      zone->maxLat = _vertexLat[i];
+    if (_vertexLng[i] < zone->minLng)
+      zone->minLng = _vertexLng[i];
+    if (_vertexLng[i] > zone->maxLng)
+      zone->maxLng = _vertexLng[i];
+  }
+  return true;
+}
+
+bool GeofenceEngine::parseLine(const char *line)
+{
+  const char *p = line;
+  if (atEnd(p))
+  {
+    return true;
+  }
+
+  if (_parsingPolygon)
+  {
+    if (matchWord(p, "end"))
+    {
+      _parsingPolygon = false;
+      uint16_t count = _vertexCount - _parsingFirstVertex;
+      if (!finishPolygon(_parsingId, _parsingFirstVertex, count))
+      {
+        _vertexCount = _parsingFirstVertex;
+        return false;
+      }
+      return true;
+    }
+
+    int32_t lat, lng;
+    if (!parseDegrees(p, lat) || !parseDegrees(p, lng) || !atEnd(p) ||
+        _vertexCount >= GEOFENCE_MAX_VERTICES)
+    {
+      // Drop the whole polygon rather than keep a malformed one
+      _parsingPolygon = false;
+      _vertexCount = _parsingFirstVertex;
+      return false;
+    }
+    _vertexLat[_vertexCount] = lat;
+    _vertexLng[_vertexCount] = lng;
+    _vertexCount++;
+    return true;
+  }
+
+  uint32_t id;
+  if (matchWord(p, "circle"))
+  {
+    int32_t lat, lng;
+    uint32_t radiusM;
+    if (!parseUnsigned(p, id) || id > 0xFFFF || !parseDegrees(p, lat) || !parseDegrees(p, lng) ||
+        !parseUnsigned(p, radiusM) || radiusM > 1000000UL || !atEnd(p))
+    {
+      return false;
+    }
+    return addCircle((uint16_t)id, lat, lng, radiusM * 100);
+  }
+  if (matchWord(p, "polygon"))
+  {
+    if (!parseUnsigned(p, id) || id > 0xFFFF || !atEnd(p))
+    {
+      return false;
+    }
+    _parsingPolygon = true;
+    _parsingId = (uint16_t)id;
+    _parsingFirstVertex = _vertexCount;
+    return true;
+  }
+  return false;
+}
+
+// ------------------- Grid Index -------------------
+
+bool GeofenceEngine::build()
+{
+  _built = false;
+  _insideCount = 0;
+  if (_zoneCount == 0)
+  {
+    return true;
+  }
+
+  int32_t minLat = _zones[0].minLat, maxLat = _zones[0].maxLat;
+  int32_t minLng = _zones[0].minLng, maxLng = _zones[0].maxLng;
+  for (uint16_t z = 1; z < _zoneCount; z++)
+  {
+    if (_zones[z].minLat < minLat)
+      minLat = _zones[z].minLat;
+    if (_zones[z].maxLat > maxLat)
+      maxLat = _zones[z].maxLat;
+    if (_zones[z].minLng < minLng)
+      minLng = _zones[z].minLng;
+    if (_zones[z].maxLng > maxLng)
+      maxLng = _zones[z].maxLng;
+  }
+
+  // Cell size rounded up so the whole extent maps into the grid
+  _gridMinLat = minLat;
+  _gridMinLng = minLng;
+  _cellLat = (int32_t)(((int64_t)maxLat - minLat) / GEOFENCE_GRID_SIZE + 1);
+  _cellLng = (int32_t)(((int64_t)maxLng - minLng) / GEOFENCE_GRID_SIZE + 1);
+
+  // First pass counts the zones per cell, second pass fills them in
+  const uint16_t cells = GEOFENCE_GRID_SIZE * GEOFENCE_GRID_SIZE;
+  for (uint16_t c = 0; c <= cells; c++)
+  {
+    _cellStart[c] = 0;
+  }
+
+  for (uint8_t pass = 0; pass < 2; pass++)
+  {
+    for (uint16_t z = 0; z < _zoneCount; z++)
+    {
+      const Zone &zone = _zones[z];
+      uint16_t row0 = (uint16_t)(((int64_t)zone.minLat - _gridMinLat) / _cellLat);
+      uint16_t row1 = (uint16_t)(((int64_t)zone.maxLat - _gridMinLat) / _cellLat);
+      uint16_t col0 = (uint16_t)(((int64_t)zone.minLng - _gridMinLng) / _cellLng);
+      uint16_t col1 = (uint16_t)(((int64_t)zone.maxLng - _gridMinLng) / _cellLng);
+
+      for (uint16_t row = row0; row <= row1; row++)
+      {
+        for (uint16_t col = col0; col <= col1; col++)
+        {
+          uint16_t cell = row * GEOFENCE_GRID_SIZE + col;
+          if (pass == 0)
+          {
+            _cellStart[cell + 1]++;
+          }
+          else
+          {
+            // _cellStart[cell] doubles as the fill cursor, see below
+            _cellZones[_cellStart[cell]++] = z;
+          }
+        }
+      }
+    }
+
+    if (pass == 0)
+    {
+      // Prefix sum gives each cell's start offset
+      for (uint16_t c = 0; c < cells; c++)
+      {
+        if ((uint32_t)_cellStart[c + 1] + _cellStart[c] > GEOFENCE_MAX_CELL_REFS)
+        {
+          return false;
+        }
+        _cellStart[c + 1] += _cellStart[c];
+      }
+    }
+  }
+
+  // The fill advanced every start to the next cell's start: shift back
+  for (uint16_t c = cells; c > 0; c--)
+  {
+    _cellStart[c] = _cellStart[c - 1];
+  }
+  _cellStart[0] = 0;
+
+  for (uint16_t z = 0; z < _zoneCount; z++)
+  {
+    _zones[z].inside = false;
+    _zones[z].dwellReported = false;
+  }
+  _built = true;
+  return true;
+}
+
+bool GeofenceEngine::cellOf(int32_t latE7, int32_t lngE7, uint16_t &cell) const
+{
+  int64_t row = ((int64_t)latE7 - _gridMinLat) / _cellLat;
+  int64_t col = ((int64_t)lngE7 - _gridMinLng) / _cellLng;
+  if (latE7 < _gridMinLat || lngE7 < _gridMinLng || row >= GEOFENCE_GRID_SIZE || col >= GEOFENCE_GRID_SIZE)
+  {
+    return false;
+  }
+  cell = (uint16_t)(row * GEOFENCE_GRID_SIZE + col);
+  return true;
+}
+
+// ------------------- Evaluation -------------------
+
+bool GeofenceEngine::contains(const Zone &zone, int32_t latE7, int32_t lngE7) const
+{
+  if (latE7 < zone.minLat || latE7 > zone.maxLat || lngE7 < zone.minLng || lngE7 > zone.maxLng)
+  {
+    return false;
+  }
+
+  if (zone.type == ZONE_CIRCLE)
+  {
+    // Equirectangular distance, accurate to well under 1% for fence-sized circles
+    int64_t dy = ((int64_t)(latE7 - _vertexLat[zone.firstVertex]) * GEOFENCE_LAT_SCALE_Q16) >> 16;
+    int64_t dx = ((int64_t)(lngE7 - _vertexLng[zone.firstVertex]) * zone.lngScaleQ16) >> 16;
+    return dx * dx + dy * dy <= (int64_t)zone.radiusCm * zone.radiusCm;
+  }
+
+  // Even-odd ray casting towards +longitude, on coordinates relative to
+  // the bounding box so the cross products stay well inside 64 bits
+  int64_t py = (int64_t)latE7 - zone.minLat;
+  int64_t px = (int64_t)lngE7 - zone.minLng;
+  bool inside = false;
+  uint16_t last = zone.firstVertex + zone.vertexCount - 1;
+  for (uint16_t i = zone.firstVertex, j = last; i <= last; j = i++)
+  {
+    int64_t yi = (int64_t)_vertexLat[i] - zone.minLat;
+    int64_t yj = (int64_t)_vertexLat[j] - zone.minLat;
+    if ((yi > py) != (yj > py))
+    {
+      int64_t xi = (int64_t)_vertexLng[i] - zone.minLng;
+      int64_t xj = (int64_t)_vertexLng[j] - zone.minLng;
+      // px < xi + (py - yi) * (xj - xi) / (yj - yi), without the division
+      int64_t lhs = (px - xi) * (yj - yi);
+      int64_t rhs = (py - yi) * (xj - xi);
+      if (yj > yi ? lhs < rhs : lhs > rhs)
+      {
+        inside = !inside;
+      }
+    }
+  }
+  return inside;
+}
+
+void GeofenceEngine::removeInside(uint8_t index)
+{
+  _inside[index] = _inside[--_insideCount];
+}
+
+size_t GeofenceEngine::evaluate(const GpsFix &fix, uint32_t nowMs, GeofenceEvent *events)
+{
+  if (!_built)
+  {
+    return 0;
+  }
+
+  // Zones near the fix are the only ones that can contain it
+  uint16_t first = 0, last = 0;
+  uint16_t cell;
+  if (cellOf(fix.latE7, fix.lngE7, cell))
+  {
+    first = _cellStart[cell];
+    last = _cellStart[cell + 1];
+  }
+  _stamp++;
+  for (uint16_t k = first; k < last; k++)
+  {
+    Zone &zone = _zones[_cellZones[k]];
+    zone.stamp = _stamp;
+    zone.hit = contains(zone, fix.latE7, fix.lngE7);
+  }
+
+  size_t eventCount = 0;
+
+  // Zones the asset was already inside: exited, or dwelling
+  for (uint8_t i = 0; i < _insideCount && eventCount < GEOFENCE_MAX_EVENTS;)
+  {
+    Zone &zone = _zones[_inside[i]];
+    if (zone.stamp != _stamp || !zone.hit)
+    {
+      zone.inside = false;
+      events[eventCount++] = {zone.id, GEOFENCE_EXIT};
+      removeInside(i);
+      continue;
+    }
+
+    if (!zone.dwellReported && nowMs - zone.enteredMs >= _dwellMs)
+    {
+      zone.dwellReported = true;
+      events[eventCount++] = {zone.id, GEOFENCE_DWELL};
+    }
+    i++;
+  }
+
+  // Newly entered zones. Anything not reported now is picked up by a later fix.
+  for (uint16_t k = first; k < last && eventCount < GEOFENCE_MAX_EVENTS && _insideCount < GEOFENCE_MAX_INSIDE; k++)
+  {
+    uint16_t z = _cellZones[k];
+    Zone &zone = _zones[z];
+    if (!zone.hit || zone.inside)
+    {
+      continue;
+    }
+    zone.inside = true;
+    zone.dwellReported = false;
+    zone.enteredMs = nowMs;
+    _inside[_insideCount++] = z;
+    events[eventCount++] = {zone.id, GEOFENCE_ENTER};
+  }
+  return eventCount;
+}
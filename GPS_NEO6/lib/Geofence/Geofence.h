@@ -0,0 +1,141 @@
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <GpsFix.h>
+
+// Storage is static; a build flag can raise the limits where RAM allows
+#ifndef GEOFENCE_MAX_ZONES
+#define GEOFENCE_MAX_ZONES 256
+#endif
+#ifndef GEOFENCE_MAX_VERTICES
+#define GEOFENCE_MAX_VERTICES 2048 // Shared by all polygons (circles use one)
+#endif
+#define GEOFENCE_GRID_SIZE 32      // Index cells per side
+#ifndef GEOFENCE_MAX_CELL_REFS
+#define GEOFENCE_MAX_CELL_REFS 4096
+#endif
+#define GEOFENCE_MAX_INSIDE 32     // Zones the asset can be inside at once
+#define GEOFENCE_MAX_EVENTS 8      // Events reported per fix
+
+enum GeofenceEventType
+{
+  GEOFENCE_ENTER,
+  GEOFENCE_EXIT,
+  GEOFENCE_DWELL
+};
+
+struct GeofenceEvent
+{
+  uint16_t zoneId;
+  GeofenceEventType type;
+};
+
+/**
+ * @brief Circle and polygon zones with enter/exit/dwell detection.
+ *
+ * Zones are indexed in a uniform grid over their combined bounding box.
+ * Each cell lists the zones whose bounding box overlaps it, so a fix is
+ * only tested against the handful of zones near it plus those it is
+ * currently inside, independent of the total zone count.
+ *
+ * Zones are added with addCircle()/addPolygon() or parseLine(), then
+ * build() creates the index. All storage is static.
+ */
+class GeofenceEngine
+{
+public:
+  explicit GeofenceEngine(uint32_t dwellMs);
+
+  bool addCircle(uint16_t id, int32_t latE7, int32_t lngE7, uint32_t radiusCm);
+  bool addPolygon(uint16_t id, const int32_t *latE7, const int32_t *lngE7, uint16_t count);
+
+  /**
+   * @brief Add zones from a line-oriented text definition.
+   *
+   *   circle <id> <lat> <lng> <radius m>
+   *   polygon <id>
+   *   <lat> <lng>          (one line per vertex)
+   *   end
+   *
+   * Blank lines and lines starting with '#' are ignored.
+   *
+   * @return false on a malformed line or when storage is full.
+   */
+  bool parseLine(const char *line);
+
+  /**
+   * @brief Build the grid index. Call after the last zone is added.
+   */
+  bool build();
+
+  /**
+   * @brief Evaluate a fix and report zone transitions.
+   *
+   * @return Number of events written to `events` (up to GEOFENCE_MAX_EVENTS).
+   */
+  size_t evaluate(const GpsFix &fix, uint32_t nowMs, GeofenceEvent *events);
+
+  uint16_t zoneCount() const { return _zoneCount; }
+
+private:
+  enum ZoneType : uint8_t
+  {
+    ZONE_CIRCLE,
+    ZONE_POLYGON
+  };
+
+  struct Zone
+  {
+    int32_t minLat;
+    int32_t minLng;
+    int32_t maxLat;
+    int32_t maxLng;
+    uint32_t radiusCm;
+    int32_t lngScaleQ16; // cm per 1e-7 degree of longitude at the center
+    uint32_t enteredMs;
+    uint16_t firstVertex;
+    uint16_t vertexCount;
+    uint16_t id;
+    uint16_t stamp; // Last evaluation that tested this zone
+    ZoneType type;
+    bool hit;       // Contained the fix at evaluation `stamp`
+    bool inside;
+    bool dwellReported;
+  };
+
+  Zone *newZone(uint16_t id, ZoneType type);
+  bool finishPolygon(uint16_t id, uint16_t firstVertex, uint16_t count);
+  bool contains(const Zone &zone, int32_t latE7, int32_t lngE7) const;
+  bool cellOf(int32_t latE7, int32_t lngE7, uint16_t &cell) const;
+  void removeInside(uint8_t index);
+
+  uint32_t _dwellMs;
+  Zone _zones[GEOFENCE_MAX_ZONES];
+  uint16_t _zoneCount;
+  int32_t _vertexLat[GEOFENCE_MAX_VERTICES];
+  int32_t _vertexLng[GEOFENCE_MAX_VERTICES];
+  uint16_t _vertexCount;
+
+  // Grid index in compressed row form: zones of cell c are
+  // _cellZones[_cellStart[c] .. _cellStart[c + 1])
+  int32_t _gridMinLat;
+  int32_t _gridMinLng;
+  int32_t _cellLat;
+  int32_t _cellLng;
+  bool _built;
+  uint16_t _cellStart[GEOFENCE_GRID_SIZE * GEOFENCE_GRID_SIZE + 1];
+  uint16_t _cellZones[GEOFENCE_MAX_CELL_REFS];
+
+  uint16_t _inside[GEOFENCE_MAX_INSIDE];
+  uint8_t _insideCount;
+  uint16_t _stamp;
+
+  // Polygon being read by parseLine()
+  bool _parsingPolygon;
+  uint16_t _parsingId;
+  uint16_t _parsingFirstVertex;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef GPS_FIX_H
+#define GPS_FIX_H
+
+#include <stdint.h>
+
+#define GPS_UNIX_EPOCH_OFFSET 315964800UL // Start of GPS time (1980-01-06) in Unix time
+#define GPS_LEAP_SECONDS 18               // GPS time minus UTC since 2017-01-01
+#define GPS_SECONDS_PER_WEEK 604800UL
+
+// GpsFix::flags
+#define GPS_FIX_FILTERED 0x01 // Position smoothed, velNCms/velECms valid
+
+/**
+ * @brief A single GPS fix in fixed-point units.
+ *
+ * Coordinates are kept as integers so a fix can be copied, queued and
+ * formatted without touching the FPU or the heap.
+ */
+struct GpsFix
+{
+  int32_t latE7;      // Latitude in 1e-7 degrees
+  int32_t lngE7;      // Longitude in 1e-7 degrees
+  int32_t altCm;      // Altitude above MSL in centimeters
+  uint16_t hdop;      // Horizontal dilution of precision in hundredths
+  uint8_t satellites; // Satellites used in the fix
+  uint16_t timeMs;    // Milliseconds within `time`
+  uint32_t time;      // UTC seconds since 1970-01-01, 0 if unknown
+  uint16_t speedCms;  // Ground speed in cm/s
+  uint16_t courseCd;  // Course over ground in hundredths of a degree (0-35999)
+  int16_t velNCms;    // Filtered velocity towards north in cm/s
+  int16_t velECms;    // Filtered velocity towards east in cm/s
+  uint8_t flags;      // GPS_FIX_* bits
+};
+
+/**
+ * @brief Convert a UTC calendar date and time to seconds since 1970-01-01.
+ */
+inline uint32_t gpsUnixTime(uint16_t year, uint8_t month, uint8_t day,
+                            uint8_t hour, uint8_t minute, uint8_t second)
+{
+  // Days from civil, with March as the first month of the year
+  int32_t y = (int32_t)year - (month <= 2 ? 1 : 0);
+  int32_t era = y / 400;
+  uint32_t yearOfEra = (uint32_t)(y - era * 400);
+  uint32_t monthIndex = month > 2 ? month - 3 : month + 9;
+  uint32_t dayOfYear = (153 * monthIndex + 2) / 5 + day - 1;
+  uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  uint32_t days = (uint32_t)(era * 146097 + (int32_t)dayOfEra - 719468);
+
+  return days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
+
+/**
+ * @brief Convert a GPS week number and time of week to Unix seconds (UTC).
+ */
+inline uint32_t gpsWeekToUnixTime(uint16_t week, uint32_t towMs)
+{
+  return GPS_UNIX_EPOCH_OFFSET + week * GPS_SECONDS_PER_WEEK + towMs / 1000 - GPS_LEAP_SECONDS;
+}
+
+/**
+ * @brief Convert Unix seconds (UTC) to a GPS week number and time of week.
+ */
+inline void gpsUnixToWeek(uint32_t unixTime, uint16_t &week, uint32_t &towMs)
+{
+  uint32_t gpsSeconds = unixTime - GPS_UNIX_EPOCH_OFFSET + GPS_LEAP_SECONDS;
+  week = (uint16_t)(gpsSeconds / GPS_SECONDS_PER_WEEK);
+  towMs = gpsSeconds % GPS_SECONDS_PER_WEEK * 1000;
+}
+
+#endif
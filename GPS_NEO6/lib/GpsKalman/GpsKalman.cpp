@@ -0,0 +1,146 @@
+#include "GpsKalman.h"
+#include <math.h>
+
+#define NORTH_SCALE_Q16 72955     // 1.11319 cm per 1e-7 degree of latitude, Q16
+#define REBASE_DISTANCE_CM 5000000 // Move the origin after 50 km to keep precision
+#define INITIAL_VELOCITY_VARIANCE 250000LL // (5 m/s)^2
+
+static int64_t mulQ16(int64_t value, int64_t q16)
+{
+  return (value * q16) / 65536;
+}
+
+GpsKalman::GpsKalman(const GpsKalmanConfig &config)
+    : _config(config), _initialized(false), _lastTimeMs(0), _originLatE7(0),
+      _originLngE7(0), _eastScaleQ16(NORTH_SCALE_Q16), _north(), _east(), _resets(0)
+{
+}
+
+void GpsKalman::setOrigin(int32_t latE7, int32_t lngE7)
+{
+  _originLatE7 = latE7;
+  _originLngE7 = lngE7;
+  _eastScaleQ16 = (int32_t)(NORTH_SCALE_Q16 * cosf(latE7 * 1e-7f * 0.01745329f));
+  if (_eastScaleQ16 < 1)
+    _eastScaleQ16 = 1; // Poles
+}
+
+int32_t GpsKalman::toNorthCm(int32_t latE7) const
+{
+  return (int32_t)(((int64_t)latE7 - _originLatE7) * NORTH_SCALE_Q16 / 65536);
+}
+
+int32_t GpsKalman::toEastCm(int32_t lngE7) const
+{
+  // Wrap across the antimeridian
+  int64_t delta = (int64_t)lngE7 - _originLngE7;
+  if (delta > 1800000000LL)
+    delta -= 3600000000LL;
+  else if (delta < -1800000000LL)
+    delta += 3600000000LL;
+  return (int32_t)(delta * _eastScaleQ16 / 65536);
+}
+
+void GpsKalman::start(const GpsFix &fix, int64_t variance)
+{
+  setOrigin(fix.latE7, fix.lngE7);
+  _north.position = 0;
+  _east.position = 0;
+  _north.velocity = 0;
+  _east.velocity = 0;
+  _north.p00 = _east.p00 = variance;
+  _north.p01 = _east.p01 = 0;
+  _north.p11 = _east.p11 = INITIAL_VELOCITY_VARIANCE;
+  _initialized = true;
+}
+
+void GpsKalman::predict(Axis &axis, int32_t dtMs)
+{
+  int64_t dt = dtMs;
+  axis.position += (int32_t)((int64_t)axis.velocity * dt / 1000);
+
+  // P = F P F' + Q for F = [1 dt; 0 1] and white-noise acceleration
+  int64_t q = (int64_t)_config.accelCms2 * _config.accelCms2;
+  axis.p00 += (2 * axis.p01 * dt) / 1000 + (axis.p11 * dt * dt) / 1000000 + q * dt * dt * dt / 3000000000LL;
+  axis.p01 += (axis.p11 * dt) / 1000 + q * dt * dt / 2000000;
+  axis.p11 += q * dt / 1000;
+}
+
+void GpsKalman::correct(Axis &axis, int32_t measured, int64_t variance)
+{
+  int64_t s = axis.p00 + variance;
+  int64_t k0 = (axis.p00 * 65536) / s; // Position gain, Q16
+  int64_t k1 = (axis.p01 * 65536) / s; // Velocity gain, Q16 (per second)
+  int64_t innovation = (int64_t)measured - axis.position;
+
+  axis.position += (int32_t)mulQ16(innovation, k0);
+  axis.velocity += (int32_t)mulQ16(innovation, k1);
+
+  // P = (I - K H) P
+  int64_t p00 = axis.p00;
+  int64_t p01 = axis.p01;
+  axis.p00 = p00 - mulQ16(p00, k0);
+  axis.p01 = p01 - mulQ16(p01, k0);
+  axis.p11 = axis.p11 - mulQ16(p01, k1);
+}
+
+void GpsKalman::update(GpsFix &fix, uint32_t timeMs)
+{
+  // Measurement variance from HDOP: (hdop * UERE)^2 in cm^2
+  int64_t sigma = (int64_t)fix.hdop * _config.uereCm / 100;
+  if (sigma < 1)
+    sigma = 1;
+  int64_t variance = sigma * sigma;
+
+  uint32_t dtMs = timeMs - _lastTimeMs;
+  _lastTimeMs = timeMs;
+
+  if (!_initialized || dtMs > _config.maxGapMs)
+  {
+    if (_initialized)
+      _resets++;
+    start(fix, variance);
+  }
+  else
+  {
+    predict(_north, (int32_t)dtMs);
+    predict(_east, (int32_t)dtMs);
+
+    int32_t north = toNorthCm(fix.latE7);
+    int32_t east = toEastCm(fix.lngE7);
+    int64_t dn = (int64_t)north - _north.position;
+    int64_t de = (int64_t)east - _east.position;
+    if ((uint64_t)(dn * dn + de * de) > (uint64_t)_config.maxJumpCm * _config.maxJumpCm)
+    {
+      // The estimate is no longer trustworthy; follow the receiver again
+      _resets++;
+      start(fix, variance);
+    }
+    else
+    {
+      correct(_north, north, variance);
+      correct(_east, east, variance);
+    }
+  }
+
+  // Convert the estimate back to degrees
+  fix.latE7 = _originLatE7 + (int32_t)((int64_t)_north.position * 65536 / NORTH_SCALE_Q16);
+  int64_t lngE7 = _originLngE7 + (int64_t)_east.position * 65536 / _eastScaleQ16;
+  if (lngE7 > 1800000000LL)
+    lngE7 -= 3600000000LL;
+  else if (lngE7 < -1800000000LL)
+    lngE7 += 3600000000LL;
+  fix.lngE7 = (int32_t)lngE7;
+  fix.velNCms = (int16_t)(_north.velocity > 32767 ? 32767 : (_north.velocity < -32767 ? -32767 : _north.velocity));
+  fix.velECms = (int16_t)(_east.velocity > 32767 ? 32767 : (_east.velocity < -32767 ? -32767 : _east.velocity));
+  fix.flags |= GPS_FIX_FILTERED;
+
+  // Keep the local frame small so the int32 state never gets near overflow
+  if (_north.position > REBASE_DISTANCE_CM || _north.position < -REBASE_DISTANCE_CM ||
+      _east.position > REBASE_DISTANCE_CM || _east.position < -REBASE_DISTANCE_CM)
+  {
+    setOrigin(fix.latE7, fix.lngE7);
+    _north.position = 0;
+    _east.position = 0;
+  }
+}
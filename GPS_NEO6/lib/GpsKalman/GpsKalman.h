@@ -0,0 +1,73 @@
+#ifndef GPS_KALMAN_H
+#define GPS_KALMAN_H
+
+#include <stdint.h>
+#include <GpsFix.h>
+
+/**
+ * @brief Tuning for GpsKalman.
+ */
+struct GpsKalmanConfig
+{
+  uint16_t uereCm;      // Receiver position error at HDOP 1.0 (1 sigma)
+  uint16_t accelCms2;   // Expected acceleration noise (1 sigma)
+  uint16_t maxGapMs;    // Longer gaps between fixes restart the filter
+  uint32_t maxJumpCm;   // Larger innovations restart the filter
+};
+
+/**
+ * @brief Constant-velocity Kalman filter for GPS fixes in integer arithmetic.
+ *
+ * North and east are filtered independently in centimeters relative to a
+ * local origin. State is kept in int32 and covariances in int64; gains are
+ * Q16 fixed point. The measurement variance follows the fix HDOP, so poor
+ * geometry moves the estimate less. Floating point is only used once, to
+ * scale longitude at the origin latitude.
+ */
+class GpsKalman
+{
+public:
+  explicit GpsKalman(const GpsKalmanConfig &config);
+
+  /**
+   * @brief Filter one fix in place.
+   *
+   * Replaces latitude/longitude with the estimate, fills velNCms/velECms
+   * and sets GPS_FIX_FILTERED.
+   *
+   * @param timeMs Fix time in milliseconds; only differences are used.
+   */
+  void update(GpsFix &fix, uint32_t timeMs);
+
+  void reset() { _initialized = false; }
+  uint32_t resets() const { return _resets; }
+
+private:
+  struct Axis
+  {
+    int32_t position; // cm from the origin
+    int32_t velocity; // cm/s
+    int64_t p00;      // Position variance (cm^2)
+    int64_t p01;      // Position/velocity covariance (cm^2/s)
+    int64_t p11;      // Velocity variance (cm^2/s^2)
+  };
+
+  void start(const GpsFix &fix, int64_t variance);
+  void setOrigin(int32_t latE7, int32_t lngE7);
+  void predict(Axis &axis, int32_t dtMs);
+  void correct(Axis &axis, int32_t measured, int64_t variance);
+  int32_t toNorthCm(int32_t latE7) const;
+  int32_t toEastCm(int32_t lngE7) const;
+
+  GpsKalmanConfig _config;
+  bool _initialized;
+  uint32_t _lastTimeMs;
+  int32_t _originLatE7;
+  int32_t _originLngE7;
+  int32_t _eastScaleQ16; // cm per 1e-7 degree of longitude, Q16
+  Axis _north;
+  Axis _east;
+  uint32_t _resets;
+};
+
+#endif
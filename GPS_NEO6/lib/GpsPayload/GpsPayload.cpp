@@ -0,0 +1,145 @@
+#include "GpsPayload.h"
+
+// ------------------- PayloadWriter -------------------
+
+PayloadWriter::PayloadWriter(char *buffer, size_t size)
+    : _buffer(buffer), _size(size), _length(0), _overflow(size == 0)
+{
+}
+
+void PayloadWriter::appendChar(char c)
+{
+  // Always keep one byte free for the terminator
+  if (_overflow || _length + 1 >= _size)
+  {
+    _overflow = true;
+    return;
+  }
+  _buffer[_length++] = c;
+}
+
+void PayloadWriter::append(const char *text)
+{
+  while (*text != '\0')
+  {
+    appendChar(*text++);
+  }
+}
+
+void PayloadWriter::appendUnsigned(uint32_t value)
+{
+  // Build the digits backwards in a small scratch buffer
+  char digits[10];
+  uint8_t count = 0;
+  do
+  {
+    digits[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+
+  while (count > 0)
+  {
+    appendChar(digits[--count]);
+  }
+}
+
+void PayloadWriter::appendSigned(int32_t value)
+{
+  if (value < 0)
+  {
+    appendChar('-');
+    appendUnsigned(0u - (uint32_t)value);
+  }
+  else
+  {
+    appendUnsigned((uint32_t)value);
+  }
+}
+
+void PayloadWriter::appendFixed(int32_t value, uint8_t decimals)
+{
+  uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+  uint32_t scale = 1;
+  for (uint8_t i = 0; i < decimals; i++)
+  {
+    scale *= 10;
+  }
+
+  if (value < 0)
+  {
+    appendChar('-');
+  }
+  appendUnsigned(magnitude / scale);
+
+  if (decimals == 0)
+  {
+    return;
+  }
+  appendChar('.');
+
+  // Print the fraction with leading zeros
+  uint32_t fraction = magnitude % scale;
+  for (scale /= 10; scale > 0; scale /= 10)
+  {
+    appendChar((char)('0' + (fraction / scale) % 10));
+  }
+}
+
+size_t PayloadWriter::finish()
+{
+  if (_overflow)
+  {
+    if (_size > 0)
+    {
+      _buffer[0] = '\0';
+    }
+    return 0;
+  }
+  _buffer[_length] = '\0';
+  return _length;
+}
+
+// ------------------- GPS Payload -------------------
+
+/**
+ * @brief Divide by 10 rounding half away from zero.
+ */
+static int32_t roundDiv10(int32_t value)
+{
+  return value >= 0 ? (value + 5) / 10 : (value - 5) / 10;
+}
+
+size_t formatGpsPayload(char *buffer, size_t size, const GpsFix &fix)
+{
+  PayloadWriter writer(buffer, size);
+
+  writer.append("{\"latitude\": ");
+  writer.appendFixed(roundDiv10(fix.latE7), 6);
+  writer.append(",\"longitude\": ");
+  writer.appendFixed(roundDiv10(fix.lngE7), 6);
+  writer.append(",\"altitude\": ");
+  writer.appendFixed(fix.altCm, 2);
+  writer.append(",\"satellites\": ");
+  writer.appendUnsigned(fix.satellites);
+  writer.append(",\"hdop\": ");
+  writer.appendFixed(fix.hdop, 2);
+  if (fix.time != 0)
+  {
+    writer.append(",\"time\": ");
+    writer.appendUnsigned(fix.time);
+    writer.appendChar('.');
+    writer.appendChar((char)('0' + fix.timeMs / 100 % 10));
+    writer.appendChar((char)('0' + fix.timeMs / 10 % 10));
+    writer.appendChar((char)('0' + fix.timeMs % 10));
+  }
+  if (fix.flags & GPS_FIX_FILTERED)
+  {
+    writer.append(",\"vn\": ");
+    writer.appendFixed(fix.velNCms, 2);
+    writer.append(",\"ve\": ");
+    writer.appendFixed(fix.velECms, 2);
+  }
+  writer.appendChar('}');
+
+  return writer.finish();
+}
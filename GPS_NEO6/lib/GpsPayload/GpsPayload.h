@@ -0,0 +1,58 @@
+#ifndef GPS_PAYLOAD_H
+#define GPS_PAYLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <GpsFix.h>
+
+// Large enough for the longest possible GPS JSON payload
+#define GPS_PAYLOAD_MAX_LEN 160
+
+/**
+ * @brief Appends text and fixed-point numbers to a caller-owned buffer.
+ *
+ * Never allocates. Once the buffer is full every further append is
+ * ignored and finish() reports the overflow by returning 0.
+ */
+class PayloadWriter
+{
+public:
+  PayloadWriter(char *buffer, size_t size);
+
+  void append(const char *text);
+  void appendChar(char c);
+  void appendUnsigned(uint32_t value);
+  void appendSigned(int32_t value);
+
+  /**
+   * @brief Append value / 10^decimals with exactly `decimals` digits after the point.
+   */
+  void appendFixed(int32_t value, uint8_t decimals);
+
+  /**
+   * @brief Null-terminate the buffer.
+   *
+   * @return Length of the text, or 0 if it did not fit.
+   */
+  size_t finish();
+
+private:
+  char *_buffer;
+  size_t _size;
+  size_t _length;
+  bool _overflow;
+};
+
+/**
+ * @brief Format a fix as the JSON document published on the `gps` topic.
+ *
+ * Latitude and longitude are printed with 6 decimals, altitude and HDOP
+ * with 2, matching the layout the String based code produced. A "time"
+ * field (Unix seconds with milliseconds) is appended when the fix has one,
+ * and filtered fixes carry their velocity as "vn"/"ve" in m/s.
+ *
+ * @return Length of the payload, or 0 if `size` is too small.
+ */
+size_t formatGpsPayload(char *buffer, size_t size, const GpsFix &fix);
+
+#endif
@@ -0,0 +1,89 @@
+#include "TrackBatch.h"
+
+TrackBatchEncoder::TrackBatchEncoder()
+{
+  reset();
+}
+
+void TrackBatchEncoder::reset()
+{
+  _buffer[0] = TRACK_BATCH_VERSION;
+  _buffer[1] = 0;
+  _buffer[2] = 0;
+  _length = 3;
+  _count = 0;
+  _lastTime = 0;
+  _lastTimeMs = 0;
+}
+
+void TrackBatchEncoder::putVarint(uint32_t value)
+{
+  while (value >= 0x80)
+  {
+    _buffer[_length++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  _buffer[_length++] = (uint8_t)value;
+}
+
+void TrackBatchEncoder::putZigzag(int32_t value)
+{
+  putVarint(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+void TrackBatchEncoder::putTime(const GpsFix &fix)
+{
+  if (fix.time == 0)
+  {
+    putVarint(TRACK_BATCH_TIME_NONE);
+    return;
+  }
+
+  // Deltas stay within int32 ms for gaps up to ~24 days
+  int64_t dt = ((int64_t)fix.time - _lastTime) * 1000 + ((int32_t)fix.timeMs - (int32_t)_lastTimeMs);
+  if (_lastTime != 0 && dt > -0x3FFFFFFFLL && dt < 0x3FFFFFFFLL)
+  {
+    int32_t delta = (int32_t)dt;
+    putVarint((((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31)) + TRACK_BATCH_TIME_DELTA);
+  }
+  else
+  {
+    putVarint(TRACK_BATCH_TIME_ABSOLUTE);
+    putVarint(fix.time);
+    putVarint(fix.timeMs);
+  }
+  _lastTime = fix.time;
+  _lastTimeMs = fix.timeMs;
+}
+
+bool TrackBatchEncoder::add(const GpsFix &fix)
+{
+  if (_count == 0xFFFF || _length + TRACK_BATCH_MAX_FIX_BYTES > TRACK_BATCH_MAX_BYTES)
+  {
+    return false;
+  }
+
+  putTime(fix);
+  if (_count == 0)
+  {
+    putZigzag(fix.latE7);
+    putZigzag(fix.lngE7);
+    putZigzag(fix.altCm);
+  }
+  else
+  {
+    putZigzag((int32_t)((uint32_t)fix.latE7 - (uint32_t)_last.latE7));
+    putZigzag((int32_t)((uint32_t)fix.lngE7 - (uint32_t)_last.lngE7));
+    putZigzag((int32_t)((uint32_t)fix.altCm - (uint32_t)_last.altCm));
+  }
+  putVarint(fix.hdop);
+  _buffer[_length++] = fix.satellites;
+  putVarint(fix.speedCms);
+  putVarint(fix.courseCd);
+
+  _last = fix;
+  _count++;
+  _buffer[1] = (uint8_t)_count;
+  _buffer[2] = (uint8_t)(_count >> 8);
+  return true;
+}
@@ -0,0 +1,68 @@
+#ifndef TRACK_BATCH_H
+#define TRACK_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <GpsFix.h>
+
+#define TRACK_BATCH_VERSION 2
+#define TRACK_BATCH_MAX_BYTES 768    // Must fit in the MQTT client buffer with the topic
+#define TRACK_BATCH_MAX_FIX_BYTES 40 // Worst-case encoded size of one fix
+
+// Time tag in front of each fix
+#define TRACK_BATCH_TIME_NONE 0     // Fix has no time
+#define TRACK_BATCH_TIME_ABSOLUTE 1 // Followed by varint time (s), varint timeMs
+#define TRACK_BATCH_TIME_DELTA 2    // Tag minus this is zigzag delta (ms)
+
+/**
+ * @brief Delta/varint encoder packing many fixes into one binary frame.
+ *
+ * Frame layout (all multi-byte integers little-endian or LEB128 varints,
+ * signed values zigzag encoded):
+ *
+ *   u8      version (TRACK_BATCH_VERSION)
+ *   u16     number of fixes
+ *   each fix:   varint time tag (TRACK_BATCH_TIME_*), then
+ *   first fix:  zigzag latE7, zigzag lngE7, zigzag altCm
+ *   next fixes: zigzag delta latE7, zigzag delta lngE7, zigzag delta altCm
+ *   each fix:   varint hdop, u8 satellites, varint speedCms, varint courseCd
+ *
+ * A time delta is taken from the last fix that had a time; a fix without
+ * one is tagged TRACK_BATCH_TIME_NONE rather than given its neighbour's.
+ * Coordinate deltas are modulo 2^32, so a decoder wraps the running sum to
+ * 32-bit signed (a track across the antimeridian steps by about -3.6e9).
+ *
+ * The reference decoder lives in backEnd/helper/gpsBatchDecoder.js.
+ */
+class TrackBatchEncoder
+{
+public:
+  TrackBatchEncoder();
+
+  void reset();
+
+  /**
+   * @brief Append a fix.
+   *
+   * @return false if the frame has no room left; the fix is not added.
+   */
+  bool add(const GpsFix &fix);
+
+  uint16_t count() const { return _count; }
+  const uint8_t *data() const { return _buffer; }
+  size_t length() const { return _length; }
+
+private:
+  void putVarint(uint32_t value);
+  void putZigzag(int32_t value);
+  void putTime(const GpsFix &fix);
+
+  uint8_t _buffer[TRACK_BATCH_MAX_BYTES];
+  size_t _length;
+  uint16_t _count;
+  GpsFix _last;
+  uint32_t _lastTime; // Of the last fix that had one, 0 if none yet
+  uint16_t _lastTimeMs;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "TrackSimplifier.h"
+#include <math.h>
+
+#define METERS_PER_E7_DEGREE 0.0111319f // Along a meridian
+#define DEG_TO_RAD_F 0.01745329f
+
+TrackSimplifier::TrackSimplifier(const TrackSimplifierConfig &config)
+    : _config(config), _haveAnchor(false), _anchorMs(0), _metersPerE7Lng(0),
+      _windowCount(0), _fixesIn(0), _fixesOut(0)
+{
+}
+
+void TrackSimplifier::setAnchor(const GpsFix &fix, uint32_t nowMs)
+{
+  _anchor = fix;
+  _anchorMs = nowMs;
+  _haveAnchor = true;
+  _metersPerE7Lng = METERS_PER_E7_DEGREE * cosf(fix.latE7 * 1e-7f * DEG_TO_RAD_F);
+  _windowCount = 0;
+}
+
+/**
+ * @brief Local east/north offset of a fix from the anchor, in meters.
+ */
+void TrackSimplifier::project(const GpsFix &fix, float &x, float &y) const
+{
+  x = (float)(fix.lngE7 - _anchor.lngE7) * _metersPerE7Lng;
+  y = (float)(fix.latE7 - _anchor.latE7) * METERS_PER_E7_DEGREE;
+}
+
+/**
+ * @brief Check that every held fix stays near the segment anchor -> candidate.
+ */
+bool TrackSimplifier::windowFits(const GpsFix &candidate) const
+{
+  float px, py;
+  project(candidate, px, py);
+  float lengthSq = px * px + py * py;
+  float toleranceSq = _config.toleranceM * _config.toleranceM;
+
+  for (size_t i = 0; i < _windowCount; i++)
+  {
+    float qx, qy;
+    project(_window[i], qx, qy);
+
+    // Distance to the closest point on the segment
+    float t = lengthSq > 0 ? (qx * px + qy * py) / lengthSq : 0;
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    float dx = qx - t * px;
+    float dy = qy - t * py;
+    if (dx * dx + dy * dy > toleranceSq)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t TrackSimplifier::emit(const GpsFix &fix, uint32_t nowMs, GpsFix out[2], size_t count)
+{
+  out[count++] = fix;
+  _fixesOut++;
+  setAnchor(fix, nowMs);
+  return count;
+}
+
+size_t TrackSimplifier::update(const GpsFix &fix, uint32_t nowMs, GpsFix out[2])
+{
+  _fixesIn++;
+
+  if (!_haveAnchor)
+  {
+    return emit(fix, nowMs, out, 0);
+  }
+
+  bool heartbeatDue = nowMs - _anchorMs >= _config.heartbeatMs;
+  float speed = fix.speedCms / 100.0f;
+
+  // Parked: ignore receiver jitter inside the deadband
+  if (speed < _config.stationarySpeedMs)
+  {
+    float x, y;
+    project(fix, x, y);
+    if (x * x + y * y < _config.deadbandM * _config.deadbandM)
+    {
+      return heartbeatDue ? emit(fix, nowMs, out, 0) : 0;
+    }
+  }
+
+  size_t count = 0;
+
+  // A sharp turn is published straight away
+  if (speed >= _config.stationarySpeedMs && _windowCount > 0)
+  {
+    float change = fabsf((float)fix.courseCd - (float)_window[_windowCount - 1].courseCd) / 100.0f;
+    if (change > 180.0f)
+      change = 360.0f - change;
+    if (change > _config.headingChangeDeg)
+    {
+      count = emit(_window[_windowCount - 1], nowMs, out, count);
+      return emit(fix, nowMs, out, count);
+    }
+  }
+
+  // The newest fix breaks the straight line: the previous fix was a corner
+  if (!windowFits(fix))
+  {
+    count = emit(_window[_windowCount - 1], nowMs, out, count);
+  }
+
+  if (heartbeatDue || _windowCount >= TRACK_WINDOW_SIZE)
+  {
+    return emit(fix, nowMs, out, count);
+  }
+
+  _window[_windowCount++] = fix;
+  return count;
+}
@@ -0,0 +1,67 @@
+#ifndef TRACK_SIMPLIFIER_H
+#define TRACK_SIMPLIFIER_H
+
+#include <stddef.h>
+#include <GpsFix.h>
+
+#define TRACK_WINDOW_SIZE 32 // Fixes held back while a straight segment grows
+
+/**
+ * @brief Tuning for motion-adaptive publishing.
+ */
+struct TrackSimplifierConfig
+{
+  float toleranceM;        // Max distance of a dropped fix from the published track
+  float deadbandM;         // Movement ignored while stationary (receiver jitter)
+  float stationarySpeedMs; // Below this ground speed the asset counts as parked
+  float headingChangeDeg;  // Course change that publishes immediately
+  uint32_t heartbeatMs;    // Longest silence before a fix is published anyway
+};
+
+/**
+ * @brief Streaming track simplifier deciding which fixes are worth uploading.
+ *
+ * Uses an opening-window variant of Douglas-Peucker: fixes are held while
+ * every one of them stays within `toleranceM` of the straight line from the
+ * last published fix to the newest one. When that stops being true the
+ * previous fix becomes a published vertex. Parked assets only publish on a
+ * heartbeat, and a sharp course change publishes at once.
+ *
+ * Every dropped fix lies within `toleranceM` of the published polyline,
+ * except while stationary where the bound is `deadbandM`.
+ */
+class TrackSimplifier
+{
+public:
+  explicit TrackSimplifier(const TrackSimplifierConfig &config);
+
+  /**
+   * @brief Feed the next fix.
+   *
+   * @param nowMs Monotonic time of arrival, used for the heartbeat.
+   * @param out   Receives the fixes to publish, oldest first (up to 2).
+   * @return Number of fixes written to `out`.
+   */
+  size_t update(const GpsFix &fix, uint32_t nowMs, GpsFix out[2]);
+
+  uint32_t fixesIn() const { return _fixesIn; }
+  uint32_t fixesOut() const { return _fixesOut; }
+
+private:
+  void project(const GpsFix &fix, float &x, float &y) const;
+  bool windowFits(const GpsFix &candidate) const;
+  void setAnchor(const GpsFix &fix, uint32_t nowMs);
+  size_t emit(const GpsFix &fix, uint32_t nowMs, GpsFix out[2], size_t count);
+
+  TrackSimplifierConfig _config;
+  bool _haveAnchor;
+  GpsFix _anchor;
+  uint32_t _anchorMs;
+  float _metersPerE7Lng; // Longitude scale at the anchor latitude
+  GpsFix _window[TRACK_WINDOW_SIZE];
+  size_t _windowCount;
+  uint32_t _fixesIn;
+  uint32_t _fixesOut;
+};
+
+#endif
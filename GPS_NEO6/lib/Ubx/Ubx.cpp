@@ -0,0 +1,290 @@
+#include "Ubx.h"
+#include <string.h>
+
+// ------------------- Frame Building -------------------
+
+void ubxChecksum(const uint8_t *data, size_t length, uint8_t &ckA, uint8_t &ckB)
+{
+  ckA = 0;
+  ckB = 0;
+  for (size_t i = 0; i < length; i++)
+  {
+    ckA += data[i];
+    ckB += ckA;
+  }
+}
+
+size_t ubxBuildFrame(uint8_t *out, size_t size, uint8_t msgClass, uint8_t msgId,
+                     const uint8_t *payload, uint16_t length)
+{
+  size_t total = (size_t)length + UBX_FRAME_OVERHEAD;
+  if (size < total)
+  {
+    return 0;
+  }
+
+  out[0] = UBX_SYNC_1;
+  out[1] = UBX_SYNC_2;
+  out[2] = msgClass;
+  out[3] = msgId;
+  ubxPutU16(out + 4, length);
+  if (length > 0)
+  {
+    memcpy(out + 6, payload, length);
+  }
+
+  // Checksum covers everything between the sync bytes and the checksum
+  ubxChecksum(out + 2, (size_t)length + 4, out[total - 2], out[total - 1]);
+  return total;
+}
+
+void ubxPutU16(uint8_t *p, uint16_t value)
+{
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+void ubxPutU32(uint8_t *p, uint32_t value)
+{
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+  p[2] = (uint8_t)(value >> 16);
+  p[3] = (uint8_t)(value >> 24);
+}
+
+uint16_t ubxGetU16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+uint32_t ubxGetU32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ------------------- Receiver Aiding -------------------
+
+// AID-INI flags
+#define UBX_AID_INI_POS 0x0001  // Position valid
+#define UBX_AID_INI_TIME 0x0002 // Time valid
+#define UBX_AID_INI_LLA 0x0020  // Position given as lat/lon/alt instead of ECEF
+
+void ubxAidIniPayload(uint8_t *payload, const UbxAidIni &aid)
+{
+  memset(payload, 0, UBX_AID_INI_LEN);
+  uint32_t flags = 0;
+
+  if (aid.positionValid)
+  {
+    ubxPutU32(payload + 0, (uint32_t)aid.latE7);
+    ubxPutU32(payload + 4, (uint32_t)aid.lngE7);
+    ubxPutU32(payload + 8, (uint32_t)aid.altCm);
+    ubxPutU32(payload + 12, aid.posAccCm);
+    flags |= UBX_AID_INI_POS | UBX_AID_INI_LLA;
+  }
+
+  if (aid.timeValid)
+  {
+    // tmCfg (16) stays 0: time is not tied to an external time mark
+    ubxPutU16(payload + 18, aid.week);
+    ubxPutU32(payload + 20, aid.towMs);
+    ubxPutU32(payload + 28, aid.tAccMs);
+    flags |= UBX_AID_INI_TIME;
+  }
+
+  ubxPutU32(payload + 44, flags);
+}
+
+// ------------------- Frame Parsing -------------------
+
+UbxParser::UbxParser()
+    : _state(SYNC_1), _class(0), _id(0), _length(0), _index(0),
+      _ckA(0), _ckB(0), _receivedCkA(0), _passed(0), _failed(0)
+{
+}
+
+void UbxParser::checksumByte(uint8_t c)
+{
+  _ckA += c;
+  _ckB += _ckA;
+}
+
+bool UbxParser::encode(uint8_t c)
+{
+  switch (_state)
+  {
+  case SYNC_1:
+    if (c == UBX_SYNC_1)
+      _state = SYNC_2;
+    break;
+
+  case SYNC_2:
+    if (c == UBX_SYNC_2)
+      _state = CLASS;
+    else
+      _state = (c == UBX_SYNC_1) ? SYNC_2 : SYNC_1;
+    break;
+
+  case CLASS:
+    _ckA = 0;
+    _ckB = 0;
+    checksumByte(c);
+    _class = c;
+    _state = ID;
+    break;
+
+  case ID:
+    checksumByte(c);
+    _id = c;
+    _state = LENGTH_1;
+    break;
+
+  case LENGTH_1:
+    checksumByte(c);
+    _length = c;
+    _state = LENGTH_2;
+    break;
+
+  case LENGTH_2:
+    checksumByte(c);
+    _length |= (uint16_t)c << 8;
+    _index = 0;
+    if (_length > UBX_MAX_PAYLOAD)
+    {
+      // Not something we decode; resynchronise on the next frame
+      _state = SYNC_1;
+    }
+    else
+    {
+      _state = _length > 0 ? PAYLOAD : CK_A;
+    }
+    break;
+
+  case PAYLOAD:
+    checksumByte(c);
+    _payload[_index++] = c;
+    if (_index >= _length)
+      _state = CK_A;
+    break;
+
+  case CK_A:
+    _receivedCkA = c;
+    _state = CK_B;
+    break;
+
+  case CK_B:
+    _state = SYNC_1;
+    if (_receivedCkA == _ckA && c == _ckB)
+    {
+      _passed++;
+      return true;
+    }
+    _failed++;
+    break;
+  }
+  return false;
+}
+
+// ------------------- Navigation Decoding -------------------
+
+#define NAV_GOT_POSLLH 0x01
+#define NAV_GOT_DOP 0x02
+#define NAV_GOT_SOL 0x04
+#define NAV_GOT_VELNED 0x08
+#define NAV_GOT_ALL (NAV_GOT_POSLLH | NAV_GOT_DOP | NAV_GOT_SOL | NAV_GOT_VELNED)
+
+#define NAV_SOL_FLAG_GPS_FIX_OK 0x01
+#define NAV_SOL_FLAG_WEEK_VALID 0x04
+#define NAV_SOL_FLAG_TOW_VALID 0x08
+#define NAV_SOL_FIX_2D 0x02
+#define NAV_SOL_FIX_3D 0x03
+
+UbxNavDecoder::UbxNavDecoder() : _iTow(0), _week(0), _received(0), _valid(false)
+{
+  memset(&_fix, 0, sizeof(_fix));
+}
+
+void UbxNavDecoder::startEpoch(uint32_t iTow)
+{
+  if (iTow != _iTow)
+  {
+    _iTow = iTow;
+    _received = 0;
+    _valid = false;
+  }
+}
+
+bool UbxNavDecoder::handle(const UbxParser &parser, GpsFix &fix)
+{
+  if (parser.msgClass() != UBX_CLASS_NAV)
+  {
+    return false;
+  }
+
+  const uint8_t *p = parser.payload();
+  uint16_t length = parser.length();
+
+  switch (parser.msgId())
+  {
+  case UBX_NAV_POSLLH:
+    if (length < 28)
+      return false;
+    startEpoch(ubxGetU32(p));
+    _fix.lngE7 = (int32_t)ubxGetU32(p + 4);
+    _fix.latE7 = (int32_t)ubxGetU32(p + 8);
+    _fix.altCm = (int32_t)ubxGetU32(p + 16) / 10; // hMSL is in millimeters
+    _received |= NAV_GOT_POSLLH;
+    break;
+
+  case UBX_NAV_DOP:
+    if (length < 18)
+      return false;
+    startEpoch(ubxGetU32(p));
+    _fix.hdop = ubxGetU16(p + 12);
+    _received |= NAV_GOT_DOP;
+    break;
+
+  case UBX_NAV_SOL:
+    if (length < 52)
+      return false;
+    startEpoch(ubxGetU32(p));
+    _fix.satellites = p[47];
+    _week = (p[11] & NAV_SOL_FLAG_WEEK_VALID) && (p[11] & NAV_SOL_FLAG_TOW_VALID) ? ubxGetU16(p + 8) : 0;
+    _valid = (p[11] & NAV_SOL_FLAG_GPS_FIX_OK) &&
+             (p[10] == NAV_SOL_FIX_2D || p[10] == NAV_SOL_FIX_3D);
+    _received |= NAV_GOT_SOL;
+    break;
+
+  case UBX_NAV_VELNED:
+  {
+    if (length < 36)
+      return false;
+    startEpoch(ubxGetU32(p));
+    uint32_t groundSpeed = ubxGetU32(p + 20);            // cm/s
+    int32_t heading = (int32_t)ubxGetU32(p + 24) / 1000; // 1e-5 deg to 1e-2 deg
+    _fix.speedCms = groundSpeed > 0xFFFF ? 0xFFFF : (uint16_t)groundSpeed;
+    _fix.courseCd = (uint16_t)(((heading % 36000) + 36000) % 36000);
+    _received |= NAV_GOT_VELNED;
+    break;
+  }
+
+  default:
+    return false;
+  }
+
+  if (_received != NAV_GOT_ALL)
+  {
+    return false;
+  }
+
+  // Report each epoch once
+  _received = 0;
+  if (!_valid)
+  {
+    return false;
+  }
+  fix = _fix;
+  fix.time = _week != 0 ? gpsWeekToUnixTime(_week, _iTow) : 0;
+  fix.timeMs = (uint16_t)(_iTow % 1000);
+  return true;
+}
@@ -0,0 +1,177 @@
+#ifndef UBX_H
+#define UBX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <GpsFix.h>
+
+// ------------------- UBX Protocol Constants -------------------
+
+#define UBX_SYNC_1 0xB5
+#define UBX_SYNC_2 0x62
+#define UBX_FRAME_OVERHEAD 8 // Sync (2) + class/id (2) + length (2) + checksum (2)
+#define UBX_MAX_PAYLOAD 64   // Largest payload this firmware needs to receive
+
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_CLASS_AID 0x0B
+#define UBX_CLASS_NMEA 0xF0
+
+#define UBX_NAV_POSLLH 0x02
+#define UBX_NAV_DOP 0x04
+#define UBX_NAV_SOL 0x06
+#define UBX_NAV_VELNED 0x12
+
+#define UBX_ACK_NAK 0x00
+#define UBX_ACK_ACK 0x01
+
+#define UBX_CFG_PRT 0x00
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_RATE 0x08
+
+#define UBX_AID_INI 0x01
+#define UBX_AID_INI_LEN 48
+
+#define UBX_NMEA_GGA 0x00
+#define UBX_NMEA_GLL 0x01
+#define UBX_NMEA_GSA 0x02
+#define UBX_NMEA_GSV 0x03
+#define UBX_NMEA_RMC 0x04
+#define UBX_NMEA_VTG 0x05
+
+// ------------------- Frame Building -------------------
+
+/**
+ * @brief Compute the 8-bit Fletcher checksum over class, id, length and payload.
+ */
+void ubxChecksum(const uint8_t *data, size_t length, uint8_t &ckA, uint8_t &ckB);
+
+/**
+ * @brief Write a complete UBX frame into `out`.
+ *
+ * @return Frame length, or 0 if `size` is too small.
+ */
+size_t ubxBuildFrame(uint8_t *out, size_t size, uint8_t msgClass, uint8_t msgId,
+                     const uint8_t *payload, uint16_t length);
+
+// Little-endian helpers for payload construction and decoding
+void ubxPutU16(uint8_t *p, uint16_t value);
+void ubxPutU32(uint8_t *p, uint32_t value);
+uint16_t ubxGetU16(const uint8_t *p);
+uint32_t ubxGetU32(const uint8_t *p);
+
+// ------------------- Receiver Aiding -------------------
+
+/**
+ * @brief Initial position and time handed to the receiver after a power cycle.
+ */
+struct UbxAidIni
+{
+  bool positionValid;
+  int32_t latE7;
+  int32_t lngE7;
+  int32_t altCm;     // Above the ellipsoid
+  uint32_t posAccCm; // 1-sigma accuracy of the position
+  bool timeValid;
+  uint16_t week;     // GPS week
+  uint32_t towMs;    // GPS time of week
+  uint32_t tAccMs;   // Accuracy of the time
+};
+
+/**
+ * @brief Fill the UBX_AID_INI_LEN byte payload of an AID-INI message.
+ *
+ * The position is sent as latitude/longitude/altitude (LLA flag), the
+ * time as GPS week and time of week, no clock drift or frequency.
+ */
+void ubxAidIniPayload(uint8_t *payload, const UbxAidIni &aid);
+
+// ------------------- Frame Parsing -------------------
+
+/**
+ * @brief Byte-at-a-time UBX frame parser.
+ *
+ * Bytes that are not part of a UBX frame (e.g. interleaved NMEA text) are
+ * skipped. Frames with a payload larger than UBX_MAX_PAYLOAD are dropped.
+ */
+class UbxParser
+{
+public:
+  UbxParser();
+
+  /**
+   * @brief Feed one byte.
+   *
+   * @return true when a complete frame with a valid checksum is available.
+   */
+  bool encode(uint8_t c);
+
+  uint8_t msgClass() const { return _class; }
+  uint8_t msgId() const { return _id; }
+  uint16_t length() const { return _length; }
+  const uint8_t *payload() const { return _payload; }
+
+  uint32_t passedChecksum() const { return _passed; }
+  uint32_t failedChecksum() const { return _failed; }
+
+private:
+  enum State
+  {
+    SYNC_1,
+    SYNC_2,
+    CLASS,
+    ID,
+    LENGTH_1,
+    LENGTH_2,
+    PAYLOAD,
+    CK_A,
+    CK_B
+  };
+
+  void checksumByte(uint8_t c);
+
+  State _state;
+  uint8_t _class;
+  uint8_t _id;
+  uint16_t _length;
+  uint16_t _index;
+  uint8_t _ckA;
+  uint8_t _ckB;
+  uint8_t _receivedCkA;
+  uint8_t _payload[UBX_MAX_PAYLOAD];
+  uint32_t _passed;
+  uint32_t _failed;
+};
+
+// ------------------- Navigation Decoding -------------------
+
+/**
+ * @brief Assembles NAV-POSLLH, NAV-DOP, NAV-SOL and NAV-VELNED into a GpsFix.
+ *
+ * The receiver emits one of each per navigation epoch; a fix is produced
+ * once all four with the same iTOW have arrived and the solution is valid.
+ */
+class UbxNavDecoder
+{
+public:
+  UbxNavDecoder();
+
+  /**
+   * @brief Consume a parsed frame.
+   *
+   * @return true when `fix` has been filled with a new position.
+   */
+  bool handle(const UbxParser &parser, GpsFix &fix);
+
+private:
+  void startEpoch(uint32_t iTow);
+
+  uint32_t _iTow;
+  uint16_t _week;
+  uint8_t _received;
+  bool _valid;
+  GpsFix _fix;
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "UbxConfig.h"
+
+#define UBX_PORT_UART1 1
+#define UBX_PORT_MODE_8N1 0x000008D0
+#define UBX_PROTO_UBX 0x0001
+#define UBX_PROTO_NMEA 0x0002
+#define UBX_BAUD_SETTLE_MS 100 // Time the receiver needs to apply a new baud rate
+#define UBX_CFG_PRT_LENGTH 20
+#define UBX_CFG_RATE_LENGTH 6
+
+UbxConfigurator::UbxConfigurator(Stream &port, SetBaudFunction setBaud, uint32_t ackTimeoutMs)
+    : _port(port), _setBaud(setBaud), _ackTimeoutMs(ackTimeoutMs), _baud(0)
+{
+}
+
+bool UbxConfigurator::send(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length)
+{
+  uint8_t frame[UBX_MAX_PAYLOAD + UBX_FRAME_OVERHEAD];
+  size_t frameLength = ubxBuildFrame(frame, sizeof(frame), msgClass, msgId, payload, length);
+  if (frameLength == 0)
+  {
+    return false;
+  }
+  _port.write(frame, frameLength);
+  _port.flush();
+  return true;
+}
+
+bool UbxConfigurator::sendWithAck(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length)
+{
+  return send(msgClass, msgId, payload, length) && waitForAck(msgClass, msgId);
+}
+
+bool UbxConfigurator::waitForAck(uint8_t msgClass, uint8_t msgId)
+{
+  unsigned long start = millis();
+  while (millis() - start < _ackTimeoutMs)
+  {
+    if (_port.available() <= 0)
+    {
+      delay(1);
+      continue;
+    }
+
+    if (!_parser.encode((uint8_t)_port.read()))
+      continue;
+    if (_parser.msgClass() != UBX_CLASS_ACK || _parser.length() < 2)
+      continue;
+    if (_parser.payload()[0] != msgClass || _parser.payload()[1] != msgId)
+      continue;
+
+    return _parser.msgId() == UBX_ACK_ACK;
+  }
+  return false;
+}
+
+bool UbxConfigurator::setMessageRate(uint8_t msgClass, uint8_t msgId, uint8_t rate)
+{
+  uint8_t payload[3] = {msgClass, msgId, rate};
+  return sendWithAck(UBX_CLASS_CFG, UBX_CFG_MSG, payload, sizeof(payload));
+}
+
+bool UbxConfigurator::configure(uint32_t factoryBaud, const UbxConfigOptions &options)
+{
+  // UBX-CFG-PRT: UART1, 8N1, UBX+NMEA in and out. Output is narrowed down
+  // per message below, so a partial failure never leaves the port silent.
+  uint8_t prt[UBX_CFG_PRT_LENGTH] = {0};
+  prt[0] = UBX_PORT_UART1;
+  ubxPutU32(prt + 4, UBX_PORT_MODE_8N1);
+  ubxPutU32(prt + 8, options.baud);
+  ubxPutU16(prt + 12, UBX_PROTO_UBX | UBX_PROTO_NMEA);
+  ubxPutU16(prt + 14, UBX_PROTO_UBX | UBX_PROTO_NMEA);
+
+  // The receiver is at the factory rate after a power cycle, but already at
+  // the target rate if only the ESP32 was reset, so send the change at both.
+  setBaud(factoryBaud);
+  send(UBX_CLASS_CFG, UBX_CFG_PRT, prt, sizeof(prt));
+  delay(UBX_BAUD_SETTLE_MS);
+
+  setBaud(options.baud);
+  send(UBX_CLASS_CFG, UBX_CFG_PRT, prt, sizeof(prt));
+  delay(UBX_BAUD_SETTLE_MS);
+
+  // UBX-CFG-RATE: measurement period, one solution per measurement, GPS time
+  uint8_t rate[UBX_CFG_RATE_LENGTH];
+  ubxPutU16(rate, options.measRateMs);
+  ubxPutU16(rate + 2, 1);
+  ubxPutU16(rate + 4, 1);
+  if (!sendWithAck(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate)) && !recoverBaud(factoryBaud, prt, rate))
+  {
+    return false;
+  }
+
+  // Sentences TinyGPSPlus never looks at. Best effort: leaving one enabled
+  // only costs bandwidth.
+  setMessageRate(UBX_CLASS_NMEA, UBX_NMEA_GLL, 0);
+  setMessageRate(UBX_CLASS_NMEA, UBX_NMEA_GSA, 0);
+  setMessageRate(UBX_CLASS_NMEA, UBX_NMEA_GSV, 0);
+  setMessageRate(UBX_CLASS_NMEA, UBX_NMEA_VTG, 0);
+
+  if (!options.ubxOutput)
+  {
+    return true;
+  }
+
+  // Enable the NAV messages before dropping GGA/RMC so there is always a
+  // usable position stream
+  bool ok = setMessageRate(UBX_CLASS_NAV, UBX_NAV_POSLLH, 1) &&
+            setMessageRate(UBX_CLASS_NAV, UBX_NAV_DOP, 1) &&
+            setMessageRate(UBX_CLASS_NAV, UBX_NAV_SOL, 1) &&
+            setMessageRate(UBX_CLASS_NAV, UBX_NAV_VELNED, 1) &&
+            setMessageRate(UBX_CLASS_NMEA, UBX_NMEA_GGA, 0) &&
+            setMessageRate(UBX_CLASS_NMEA, UBX_NMEA_RMC, 0);
+  if (!ok)
+  {
+    setMessageRate(UBX_CLASS_NMEA, UBX_NMEA_GGA, 1);
+    setMessageRate(UBX_CLASS_NMEA, UBX_NMEA_RMC, 1);
+  }
+  return ok;
+}
+
+/**
+ * @brief Find the receiver after CFG-RATE went unanswered at the new baud.
+ *
+ * Either CFG-PRT never took effect and the receiver is still at the
+ * factory rate, or it did and the reply was lost. Probe for an ACK at both
+ * rates; if neither answers, send CFG-PRT(factoryBaud) at the new rate so
+ * a receiver that did switch comes back to where the host ends up.
+ *
+ * @return true if the receiver answered at the new rate and took `rate`.
+ *         On false the host port is at `factoryBaud`.
+ */
+bool UbxConfigurator::recoverBaud(uint32_t factoryBaud, uint8_t *prt, const uint8_t *rate)
+{
+  uint32_t targetBaud = _baud;
+
+  setBaud(factoryBaud);
+  if (probe())
+  {
+    return false; // Still on factory settings, which NMEA works with
+  }
+
+  setBaud(targetBaud);
+  if (sendWithAck(UBX_CLASS_CFG, UBX_CFG_RATE, rate, UBX_CFG_RATE_LENGTH))
+  {
+    return true;
+  }
+
+  ubxPutU32(prt + 8, factoryBaud);
+  send(UBX_CLASS_CFG, UBX_CFG_PRT, prt, UBX_CFG_PRT_LENGTH);
+  delay(UBX_BAUD_SETTLE_MS);
+  setBaud(factoryBaud);
+  return false;
+}
+
+bool UbxConfigurator::probe()
+{
+  // Polling CFG-RATE changes nothing; the receiver answers with the
+  // current setting and an ACK
+  return sendWithAck(UBX_CLASS_CFG, UBX_CFG_RATE, nullptr, 0);
+}
+
+void UbxConfigurator::setBaud(uint32_t baud)
+{
+  _setBaud(baud);
+  _baud = baud;
+}
@@ -0,0 +1,72 @@
+#ifndef UBX_CONFIG_H
+#define UBX_CONFIG_H
+
+#include <Arduino.h>
+#include "Ubx.h"
+
+/**
+ * @brief Receiver settings applied by UbxConfigurator.
+ */
+struct UbxConfigOptions
+{
+  uint32_t baud;       // UART baud rate to switch the receiver to
+  uint16_t measRateMs; // Navigation measurement period (200 = 5 Hz, 100 = 10 Hz)
+  bool ubxOutput;      // Output binary NAV messages instead of NMEA
+};
+
+/**
+ * @brief Startup configuration stage for u-blox NEO-6 receivers.
+ *
+ * Sends UBX-CFG-PRT/RATE/MSG over any Stream. Changing the host side baud
+ * rate is delegated to a callback so the stage can run against a fake port.
+ * Settings are not saved to the receiver's BBR/flash and are reapplied at
+ * every boot.
+ */
+class UbxConfigurator
+{
+public:
+  typedef void (*SetBaudFunction)(uint32_t baud);
+
+  UbxConfigurator(Stream &port, SetBaudFunction setBaud, uint32_t ackTimeoutMs = 500);
+
+  /**
+   * @brief Move the receiver from `factoryBaud` to the requested settings.
+   *
+   * If the receiver does not answer at the new baud, it is probed at both
+   * rates and, when still silent, told to go back to `factoryBaud`.
+   *
+   * @return true if the requested output mode is active. On false the
+   *         receiver still outputs NMEA GGA/RMC at baud().
+   */
+  bool configure(uint32_t factoryBaud, const UbxConfigOptions &options);
+
+  /**
+   * @brief Baud rate the host side port was last switched to.
+   */
+  uint32_t baud() const { return _baud; }
+
+  /**
+   * @brief Send a UBX message without waiting for a reply.
+   */
+  bool send(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length);
+
+  /**
+   * @brief Send a CFG message and wait for the matching ACK-ACK.
+   */
+  bool sendWithAck(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length);
+
+private:
+  bool waitForAck(uint8_t msgClass, uint8_t msgId);
+  bool setMessageRate(uint8_t msgClass, uint8_t msgId, uint8_t rate);
+  bool recoverBaud(uint32_t factoryBaud, uint8_t *prt, const uint8_t *rate);
+  bool probe();
+  void setBaud(uint32_t baud);
+
+  Stream &_port;
+  SetBaudFunction _setBaud;
+  uint32_t _ackTimeoutMs;
+  uint32_t _baud;
+  UbxParser _parser;
+};
+
+#endif
@@ -1,7 +1,23 @@
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <WiFi.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <time.h>
 #include <TinyGPSPlus.h>
+#include <GpsFix.h>
+#include <GpsPayload.h>
+#include <SpscRing.h>
+#include <Ubx.h>
+#include <UbxConfig.h>
+#include <FixJournal.h>
+#include <TrackSimplifier.h>
+#include <TrackBatch.h>
+#include <GpsKalman.h>
+#include <Geofence.h>
+#include <ConnectionManager.h>
+#include <TaskMetrics.h>
+#include <LogQueue.h>
 
 // ------------------- Configuration -------------------
 
@@ -15,35 +31,247 @@ const uint16_t mqtt_port = 1883;           // MQTT Broker Port (default 1883)
 
 // MQTT Topics
 const char *mqtt_topic_gps = "gps";
-const char *mqtt_topic_count = "count"; // New topic for count
+const char *mqtt_topic_metrics = "gps/metrics"; // Runtime health, every `interval`
+const char *mqtt_topic_ingest = "gps/ingest"; // NMEA ingestion counters
+const char *mqtt_topic_replay = "gps/replay";   // Journaled fixes sent after reconnect
+const char *mqtt_topic_journal = "gps/journal"; // Journal counters
+const char *mqtt_topic_batch = "gps/batch";     // Binary multi-fix frames (batch mode)
+const char *mqtt_topic_geofence = "gps/geofence"; // Zone enter/exit/dwell events
+const char *mqtt_topic_tasks = "gps/tasks";       // CPU and stack use per task
 
 // UART settings for GPS
 #define GPS_RX_PIN 17 // GPIO17 (TX2) on ESP32
 #define GPS_TX_PIN 16 // GPIO16 (RX2) on ESP32
-#define GPS_BAUD 9600
+#define GPS_BAUD 9600           // NEO-6 factory default
+#define GPS_RX_BUFFER_SIZE 1024 // UART driver RX buffer (bytes)
+
+// Receiver configuration applied at boot (set GPS_CONFIGURE to 0 to keep factory settings)
+#define GPS_CONFIGURE 1
+#define GPS_FAST_BAUD 115200
+#define GPS_RATE_HZ 5 // 1, 2, 5 or 10 Hz
+#define GPS_USE_UBX 1 // Parse binary UBX NAV messages instead of NMEA
+
+// NMEA ingestion task settings; it shares core 1 with loop(), which
+// filters the fixes, and preempts it whenever bytes arrive
+#define GPS_TASK_CORE 1
+#define GPS_TASK_PRIORITY 3
+#define GPS_TASK_STACK_SIZE 4096
+#define GPS_FIX_QUEUE_SIZE 64 // Fixes buffered for loop() (power of two)
+#define LOOP_IDLE_MS 100      // loop() sleeps this long unless a fix wakes it
+
+// Networking task: WiFi, MQTT, the journal and all publishing run on
+// core 0 next to the WiFi stack, so a stalled broker or a slow flash
+// commit never holds up ingestion or filtering
+#define NET_TASK_CORE 0
+#define NET_TASK_PRIORITY 1
+#define NET_TASK_STACK_SIZE 8192
+#define NET_IDLE_MS 10
+#define PUBLISH_QUEUE_SIZE 32 // Selected fixes waiting for the network task (power of two)
+#define ZONE_QUEUE_SIZE 8     // Geofence events waiting for the network task (power of two)
+
+// Store-and-forward journal replay, kept slow enough not to starve live fixes
+#define JOURNAL_REPLAY_BATCH 10        // Fixes per replay burst
+#define JOURNAL_REPLAY_INTERVAL_MS 250 // Minimum time between bursts
+
+// Connection handling: failed attempts back off from NET_BACKOFF_MIN_MS to
+// NET_BACKOFF_MAX_MS with jitter, and a broker attempt never holds up
+// the network task for more than NET_CONNECT_TIMEOUT_MS
+#define MQTT_CLIENT_ID "ESP32GPSClient"
+#define NET_JOIN_TIMEOUT_MS 15000
+#define NET_CONNECT_TIMEOUT_MS 2000
+#define NET_BACKOFF_MIN_MS 1000
+#define NET_BACKOFF_MAX_MS 60000
+
+// Constant-velocity Kalman smoothing (set GPS_KALMAN to 0 to publish raw fixes)
+#define GPS_KALMAN 1
+#define KALMAN_UERE_CM 500         // Position error at HDOP 1.0
+#define KALMAN_ACCEL_CMS2 100      // Acceleration noise
+#define KALMAN_MAX_GAP_MS 5000     // Restart after a longer gap between fixes
+#define KALMAN_MAX_JUMP_CM 10000   // Restart when the receiver jumps further
+#define KALMAN_CYCLE_BUDGET 20000  // CPU cycles allowed per update (~83 us at 240 MHz)
+
+// Motion-adaptive publishing (set GPS_ADAPTIVE to 0 to publish every fix)
+#define GPS_ADAPTIVE 1
+#define ADAPTIVE_TOLERANCE_M 5.0f       // Max error of the published track
+#define ADAPTIVE_DEADBAND_M 10.0f       // Jitter ignored while parked
+#define ADAPTIVE_STATIONARY_SPEED 0.5f  // m/s
+#define ADAPTIVE_HEADING_CHANGE 30.0f   // Degrees
+#define ADAPTIVE_HEARTBEAT_MS 60000     // Max interval between publishes
+
+// Batch mode: pack fixes into delta-encoded binary frames on gps/batch
+// instead of one JSON message per fix
+#define GPS_BATCH 0
+#define GPS_BATCH_MAX_FIXES 50      // Publish once this many fixes are collected
+#define GPS_BATCH_MAX_AGE_MS 10000  // ...or once the oldest fix is this old
+#define MQTT_BUFFER_SIZE 1024       // Room for a full batch frame
+#define STATS_PAYLOAD_MAX_LEN 512   // Counter topics (gps/ingest, gps/journal)
+
+// On-device geofencing (zones are read from GEOFENCE_FILE on LittleFS)
+#define GPS_GEOFENCE 1
+#define GPS_GEOFENCE_ONLY 0           // Publish zone events only, no position stream
+#define GEOFENCE_FILE "/geofences.txt"
+#define GEOFENCE_DWELL_MS 300000      // Time inside a zone before a dwell event
+#define GEOFENCE_LINE_MAX_LEN 96
+
+// Hot start: the last good fix is kept in NVS and handed back to the
+// receiver with UBX-AID-INI at boot, together with NTP time
+#define GPS_AIDING 1
+#define AIDING_SAVE_INTERVAL_MS 600000 // Limits NVS wear while moving
+#define AIDING_MAX_HDOP 500            // Only cache fixes with HDOP up to 5.0
+#define AIDING_POS_ACC_M 5000          // Distance the asset may move while off
+#define AIDING_TIME_ACC_MS 1000        // NTP over WiFi, with margin
+#define AIDING_NTP_TIMEOUT_MS 15000    // From boot, covers the WiFi association
+#define EPHEMERIS_VALID_S 14400UL      // Broadcast ephemeris is good for ~4 hours
+#define ALMANAC_VALID_S 7776000UL      // Almanac is usable for months
+const char *ntp_server = "pool.ntp.org";
 
 // ------------------- Global Objects -------------------
 
 WiFiClient espClient;
 PubSubClient client(espClient);
+ConnectionManager net(client, espClient);
 TinyGPSPlus gps;
 
 // Create a HardwareSerial instance for GPS
 HardwareSerial gpsSerial(2); // UART2
 
-// ------------------- Global Variables -------------------
+// Decoded fixes handed from the ingestion task to loop()
+SpscRing<GpsFix, GPS_FIX_QUEUE_SIZE> fixQueue;
+TaskHandle_t gpsTaskHandle = NULL;
+
+// A zone transition and the fix that caused it
+struct ZoneEvent
+{
+  GeofenceEvent event;
+  GpsFix fix;
+};
+
+// Filtered fixes and zone events handed from loop() to the network task
+SpscRing<GpsFix, PUBLISH_QUEUE_SIZE> publishQueue;
+SpscRing<ZoneEvent, ZONE_QUEUE_SIZE> zoneQueue;
+TaskHandle_t netTaskHandle = NULL;
+TaskHandle_t ioTaskHandle = NULL; // Arduino's loop() task
+
+// CPU and stack use of each task
+TaskMetrics netMetrics("net");
+TaskMetrics ioMetrics("io");
+TaskMetrics gpsMetrics("gps");
+
+// Once the network task runs it is the only one printing; loop() queues
+// its lines here
+LogQueue ioLog(Serial);
+
+// Binary protocol decoders, used when the receiver accepted UBX output
+UbxParser ubxParser;
+UbxNavDecoder ubxNav;
+bool gpsUbxMode = false;
+
+// Smooths receiver jitter before any other processing
+GpsKalman kalman({KALMAN_UERE_CM, KALMAN_ACCEL_CMS2, KALMAN_MAX_GAP_MS, KALMAN_MAX_JUMP_CM});
+uint32_t kalmanUpdates = 0;
+uint64_t kalmanCyclesTotal = 0;
+volatile uint32_t kalmanCyclesAvg = 0; // Kept up to date for the network task
+volatile uint32_t kalmanCyclesMax = 0;
+volatile uint32_t kalmanOverruns = 0; // Updates over KALMAN_CYCLE_BUDGET
+
+// Decides which fixes are worth uploading
+TrackSimplifier simplifier({ADAPTIVE_TOLERANCE_M, ADAPTIVE_DEADBAND_M, ADAPTIVE_STATIONARY_SPEED,
+                            ADAPTIVE_HEADING_CHANGE, ADAPTIVE_HEARTBEAT_MS});
+
+// Current batch frame, plus the raw fixes so they can be journaled on failure
+TrackBatchEncoder batch;
+GpsFix batchFixes[GPS_BATCH_MAX_FIXES];
+unsigned long batchStartMillis = 0;
+uint32_t batchesPublished = 0;
+uint32_t batchBytes = 0;
+uint32_t batchedFixes = 0;
+
+// Fixes taken while the broker is unreachable
+FixJournal journal(LittleFS);
+bool journalReady = false;
 
-// Count variable
-unsigned long count = 0;
+// Zone transitions detected on the device
+GeofenceEngine geofence(GEOFENCE_DWELL_MS);
+volatile uint32_t geofenceEvents = 0;
+volatile uint32_t geofenceEvalMaxUs = 0;
+uint32_t geofenceDropped = 0; // Events lost while the broker was unreachable
+
+// Last good fix, persisted for the next boot. loop() picks the fix and the
+// network task writes it, so the NVS write never holds up fix handling
+struct AidingCache
+{
+  int32_t latE7;
+  int32_t lngE7;
+  int32_t altCm;
+  uint32_t time; // Unix seconds of the fix, also dates the receiver's ephemeris
+};
+SpscRing<AidingCache, 2> aidingQueue;
+unsigned long lastCacheSave = 0;
+bool cacheSaved = false;
+bool aidingSent = false;
+
+// Time to first fix since boot, and the start the cache allowed for
+volatile uint32_t ttffMs = 0;
+const char *startMode = "cold";
+
+// ------------------- Global Variables -------------------
 
 // Timing variables
 unsigned long previousMillis = 0;
-const long interval = 10000; // Interval at which to publish count (milliseconds)
+const long interval = 10000; // Interval at which to publish metrics (milliseconds)
+
+// Runtime metrics, since boot
+uint32_t fixesPublished = 0; // Live, replayed and batched
+uint32_t mqttReconnects = 0;
+
+// Ingestion counters, written by the GPS task only
+volatile uint32_t uartBytes = 0;     // Bytes fed to the NMEA/UBX parser
+volatile uint32_t uartOverflows = 0; // RX FIFO/buffer overflows reported by the driver
+volatile uint32_t droppedFixes = 0;  // Fixes lost because the queue was full
+volatile uint32_t queueDepth = 0;    // Fix queue fill after the last drain of the UART
+volatile uint32_t queueHighWater = 0;
+
+// Fixes and zone events loop() could not hand to the network task,
+// written by loop() only
+volatile uint32_t coreQueueFull = 0;
+
+// Journal replay state
+unsigned long lastReplayMillis = 0;
+unsigned long drainStartMillis = 0;
+bool journalDraining = false;
+uint32_t lastDrainMs = 0;       // Time the last backlog took to replay
+uint32_t replayedFixes = 0;
+uint32_t journalAppendMaxUs = 0; // Slowest append, including flash commits
 
 // ------------------- Function Prototypes -------------------
-void setup_wifi();
-void reconnect();
+void onConnectionChange(ConnectionState state);
 void callback(char *topic, byte *payload, unsigned int length);
+GpsFix readFix();
+bool decodeNmea(char c, GpsFix &fix);
+void gpsTask(void *parameter);
+void onGpsReceive();
+void onGpsReceiveError(hardwareSerial_error_t error);
+void netTask(void *parameter);
+void publishIngestStats();
+void publishMetrics(const TaskUsage &loopUsage);
+void publishTaskStats(const TaskUsage *usage, size_t count);
+void configureGps();
+void setGpsBaud(uint32_t baud);
+bool publishFix(const char *topic, const GpsFix &fix);
+void storeFix(const GpsFix &fix);
+void handleFix(const GpsFix &fix);
+void publishQueuedFixes();
+void filterFix(GpsFix &fix);
+void batchFix(const GpsFix &fix);
+void flushBatch();
+void replayJournal();
+void publishJournalStats();
+void loadGeofences();
+void checkGeofences(const GpsFix &fix);
+void publishZoneEvents();
+void injectAiding();
+void saveAidingCache(const GpsFix &fix);
+void storeAidingCache();
 
 // ------------------- Setup Function -------------------
 
@@ -56,127 +284,971 @@ void setup()
   Serial.println("ESP32 GPS MQTT Publisher");
 
   // Initialize GPS Serial
+  gpsSerial.setRxBufferSize(GPS_RX_BUFFER_SIZE);
   gpsSerial.begin(GPS_BAUD, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
   Serial.println("GPS Serial Started");
 
-  // Initialize WiFi
-  setup_wifi();
+#if GPS_CONFIGURE
+  configureGps();
+#endif
+
+  // loop() runs in the task calling setup(); ingestion wakes it per fix
+  ioTaskHandle = xTaskGetCurrentTaskHandle();
+  ioMetrics.attach();
 
-  // Initialize MQTT
-  client.setServer(mqtt_server, mqtt_port);
+  // Start GPS ingestion in its own task so the UART is drained as bytes arrive
+  xTaskCreatePinnedToCore(gpsTask, "gpsTask", GPS_TASK_STACK_SIZE, NULL,
+                          GPS_TASK_PRIORITY, &gpsTaskHandle, GPS_TASK_CORE);
+  gpsSerial.onReceive(onGpsReceive);
+  gpsSerial.onReceiveError(onGpsReceiveError);
+
+  // Mount the journal, formatting the partition on first use
+  bool fsReady = LittleFS.begin(true);
+  journalReady = fsReady && journal.begin();
+  Serial.print("Journal ");
+  Serial.print(journalReady ? "ready, pending fixes: " : "unavailable");
+  if (journalReady)
+    Serial.print(journal.pending());
+  Serial.println();
+
+#if GPS_GEOFENCE
+  if (fsReady)
+    loadGeofences();
+#endif
+
+  // Initialize MQTT; WiFi and the broker are brought up by the network task
   client.setCallback(callback);
+  client.setBufferSize(MQTT_BUFFER_SIZE);
+  net.setStateCallback(onConnectionChange);
+  net.begin({ssid, password, mqtt_server, mqtt_port, MQTT_CLIENT_ID, NET_JOIN_TIMEOUT_MS,
+             NET_CONNECT_TIMEOUT_MS, NET_BACKOFF_MIN_MS, NET_BACKOFF_MAX_MS});
+
+#if GPS_AIDING
+  // Synchronised in the background once WiFi is up, see injectAiding()
+  configTime(0, 0, ntp_server);
+#endif
+
+  xTaskCreatePinnedToCore(netTask, "netTask", NET_TASK_STACK_SIZE, NULL,
+                          NET_TASK_PRIORITY, &netTaskHandle, NET_TASK_CORE);
 }
 
 // ------------------- Loop Function -------------------
 
 void loop()
 {
-  // Ensure MQTT connection
+  ioMetrics.beginPass();
+
+#if GPS_AIDING
+  // Aid the receiver as soon as NTP time is known, or without it after a while
+  if (!aidingSent && (time(nullptr) >= (time_t)GPS_UNIX_EPOCH_OFFSET || millis() >= AIDING_NTP_TIMEOUT_MS))
+  {
+    aidingSent = true;
+    injectAiding();
+  }
+#endif
+
+  // Handle every fix decoded by the ingestion task
+  GpsFix fix;
+  while (fixQueue.pop(fix))
+  {
+    handleFix(fix);
+  }
+
+  ioMetrics.endPass();
+
+  // Sleep until the ingestion task has a fix
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOOP_IDLE_MS));
+}
+
+// ------------------- Networking Task -------------------
+
+/**
+ * @brief Keep WiFi and MQTT up and publish everything loop() selected.
+ *
+ * Runs pinned to NET_TASK_CORE. Connection attempts, socket writes,
+ * journal and aiding cache flash writes and all console output after
+ * setup() happen here, so they only delay this task.
+ */
+void netTask(void *parameter)
+{
+  netMetrics.attach();
+  for (;;)
+  {
+    netMetrics.beginPass();
+
+    // Keep WiFi and MQTT up, one short step per pass
+    net.loop();
+
+    publishZoneEvents();
+    publishQueuedFixes();
+
+#if GPS_BATCH
+    // Do not let a slow trickle of fixes sit in the batch forever
+    if (batch.count() > 0 && millis() - batchStartMillis >= GPS_BATCH_MAX_AGE_MS)
+    {
+      flushBatch();
+    }
+#endif
+
+    // Catch up on fixes taken while offline
+    replayJournal();
+
+#if GPS_AIDING
+    storeAidingCache();
+#endif
+    ioLog.flush();
+
+    // Publish metrics every 10 seconds
+    unsigned long currentMillis = millis();
+    if (currentMillis - previousMillis >= interval)
+    {
+      // Save the last time metrics were published
+      previousMillis = currentMillis;
+
+      TaskUsage usage[3] = {netMetrics.take(), ioMetrics.take(), gpsMetrics.take()};
+      publishMetrics(usage[1]);
+      publishTaskStats(usage, 3);
+      publishIngestStats();
+      publishJournalStats();
+
+      // Bound what a power loss can take with it
+      journal.flush();
+    }
+
+    netMetrics.endPass();
+
+    // Sleep until loop() queues something, or for one step of the connection
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NET_IDLE_MS));
+  }
+}
+
+// ------------------- Publishing and Journal Replay -------------------
+
+/**
+ * @brief Filter a fix and queue it for publishing.
+ *
+ * In adaptive mode only the fixes kept by the track simplifier are sent.
+ */
+void handleFix(const GpsFix &raw)
+{
+  if (ttffMs == 0)
+  {
+    ttffMs = millis();
+    ioLog.printf("Time to first fix: %lu ms", (unsigned long)ttffMs);
+  }
+#if GPS_AIDING
+  saveAidingCache(raw);
+#endif
+
+  GpsFix fix = raw;
+#if GPS_KALMAN
+  filterFix(fix);
+#endif
+
+#if GPS_GEOFENCE
+  checkGeofences(fix);
+#if GPS_GEOFENCE_ONLY
+  return;
+#endif
+#endif
+
+#if GPS_ADAPTIVE
+  GpsFix selected[2];
+  size_t count = simplifier.update(fix, millis(), selected);
+#else
+  const GpsFix *selected = &fix;
+  size_t count = 1;
+#endif
+
+  for (size_t i = 0; i < count; i++)
+  {
+    if (!publishQueue.push(selected[i]))
+    {
+      coreQueueFull++;
+    }
+  }
+  if (count > 0)
+  {
+    xTaskNotifyGive(netTaskHandle);
+  }
+}
+
+/**
+ * @brief Publish the fixes loop() selected, journaling whatever cannot go out now.
+ */
+void publishQueuedFixes()
+{
+  GpsFix fix;
+  while (publishQueue.pop(fix))
+  {
+#if GPS_BATCH
+    batchFix(fix);
+#else
+    if (!publishFix(mqtt_topic_gps, fix))
+    {
+      storeFix(fix);
+    }
+#endif
+  }
+}
+
+/**
+ * @brief Run the Kalman filter on a fix and account for its CPU cost.
+ */
+void filterFix(GpsFix &fix)
+{
+  // Prefer receiver time so queued fixes keep their real spacing
+  uint32_t timeMs = fix.time != 0 ? fix.time * 1000 + fix.timeMs : millis();
+
+  uint32_t start = ESP.getCycleCount();
+  kalman.update(fix, timeMs);
+  uint32_t cycles = ESP.getCycleCount() - start;
+
+  kalmanUpdates++;
+  kalmanCyclesTotal += cycles;
+  kalmanCyclesAvg = (uint32_t)(kalmanCyclesTotal / kalmanUpdates);
+  if (cycles > kalmanCyclesMax)
+  {
+    kalmanCyclesMax = cycles;
+  }
+  if (cycles > KALMAN_CYCLE_BUDGET)
+  {
+    kalmanOverruns++;
+  }
+}
+
+/**
+ * @brief Add a fix to the current batch frame, publishing it when full.
+ */
+void batchFix(const GpsFix &fix)
+{
+  if (batch.count() >= GPS_BATCH_MAX_FIXES || !batch.add(fix))
+  {
+    flushBatch();
+    batch.add(fix);
+  }
+  if (batch.count() == 1)
+  {
+    batchStartMillis = millis();
+  }
+  batchFixes[batch.count() - 1] = fix;
+
+  if (batch.count() >= GPS_BATCH_MAX_FIXES)
+  {
+    flushBatch();
+  }
+}
+
+/**
+ * @brief Publish the current batch frame, journaling its fixes on failure.
+ */
+void flushBatch()
+{
+  uint16_t count = batch.count();
+  if (count == 0)
+  {
+    return;
+  }
+
+  if (client.connected() && client.publish(mqtt_topic_batch, batch.data(), batch.length()))
+  {
+    fixesPublished += count;
+    batchesPublished++;
+    batchBytes += batch.length();
+    batchedFixes += count;
+  }
+  else
+  {
+    for (uint16_t i = 0; i < count; i++)
+    {
+      storeFix(batchFixes[i]);
+    }
+  }
+  batch.reset();
+}
+
+/**
+ * @brief Publish one fix as JSON.
+ *
+ * @return false if the fix could not be handed to the broker.
+ */
+bool publishFix(const char *topic, const GpsFix &fix)
+{
   if (!client.connected())
   {
-    reconnect();
+    return false;
   }
-  client.loop();
 
-  // Read GPS data
-  while (gpsSerial.available() > 0)
+  // Serialize into a stack buffer to keep the heap untouched
+  char payload[GPS_PAYLOAD_MAX_LEN];
+  if (formatGpsPayload(payload, sizeof(payload), fix) == 0)
   {
-    char c = gpsSerial.read();
-    gps.encode(c);
+    return false;
   }
 
-  // If a new valid location is obtained, publish it
-  if (gps.location.isUpdated())
+  Serial.print("Publishing GPS Data: ");
+  Serial.println(payload);
+
+  if (!client.publish(topic, payload))
   {
-    String payload = "";
-    payload += "{";
-    payload += "\"latitude\": " + String(gps.location.lat(), 6) + ",";
-    payload += "\"longitude\": " + String(gps.location.lng(), 6) + ",";
-    payload += "\"altitude\": " + String(gps.altitude.meters()) + ",";
-    payload += "\"satellites\": " + String(gps.satellites.value()) + ",";
-    payload += "\"hdop\": " + String(gps.hdop.value() / 100.0);
-    payload += "}";
+    return false;
+  }
+  fixesPublished++;
+  return true;
+}
 
-    Serial.print("Publishing GPS Data: ");
-    Serial.println(payload);
+void storeFix(const GpsFix &fix)
+{
+  if (!journalReady)
+  {
+    return;
+  }
 
-    client.publish(mqtt_topic_gps, payload.c_str());
+  unsigned long start = micros();
+  journal.append(fix);
+  uint32_t elapsed = micros() - start;
+  if (elapsed > journalAppendMaxUs)
+  {
+    journalAppendMaxUs = elapsed;
   }
+}
 
-  // Publish count every 10 seconds
-  unsigned long currentMillis = millis();
-  if (currentMillis - previousMillis >= interval)
+/**
+ * @brief Send one burst of journaled fixes, at most every JOURNAL_REPLAY_INTERVAL_MS.
+ *
+ * A burst is only consumed from flash once all of it was published.
+ */
+void replayJournal()
+{
+  if (!journalReady || journal.pending() == 0 || !client.connected())
   {
-    // Save the last time count was published
-    previousMillis = currentMillis;
+    return;
+  }
 
-    // Increment count
-    count++;
+  unsigned long now = millis();
+  if (now - lastReplayMillis < JOURNAL_REPLAY_INTERVAL_MS)
+  {
+    return;
+  }
+  lastReplayMillis = now;
 
-    // Convert count to string
-    String countPayload = String(count);
+  if (!journalDraining)
+  {
+    journalDraining = true;
+    drainStartMillis = now;
+  }
 
-    // Publish count
-    Serial.print("Publishing Count: ");
-    Serial.println(countPayload);
+  GpsFix fixes[JOURNAL_REPLAY_BATCH];
+  size_t fixCount;
+  size_t records = journal.read(fixes, JOURNAL_REPLAY_BATCH, fixCount);
+  for (size_t i = 0; i < fixCount; i++)
+  {
+    if (!publishFix(mqtt_topic_replay, fixes[i]))
+    {
+      // Retry the whole burst later
+      return;
+    }
+  }
+  journal.consume(records);
+  replayedFixes += fixCount;
 
-    client.publish(mqtt_topic_count, countPayload.c_str());
+  if (journal.pending() == 0)
+  {
+    journalDraining = false;
+    lastDrainMs = millis() - drainStartMillis;
+    Serial.print("Journal drained in ");
+    Serial.print(lastDrainMs);
+    Serial.println(" ms");
   }
 }
 
-// ------------------- WiFi Setup Function -------------------
+void publishJournalStats()
+{
+  if (!journalReady)
+  {
+    return;
+  }
+
+  char payload[STATS_PAYLOAD_MAX_LEN];
+  PayloadWriter writer(payload, sizeof(payload));
+
+  writer.append("{\"pending\": ");
+  writer.appendUnsigned(journal.pending());
+  writer.append(",\"capacity\": ");
+  writer.appendUnsigned(journal.capacity());
+  writer.append(",\"appended\": ");
+  writer.appendUnsigned(journal.appended());
+  writer.append(",\"replayed\": ");
+  writer.appendUnsigned(replayedFixes);
+  writer.append(",\"overwritten\": ");
+  writer.appendUnsigned(journal.overwritten());
+  writer.append(",\"corrupted\": ");
+  writer.appendUnsigned(journal.corrupted());
+  writer.append(",\"appendMaxUs\": ");
+  writer.appendUnsigned(journalAppendMaxUs);
+  writer.append(",\"lastDrainMs\": ");
+  writer.appendUnsigned(lastDrainMs);
+  writer.appendChar('}');
+
+  if (writer.finish() > 0)
+  {
+    client.publish(mqtt_topic_journal, payload);
+  }
+}
+
+// ------------------- Geofencing -------------------
 
 /**
- * @brief Set up the WiFi connection.
+ * @brief Read the zone definitions from GEOFENCE_FILE and build the index.
+ *
+ * See GeofenceEngine::parseLine() for the file format. Malformed lines are
+ * reported and skipped.
  */
-void setup_wifi()
+void loadGeofences()
 {
-  delay(10);
-  Serial.println();
-  Serial.print("Connecting to ");
-  Serial.println(ssid);
+  File file = LittleFS.open(GEOFENCE_FILE, "r");
+  if (!file)
+  {
+    Serial.println("No geofences defined");
+    return;
+  }
 
-  // Begin WiFi connection
-  WiFi.begin(ssid, password);
+  char line[GEOFENCE_LINE_MAX_LEN];
+  uint16_t lineNumber = 0;
+  while (file.available())
+  {
+    size_t length = file.readBytesUntil('\n', line, sizeof(line) - 1);
+    line[length] = '\0';
+    lineNumber++;
+    if (!geofence.parseLine(line))
+    {
+      Serial.print("Geofence line ");
+      Serial.print(lineNumber);
+      Serial.println(" ignored");
+    }
+  }
+  file.close();
+
+  bool built = geofence.build();
+  Serial.print("Geofences loaded: ");
+  Serial.print(geofence.zoneCount());
+  Serial.println(built ? "" : " (index full, geofencing disabled)");
+}
+
+/**
+ * @brief Evaluate a fix against the zones and queue any transitions.
+ */
+void checkGeofences(const GpsFix &fix)
+{
+  GeofenceEvent events[GEOFENCE_MAX_EVENTS];
 
-  // Wait until connected
-  while (WiFi.status() != WL_CONNECTED)
+  unsigned long start = micros();
+  size_t count = geofence.evaluate(fix, millis(), events);
+  uint32_t elapsed = micros() - start;
+  if (elapsed > geofenceEvalMaxUs)
   {
-    delay(500);
-    Serial.print(".");
+    geofenceEvalMaxUs = elapsed;
   }
 
-  // Connected
-  Serial.println("");
-  Serial.println("WiFi connected");
-  Serial.print("IP address: ");
-  Serial.println(WiFi.localIP());
+  for (size_t i = 0; i < count; i++)
+  {
+    geofenceEvents++;
+    if (!zoneQueue.push({events[i], fix}))
+    {
+      coreQueueFull++;
+    }
+  }
+  if (count > 0)
+  {
+    xTaskNotifyGive(netTaskHandle);
+  }
+}
+
+/**
+ * @brief Publish the zone transitions loop() queued.
+ */
+void publishZoneEvents()
+{
+  static const char *const names[] = {"enter", "exit", "dwell"};
+  ZoneEvent zoneEvent;
+  while (zoneQueue.pop(zoneEvent))
+  {
+    const GpsFix &fix = zoneEvent.fix;
+    char payload[GPS_PAYLOAD_MAX_LEN];
+    PayloadWriter writer(payload, sizeof(payload));
+    writer.append("{\"zone\": ");
+    writer.appendUnsigned(zoneEvent.event.zoneId);
+    writer.append(",\"event\": \"");
+    writer.append(names[zoneEvent.event.type]);
+    writer.append("\",\"latitude\": ");
+    writer.appendFixed((fix.latE7 >= 0 ? fix.latE7 + 5 : fix.latE7 - 5) / 10, 6);
+    writer.append(",\"longitude\": ");
+    writer.appendFixed((fix.lngE7 >= 0 ? fix.lngE7 + 5 : fix.lngE7 - 5) / 10, 6);
+    if (fix.time != 0)
+    {
+      writer.append(",\"time\": ");
+      writer.appendUnsigned(fix.time);
+    }
+    writer.appendChar('}');
+
+    if (writer.finish() == 0 || !client.connected() || !client.publish(mqtt_topic_geofence, payload))
+    {
+      geofenceDropped++;
+      continue;
+    }
+    Serial.print("Geofence event: ");
+    Serial.println(payload);
+  }
 }
 
-// ------------------- MQTT Reconnect Function -------------------
+// ------------------- NMEA Ingestion Task -------------------
 
-void reconnect()
+/**
+ * @brief Called by the UART driver's event task when bytes arrive.
+ */
+void onGpsReceive()
 {
-  // Loop until reconnected
-  while (!client.connected())
+  xTaskNotifyGive(gpsTaskHandle);
+}
+
+/**
+ * @brief Called by the UART driver when received bytes had to be discarded.
+ */
+void onGpsReceiveError(hardwareSerial_error_t error)
+{
+  if (error == UART_BUFFER_FULL_ERROR || error == UART_FIFO_OVF_ERROR)
+  {
+    uartOverflows++;
+  }
+}
+
+/**
+ * @brief Drain the GPS UART and queue every decoded fix for loop().
+ *
+ * The task sleeps until the UART driver signals new data; the timeout only
+ * guards against a missed notification.
+ */
+void gpsTask(void *parameter)
+{
+  gpsMetrics.attach();
+  for (;;)
   {
-    Serial.print("Attempting MQTT connection...");
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    gpsMetrics.beginPass();
 
-    // Attempt to connect
-    if (client.connect("ESP32GPSClient"))
+    bool fixesQueued = false;
+    while (gpsSerial.available() > 0)
     {
-      Serial.println("connected");
-      // Subscribe to topics if needed
-      // client.subscribe("your_topic");
+      char c = gpsSerial.read();
+      uartBytes++;
+
+      GpsFix fix;
+      bool fixReady;
+      if (gpsUbxMode)
+      {
+        fixReady = ubxParser.encode((uint8_t)c) && ubxNav.handle(ubxParser, fix);
+      }
+      else
+      {
+        fixReady = decodeNmea(c, fix);
+      }
+
+      if (fixReady)
+      {
+        if (fixQueue.push(fix))
+        {
+          fixesQueued = true;
+        }
+        else
+        {
+          droppedFixes++;
+        }
+      }
+    }
+
+    // Only the two ends of the ring can read its size; the network task
+    // reports this copy
+    uint32_t depth = fixQueue.size();
+    queueDepth = depth;
+    if (depth > queueHighWater)
+    {
+      queueHighWater = depth;
     }
-    else
+    if (fixesQueued)
+    {
+      xTaskNotifyGive(ioTaskHandle);
+    }
+    gpsMetrics.endPass();
+  }
+}
+
+/**
+ * @brief Publish the runtime health record on gps/metrics.
+ *
+ * Loop rate, max loop latency and the net* connection counters cover the
+ * window since the last record; the other fields are totals since boot.
+ */
+void publishMetrics(const TaskUsage &loopUsage)
+{
+  char payload[STATS_PAYLOAD_MAX_LEN];
+  PayloadWriter writer(payload, sizeof(payload));
+
+  writer.append("{\"loopHz\": ");
+  writer.appendUnsigned(loopUsage.windowMs > 0 ? (uint32_t)((uint64_t)loopUsage.passes * 1000 / loopUsage.windowMs)
+                                               : 0);
+  writer.append(",\"loopMaxUs\": ");
+  writer.appendUnsigned(loopUsage.passMaxUs);
+  writer.append(",\"uartBytes\": ");
+  writer.appendUnsigned(uartBytes);
+  writer.append(",\"failedChecksum\": ");
+  writer.appendUnsigned(gpsUbxMode ? ubxParser.failedChecksum() : gps.failedChecksum());
+  writer.append(",\"fixesPublished\": ");
+  writer.appendUnsigned(fixesPublished);
+  writer.append(",\"mqttReconnects\": ");
+  writer.appendUnsigned(mqttReconnects);
+  ConnectionStats netStats = net.takeStats();
+  writer.append(",\"netBlockedMs\": ");
+  writer.appendUnsigned(netStats.blockedMs);
+  writer.append(",\"netBlockedMaxMs\": ");
+  writer.appendUnsigned(netStats.blockedMaxMs);
+  writer.append(",\"netBlockedMsPerHour\": ");
+  writer.appendUnsigned(netStats.blockedMsPerHour());
+  writer.append(",\"netOfflineMs\": ");
+  writer.appendUnsigned(netStats.offlineMs);
+  writer.append(",\"wifiJoinMs\": ");
+  writer.appendUnsigned(net.lastJoinMs());
+  writer.append(",\"fastJoin\": ");
+  writer.append(net.lastJoinFast() ? "true" : "false");
+  writer.append(",\"bootToOnlineMs\": ");
+  writer.appendUnsigned(net.bootToOnlineMs());
+  writer.append(",\"freeHeap\": ");
+  writer.appendUnsigned(ESP.getFreeHeap());
+  writer.append(",\"minFreeHeap\": ");
+  writer.appendUnsigned(ESP.getMinFreeHeap());
+  writer.append(",\"ttffMs\": ");
+  writer.appendUnsigned(ttffMs);
+  writer.append(",\"startMode\": \"");
+  writer.append(startMode);
+  writer.appendChar('"');
+  writer.appendChar('}');
+
+  if (writer.finish() > 0)
+  {
+    Serial.print("Publishing Metrics: ");
+    Serial.println(payload);
+    client.publish(mqtt_topic_metrics, payload);
+  }
+}
+
+/**
+ * @brief Publish each task's CPU share, longest pass and least free stack.
+ */
+void publishTaskStats(const TaskUsage *usage, size_t count)
+{
+  char payload[STATS_PAYLOAD_MAX_LEN];
+  if (formatTaskUsage(payload, sizeof(payload), usage, count) > 0)
+  {
+    client.publish(mqtt_topic_tasks, payload);
+  }
+}
+
+/**
+ * @brief Publish the ingestion counters used to prove no NMEA data is lost.
+ */
+void publishIngestStats()
+{
+  char payload[STATS_PAYLOAD_MAX_LEN];
+  PayloadWriter writer(payload, sizeof(payload));
+
+  writer.append("{\"uartBytes\": ");
+  writer.appendUnsigned(uartBytes);
+  writer.append(",\"sentences\": ");
+  writer.appendUnsigned(gpsUbxMode ? ubxParser.passedChecksum() : gps.passedChecksum());
+  writer.append(",\"failedChecksum\": ");
+  writer.appendUnsigned(gpsUbxMode ? ubxParser.failedChecksum() : gps.failedChecksum());
+  writer.append(",\"uartOverflows\": ");
+  writer.appendUnsigned(uartOverflows);
+  writer.append(",\"droppedFixes\": ");
+  writer.appendUnsigned(droppedFixes);
+  writer.append(",\"queueDepth\": ");
+  writer.appendUnsigned(queueDepth);
+  writer.append(",\"queueHighWater\": ");
+  writer.appendUnsigned(queueHighWater);
+  writer.append(",\"coreQueueFull\": ");
+  writer.appendUnsigned(coreQueueFull);
+  writer.append(",\"logDropped\": ");
+  writer.appendUnsigned(ioLog.dropped());
+#if GPS_BATCH
+  writer.append(",\"batches\": ");
+  writer.appendUnsigned(batchesPublished);
+  writer.append(",\"batchBytes\": ");
+  writer.appendUnsigned(batchBytes);
+  writer.append(",\"batchFixes\": ");
+  writer.appendUnsigned(batchedFixes);
+#endif
+#if GPS_KALMAN
+  writer.append(",\"kalmanCyclesAvg\": ");
+  writer.appendUnsigned(kalmanCyclesAvg);
+  writer.append(",\"kalmanCyclesMax\": ");
+  writer.appendUnsigned(kalmanCyclesMax);
+  writer.append(",\"kalmanOverruns\": ");
+  writer.appendUnsigned(kalmanOverruns);
+  writer.append(",\"kalmanResets\": ");
+  writer.appendUnsigned(kalman.resets());
+#endif
+#if GPS_ADAPTIVE
+  writer.append(",\"adaptiveIn\": ");
+  writer.appendUnsigned(simplifier.fixesIn());
+  writer.append(",\"adaptiveOut\": ");
+  writer.appendUnsigned(simplifier.fixesOut());
+#endif
+#if GPS_GEOFENCE
+  writer.append(",\"geofenceZones\": ");
+  writer.appendUnsigned(geofence.zoneCount());
+  writer.append(",\"geofenceEvents\": ");
+  writer.appendUnsigned(geofenceEvents);
+  writer.append(",\"geofenceDropped\": ");
+  writer.appendUnsigned(geofenceDropped);
+  writer.append(",\"geofenceEvalMaxUs\": ");
+  writer.appendUnsigned(geofenceEvalMaxUs);
+#endif
+  writer.appendChar('}');
+
+  if (writer.finish() > 0)
+  {
+    client.publish(mqtt_topic_ingest, payload);
+  }
+}
+
+// ------------------- GPS Receiver Configuration -------------------
+
+void setGpsBaud(uint32_t baud)
+{
+  gpsSerial.updateBaudRate(baud);
+}
+
+/**
+ * @brief Raise the NEO-6 fix rate and baud rate and trim its output.
+ *
+ * Falls back to NMEA parsing if the receiver does not acknowledge the
+ * UBX output settings.
+ */
+void configureGps()
+{
+  UbxConfigOptions options;
+  options.baud = GPS_FAST_BAUD;
+  options.measRateMs = 1000 / GPS_RATE_HZ;
+  options.ubxOutput = GPS_USE_UBX;
+
+  UbxConfigurator configurator(gpsSerial, setGpsBaud);
+  bool ok = configurator.configure(GPS_BAUD, options);
+  gpsUbxMode = ok && options.ubxOutput;
+
+  Serial.print("GPS configuration ");
+  Serial.print(ok ? "applied" : "failed");
+  Serial.print(", baud ");
+  Serial.print(configurator.baud());
+  Serial.println(gpsUbxMode ? ", UBX output" : ", NMEA output");
+}
+
+// ------------------- Startup Aiding -------------------
+
+/**
+ * @brief Feed the cached position and NTP time to the receiver.
+ *
+ * With both the receiver only has to confirm the satellites it expects
+ * instead of searching the whole sky. Whether that is a hot or warm start
+ * depends on how old the ephemeris kept in its battery-backed RAM is,
+ * which is estimated from the time of the cached fix.
+ */
+void injectAiding()
+{
+  UbxAidIni aid = UbxAidIni();
+
+  AidingCache cache;
+  Preferences prefs;
+  prefs.begin("gpsCache", true);
+  aid.positionValid = prefs.getBytes("fix", &cache, sizeof(cache)) == sizeof(cache);
+  prefs.end();
+  if (aid.positionValid)
+  {
+    // Cached altitude is above MSL; the geoid offset is well inside posAcc
+    aid.latE7 = cache.latE7;
+    aid.lngE7 = cache.lngE7;
+    aid.altCm = cache.altCm;
+    aid.posAccCm = AIDING_POS_ACC_M * 100UL;
+  }
+
+  uint32_t now = (uint32_t)time(nullptr);
+  aid.timeValid = now >= GPS_UNIX_EPOCH_OFFSET;
+  if (aid.timeValid)
+  {
+    gpsUnixToWeek(now, aid.week, aid.towMs);
+    aid.tAccMs = AIDING_TIME_ACC_MS;
+  }
+
+  if (aid.positionValid && aid.timeValid && now >= cache.time)
+  {
+    uint32_t age = now - cache.time;
+    startMode = age < EPHEMERIS_VALID_S ? "hot" : age < ALMANAC_VALID_S ? "warm" : "cold";
+  }
+
+  ioLog.printf("GPS aiding: position %s, time %s, expecting %s start", aid.positionValid ? "cached" : "unknown",
+               aid.timeValid ? "from NTP" : "unknown", startMode);
+
+  if (!aid.positionValid && !aid.timeValid)
+  {
+    return;
+  }
+
+  uint8_t payload[UBX_AID_INI_LEN];
+  uint8_t frame[UBX_AID_INI_LEN + UBX_FRAME_OVERHEAD];
+  ubxAidIniPayload(payload, aid);
+  size_t length = ubxBuildFrame(frame, sizeof(frame), UBX_CLASS_AID, UBX_AID_INI, payload, sizeof(payload));
+  gpsSerial.write(frame, length);
+}
+
+/**
+ * @brief Pick a good fix to remember for the next boot, at most every AIDING_SAVE_INTERVAL_MS.
+ *
+ * Only queues it; storeAidingCache() writes it from the network task.
+ */
+void saveAidingCache(const GpsFix &fix)
+{
+  if (fix.time == 0 || fix.hdop > AIDING_MAX_HDOP)
+  {
+    return;
+  }
+  if (cacheSaved && millis() - lastCacheSave < AIDING_SAVE_INTERVAL_MS)
+  {
+    return;
+  }
+  if (!aidingQueue.push({fix.latE7, fix.lngE7, fix.altCm, fix.time}))
+  {
+    return; // Try again with the next fix
+  }
+  cacheSaved = true;
+  lastCacheSave = millis();
+  xTaskNotifyGive(netTaskHandle);
+}
+
+/**
+ * @brief Write the fix saveAidingCache() picked to NVS.
+ */
+void storeAidingCache()
+{
+  AidingCache cache;
+  if (!aidingQueue.pop(cache))
+  {
+    return;
+  }
+  Preferences prefs;
+  prefs.begin("gpsCache", false);
+  prefs.putBytes("fix", &cache, sizeof(cache));
+  prefs.end();
+}
+
+// ------------------- GPS Fix Conversion -------------------
+
+/**
+ * @brief Feed one NMEA byte to TinyGPSPlus.
+ *
+ * GGA and RMC both carry the position, so location.isUpdated() is set
+ * twice per epoch. A fix is only taken once the epoch's GGA (altitude,
+ * HDOP) and RMC (speed, date) are both in and the receiver time differs
+ * from the last fix, which gives one fix per epoch whichever sentence the
+ * receiver sends first and lets a lost sentence delay a fix rather than
+ * duplicate one.
+ *
+ * @return true with `fix` set once per epoch.
+ */
+bool decodeNmea(char c, GpsFix &fix)
+{
+  static uint32_t lastEpoch = 0xFFFFFFFFUL; // gps.time.value() of the last fix
+
+  // encode() returns true at the end of each complete sentence
+  if (!gps.encode(c) || !gps.location.isUpdated() || !gps.altitude.isUpdated() || !gps.speed.isUpdated())
+  {
+    return false;
+  }
+  uint32_t epoch = gps.time.value();
+  if (epoch == lastEpoch)
+  {
+    return false;
+  }
+  lastEpoch = epoch;
+  fix = readFix(); // Reading the values clears their updated flags
+  return true;
+}
+
+/**
+ * @brief Convert the current TinyGPSPlus state into a fixed-point fix.
+ *
+ * Uses the raw degree fields so no float conversion is involved.
+ */
+GpsFix readFix()
+{
+  const RawDegrees &rawLat = gps.location.rawLat();
+  const RawDegrees &rawLng = gps.location.rawLng();
+
+  GpsFix fix = GpsFix();
+  fix.latE7 = (int32_t)(rawLat.deg * 10000000UL + (rawLat.billionths + 50) / 100);
+  fix.lngE7 = (int32_t)(rawLng.deg * 10000000UL + (rawLng.billionths + 50) / 100);
+  if (rawLat.negative)
+    fix.latE7 = -fix.latE7;
+  if (rawLng.negative)
+    fix.lngE7 = -fix.lngE7;
+  fix.altCm = gps.altitude.value();
+  fix.hdop = (uint16_t)gps.hdop.value();
+  fix.satellites = (uint8_t)gps.satellites.value();
+
+  // TinyGPSPlus reports speed in 1/100 knot and course in 1/100 degree
+  uint32_t knots100 = (uint32_t)gps.speed.value();
+  uint32_t speedCms = (knots100 * 5144 + 5000) / 10000;
+  fix.speedCms = speedCms > 0xFFFF ? 0xFFFF : (uint16_t)speedCms;
+  fix.courseCd = (uint16_t)(gps.course.value() % 36000);
+
+  if (gps.date.isValid() && gps.time.isValid())
+  {
+    fix.time = gpsUnixTime(gps.date.year(), gps.date.month(), gps.date.day(),
+                           gps.time.hour(), gps.time.minute(), gps.time.second());
+    fix.timeMs = gps.time.centisecond() * 10;
+  }
+  return fix;
+}
+
+// ------------------- Connection Events -------------------
+
+/**
+ * @brief Log connection changes and count broker reconnects.
+ */
+void onConnectionChange(ConnectionState state)
+{
+  static bool everConnected = false;
+  switch (state)
+  {
+  case NET_WIFI_JOINING:
+    Serial.print("Connecting to ");
+    Serial.println(ssid);
+    break;
+  case NET_MQTT_DOWN:
+    Serial.print("WiFi up, IP address ");
+    Serial.print(WiFi.localIP());
+    Serial.println(", connecting to MQTT");
+    break;
+  case NET_ONLINE:
+    Serial.println("MQTT connected");
+    if (everConnected)
     {
-      Serial.print("failed, rc=");
-      Serial.print(client.state());
-      Serial.println(" try again in 5 seconds");
-      // Wait before retrying
-      delay(5000);
+      mqttReconnects++;
     }
+    everConnected = true;
+    // Subscribe to topics if needed
+    // client.subscribe("your_topic");
+    break;
+  case NET_WIFI_DOWN:
+    Serial.println("WiFi down, retrying with backoff");
+    break;
   }
 }
 
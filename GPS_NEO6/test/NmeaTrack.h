@@ -0,0 +1,132 @@
+#ifndef NMEA_TRACK_H
+#define NMEA_TRACK_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <time.h>
+
+// Synthetic receiver output for the host tests: a known true track, and the
+// RMC/GGA pair a NEO-6 would send for each epoch of it.
+
+#define NMEA_EARTH_RADIUS_M 6371000.0
+#define NMEA_KNOTS_PER_MS 1.943844
+
+/**
+ * @brief One epoch of a track: where the asset is and how it moves.
+ */
+struct TrackPoint
+{
+  double lat;      // Degrees
+  double lng;
+  double altM;
+  double speedMs;
+  double courseDeg;
+  uint32_t time;   // Unix seconds
+  uint16_t timeMs; // Multiple of 10
+  double hdop;
+  uint8_t satellites;
+};
+
+/**
+ * @brief Move `point` by `metres` along `courseDeg` (flat earth, fine below a few km).
+ */
+inline void trackMove(TrackPoint &point, double courseDeg, double metres)
+{
+  double course = courseDeg * M_PI / 180.0;
+  point.lat += metres * cos(course) / NMEA_EARTH_RADIUS_M * 180.0 / M_PI;
+  point.lng += metres * sin(course) / (NMEA_EARTH_RADIUS_M * cos(point.lat * M_PI / 180.0)) * 180.0 / M_PI;
+}
+
+/**
+ * @brief Distance between two positions in metres (flat earth).
+ */
+inline double trackDistanceM(double lat1, double lng1, double lat2, double lng2)
+{
+  double north = (lat2 - lat1) * M_PI / 180.0 * NMEA_EARTH_RADIUS_M;
+  double east = (lng2 - lng1) * M_PI / 180.0 * NMEA_EARTH_RADIUS_M * cos(lat1 * M_PI / 180.0);
+  return sqrt(north * north + east * east);
+}
+
+/**
+ * @brief Wrap `body` (without '$') into a sentence with its checksum.
+ */
+inline std::string nmeaSentence(const std::string &body)
+{
+  uint8_t checksum = 0;
+  for (size_t i = 0; i < body.size(); i++)
+  {
+    checksum ^= (uint8_t)body[i];
+  }
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", checksum);
+  return "$" + body + tail;
+}
+
+/**
+ * @brief Degrees as NMEA ddmm.mmmmm / dddmm.mmmmm plus hemisphere.
+ */
+inline std::string nmeaDegrees(double degrees, bool longitude)
+{
+  char hemisphere = longitude ? (degrees < 0 ? 'W' : 'E') : (degrees < 0 ? 'S' : 'N');
+  degrees = fabs(degrees);
+  int whole = (int)degrees;
+  double minutes = (degrees - whole) * 60.0;
+  char text[24];
+  snprintf(text, sizeof(text), longitude ? "%03d%08.5f,%c" : "%02d%08.5f,%c", whole, minutes, hemisphere);
+  return text;
+}
+
+/**
+ * @brief The RMC and GGA sentences for one epoch, in the order a NEO-6 sends them.
+ */
+inline std::string nmeaEpoch(const TrackPoint &point, bool ggaFirst = false)
+{
+  time_t seconds = point.time;
+  struct tm utc;
+  gmtime_r(&seconds, &utc);
+  char clock[16];
+  snprintf(clock, sizeof(clock), "%02u%02u%02u.%02u", (uint8_t)utc.tm_hour, (uint8_t)utc.tm_min, (uint8_t)utc.tm_sec,
+           (uint8_t)(point.timeMs / 10 % 100));
+  char date[16];
+  snprintf(date, sizeof(date), "%02u%02u%02u", (uint8_t)utc.tm_mday, (uint8_t)(utc.tm_mon + 1),
+           (uint8_t)(utc.tm_year % 100));
+
+  char fields[96];
+  snprintf(fields, sizeof(fields), ",1,%02u,%.2f,%.1f,M,0.0,M,,", point.satellites, point.hdop, point.altM);
+  std::string gga = nmeaSentence("GPGGA," + std::string(clock) + "," + nmeaDegrees(point.lat, false) + "," +
+                                 nmeaDegrees(point.lng, true) + fields);
+
+  snprintf(fields, sizeof(fields), ",%.3f,%.2f,%s,,,A", point.speedMs * NMEA_KNOTS_PER_MS, point.courseDeg, date);
+  std::string rmc = nmeaSentence("GPRMC," + std::string(clock) + ",A," + nmeaDegrees(point.lat, false) + "," +
+                                 nmeaDegrees(point.lng, true) + fields);
+  return ggaFirst ? gga + rmc : rmc + gga;
+}
+
+/**
+ * @brief Deterministic Gaussian noise (Box-Muller over a 32-bit LCG).
+ */
+class TrackNoise
+{
+public:
+  explicit TrackNoise(uint32_t seed) : _state(seed) {}
+
+  double gaussian(double sigma)
+  {
+    double u1 = (next() + 1.0) / 4294967297.0;
+    double u2 = next() / 4294967296.0;
+    return sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+  }
+
+private:
+  uint32_t next()
+  {
+    _state = _state * 1664525UL + 1013904223UL;
+    return _state;
+  }
+
+  uint32_t _state;
+};
+
+#endif
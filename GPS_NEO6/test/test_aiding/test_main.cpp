@@ -0,0 +1,152 @@
+#include <Arduino.h>
+#include <Ubx.h>
+#include <GpsFix.h>
+#include <unity.h>
+
+// AID-INI frames byte for byte against reference frames. The references
+// were packed by hand from the u-blox 6 protocol description (payload
+// layout, flags, Fletcher checksum), not by this firmware, so a field at
+// the wrong offset or with the wrong width cannot pass by agreeing with
+// itself.
+
+#define POS_ACC_CM 500000UL // AIDING_POS_ACC_M in src/main.cpp
+#define TIME_ACC_MS 1000    // AIDING_TIME_ACC_MS in src/main.cpp
+
+// 30.6573420 N 76.7853210 E, 351.20 m; 2025-10-09 08:53:20 UTC
+// (unix 1760000000) = GPS week 2387, TOW 377618000 ms
+static const uint8_t REFERENCE_POSITION_TIME[] = {
+    0xB5, 0x62, 0x0B, 0x01, 0x30, 0x00, 0x6C, 0xF0, 0x45, 0x12, 0x9A, 0x82, 0xC4, 0x2D,
+    0x30, 0x89, 0x00, 0x00, 0x20, 0xA1, 0x07, 0x00, 0x00, 0x00, 0x53, 0x09, 0x50, 0xFE,
+    0x81, 0x16, 0x00, 0x00, 0x00, 0x00, 0xE8, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x23, 0x00, 0x00, 0x00, 0xCC, 0x98};
+
+static const uint8_t REFERENCE_POSITION_ONLY[] = {
+    0xB5, 0x62, 0x0B, 0x01, 0x30, 0x00, 0x6C, 0xF0, 0x45, 0x12, 0x9A, 0x82, 0xC4, 0x2D,
+    0x30, 0x89, 0x00, 0x00, 0x20, 0xA1, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00, 0x9E, 0xAE};
+
+static const uint8_t REFERENCE_TIME_ONLY[] = {
+    0xB5, 0x62, 0x0B, 0x01, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x53, 0x09, 0x50, 0xFE,
+    0x81, 0x16, 0x00, 0x00, 0x00, 0x00, 0xE8, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x6A, 0xB9};
+
+// 33.8688000 S 151.2093000 W, 12.50 m below the ellipsoid
+static const uint8_t REFERENCE_SOUTH_WEST[] = {
+    0xB5, 0x62, 0x0B, 0x01, 0x30, 0x00, 0x00, 0x08, 0xD0, 0xEB, 0xB8, 0x4A, 0xDF, 0xA5,
+    0x1E, 0xFB, 0xFF, 0xFF, 0x20, 0xA1, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00, 0x85, 0x9E};
+
+static UbxAidIni positionAid(int32_t latE7, int32_t lngE7, int32_t altCm)
+{
+  UbxAidIni aid = UbxAidIni();
+  aid.positionValid = true;
+  aid.latE7 = latE7;
+  aid.lngE7 = lngE7;
+  aid.altCm = altCm;
+  aid.posAccCm = POS_ACC_CM;
+  return aid;
+}
+
+static void addTime(UbxAidIni &aid, uint32_t unixTime)
+{
+  aid.timeValid = true;
+  gpsUnixToWeek(unixTime, aid.week, aid.towMs);
+  aid.tAccMs = TIME_ACC_MS;
+}
+
+/**
+ * @brief Build the frame injectAiding() sends and compare it to `expected`.
+ */
+static void assertFrame(const UbxAidIni &aid, const uint8_t *expected, size_t expectedLength)
+{
+  uint8_t payload[UBX_AID_INI_LEN];
+  uint8_t frame[UBX_AID_INI_LEN + UBX_FRAME_OVERHEAD];
+  memset(payload, 0xA5, sizeof(payload)); // Every byte must be written
+  ubxAidIniPayload(payload, aid);
+  size_t length = ubxBuildFrame(frame, sizeof(frame), UBX_CLASS_AID, UBX_AID_INI, payload, sizeof(payload));
+  TEST_ASSERT_EQUAL(expectedLength, length);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, frame, expectedLength);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_gps_week()
+{
+  uint16_t week;
+  uint32_t towMs;
+  gpsUnixToWeek(1760000000UL, week, towMs);
+  TEST_ASSERT_EQUAL_UINT16(2387, week);
+  TEST_ASSERT_EQUAL_UINT32(377618000UL, towMs);
+
+  // 2025-01-04 23:59:42 UTC is the first second of GPS week 2348
+  gpsUnixToWeek(1736035182UL, week, towMs);
+  TEST_ASSERT_EQUAL_UINT16(2348, week);
+  TEST_ASSERT_EQUAL_UINT32(0, towMs);
+  gpsUnixToWeek(1736035181UL, week, towMs);
+  TEST_ASSERT_EQUAL_UINT16(2347, week);
+  TEST_ASSERT_EQUAL_UINT32(604799000UL, towMs);
+}
+
+void test_position_and_time()
+{
+  UbxAidIni aid = positionAid(306573420L, 767853210L, 35120);
+  addTime(aid, 1760000000UL);
+  assertFrame(aid, REFERENCE_POSITION_TIME, sizeof(REFERENCE_POSITION_TIME));
+}
+
+void test_position_only()
+{
+  assertFrame(positionAid(306573420L, 767853210L, 35120), REFERENCE_POSITION_ONLY,
+              sizeof(REFERENCE_POSITION_ONLY));
+}
+
+void test_time_only()
+{
+  UbxAidIni aid = UbxAidIni();
+  addTime(aid, 1760000000UL);
+  assertFrame(aid, REFERENCE_TIME_ONLY, sizeof(REFERENCE_TIME_ONLY));
+}
+
+void test_negative_coordinates()
+{
+  assertFrame(positionAid(-338688000L, -1512093000L, -1250), REFERENCE_SOUTH_WEST, sizeof(REFERENCE_SOUTH_WEST));
+}
+
+void test_frame_parses()
+{
+  // The receiver side: the frame decodes to the same fields
+  UbxParser parser;
+  bool complete = false;
+  for (size_t i = 0; i < sizeof(REFERENCE_POSITION_TIME); i++)
+  {
+    complete = parser.encode(REFERENCE_POSITION_TIME[i]);
+  }
+  TEST_ASSERT_TRUE(complete);
+  TEST_ASSERT_EQUAL_HEX8(UBX_CLASS_AID, parser.msgClass());
+  TEST_ASSERT_EQUAL_HEX8(UBX_AID_INI, parser.msgId());
+  TEST_ASSERT_EQUAL(UBX_AID_INI_LEN, parser.length());
+  TEST_ASSERT_EQUAL_INT32(306573420L, (int32_t)ubxGetU32(parser.payload()));
+  TEST_ASSERT_EQUAL_UINT16(2387, ubxGetU16(parser.payload() + 18));
+  TEST_ASSERT_EQUAL_UINT32(0x23, ubxGetU32(parser.payload() + 44));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_gps_week);
+  RUN_TEST(test_position_and_time);
+  RUN_TEST(test_position_only);
+  RUN_TEST(test_time_only);
+  RUN_TEST(test_negative_coordinates);
+  RUN_TEST(test_frame_parses);
+  return UNITY_END();
+}
@@ -0,0 +1,200 @@
+#include <Arduino.h>
+#include <NativeBroker.h>
+#include <NativeHooks.h>
+#include <Preferences.h>
+#include <sys/stat.h>
+#include <unity.h>
+#include "../NmeaTrack.h"
+
+// Host tests of the whole firmware, built by the native environment:
+//   pio test -e native
+// setup() runs once on a synthetic NMEA track replayed into UART2 at
+// 9600 baud; the GPS, I/O and network tasks run on their own threads, as on
+// the device, against an in-process broker.
+
+#define TRACK_EPOCHS 1200  // 20 minutes at 1 Hz, longer than the test runs
+#define TRACK_SIDE_M 200.0 // A square, driven at TRACK_SPEED_MS
+#define TRACK_SPEED_MS 10.0
+#define TRACK_START_LAT 30.7
+#define TRACK_START_LNG 76.7
+#define TRACK_START_TIME 1760000000UL
+#define ZONE_ID 7
+#define ZONE_RADIUS_M 30
+
+static NativeBroker broker;
+
+static bool hasMessage(const char *topic, const char *text)
+{
+  std::vector<NativeBrokerMessage> messages = broker.messages();
+  for (size_t i = 0; i < messages.size(); i++)
+  {
+    if (messages[i].topic == topic && messages[i].payload.find(text) != std::string::npos)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Value of numeric field `key` in a JSON payload, NAN if missing.
+ */
+static double jsonNumber(const std::string &payload, const char *key)
+{
+  std::string field = std::string("\"") + key + "\": ";
+  size_t at = payload.find(field);
+  return at == std::string::npos ? NAN : atof(payload.c_str() + at + field.size());
+}
+
+/**
+ * @brief Whether a published fix lies on the square, within GPS noise.
+ */
+static bool onTrack(const std::string &payload)
+{
+  TrackPoint far = {TRACK_START_LAT, TRACK_START_LNG};
+  trackMove(far, 90.0, TRACK_SIDE_M);
+  trackMove(far, 180.0, TRACK_SIDE_M);
+  double lat = jsonNumber(payload, "latitude");
+  double lng = jsonNumber(payload, "longitude");
+  return lat >= far.lat - 0.0001 && lat <= TRACK_START_LAT + 0.0001 && lng >= TRACK_START_LNG - 0.0001 &&
+         lng <= far.lng + 0.0001;
+}
+
+/**
+ * @brief Write the track's NMEA to `path`: clockwise round the square, corner 1 first.
+ */
+static bool writeTrack(const std::string &path)
+{
+  FILE *file = fopen(path.c_str(), "wb");
+  if (file == nullptr)
+  {
+    return false;
+  }
+  TrackPoint point = {TRACK_START_LAT, TRACK_START_LNG, 250.0, TRACK_SPEED_MS, 90.0, TRACK_START_TIME, 0, 1.0, 8};
+  const int epochsPerSide = (int)(TRACK_SIDE_M / TRACK_SPEED_MS);
+  for (int i = 0; i < TRACK_EPOCHS; i++)
+  {
+    point.courseDeg = fmod(90.0 + 90.0 * (i / epochsPerSide), 360.0);
+    fputs(nmeaEpoch(point).c_str(), file);
+    trackMove(point, point.courseDeg, TRACK_SPEED_MS);
+    point.time++;
+  }
+  return fclose(file) == 0;
+}
+
+/**
+ * @brief A circle zone on the track's second corner.
+ */
+static bool writeGeofences(const std::string &path)
+{
+  TrackPoint corner = {TRACK_START_LAT, TRACK_START_LNG};
+  trackMove(corner, 90.0, TRACK_SIDE_M);
+  FILE *file = fopen(path.c_str(), "w");
+  if (file == nullptr)
+  {
+    return false;
+  }
+  fprintf(file, "# Test zone\ncircle %d %.7f %.7f %d\n", ZONE_ID, corner.lat, corner.lng, ZONE_RADIUS_M);
+  return fclose(file) == 0;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_connects()
+{
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.connects() == 1; }, 5000));
+}
+
+void test_publishes_track_fixes()
+{
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("gps") >= 3; }, 20000));
+  std::vector<NativeBrokerMessage> messages = broker.messages();
+  for (size_t i = 0; i < messages.size(); i++)
+  {
+    if (messages[i].topic == "gps")
+    {
+      TEST_ASSERT_TRUE_MESSAGE(onTrack(messages[i].payload), messages[i].payload.c_str());
+    }
+  }
+}
+
+void test_geofence_enter_and_exit()
+{
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return hasMessage("gps/geofence", "\"event\": \"exit\""); }, 30000));
+  TEST_ASSERT_TRUE(hasMessage("gps/geofence", "{\"zone\": 7,\"event\": \"enter\""));
+}
+
+void test_health_topics()
+{
+  TEST_ASSERT_TRUE(nativeLoopUntil(
+      []() { return broker.count("gps/metrics") > 0 && broker.count("gps/ingest") > 0 && broker.count("gps/tasks") > 0; },
+      12000));
+  TEST_ASSERT_TRUE(hasMessage("gps/ingest", "\"droppedFixes\": 0,"));
+  TEST_ASSERT_TRUE(hasMessage("gps/tasks", "\"gps\": {"));
+}
+
+void test_aiding_cache_saved()
+{
+  struct
+  {
+    int32_t latE7;
+    int32_t lngE7;
+    int32_t altCm;
+    uint32_t time;
+  } cache;
+  Preferences prefs;
+  prefs.begin("gpsCache", true);
+  size_t length = prefs.getBytes("fix", &cache, sizeof(cache));
+  prefs.end();
+  TEST_ASSERT_EQUAL(sizeof(cache), length);
+  TEST_ASSERT_INT_WITHIN(100000, 307000000, cache.latE7);
+  TEST_ASSERT_TRUE(cache.time >= TRACK_START_TIME);
+}
+
+void test_offline_fixes_replayed()
+{
+  broker.stop();
+  nativeLoopUntil(nullptr, 5000); // Covers a corner, which is always published
+  TEST_ASSERT_TRUE(broker.start());
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("gps/replay") > 0; }, 10000));
+  TEST_ASSERT_TRUE(onTrack(broker.last("gps/replay")));
+}
+
+int main()
+{
+  nativeSetConsoleOutput(false);
+  char directory[] = "/tmp/gps_test_XXXXXX";
+  if (mkdtemp(directory) == nullptr || !broker.start())
+  {
+    return 1;
+  }
+  std::string root = directory;
+  std::string track = root + "/track.nmea";
+  std::string fs = root + "/fs";
+  mkdir(fs.c_str(), 0755);
+  if (!writeTrack(track) || !writeGeofences(fs + "/geofences.txt"))
+  {
+    return 1;
+  }
+  setenv("NATIVE_UART2", track.c_str(), 1);
+  setenv("NATIVE_FS_ROOT", fs.c_str(), 1);
+  setenv("NATIVE_NVS_ROOT", (root + "/nvs").c_str(), 1);
+  setenv("NATIVE_BROKER", "127.0.0.1", 1);
+  setenv("NATIVE_BROKER_PORT", String(broker.port()).c_str(), 1);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_connects);
+  RUN_TEST(test_publishes_track_fixes);
+  RUN_TEST(test_geofence_enter_and_exit);
+  RUN_TEST(test_health_topics);
+  RUN_TEST(test_aiding_cache_saved);
+  RUN_TEST(test_offline_fixes_replayed);
+  return UNITY_END();
+}
@@ -0,0 +1,266 @@
+#include <Arduino.h>
+#include <FixJournal.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+
+// FixJournal on a file-backed flash emulator: an fs::FS rooted at a fresh
+// host directory per test, so segment files, the cursor and torn records
+// can be inspected and damaged directly. Reports append throughput,
+// capacity and the drain time of a full journal at the firmware's replay
+// rate.
+
+#define REPLAY_BATCH 10        // JOURNAL_REPLAY_BATCH in src/main.cpp
+#define REPLAY_INTERVAL_MS 250 // JOURNAL_REPLAY_INTERVAL_MS in src/main.cpp
+
+static char root[64];
+static fs::FS *flash;
+
+static GpsFix makeFix(uint32_t i)
+{
+  GpsFix fix = GpsFix();
+  fix.time = 1760000000UL + i;
+  fix.timeMs = (uint16_t)(i % 10) * 100;
+  fix.hdop = 90 + i % 7;
+  fix.latE7 = 307000000L + (int32_t)i * 17;
+  fix.lngE7 = 767000000L - (int32_t)i * 11;
+  fix.altCm = 25000 + (int32_t)(i % 300);
+  fix.satellites = 4 + i % 9;
+  return fix;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char *text)
+{
+  TEST_MESSAGE(text);
+}
+
+/**
+ * @brief Drain the journal as the network task does, checking the order.
+ *
+ * @return Fixes delivered.
+ */
+static uint32_t drain(FixJournal &journal, uint32_t firstIndex, uint32_t &bursts)
+{
+  uint32_t delivered = 0;
+  bursts = 0;
+  while (journal.pending() > 0)
+  {
+    GpsFix fixes[REPLAY_BATCH];
+    size_t fixCount;
+    size_t records = journal.read(fixes, REPLAY_BATCH, fixCount);
+    TEST_ASSERT_GREATER_THAN(0, records);
+    for (size_t i = 0; i < fixCount; i++)
+    {
+      TEST_ASSERT_EQUAL_UINT32(makeFix(firstIndex + delivered).time, fixes[i].time);
+      delivered++;
+    }
+    journal.consume(records);
+    bursts++;
+  }
+  return delivered;
+}
+
+static uint32_t segmentFiles()
+{
+  uint32_t count = 0;
+  File dir = flash->open("/journal");
+  File file = dir.openNextFile();
+  while (file)
+  {
+    count += strstr(file.name(), ".bin") != nullptr ? 1 : 0;
+    file = dir.openNextFile();
+  }
+  return count;
+}
+
+void setUp()
+{
+  snprintf(root, sizeof(root), "/tmp/fixjournalXXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+  flash = new fs::FS(root);
+}
+
+void tearDown()
+{
+  delete flash;
+  char command[96];
+  snprintf(command, sizeof(command), "rm -rf %s", root);
+  system(command);
+}
+
+void test_round_trip()
+{
+  FixJournal journal(*flash);
+  TEST_ASSERT_TRUE(journal.begin());
+  for (uint32_t i = 0; i < 25; i++)
+  {
+    TEST_ASSERT_TRUE(journal.append(makeFix(i)));
+  }
+  TEST_ASSERT_EQUAL_UINT32(25, journal.pending());
+
+  GpsFix fixes[25];
+  size_t fixCount;
+  TEST_ASSERT_EQUAL(25, journal.read(fixes, 25, fixCount));
+  TEST_ASSERT_EQUAL(25, fixCount);
+  for (uint32_t i = 0; i < 25; i++)
+  {
+    GpsFix expected = makeFix(i);
+    TEST_ASSERT_EQUAL_UINT32(expected.time, fixes[i].time);
+    TEST_ASSERT_EQUAL_UINT16(expected.timeMs, fixes[i].timeMs);
+    TEST_ASSERT_EQUAL_UINT16(expected.hdop, fixes[i].hdop);
+    TEST_ASSERT_EQUAL_INT32(expected.latE7, fixes[i].latE7);
+    TEST_ASSERT_EQUAL_INT32(expected.lngE7, fixes[i].lngE7);
+    TEST_ASSERT_EQUAL_INT32(expected.altCm, fixes[i].altCm);
+    TEST_ASSERT_EQUAL_UINT8(expected.satellites, fixes[i].satellites);
+  }
+
+  // Nothing is dropped until consumed
+  TEST_ASSERT_EQUAL_UINT32(25, journal.pending());
+  journal.consume(25);
+  TEST_ASSERT_EQUAL_UINT32(0, journal.pending());
+}
+
+void test_capacity_and_wrap()
+{
+  FixJournal journal(*flash);
+  TEST_ASSERT_TRUE(journal.begin());
+  uint32_t extra = 3 * JOURNAL_SEGMENT_RECORDS;
+  uint32_t total = journal.capacity() + extra;
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < total; i++)
+  {
+    TEST_ASSERT_TRUE(journal.append(makeFix(i)));
+  }
+  double appendSeconds = secondsSince(start);
+
+  // Whole segments are evicted, so up to one segment short of capacity
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(journal.capacity(), journal.pending());
+  TEST_ASSERT_GREATER_THAN_UINT32(journal.capacity() - JOURNAL_SEGMENT_RECORDS, journal.pending());
+  TEST_ASSERT_EQUAL_UINT32(total, journal.pending() + journal.overwritten());
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(JOURNAL_MAX_SEGMENTS, segmentFiles());
+
+  uint32_t pending = journal.pending();
+  uint32_t bursts;
+  start = std::chrono::steady_clock::now();
+  TEST_ASSERT_EQUAL_UINT32(pending, drain(journal, journal.overwritten(), bursts));
+  double drainSeconds = secondsSince(start);
+  TEST_ASSERT_EQUAL_UINT32(1, segmentFiles()); // The head segment stays open
+
+  char text[160];
+  snprintf(text, sizeof(text), "capacity %lu fixes (%lu KB on flash), appends %.0f fixes/s",
+           (unsigned long)journal.capacity(), (unsigned long)(journal.capacity() * sizeof(JournalRecord) / 1024),
+           total / appendSeconds);
+  report(text);
+  snprintf(text, sizeof(text), "drain of %lu fixes: %lu bursts, %.1f s at the replay rate, %.1f ms of flash reads",
+           (unsigned long)pending, (unsigned long)bursts, bursts * REPLAY_INTERVAL_MS / 1000.0,
+           drainSeconds * 1000.0);
+  report(text);
+}
+
+void test_cursor_survives_reboot()
+{
+  {
+    FixJournal journal(*flash);
+    TEST_ASSERT_TRUE(journal.begin());
+    for (uint32_t i = 0; i < 2 * JOURNAL_SEGMENT_RECORDS; i++)
+    {
+      journal.append(makeFix(i));
+    }
+    GpsFix fixes[REPLAY_BATCH];
+    size_t fixCount;
+    for (uint32_t i = 0; i < 60; i++)
+    {
+      journal.consume(journal.read(fixes, REPLAY_BATCH, fixCount));
+    }
+    journal.flush();
+  }
+
+  // The first 600 fixes were delivered before the reset
+  FixJournal journal(*flash);
+  TEST_ASSERT_TRUE(journal.begin());
+  TEST_ASSERT_EQUAL_UINT32(2 * JOURNAL_SEGMENT_RECORDS - 600, journal.pending());
+  uint32_t bursts;
+  TEST_ASSERT_EQUAL_UINT32(2 * JOURNAL_SEGMENT_RECORDS - 600, drain(journal, 600, bursts));
+
+  // New appends go to a fresh segment after the old ones
+  journal.append(makeFix(5000));
+  GpsFix fix;
+  size_t fixCount;
+  TEST_ASSERT_EQUAL(1, journal.read(&fix, 1, fixCount));
+  TEST_ASSERT_EQUAL_UINT32(makeFix(5000).time, fix.time);
+}
+
+void test_corrupt_record_skipped()
+{
+  {
+    FixJournal journal(*flash);
+    TEST_ASSERT_TRUE(journal.begin());
+    for (uint32_t i = 0; i < 10; i++)
+    {
+      journal.append(makeFix(i));
+    }
+    journal.flush();
+  }
+
+  // Flip a bit in the fourth record, as a torn or worn page would
+  char path[96];
+  snprintf(path, sizeof(path), "%s/journal/0.bin", root);
+  FILE *segment = fopen(path, "r+b");
+  TEST_ASSERT_NOT_NULL(segment);
+  fseek(segment, 3 * sizeof(JournalRecord) + 8, SEEK_SET);
+  int c = fgetc(segment);
+  fseek(segment, 3 * sizeof(JournalRecord) + 8, SEEK_SET);
+  fputc(c ^ 0x10, segment);
+  fclose(segment);
+
+  FixJournal journal(*flash);
+  TEST_ASSERT_TRUE(journal.begin());
+  GpsFix fixes[10];
+  size_t fixCount;
+  TEST_ASSERT_EQUAL(10, journal.read(fixes, 10, fixCount));
+  TEST_ASSERT_EQUAL(9, fixCount);
+  TEST_ASSERT_EQUAL_UINT32(1, journal.corrupted());
+  TEST_ASSERT_EQUAL_UINT32(makeFix(4).time, fixes[3].time);
+}
+
+void test_segments_rotate()
+{
+  // Segment numbers keep growing across fill/drain cycles instead of
+  // rewriting the same files
+  FixJournal journal(*flash);
+  TEST_ASSERT_TRUE(journal.begin());
+  uint32_t index = 0;
+  for (int cycle = 0; cycle < 4; cycle++)
+  {
+    uint32_t first = index;
+    for (uint32_t i = 0; i < JOURNAL_SEGMENT_RECORDS + 100; i++)
+    {
+      journal.append(makeFix(index++));
+    }
+    uint32_t bursts;
+    drain(journal, first, bursts);
+  }
+
+  // 4 x 612 fixes fill segments 0-3; only the head is left
+  File head = flash->open("/journal/4.bin");
+  TEST_ASSERT_TRUE((bool)head);
+  TEST_ASSERT_EQUAL(1, segmentFiles());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_capacity_and_wrap);
+  RUN_TEST(test_cursor_survives_reboot);
+  RUN_TEST(test_corrupt_record_skipped);
+  RUN_TEST(test_segments_rotate);
+  return UNITY_END();
+}
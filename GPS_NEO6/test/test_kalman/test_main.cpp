@@ -0,0 +1,158 @@
+#include <Arduino.h>
+#include <GpsKalman.h>
+#include <chrono>
+#include <vector>
+#include <unity.h>
+#include "../NmeaTrack.h"
+
+// NMEA replay through the firmware's Kalman stage. Known tracks are
+// rendered as noisy receiver output, decoded by decodeNmea() and filtered
+// by filterFix(), the same path gpsTask and loop() take. Reports the
+// smoothing error against the true track next to the raw error, and the
+// CPU cost per fix on the host.
+
+#define NOISE_M 3.0 // Receiver error at HDOP 1 (KALMAN_UERE_CM is 5 m)
+
+bool decodeNmea(char c, GpsFix &fix);
+void filterFix(GpsFix &fix);
+extern GpsKalman kalman;
+
+/**
+ * @brief Errors against the true track, in meters.
+ */
+struct KalmanResult
+{
+  double rawRmsM;
+  double filteredRmsM;
+  double filteredMaxM;
+  double speedRmsMs; // Filtered velocity against the true speed
+  double nsPerFix;
+};
+
+static KalmanResult replay(const std::vector<TrackPoint> &truth, uint32_t seed, size_t settle)
+{
+  kalman.reset();
+  TrackNoise noise(seed);
+  KalmanResult result = KalmanResult();
+  double rawSq = 0, filteredSq = 0, speedSq = 0;
+  double filterNs = 0;
+  size_t counted = 0;
+
+  for (size_t i = 0; i < truth.size(); i++)
+  {
+    const TrackPoint &at = truth[i];
+    TrackPoint measured = at;
+    trackMove(measured, 0.0, noise.gaussian(NOISE_M));
+    trackMove(measured, 90.0, noise.gaussian(NOISE_M));
+    std::string nmea = nmeaEpoch(measured);
+
+    GpsFix fix;
+    bool decoded = false;
+    for (size_t j = 0; j < nmea.size(); j++)
+    {
+      decoded = decodeNmea(nmea[j], fix) || decoded;
+    }
+    TEST_ASSERT_TRUE(decoded);
+
+    double rawM = trackDistanceM(at.lat, at.lng, fix.latE7 * 1e-7, fix.lngE7 * 1e-7);
+    auto start = std::chrono::steady_clock::now();
+    filterFix(fix);
+    filterNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_TRUE(fix.flags & GPS_FIX_FILTERED);
+
+    // Skip the filter's start-up before scoring it
+    if (i < settle)
+    {
+      continue;
+    }
+    double filteredM = trackDistanceM(at.lat, at.lng, fix.latE7 * 1e-7, fix.lngE7 * 1e-7);
+    double speedMs = sqrt((double)fix.velNCms * fix.velNCms + (double)fix.velECms * fix.velECms) / 100.0;
+    rawSq += rawM * rawM;
+    filteredSq += filteredM * filteredM;
+    speedSq += (speedMs - at.speedMs) * (speedMs - at.speedMs);
+    result.filteredMaxM = filteredM > result.filteredMaxM ? filteredM : result.filteredMaxM;
+    counted++;
+  }
+
+  result.rawRmsM = sqrt(rawSq / counted);
+  result.filteredRmsM = sqrt(filteredSq / counted);
+  result.speedRmsMs = sqrt(speedSq / counted);
+  result.nsPerFix = filterNs / truth.size();
+
+  char text[192];
+  snprintf(text, sizeof(text),
+           "%u fixes: raw RMS %.2f m, filtered RMS %.2f m (max %.2f m), speed RMS %.2f m/s, %.0f ns/fix on host",
+           (unsigned)truth.size(), result.rawRmsM, result.filteredRmsM, result.filteredMaxM, result.speedRmsMs,
+           result.nsPerFix);
+  TEST_MESSAGE(text);
+  return result;
+}
+
+/**
+ * @brief A 1 Hz track at `speedMs`, turning `turnDeg` every `legEpochs`.
+ */
+static std::vector<TrackPoint> makeTrack(uint32_t startTime, uint32_t epochs, double speedMs, double turnDeg,
+                                         uint32_t legEpochs)
+{
+  std::vector<TrackPoint> track;
+  TrackPoint point = {30.7, 76.7, 250.0, speedMs, 0.0, startTime, 0, 1.0, 9};
+  for (uint32_t i = 0; i < epochs; i++)
+  {
+    point.courseDeg = fmod((i / legEpochs) * turnDeg, 360.0);
+    point.time = startTime + i;
+    track.push_back(point);
+    trackMove(point, point.courseDeg, speedMs);
+  }
+  return track;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_parked()
+{
+  KalmanResult result = replay(makeTrack(1760100000UL, 600, 0.0, 0.0, 1), 11, 30);
+  TEST_ASSERT_TRUE(result.filteredRmsM < 0.7 * result.rawRmsM);
+  TEST_ASSERT_TRUE(result.speedRmsMs < 1.0);
+}
+
+void test_straight_line()
+{
+  KalmanResult result = replay(makeTrack(1760200000UL, 600, 15.0, 0.0, 1), 12, 30);
+  TEST_ASSERT_TRUE(result.filteredRmsM < 0.7 * result.rawRmsM);
+  TEST_ASSERT_TRUE(result.speedRmsMs < 1.0);
+}
+
+void test_square_route()
+{
+  // 90 degree turns every 20 s at 10 m/s: a constant-velocity model
+  // overshoots each corner, so the error here is above the raw one. It
+  // must stay well inside KALMAN_MAX_JUMP_CM so the filter never restarts.
+  uint32_t resets = kalman.resets();
+  KalmanResult result = replay(makeTrack(1760300000UL, 600, 10.0, 90.0, 20), 13, 30);
+  TEST_ASSERT_TRUE(result.filteredRmsM < 1.5 * result.rawRmsM);
+  TEST_ASSERT_TRUE(result.filteredMaxM < 25.0);
+  TEST_ASSERT_EQUAL_UINT32(resets, kalman.resets());
+}
+
+void test_cost_per_fix()
+{
+  // Host time is only a rough guide; the device reports kalmanCyclesAvg
+  KalmanResult result = replay(makeTrack(1760400000UL, 2000, 15.0, 0.0, 1), 14, 30);
+  TEST_ASSERT_TRUE(result.nsPerFix < 20000.0);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_parked);
+  RUN_TEST(test_straight_line);
+  RUN_TEST(test_square_route);
+  RUN_TEST(test_cost_per_fix);
+  return UNITY_END();
+}
@@ -0,0 +1,106 @@
+#include <Arduino.h>
+#include <GpsFix.h>
+#include <unity.h>
+#include "../NmeaTrack.h"
+
+// decodeNmea() against synthetic receiver output: one fix per epoch,
+// whatever the sentence order, and no duplicate when a sentence is lost.
+
+#define EPOCHS 20
+
+bool decodeNmea(char c, GpsFix &fix);
+
+static std::vector<GpsFix> fixes;
+
+static void feed(const std::string &nmea)
+{
+  for (size_t i = 0; i < nmea.size(); i++)
+  {
+    GpsFix fix;
+    if (decodeNmea(nmea[i], fix))
+    {
+      fixes.push_back(fix);
+    }
+  }
+}
+
+static TrackPoint start(uint32_t time)
+{
+  TrackPoint point = {30.7, 76.7, 250.0, 5.0, 90.0, time, 0, 0.9, 9};
+  return point;
+}
+
+void setUp()
+{
+  fixes.clear();
+}
+
+void tearDown()
+{
+}
+
+void test_one_fix_per_epoch()
+{
+  TrackPoint point = start(1760000000);
+  for (int i = 0; i < EPOCHS; i++)
+  {
+    feed(nmeaEpoch(point));
+    trackMove(point, point.courseDeg, point.speedMs);
+    point.time++;
+  }
+  TEST_ASSERT_EQUAL(EPOCHS, fixes.size());
+  for (size_t i = 1; i < fixes.size(); i++)
+  {
+    TEST_ASSERT_EQUAL_UINT32(fixes[i - 1].time + 1, fixes[i].time);
+  }
+}
+
+void test_fix_has_both_sentences()
+{
+  TrackPoint point = start(1760001000);
+  feed(nmeaEpoch(point));
+  TEST_ASSERT_EQUAL(1, fixes.size());
+  TEST_ASSERT_EQUAL_INT32(25000, fixes[0].altCm); // GGA
+  TEST_ASSERT_EQUAL_UINT16(90, fixes[0].hdop);
+  TEST_ASSERT_EQUAL_UINT32(1760001000, fixes[0].time); // RMC date
+  TEST_ASSERT_INT_WITHIN(2, 500, fixes[0].speedCms);
+}
+
+void test_gga_first_order()
+{
+  TrackPoint point = start(1760002000);
+  for (int i = 0; i < EPOCHS; i++)
+  {
+    feed(nmeaEpoch(point, true));
+    point.time++;
+  }
+  TEST_ASSERT_EQUAL(EPOCHS, fixes.size());
+}
+
+void test_lost_sentence_delays_not_duplicates()
+{
+  TrackPoint point = start(1760003000);
+  feed(nmeaEpoch(point));
+  point.time++;
+
+  // This epoch's GGA is corrupted on the wire
+  std::string epoch = nmeaEpoch(point);
+  epoch[epoch.find("$GPGGA") + 10] ^= 0x01;
+  feed(epoch);
+  point.time++;
+  feed(nmeaEpoch(point));
+
+  TEST_ASSERT_EQUAL(2, fixes.size());
+  TEST_ASSERT_EQUAL_UINT32(1760003000, fixes[0].time);
+  TEST_ASSERT_EQUAL_UINT32(1760003002, fixes[1].time);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_one_fix_per_epoch);
+  RUN_TEST(test_fix_has_both_sentences);
+  RUN_TEST(test_gga_first_order);
+  RUN_TEST(test_lost_sentence_delays_not_duplicates);
+  return UNITY_END();
+}
@@ -0,0 +1,254 @@
+#include <Arduino.h>
+#include <TrackBatch.h>
+#include <GpsFix.h>
+#include <vector>
+#include <unity.h>
+
+// TrackBatch frames byte for byte, and decoded again the way
+// backEnd/helper/gpsBatchDecoder.js does. The reference frame was packed by
+// hand from the layout in TrackBatch.h; the same bytes decode to the same
+// fixes with the JavaScript decoder.
+
+// 1.2345678 N 179.999999 E, across the antimeridian with no time, then back
+// in time by 300 ms from the first fix (a late epoch)
+static const GpsFix ACROSS_ANTIMERIDIAN[] = {
+    {12345678, 1799999990, 1050, 90, 7, 200, 1700000000, 500, 9000, 0, 0, 0},
+    {12345688, -1799999990, 1040, 110, 6, 0, 0, 510, 9010, 0, 0, 0},
+    {12345700, -1799999980, 1045, 95, 7, 900, 1699999999, 505, 9020, 0, 0, 0}};
+
+static const uint8_t REFERENCE_ACROSS_ANTIMERIDIAN[] = {
+    0x02, 0x03, 0x00,                                                 // Version 2, 3 fixes
+    0x01, 0x80, 0xE2, 0xCF, 0xAA, 0x06, 0xC8, 0x01,                   // Absolute time
+    0x9C, 0x85, 0xE3, 0x0B, 0xEC, 0xC7, 0xCE, 0xB4, 0x0D, 0xB4, 0x10, // lat, lng, alt
+    0x5A, 0x07, 0xF4, 0x03, 0xA8, 0x46,                               // hdop, sats, speed, course
+    0x00,                                                             // No time
+    0x14, 0xA8, 0xF0, 0xE2, 0x96, 0x05, 0x13,                         // lng delta wraps modulo 2^32
+    0x6E, 0x06, 0xFE, 0x03, 0xB2, 0x46,
+    0xD9, 0x04,                                                       // Delta -300 ms from the first fix
+    0x18, 0x14, 0x0A,
+    0x5F, 0x07, 0xF9, 0x03, 0xBC, 0x46};
+
+/**
+ * @brief Minimal mirror of the reference decoder.
+ */
+class FrameReader
+{
+public:
+  FrameReader(const uint8_t *data, size_t length) : _data(data), _length(length), _offset(0), _ok(true) {}
+
+  uint32_t varint()
+  {
+    uint32_t value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7)
+    {
+      if (_offset >= _length)
+      {
+        _ok = false;
+        return 0;
+      }
+      uint8_t byte = _data[_offset++];
+      value |= (uint32_t)(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+      {
+        return value;
+      }
+    }
+    _ok = false;
+    return 0;
+  }
+
+  int32_t zigzag()
+  {
+    uint32_t raw = varint();
+    return (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+  }
+
+  uint8_t byte()
+  {
+    if (_offset >= _length)
+    {
+      _ok = false;
+      return 0;
+    }
+    return _data[_offset++];
+  }
+
+  bool done() const { return _ok && _offset == _length; }
+
+private:
+  const uint8_t *_data;
+  size_t _length;
+  size_t _offset;
+  bool _ok;
+};
+
+static std::vector<GpsFix> decode(const uint8_t *data, size_t length)
+{
+  std::vector<GpsFix> fixes;
+  FrameReader reader(data, length);
+  TEST_ASSERT_EQUAL_UINT8(TRACK_BATCH_VERSION, reader.byte());
+  uint16_t count = reader.byte();
+  count |= reader.byte() << 8;
+
+  GpsFix fix = GpsFix();
+  int64_t lastTimeMs = -1;
+  for (uint16_t i = 0; i < count; i++)
+  {
+    uint32_t tag = reader.varint();
+    int64_t timeMs = -1;
+    if (tag == TRACK_BATCH_TIME_ABSOLUTE)
+    {
+      timeMs = (int64_t)reader.varint() * 1000;
+      timeMs += reader.varint();
+    }
+    else if (tag >= TRACK_BATCH_TIME_DELTA)
+    {
+      TEST_ASSERT_TRUE(lastTimeMs >= 0);
+      uint32_t raw = tag - TRACK_BATCH_TIME_DELTA;
+      timeMs = lastTimeMs + ((int32_t)(raw >> 1) ^ -(int32_t)(raw & 1));
+    }
+    lastTimeMs = timeMs >= 0 ? timeMs : lastTimeMs;
+    fix.time = timeMs >= 0 ? (uint32_t)(timeMs / 1000) : 0;
+    fix.timeMs = timeMs >= 0 ? (uint16_t)(timeMs % 1000) : 0;
+
+    // Running sums wrap to int32 like the encoder's deltas
+    fix.latE7 = (int32_t)((i == 0 ? 0 : (uint32_t)fix.latE7) + (uint32_t)reader.zigzag());
+    fix.lngE7 = (int32_t)((i == 0 ? 0 : (uint32_t)fix.lngE7) + (uint32_t)reader.zigzag());
+    fix.altCm = (int32_t)((i == 0 ? 0 : (uint32_t)fix.altCm) + (uint32_t)reader.zigzag());
+    fix.hdop = (uint16_t)reader.varint();
+    fix.satellites = reader.byte();
+    fix.speedCms = (uint16_t)reader.varint();
+    fix.courseCd = (uint16_t)reader.varint();
+    fixes.push_back(fix);
+  }
+  TEST_ASSERT_TRUE(reader.done());
+  return fixes;
+}
+
+static void assertSameFix(const GpsFix &expected, const GpsFix &actual)
+{
+  TEST_ASSERT_EQUAL_INT32(expected.latE7, actual.latE7);
+  TEST_ASSERT_EQUAL_INT32(expected.lngE7, actual.lngE7);
+  TEST_ASSERT_EQUAL_INT32(expected.altCm, actual.altCm);
+  TEST_ASSERT_EQUAL_UINT16(expected.hdop, actual.hdop);
+  TEST_ASSERT_EQUAL_UINT8(expected.satellites, actual.satellites);
+  TEST_ASSERT_EQUAL_UINT32(expected.time, actual.time);
+  TEST_ASSERT_EQUAL_UINT16(expected.time != 0 ? expected.timeMs : 0, actual.timeMs);
+  TEST_ASSERT_EQUAL_UINT16(expected.speedCms, actual.speedCms);
+  TEST_ASSERT_EQUAL_UINT16(expected.courseCd, actual.courseCd);
+}
+
+/**
+ * @brief A fix with every field at its widest encoding.
+ *
+ * Alternating between two of these makes every delta, including the time,
+ * take its longest form.
+ */
+static GpsFix worstCaseFix(bool odd)
+{
+  GpsFix fix = GpsFix();
+  fix.latE7 = odd ? -900000000 : 900000000;
+  fix.lngE7 = odd ? -1800000000 : 1800000000;
+  fix.altCm = odd ? -2000000000 : 2000000000;
+  fix.hdop = 0xFFFF;
+  fix.satellites = 0xFF;
+  fix.time = odd ? 1000000000UL : 4000000000UL;
+  fix.timeMs = 999;
+  fix.speedCms = 0xFFFF;
+  fix.courseCd = 35999;
+  return fix;
+}
+
+static TrackBatchEncoder batch;
+
+void setUp()
+{
+  batch.reset();
+}
+
+void tearDown()
+{
+}
+
+void test_empty_frame()
+{
+  static const uint8_t expected[] = {TRACK_BATCH_VERSION, 0x00, 0x00};
+  TEST_ASSERT_EQUAL_UINT32(sizeof(expected), batch.length());
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, batch.data(), sizeof(expected));
+}
+
+void test_frame_across_antimeridian()
+{
+  for (const GpsFix &fix : ACROSS_ANTIMERIDIAN)
+  {
+    TEST_ASSERT_TRUE(batch.add(fix));
+  }
+  TEST_ASSERT_EQUAL_UINT32(sizeof(REFERENCE_ACROSS_ANTIMERIDIAN), batch.length());
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(REFERENCE_ACROSS_ANTIMERIDIAN, batch.data(), batch.length());
+}
+
+void test_round_trip_across_antimeridian()
+{
+  for (const GpsFix &fix : ACROSS_ANTIMERIDIAN)
+  {
+    batch.add(fix);
+  }
+  std::vector<GpsFix> fixes = decode(batch.data(), batch.length());
+  TEST_ASSERT_EQUAL_UINT32(3, fixes.size());
+  for (size_t i = 0; i < fixes.size(); i++)
+  {
+    assertSameFix(ACROSS_ANTIMERIDIAN[i], fixes[i]);
+  }
+}
+
+void test_round_trip_worst_case()
+{
+  std::vector<GpsFix> added;
+  for (uint16_t i = 0; i < 8; i++)
+  {
+    GpsFix fix = worstCaseFix(i % 2 == 1);
+    fix.time = i == 3 ? 0 : fix.time; // A missing time in between
+    TEST_ASSERT_TRUE(batch.add(fix));
+    added.push_back(fix);
+  }
+  std::vector<GpsFix> fixes = decode(batch.data(), batch.length());
+  TEST_ASSERT_EQUAL_UINT32(added.size(), fixes.size());
+  for (size_t i = 0; i < fixes.size(); i++)
+  {
+    assertSameFix(added[i], fixes[i]);
+  }
+}
+
+void test_full_frame_refuses_instead_of_overrunning()
+{
+  uint16_t added = 0;
+  size_t length = batch.length();
+  while (batch.add(worstCaseFix(added % 2 == 1)))
+  {
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(TRACK_BATCH_MAX_FIX_BYTES, batch.length() - length);
+    length = batch.length();
+    added++;
+  }
+
+  // Refused only once another worst-case fix might not fit, and unchanged
+  TEST_ASSERT_GREATER_THAN_UINT32(TRACK_BATCH_MAX_BYTES, batch.length() + TRACK_BATCH_MAX_FIX_BYTES);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(TRACK_BATCH_MAX_BYTES, batch.length());
+  TEST_ASSERT_EQUAL_UINT32(length, batch.length());
+  TEST_ASSERT_EQUAL_UINT16(added, batch.count());
+  TEST_ASSERT_FALSE(batch.add(worstCaseFix(false)));
+
+  std::vector<GpsFix> fixes = decode(batch.data(), batch.length());
+  TEST_ASSERT_EQUAL_UINT32(added, fixes.size());
+  assertSameFix(worstCaseFix((added - 1) % 2 == 1), fixes.back());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_frame);
+  RUN_TEST(test_frame_across_antimeridian);
+  RUN_TEST(test_round_trip_across_antimeridian);
+  RUN_TEST(test_round_trip_worst_case);
+  RUN_TEST(test_full_frame_refuses_instead_of_overrunning);
+  return UNITY_END();
+}
@@ -0,0 +1,189 @@
+#include <Arduino.h>
+#include <TrackSimplifier.h>
+#include <vector>
+#include <unity.h>
+#include "../NmeaTrack.h"
+
+// Track replay through TrackSimplifier, with the firmware's tuning. Each
+// track is rendered as the receiver's NMEA, noise included, and decoded by
+// the firmware's own decodeNmea() before it reaches the simplifier. Checks
+// the uplink reduction, the error of the published polyline against every
+// fix it dropped, and the heartbeat interval.
+
+#define TOLERANCE_M 5.0f // ADAPTIVE_* in src/main.cpp
+#define DEADBAND_M 10.0f
+#define STATIONARY_SPEED_MS 0.5f
+#define HEADING_CHANGE_DEG 30.0f
+#define HEARTBEAT_MS 60000
+
+bool decodeNmea(char c, GpsFix &fix);
+
+/**
+ * @brief Outcome of one replay.
+ */
+struct ReplayResult
+{
+  uint32_t fixesIn;
+  uint32_t fixesOut;
+  double maxErrorM;  // Dropped fix to the published polyline
+  double maxTruthM;  // Published fix to the true position
+  uint32_t maxGapMs; // Between consecutive publishes
+};
+
+static uint32_t fixMillis(const GpsFix &fix)
+{
+  return (fix.time - 1760000000UL) * 1000UL + fix.timeMs;
+}
+
+/**
+ * @brief Distance from `p` to the segment a-b, in meters.
+ */
+static double segmentDistanceM(const GpsFix &p, const GpsFix &a, const GpsFix &b)
+{
+  double scale = cos(a.latE7 * 1e-7 * M_PI / 180.0);
+  double bx = (b.lngE7 - a.lngE7) * scale, by = b.latE7 - a.latE7;
+  double px = (p.lngE7 - a.lngE7) * scale, py = p.latE7 - a.latE7;
+  double lengthSq = bx * bx + by * by;
+  double t = lengthSq > 0 ? (px * bx + py * by) / lengthSq : 0;
+  t = t < 0 ? 0 : (t > 1 ? 1 : t);
+  double dx = px - t * bx, dy = py - t * by;
+  return sqrt(dx * dx + dy * dy) * 1e-7 * M_PI / 180.0 * NMEA_EARTH_RADIUS_M;
+}
+
+static ReplayResult replay(const std::vector<TrackPoint> &truth, double noiseM, uint32_t seed)
+{
+  TrackSimplifier simplifier({TOLERANCE_M, DEADBAND_M, STATIONARY_SPEED_MS, HEADING_CHANGE_DEG, HEARTBEAT_MS});
+  TrackNoise noise(seed);
+  std::vector<GpsFix> fixes;
+  std::vector<size_t> published; // Indices into fixes
+  ReplayResult result = ReplayResult();
+
+  for (size_t i = 0; i < truth.size(); i++)
+  {
+    TrackPoint point = truth[i];
+    trackMove(point, 0.0, noise.gaussian(noiseM));
+    trackMove(point, 90.0, noise.gaussian(noiseM));
+    std::string nmea = nmeaEpoch(point);
+
+    GpsFix fix;
+    for (size_t j = 0; j < nmea.size(); j++)
+    {
+      if (!decodeNmea(nmea[j], fix))
+      {
+        continue;
+      }
+      fixes.push_back(fix);
+      GpsFix out[2];
+      size_t count = simplifier.update(fix, fixMillis(fix), out);
+      for (size_t k = 0; k < count; k++)
+      {
+        // A published fix is either this one or the one before it
+        published.push_back(out[k].time == fix.time && out[k].timeMs == fix.timeMs ? fixes.size() - 1
+                                                                                    : fixes.size() - 2);
+        const TrackPoint &at = truth[i - (fixes.size() - 1 - published.back())];
+        double truthM = trackDistanceM(at.lat, at.lng, out[k].latE7 * 1e-7, out[k].lngE7 * 1e-7);
+        result.maxTruthM = truthM > result.maxTruthM ? truthM : result.maxTruthM;
+      }
+    }
+  }
+
+  result.fixesIn = simplifier.fixesIn();
+  result.fixesOut = simplifier.fixesOut();
+  TEST_ASSERT_EQUAL(fixes.size(), result.fixesIn);
+  TEST_ASSERT_EQUAL(published.size(), result.fixesOut);
+
+  for (size_t p = 1; p < published.size(); p++)
+  {
+    const GpsFix &a = fixes[published[p - 1]];
+    const GpsFix &b = fixes[published[p]];
+    uint32_t gap = fixMillis(b) - fixMillis(a);
+    result.maxGapMs = gap > result.maxGapMs ? gap : result.maxGapMs;
+    for (size_t i = published[p - 1] + 1; i < published[p]; i++)
+    {
+      double error = segmentDistanceM(fixes[i], a, b);
+      result.maxErrorM = error > result.maxErrorM ? error : result.maxErrorM;
+    }
+  }
+
+  char text[160];
+  snprintf(text, sizeof(text), "%lu fixes -> %lu published (%.1fx), max error %.2f m, max gap %lu ms",
+           (unsigned long)result.fixesIn, (unsigned long)result.fixesOut,
+           (double)result.fixesIn / result.fixesOut, result.maxErrorM, (unsigned long)result.maxGapMs);
+  TEST_MESSAGE(text);
+  return result;
+}
+
+/**
+ * @brief A track of `epochs` fixes every `periodMs`, following `course(i)`.
+ */
+static std::vector<TrackPoint> makeTrack(uint32_t startTime, uint32_t epochs, uint32_t periodMs, double speedMs,
+                                         double (*course)(uint32_t epoch))
+{
+  std::vector<TrackPoint> track;
+  TrackPoint point = {30.7, 76.7, 250.0, speedMs, 0.0, startTime, 0, 0.9, 9};
+  uint64_t ms = 0;
+  for (uint32_t i = 0; i < epochs; i++)
+  {
+    point.courseDeg = course(i);
+    point.time = startTime + (uint32_t)(ms / 1000);
+    point.timeMs = ms % 1000;
+    track.push_back(point);
+    trackMove(point, point.courseDeg, speedMs * periodMs / 1000.0);
+    ms += periodMs;
+  }
+  return track;
+}
+
+static double courseNorthEast(uint32_t)
+{
+  return 45.0;
+}
+
+static double courseSquare(uint32_t epoch)
+{
+  return (epoch / 20) % 4 * 90.0; // 200 m sides at 10 m/s
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_parked()
+{
+  // 30 minutes parked at 1 Hz with 2 m of receiver jitter
+  ReplayResult result = replay(makeTrack(1760000000UL, 1800, 1000, 0.0, courseNorthEast), 2.0, 1);
+  TEST_ASSERT_GREATER_OR_EQUAL(10 * result.fixesOut, result.fixesIn);
+  TEST_ASSERT_TRUE(result.maxErrorM <= DEADBAND_M);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(HEARTBEAT_MS + 1000, result.maxGapMs);
+}
+
+void test_straight_line()
+{
+  // 10 minutes at 15 m/s and 5 Hz
+  ReplayResult result = replay(makeTrack(1760010000UL, 3000, 200, 15.0, courseNorthEast), 1.0, 2);
+  TEST_ASSERT_GREATER_OR_EQUAL(10 * result.fixesOut, result.fixesIn);
+  TEST_ASSERT_TRUE(result.maxErrorM <= TOLERANCE_M + 0.05);
+  TEST_ASSERT_TRUE(result.maxTruthM <= 4.0);
+}
+
+void test_square_route()
+{
+  // Ten laps of a 200 m square: every corner has to survive
+  ReplayResult result = replay(makeTrack(1760020000UL, 800, 1000, 10.0, courseSquare), 1.0, 3);
+  TEST_ASSERT_GREATER_OR_EQUAL(40, result.fixesOut);
+  TEST_ASSERT_TRUE(result.maxErrorM <= TOLERANCE_M + 0.05);
+  TEST_ASSERT_GREATER_OR_EQUAL(3 * result.fixesOut, result.fixesIn);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_parked);
+  RUN_TEST(test_straight_line);
+  RUN_TEST(test_square_route);
+  return UNITY_END();
+}
@@ -0,0 +1,203 @@
+#include <Arduino.h>
+#include <UbxConfig.h>
+#include <deque>
+#include <unity.h>
+
+// UbxConfigurator against a fake NEO-6 on the other end of the UART.
+// Bytes only get through when both ends run at the same baud rate, as on
+// the wire; each scenario breaks the link a different way.
+
+#define FACTORY_BAUD 9600
+#define TARGET_BAUD 115200
+#define ACK_TIMEOUT_MS 30
+
+/**
+ * @brief The receiver side of the UART: answers CFG messages like a NEO-6.
+ */
+class FakeReceiver : public Stream
+{
+public:
+  void reset(uint32_t baud)
+  {
+    receiverBaud = baud;
+    hostBaud = 0;
+    measRateMs = 1000;
+    ignorePrt = false;
+    dropAcks = 0;
+    deafBaud = 0;
+    _rx.clear();
+    _parser = UbxParser();
+  }
+
+  // Host side
+  int available() override { return (int)_rx.size(); }
+  int read() override
+  {
+    if (_rx.empty())
+    {
+      return -1;
+    }
+    uint8_t c = _rx.front();
+    _rx.pop_front();
+    return c;
+  }
+  int peek() override { return _rx.empty() ? -1 : _rx.front(); }
+  size_t write(uint8_t c) override
+  {
+    if (hostBaud == receiverBaud && _parser.encode(c))
+    {
+      handle();
+    }
+    return 1;
+  }
+  using Print::write;
+
+  void setHostBaud(uint32_t baud)
+  {
+    hostBaud = baud;
+    _rx.clear(); // Whatever was in flight is garbage at the new rate
+  }
+
+  uint32_t receiverBaud;
+  uint32_t hostBaud;
+  uint16_t measRateMs;
+  bool ignorePrt;    // Acknowledge CFG-PRT but keep the baud rate
+  int dropAcks;      // ACKs lost on the way back
+  uint32_t deafBaud; // Every reply sent at this rate is lost
+
+private:
+  void handle()
+  {
+    uint8_t msgClass = _parser.msgClass();
+    uint8_t msgId = _parser.msgId();
+    if (msgClass != UBX_CLASS_CFG)
+    {
+      return;
+    }
+    uint32_t newBaud = receiverBaud;
+    if (msgId == UBX_CFG_RATE && _parser.length() == 0)
+    {
+      uint8_t rate[6];
+      ubxPutU16(rate, measRateMs);
+      ubxPutU16(rate + 2, 1);
+      ubxPutU16(rate + 4, 1);
+      reply(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate));
+    }
+    else if (msgId == UBX_CFG_RATE)
+    {
+      measRateMs = ubxGetU16(_parser.payload());
+    }
+    else if (msgId == UBX_CFG_PRT && !ignorePrt)
+    {
+      newBaud = ubxGetU32(_parser.payload() + 8);
+    }
+
+    // The ACK goes out at the old rate, then the port switches
+    uint8_t ack[2] = {msgClass, msgId};
+    if (dropAcks > 0)
+    {
+      dropAcks--;
+    }
+    else
+    {
+      reply(UBX_CLASS_ACK, UBX_ACK_ACK, ack, sizeof(ack));
+    }
+    receiverBaud = newBaud;
+  }
+
+  void reply(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length)
+  {
+    if (receiverBaud != hostBaud || receiverBaud == deafBaud)
+    {
+      return;
+    }
+    uint8_t frame[UBX_FRAME_OVERHEAD + 8];
+    size_t frameLength = ubxBuildFrame(frame, sizeof(frame), msgClass, msgId, payload, length);
+    _rx.insert(_rx.end(), frame, frame + frameLength);
+  }
+
+  std::deque<uint8_t> _rx;
+  UbxParser _parser;
+};
+
+static FakeReceiver receiver;
+
+static void setHostBaud(uint32_t baud)
+{
+  receiver.setHostBaud(baud);
+}
+
+static bool configure(bool ubxOutput)
+{
+  UbxConfigOptions options;
+  options.baud = TARGET_BAUD;
+  options.measRateMs = 200;
+  options.ubxOutput = ubxOutput;
+  UbxConfigurator configurator(receiver, setHostBaud, ACK_TIMEOUT_MS);
+  bool ok = configurator.configure(FACTORY_BAUD, options);
+  TEST_ASSERT_EQUAL_UINT32(configurator.baud(), receiver.hostBaud);
+  return ok;
+}
+
+void setUp()
+{
+  receiver.reset(FACTORY_BAUD);
+}
+
+void tearDown()
+{
+}
+
+void test_cold_receiver()
+{
+  TEST_ASSERT_TRUE(configure(true));
+  TEST_ASSERT_EQUAL_UINT32(TARGET_BAUD, receiver.receiverBaud);
+  TEST_ASSERT_EQUAL_UINT32(TARGET_BAUD, receiver.hostBaud);
+  TEST_ASSERT_EQUAL_UINT16(200, receiver.measRateMs);
+}
+
+void test_receiver_already_at_target()
+{
+  receiver.reset(TARGET_BAUD);
+  TEST_ASSERT_TRUE(configure(false));
+  TEST_ASSERT_EQUAL_UINT32(TARGET_BAUD, receiver.receiverBaud);
+  TEST_ASSERT_EQUAL_UINT16(200, receiver.measRateMs);
+}
+
+void test_baud_change_ignored()
+{
+  receiver.ignorePrt = true;
+  TEST_ASSERT_FALSE(configure(true));
+  TEST_ASSERT_EQUAL_UINT32(FACTORY_BAUD, receiver.receiverBaud);
+  TEST_ASSERT_EQUAL_UINT32(FACTORY_BAUD, receiver.hostBaud);
+}
+
+void test_rate_ack_lost()
+{
+  // The CFG-PRT sent at 9600 switches the receiver; the one sent at the
+  // new rate and the first CFG-RATE lose their ACKs
+  receiver.dropAcks = 3;
+  TEST_ASSERT_TRUE(configure(true));
+  TEST_ASSERT_EQUAL_UINT32(TARGET_BAUD, receiver.receiverBaud);
+  TEST_ASSERT_EQUAL_UINT16(200, receiver.measRateMs);
+}
+
+void test_silent_at_target_falls_back()
+{
+  // The receiver switches but nothing it sends at 115200 arrives
+  receiver.deafBaud = TARGET_BAUD;
+  TEST_ASSERT_FALSE(configure(true));
+  TEST_ASSERT_EQUAL_UINT32(FACTORY_BAUD, receiver.receiverBaud);
+  TEST_ASSERT_EQUAL_UINT32(FACTORY_BAUD, receiver.hostBaud);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_cold_receiver);
+  RUN_TEST(test_receiver_already_at_target);
+  RUN_TEST(test_baud_change_ignored);
+  RUN_TEST(test_rate_ack_lost);
+  RUN_TEST(test_silent_at_target_falls_back);
+  return UNITY_END();
+}
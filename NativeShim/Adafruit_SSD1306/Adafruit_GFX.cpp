@@ -0,0 +1,101 @@
+#include "Adafruit_GFX.h"
+
+Adafruit_GFX::Adafruit_GFX(int16_t width, int16_t height)
+    : _width(width), _height(height), _cursorX(0), _cursorY(0), _textSize(1), _textColor(0xFFFF), _wrap(true)
+{
+}
+
+void Adafruit_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+{
+  // Bresenham
+  int16_t dx = abs(x1 - x0);
+  int16_t dy = -abs(y1 - y0);
+  int16_t stepX = x0 < x1 ? 1 : -1;
+  int16_t stepY = y0 < y1 ? 1 : -1;
+  int16_t error = dx + dy;
+  while (true)
+  {
+    drawPixel(x0, y0, color);
+    if (x0 == x1 && y0 == y1)
+    {
+      break;
+    }
+    int16_t doubled = 2 * error;
+    if (doubled >= dy)
+    {
+      error += dy;
+      x0 += stepX;
+    }
+    if (doubled <= dx)
+    {
+      error += dx;
+      y0 += stepY;
+    }
+  }
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+{
+  for (int16_t i = 0; i < w; i++)
+  {
+    drawPixel(x + i, y, color);
+  }
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+{
+  for (int16_t i = 0; i < h; i++)
+  {
+    drawPixel(x, y + i, color);
+  }
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  for (int16_t i = 0; i < h; i++)
+  {
+    drawFastHLine(x, y + i, w, color);
+  }
+}
+
+void Adafruit_GFX::drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h, uint16_t color)
+{
+  int16_t rowBytes = (w + 7) / 8;
+  for (int16_t j = 0; j < h; j++)
+  {
+    for (int16_t i = 0; i < w; i++)
+    {
+      if (pgm_read_byte(&bitmap[j * rowBytes + i / 8]) & (0x80 >> (i & 7)))
+      {
+        drawPixel(x + i, y + j, color);
+      }
+    }
+  }
+}
+
+size_t Adafruit_GFX::write(uint8_t c)
+{
+  if (c == '\n')
+  {
+    _cursorX = 0;
+    _cursorY += 8 * _textSize;
+  }
+  else if (c != '\r')
+  {
+    if (_wrap && _cursorX + 6 * _textSize > _width)
+    {
+      _cursorX = 0;
+      _cursorY += 8 * _textSize;
+    }
+    _cursorX += 6 * _textSize;
+  }
+  return 1;
+}
@@ -0,0 +1,48 @@
+#ifndef NATIVE_ADAFRUIT_GFX_H
+#define NATIVE_ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Drawing primitives on top of drawPixel(), as in Adafruit GFX.
+ *
+ * Text only moves the cursor: glyphs are not rasterized on the host.
+ */
+class Adafruit_GFX : public Print
+{
+public:
+  Adafruit_GFX(int16_t width, int16_t height);
+  virtual ~Adafruit_GFX() {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h, uint16_t color);
+
+  void setCursor(int16_t x, int16_t y) { _cursorX = x; _cursorY = y; }
+  void setTextSize(uint8_t size) { _textSize = size > 0 ? size : 1; }
+  void setTextColor(uint16_t color) { _textColor = color; }
+  void setTextColor(uint16_t color, uint16_t) { _textColor = color; }
+  void setTextWrap(bool wrap) { _wrap = wrap; }
+  int16_t getCursorX() const { return _cursorX; }
+  int16_t getCursorY() const { return _cursorY; }
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+
+  using Print::write;
+  size_t write(uint8_t c) override;
+
+protected:
+  int16_t _width;
+  int16_t _height;
+  int16_t _cursorX;
+  int16_t _cursorY;
+  uint8_t _textSize;
+  uint16_t _textColor;
+  bool _wrap;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "Adafruit_SSD1306.h"
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *, int8_t, uint32_t, uint32_t)
+    : Adafruit_GFX(w, h), _buffer(nullptr), _frames(0)
+{
+}
+
+Adafruit_SSD1306::~Adafruit_SSD1306()
+{
+  free(_buffer);
+}
+
+bool Adafruit_SSD1306::begin(uint8_t, uint8_t, bool, bool)
+{
+  if (_buffer == nullptr)
+  {
+    _buffer = (uint8_t *)malloc(_width * ((_height + 7) / 8));
+  }
+  if (_buffer == nullptr)
+  {
+    return false;
+  }
+  clearDisplay();
+  return true;
+}
+
+void Adafruit_SSD1306::display()
+{
+  _frames++;
+}
+
+void Adafruit_SSD1306::clearDisplay()
+{
+  if (_buffer != nullptr)
+  {
+    memset(_buffer, 0, _width * ((_height + 7) / 8));
+  }
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+  if (_buffer == nullptr || x < 0 || x >= _width || y < 0 || y >= _height)
+  {
+    return;
+  }
+  uint8_t &cell = _buffer[x + (y / 8) * _width];
+  uint8_t bit = 1 << (y & 7);
+  switch (color)
+  {
+  case WHITE:
+    cell |= bit;
+    break;
+  case BLACK:
+    cell &= ~bit;
+    break;
+  case INVERSE:
+    cell ^= bit;
+    break;
+  }
+}
+
+bool Adafruit_SSD1306::getPixel(int16_t x, int16_t y) const
+{
+  if (_buffer == nullptr || x < 0 || x >= _width || y < 0 || y >= _height)
+  {
+    return false;
+  }
+  return _buffer[x + (y / 8) * _width] & (1 << (y & 7));
+}
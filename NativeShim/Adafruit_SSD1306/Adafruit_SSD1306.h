@@ -0,0 +1,44 @@
+#ifndef NATIVE_ADAFRUIT_SSD1306_H
+#define NATIVE_ADAFRUIT_SSD1306_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "Adafruit_GFX.h"
+
+#define BLACK 0
+#define WHITE 1
+#define INVERSE 2
+#define SSD1306_BLACK BLACK
+#define SSD1306_WHITE WHITE
+#define SSD1306_INVERSE INVERSE
+#define SSD1306_EXTERNALVCC 0x01
+#define SSD1306_SWITCHCAPVCC 0x02
+
+/**
+ * @brief SSD1306 with the page-ordered 1-bpp frame buffer of the real driver.
+ *
+ * display() sends nothing; it counts frames, so host runs can report
+ * how often the firmware redraws.
+ */
+class Adafruit_SSD1306 : public Adafruit_GFX
+{
+public:
+  Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi = &Wire, int8_t resetPin = -1,
+                   uint32_t clkDuring = 400000UL, uint32_t clkAfter = 100000UL);
+  ~Adafruit_SSD1306() override;
+
+  bool begin(uint8_t switchVcc = SSD1306_SWITCHCAPVCC, uint8_t i2cAddress = 0, bool reset = true,
+             bool periphBegin = true);
+  void display();
+  void clearDisplay();
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  bool getPixel(int16_t x, int16_t y) const;
+  uint8_t *getBuffer() { return _buffer; }
+  uint32_t nativeFrameCount() const { return _frames; }
+
+private:
+  uint8_t *_buffer;
+  uint32_t _frames;
+};
+
+#endif
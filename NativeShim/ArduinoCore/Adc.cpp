@@ -0,0 +1,121 @@
+#include "Arduino.h"
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+
+static const uint8_t adc1Pins[ADC1_CHANNEL_MAX] = {36, 37, 38, 39, 32, 33, 34, 35};
+
+static bool digiReady = false;
+static bool digiRunning = false;
+static bool digiOverflow = false;
+static uint32_t digiBufferSamples = 0;
+static adc_digi_pattern_config_t digiPattern;
+static uint32_t digiRateHz = 0;
+static unsigned long digiStartMicros = 0;
+static uint64_t digiTaken = 0; // Conversions handed out or dropped since start
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *init_config)
+{
+  if (init_config == nullptr || init_config->adc1_chan_mask == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  digiBufferSamples = init_config->max_store_buf_size / sizeof(adc_digi_output_data_t);
+  digiReady = true;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_deinitialize()
+{
+  digiReady = false;
+  digiRunning = false;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config)
+{
+  // Only the single channel pattern the firmware uses
+  if (!digiReady || config == nullptr || config->pattern_num != 1 || config->adc_pattern == nullptr ||
+      config->adc_pattern[0].channel >= ADC1_CHANNEL_MAX || config->sample_freq_hz == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  digiPattern = config->adc_pattern[0];
+  digiRateHz = config->sample_freq_hz;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_start()
+{
+  if (!digiReady || digiRateHz == 0)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  digiRunning = true;
+  digiOverflow = false;
+  digiStartMicros = micros();
+  digiTaken = 0;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_stop()
+{
+  digiRunning = false;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_read_bytes(uint8_t *buf, uint32_t length_max, uint32_t *out_length, uint32_t)
+{
+  *out_length = 0;
+  if (!digiRunning)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  uint64_t converted = (uint64_t)(uint32_t)(micros() - digiStartMicros) * digiRateHz / 1000000;
+  uint64_t pending = converted - digiTaken;
+  if (pending > digiBufferSamples)
+  {
+    // The driver keeps the oldest conversions and drops the rest
+    digiTaken += pending - digiBufferSamples;
+    pending = digiBufferSamples;
+    digiOverflow = true;
+  }
+  if (pending == 0)
+  {
+    return ESP_ERR_TIMEOUT;
+  }
+
+  uint32_t count = length_max / sizeof(adc_digi_output_data_t);
+  if (count > pending)
+  {
+    count = (uint32_t)pending;
+  }
+  adc_digi_output_data_t sample;
+  sample.type1.channel = digiPattern.channel;
+  sample.type1.data = constrain(analogRead(adc1Pins[digiPattern.channel]), 0, 4095);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    memcpy(buf + i * sizeof(sample), &sample, sizeof(sample));
+  }
+  digiTaken += count;
+  *out_length = count * sizeof(sample);
+  return digiOverflow ? ESP_ERR_INVALID_STATE : ESP_OK;
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adc_num, adc_atten_t atten, adc_bits_width_t bit_width,
+                                             uint32_t default_vref, esp_adc_cal_characteristics_t *chars)
+{
+  chars->adc_num = adc_num;
+  chars->atten = atten;
+  chars->bit_width = bit_width;
+  chars->vref = default_vref;
+  return ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adc_reading, const esp_adc_cal_characteristics_t *chars)
+{
+  // Full scale of each attenuation with a nominal reference
+  static const uint32_t fullScaleMv[] = {950, 1250, 1750, 3100};
+  uint32_t maxRaw = (1UL << (9 + chars->bit_width)) - 1;
+  return adc_reading * fullScaleMv[chars->atten] / maxRaw;
+}
@@ -0,0 +1,252 @@
+#include "Arduino.h"
+#include "NativeHooks.h"
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#define NATIVE_PIN_COUNT 64
+
+static const auto bootTime = std::chrono::steady_clock::now();
+static std::atomic<int64_t> clockOffsetUs(0); // Added by nativeAdvanceClock()
+static int digitalInputs[NATIVE_PIN_COUNT];
+static int analogInputs[NATIVE_PIN_COUNT];
+static int pinOutputs[NATIVE_PIN_COUNT];
+static bool inputsReady = false;
+static std::vector<void (*)()> tickers;
+
+struct PinInterrupt
+{
+  void (*handler)(void);
+  void (*argHandler)(void *);
+  void *arg;
+  int mode;
+};
+static PinInterrupt interrupts[NATIVE_PIN_COUNT];
+
+static void initInputs()
+{
+  if (!inputsReady)
+  {
+    for (int i = 0; i < NATIVE_PIN_COUNT; i++)
+    {
+      digitalInputs[i] = HIGH;
+    }
+    inputsReady = true;
+  }
+}
+
+static int64_t uptimeUs()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count() +
+         clockOffsetUs.load();
+}
+
+unsigned long millis()
+{
+  return (unsigned long)(uint32_t)(uptimeUs() / 1000);
+}
+
+unsigned long micros()
+{
+  return (unsigned long)(uint32_t)uptimeUs();
+}
+
+void nativeAdvanceClock(unsigned long ms)
+{
+  clockOffsetUs += (int64_t)ms * 1000;
+}
+
+void delay(unsigned long ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield()
+{
+  std::this_thread::yield();
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  if (pin < NATIVE_PIN_COUNT)
+  {
+    pinOutputs[pin] = value;
+  }
+}
+
+int digitalRead(uint8_t pin)
+{
+  initInputs();
+  return pin < NATIVE_PIN_COUNT ? digitalInputs[pin] : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+  return pin < NATIVE_PIN_COUNT ? analogInputs[pin] : 0;
+}
+
+uint16_t touchRead(uint8_t)
+{
+  return 100; // Untouched
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode)
+{
+  if (pin < NATIVE_PIN_COUNT)
+  {
+    interrupts[pin] = {handler, nullptr, nullptr, mode};
+  }
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode)
+{
+  if (pin < NATIVE_PIN_COUNT)
+  {
+    interrupts[pin] = {nullptr, handler, arg, mode};
+  }
+}
+
+void detachInterrupt(uint8_t pin)
+{
+  if (pin < NATIVE_PIN_COUNT)
+  {
+    interrupts[pin] = {nullptr, nullptr, nullptr, 0};
+  }
+}
+
+long random(long howbig)
+{
+  return howbig > 0 ? ::random() % howbig : 0;
+}
+
+long random(long howsmall, long howbig)
+{
+  return howsmall < howbig ? howsmall + random(howbig - howsmall) : howsmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+  srandom((unsigned int)seed);
+}
+
+void configTime(long, int, const char *, const char *, const char *)
+{
+  // The host clock is already set
+}
+
+void nativeSetDigitalInput(uint8_t pin, int value)
+{
+  initInputs();
+  if (pin >= NATIVE_PIN_COUNT || digitalInputs[pin] == value)
+  {
+    return;
+  }
+  digitalInputs[pin] = value;
+
+  const PinInterrupt &interrupt = interrupts[pin];
+  bool triggered = interrupt.mode == CHANGE || (interrupt.mode == RISING && value == HIGH) ||
+                   (interrupt.mode == FALLING && value == LOW);
+  if (!triggered)
+  {
+    return;
+  }
+  nativeEnterCritical(); // Interrupts do not nest on the device either
+  if (interrupt.handler != nullptr)
+  {
+    interrupt.handler();
+  }
+  else if (interrupt.argHandler != nullptr)
+  {
+    interrupt.argHandler(interrupt.arg);
+  }
+  nativeExitCritical();
+}
+
+void nativeSetAnalogInput(uint8_t pin, int value)
+{
+  if (pin < NATIVE_PIN_COUNT)
+  {
+    analogInputs[pin] = value;
+  }
+}
+
+int nativeGetPinOutput(uint8_t pin)
+{
+  return pin < NATIVE_PIN_COUNT ? pinOutputs[pin] : LOW;
+}
+
+void nativeAttachTicker(void (*function)())
+{
+  nativeDetachTicker(function);
+  tickers.push_back(function);
+}
+
+void nativeDetachTicker(void (*function)())
+{
+  for (size_t i = 0; i < tickers.size(); i++)
+  {
+    if (tickers[i] == function)
+    {
+      tickers.erase(tickers.begin() + i);
+      return;
+    }
+  }
+}
+
+void nativeRunTickers()
+{
+  // A ticker may detach itself
+  std::vector<void (*)()> pending = tickers;
+  for (size_t i = 0; i < pending.size(); i++)
+  {
+    pending[i]();
+  }
+}
+
+bool nativeLoopUntil(bool (*done)(), unsigned long timeoutMs)
+{
+  unsigned long start = millis();
+  while (done == nullptr || !done())
+  {
+    if (millis() - start >= timeoutMs)
+    {
+      return done == nullptr;
+    }
+    loop();
+    nativeRunTickers();
+    delayMicroseconds(100);
+  }
+  return true;
+}
+
+/**
+ * @brief Host entry point: setup() once, then loop() until NATIVE_RUN_MS.
+ *
+ * Weak so that a benchmark or test runner can bring its own main().
+ */
+__attribute__((weak)) int main()
+{
+  const char *runMs = getenv("NATIVE_RUN_MS");
+  unsigned long limit = runMs != nullptr ? strtoul(runMs, nullptr, 10) : 0;
+
+  setup();
+  while (limit == 0 || millis() < limit)
+  {
+    loop();
+    nativeRunTickers();
+    delayMicroseconds(100); // Keeps an idle firmware from pinning a host core
+  }
+  Serial.flush();
+  return 0;
+}
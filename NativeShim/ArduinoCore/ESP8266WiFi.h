@@ -0,0 +1,7 @@
+#ifndef NATIVE_ESP8266_WIFI_H
+#define NATIVE_ESP8266_WIFI_H
+
+// Both cores share the host WiFi shim
+#include "WiFi.h"
+
+#endif
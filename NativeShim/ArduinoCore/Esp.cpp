@@ -0,0 +1,63 @@
+#include "Esp.h"
+#include "Arduino.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#define NATIVE_HEAP_SIZE 327680 // What an ESP32 Arduino sketch starts with, roughly
+#define NATIVE_RTC_USER_MEMORY 512
+
+EspClass ESP;
+
+static uint32_t minFreeHeap = NATIVE_HEAP_SIZE;
+static uint8_t rtcUserMemory[NATIVE_RTC_USER_MEMORY];
+
+uint32_t EspClass::getFreeHeap()
+{
+  size_t used = mallinfo2().uordblks;
+  uint32_t free = used < NATIVE_HEAP_SIZE ? NATIVE_HEAP_SIZE - (uint32_t)used : 0;
+  if (free < minFreeHeap)
+  {
+    minFreeHeap = free;
+  }
+  return free;
+}
+
+uint32_t EspClass::getMinFreeHeap()
+{
+  getFreeHeap();
+  return minFreeHeap;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+  return (uint32_t)micros() * getCpuFreqMHz();
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size)
+{
+  if (offset * 4 + size > NATIVE_RTC_USER_MEMORY)
+  {
+    return false;
+  }
+  memcpy(data, rtcUserMemory + offset * 4, size);
+  return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size)
+{
+  if (offset * 4 + size > NATIVE_RTC_USER_MEMORY)
+  {
+    return false;
+  }
+  memcpy(rtcUserMemory + offset * 4, data, size);
+  return true;
+}
+
+void EspClass::restart()
+{
+  Serial.println("ESP.restart() requested, exiting");
+  Serial.flush();
+  exit(0);
+}
@@ -0,0 +1,28 @@
+#ifndef NATIVE_ESP_H
+#define NATIVE_ESP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief The parts of the ESP object used here.
+ *
+ * Heap figures come from the allocator, the cycle counter runs at a
+ * nominal 240 MHz off the host clock, and RTC user memory is a plain
+ * array that lives as long as the process.
+ */
+class EspClass
+{
+public:
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getCycleCount();
+  uint32_t getCpuFreqMHz() { return 240; }
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size);
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size);
+  void restart();
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,211 @@
+#include "FS.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs
+{
+
+struct FileImpl
+{
+  std::string path;     // As the firmware named it
+  std::string hostPath;
+  FILE *file = nullptr;
+  DIR *dir = nullptr;
+
+  ~FileImpl()
+  {
+    if (file != nullptr)
+    {
+      fclose(file);
+    }
+    if (dir != nullptr)
+    {
+      closedir(dir);
+    }
+  }
+};
+
+size_t File::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buffer, size_t size)
+{
+  return _impl && _impl->file != nullptr ? fwrite(buffer, 1, size, _impl->file) : 0;
+}
+
+int File::available()
+{
+  if (!_impl || _impl->file == nullptr)
+  {
+    return 0;
+  }
+  long remaining = (long)size() - (long)position();
+  return remaining > 0 ? (int)remaining : 0;
+}
+
+int File::read()
+{
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek()
+{
+  if (!_impl || _impl->file == nullptr)
+  {
+    return -1;
+  }
+  int c = fgetc(_impl->file);
+  if (c != EOF)
+  {
+    ungetc(c, _impl->file);
+  }
+  return c == EOF ? -1 : c;
+}
+
+void File::flush()
+{
+  if (_impl && _impl->file != nullptr)
+  {
+    fflush(_impl->file);
+  }
+}
+
+size_t File::read(uint8_t *buffer, size_t size)
+{
+  return _impl && _impl->file != nullptr ? fread(buffer, 1, size, _impl->file) : 0;
+}
+
+bool File::seek(uint32_t position)
+{
+  return _impl && _impl->file != nullptr && fseek(_impl->file, position, SEEK_SET) == 0;
+}
+
+size_t File::position() const
+{
+  return _impl && _impl->file != nullptr ? (size_t)ftell(_impl->file) : 0;
+}
+
+size_t File::size() const
+{
+  if (!_impl || _impl->file == nullptr)
+  {
+    return 0;
+  }
+  fflush(_impl->file);
+  struct stat info;
+  return fstat(fileno(_impl->file), &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+void File::close()
+{
+  _impl.reset();
+}
+
+const char *File::name() const
+{
+  if (!_impl)
+  {
+    return nullptr;
+  }
+  size_t slash = _impl->path.rfind('/');
+  return _impl->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+const char *File::path() const
+{
+  return _impl ? _impl->path.c_str() : nullptr;
+}
+
+bool File::isDirectory() const
+{
+  return _impl && _impl->dir != nullptr;
+}
+
+File File::openNextFile(const char *mode)
+{
+  if (!_impl || _impl->dir == nullptr)
+  {
+    return File();
+  }
+  struct dirent *entry;
+  while ((entry = readdir(_impl->dir)) != nullptr)
+  {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+    {
+      continue;
+    }
+    std::shared_ptr<FileImpl> impl = std::make_shared<FileImpl>();
+    impl->path = _impl->path + (_impl->path.back() == '/' ? "" : "/") + entry->d_name;
+    impl->hostPath = _impl->hostPath + "/" + entry->d_name;
+    impl->dir = opendir(impl->hostPath.c_str());
+    if (impl->dir == nullptr)
+    {
+      impl->file = fopen(impl->hostPath.c_str(), strcmp(mode, "r") == 0 ? "rb" : mode);
+      if (impl->file == nullptr)
+      {
+        continue;
+      }
+    }
+    return File(impl);
+  }
+  return File();
+}
+
+File FS::open(const char *path, const char *mode, bool)
+{
+  std::shared_ptr<FileImpl> impl = std::make_shared<FileImpl>();
+  impl->path = path;
+  impl->hostPath = hostPath(path);
+
+  struct stat info;
+  if (stat(impl->hostPath.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+  {
+    impl->dir = opendir(impl->hostPath.c_str());
+    return impl->dir != nullptr ? File(impl) : File();
+  }
+
+  // "r+" must not truncate but may create, as on LittleFS
+  std::string hostMode = strcmp(mode, "r+") == 0 && stat(impl->hostPath.c_str(), &info) != 0 ? "w+" : mode;
+  hostMode += "b";
+  impl->file = fopen(impl->hostPath.c_str(), hostMode.c_str());
+  return impl->file != nullptr ? File(impl) : File();
+}
+
+bool FS::exists(const char *path)
+{
+  struct stat info;
+  return stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool FS::remove(const char *path)
+{
+  return unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to)
+{
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path)
+{
+  return ::mkdir(hostPath(path).c_str(), 0755) == 0 || exists(path);
+}
+
+bool FS::rmdir(const char *path)
+{
+  return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+std::string FS::hostPath(const char *path) const
+{
+  return _root + (path[0] == '/' ? "" : "/") + path;
+}
+
+} // namespace fs
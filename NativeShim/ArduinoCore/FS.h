@@ -0,0 +1,74 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+#include <memory>
+#include <string>
+#include "Stream.h"
+
+namespace fs
+{
+
+struct FileImpl;
+
+/**
+ * @brief File or directory handle on the host file system.
+ */
+class File : public Stream
+{
+public:
+  File() {}
+  explicit File(std::shared_ptr<FileImpl> impl) : _impl(impl) {}
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override;
+  size_t read(uint8_t *buffer, size_t size);
+  bool seek(uint32_t position);
+  size_t position() const;
+  size_t size() const;
+  void close();
+  const char *name() const;
+  const char *path() const;
+  bool isDirectory() const;
+  File openNextFile(const char *mode = "r");
+
+  operator bool() const { return _impl != nullptr; }
+
+private:
+  std::shared_ptr<FileImpl> _impl;
+};
+
+/**
+ * @brief File system rooted at a host directory.
+ */
+class FS
+{
+public:
+  explicit FS(const std::string &root) : _root(root) {}
+
+  File open(const char *path, const char *mode = "r", bool create = false);
+  File open(const String &path, const char *mode = "r", bool create = false) { return open(path.c_str(), mode, create); }
+  bool exists(const char *path);
+  bool exists(const String &path) { return exists(path.c_str()); }
+  bool remove(const char *path);
+  bool remove(const String &path) { return remove(path.c_str()); }
+  bool rename(const char *from, const char *to);
+  bool mkdir(const char *path);
+  bool mkdir(const String &path) { return mkdir(path.c_str()); }
+  bool rmdir(const char *path);
+
+protected:
+  std::string hostPath(const char *path) const;
+
+  std::string _root;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif
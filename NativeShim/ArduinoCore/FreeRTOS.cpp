@@ -0,0 +1,287 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <Arduino.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <vector>
+
+struct NativeTask
+{
+  const char *name;
+  uint32_t stackDepth;
+  BaseType_t core;
+  std::mutex lock;
+  std::condition_variable wake;
+  uint32_t notifications = 0;
+};
+
+struct NativeQueue
+{
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> items;
+};
+
+static std::recursive_mutex criticalLock;
+static NativeTask loopTask{"loopTask", 8192, 1};
+static thread_local NativeTask *currentTask = &loopTask;
+
+void nativeEnterCritical()
+{
+  criticalLock.lock();
+}
+
+void nativeExitCritical()
+{
+  criticalLock.unlock();
+}
+
+BaseType_t xPortGetCoreID()
+{
+  return currentTask->core == tskNO_AFFINITY ? 0 : currentTask->core;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth,
+                                   void *parameter, UBaseType_t, TaskHandle_t *handle, BaseType_t coreId)
+{
+  NativeTask *task = new NativeTask();
+  task->name = name;
+  task->stackDepth = stackDepth;
+  task->core = coreId;
+  if (handle != nullptr)
+  {
+    *handle = task;
+  }
+  std::thread([task, function, parameter]()
+              {
+                currentTask = task;
+                function(parameter);
+              })
+      .detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackDepth,
+                       void *parameter, UBaseType_t priority, TaskHandle_t *handle)
+{
+  return xTaskCreatePinnedToCore(function, name, stackDepth, parameter, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+  if (task == nullptr || task == currentTask)
+  {
+    // The thread ends here; its record stays, handles may still be held
+    for (;;)
+    {
+      std::this_thread::sleep_for(std::chrono::hours(24));
+    }
+  }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  if (ticks == 0)
+  {
+    std::this_thread::yield();
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment)
+{
+  *previousWake += increment;
+  TickType_t now = xTaskGetTickCount();
+  if ((int32_t)(*previousWake - now) > 0)
+  {
+    vTaskDelay(*previousWake - now);
+  }
+}
+
+TickType_t xTaskGetTickCount()
+{
+  return (TickType_t)millis(); // One tick per millisecond, on the same clock
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+  return currentTask;
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+  return (task != nullptr ? task : currentTask)->name;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+  return (task != nullptr ? task : currentTask)->stackDepth;
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+  {
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notifications++;
+  }
+  task->wake.notify_one();
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken)
+{
+  xTaskNotifyGive(task);
+  if (higherPriorityTaskWoken != nullptr)
+  {
+    *higherPriorityTaskWoken = pdTRUE;
+  }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+  NativeTask *task = currentTask;
+  std::unique_lock<std::mutex> guard(task->lock);
+  auto ready = [task]() { return task->notifications > 0; };
+  if (ticksToWait == portMAX_DELAY)
+  {
+    task->wake.wait(guard, ready);
+  }
+  else
+  {
+    task->wake.wait_for(guard, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS), ready);
+  }
+  uint32_t count = task->notifications;
+  if (count > 0)
+  {
+    task->notifications = clearCountOnExit ? 0 : count - 1;
+  }
+  return count;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+  NativeQueue *queue = new NativeQueue();
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+  delete queue;
+}
+
+static BaseType_t queueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait, bool front)
+{
+  std::unique_lock<std::mutex> guard(queue->lock);
+  auto space = [queue]() { return queue->items.size() < queue->length; };
+  if (ticksToWait == portMAX_DELAY)
+  {
+    queue->changed.wait(guard, space);
+  }
+  else if (!queue->changed.wait_for(guard, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS), space))
+  {
+    return errQUEUE_FULL;
+  }
+  std::vector<uint8_t> copy((const uint8_t *)item, (const uint8_t *)item + queue->itemSize);
+  if (front)
+  {
+    queue->items.push_front(std::move(copy));
+  }
+  else
+  {
+    queue->items.push_back(std::move(copy));
+  }
+  queue->changed.notify_all();
+  return pdPASS;
+}
+
+static BaseType_t queueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait, bool remove)
+{
+  std::unique_lock<std::mutex> guard(queue->lock);
+  auto ready = [queue]() { return !queue->items.empty(); };
+  if (ticksToWait == portMAX_DELAY)
+  {
+    queue->changed.wait(guard, ready);
+  }
+  else if (!queue->changed.wait_for(guard, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS), ready))
+  {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  if (remove)
+  {
+    queue->items.pop_front();
+    queue->changed.notify_all();
+  }
+  return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+  return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+  return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+  return queueSend(queue, item, ticksToWait, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken)
+{
+  if (higherPriorityTaskWoken != nullptr)
+  {
+    *higherPriorityTaskWoken = pdFALSE;
+  }
+  return queueSend(queue, item, 0, false);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait)
+{
+  return queueReceive(queue, item, ticksToWait, true);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *item, BaseType_t *higherPriorityTaskWoken)
+{
+  if (higherPriorityTaskWoken != nullptr)
+  {
+    *higherPriorityTaskWoken = pdFALSE;
+  }
+  return queueReceive(queue, item, 0, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticksToWait)
+{
+  return queueReceive(queue, item, ticksToWait, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return (UBaseType_t)queue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return queue->length - (UBaseType_t)queue->items.size();
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+  std::lock_guard<std::mutex> guard(queue->lock);
+  queue->items.clear();
+  queue->changed.notify_all();
+  return pdPASS;
+}
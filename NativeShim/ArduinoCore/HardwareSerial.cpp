@@ -0,0 +1,199 @@
+#include "HardwareSerial.h"
+#include "NativeHooks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial(0);
+
+static bool consoleOutput = true;
+
+void nativeSetConsoleOutput(bool enabled)
+{
+  consoleOutput = enabled;
+}
+
+HardwareSerial::HardwareSerial(int uartNumber)
+    : _uart(uartNumber), _baud(115200), _rxBufferSize(256), _feeder(nullptr), _running(false)
+{
+}
+
+HardwareSerial::~HardwareSerial()
+{
+  end();
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t, int8_t, int8_t)
+{
+  _baud = baud;
+  if (_uart == 0 || _running)
+  {
+    return;
+  }
+  char name[16];
+  snprintf(name, sizeof(name), "NATIVE_UART%d", _uart);
+  if (getenv(name) == nullptr)
+  {
+    return;
+  }
+  _running = true;
+  _feeder = new std::thread(&HardwareSerial::feed, this);
+}
+
+void HardwareSerial::end()
+{
+  if (_feeder != nullptr)
+  {
+    _running = false;
+    std::thread *feeder = (std::thread *)_feeder;
+    feeder->join();
+    delete feeder;
+    _feeder = nullptr;
+  }
+}
+
+void HardwareSerial::updateBaudRate(unsigned long baud)
+{
+  _baud = baud;
+}
+
+size_t HardwareSerial::setRxBufferSize(size_t size)
+{
+  _rxBufferSize = size;
+  return size;
+}
+
+void HardwareSerial::onReceive(OnReceiveCb function, bool)
+{
+  _onReceive = function;
+}
+
+void HardwareSerial::onReceiveError(OnReceiveErrorCb function)
+{
+  _onReceiveError = function;
+}
+
+/**
+ * @brief Replay the capture file into the RX buffer at line speed.
+ *
+ * Bytes arrive in 1 ms slices, like the UART driver's RX timeout would
+ * hand them over, and overflow the buffer exactly as a stalled reader
+ * would on the device.
+ */
+void HardwareSerial::feed()
+{
+  char name[16];
+  snprintf(name, sizeof(name), "NATIVE_UART%d", _uart);
+  FILE *file = fopen(getenv(name), "rb");
+  if (file == nullptr)
+  {
+    perror(getenv(name));
+    return;
+  }
+
+  double credit = 0;
+  while (_running)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    credit += _baud / 10000.0; // 10 bits per byte, per millisecond
+    size_t count = (size_t)credit;
+    credit -= count;
+    if (count == 0)
+    {
+      continue;
+    }
+
+    bool overflow = false;
+    {
+      std::lock_guard<std::mutex> guard(_lock);
+      for (size_t i = 0; i < count; i++)
+      {
+        int c = fgetc(file);
+        if (c == EOF)
+        {
+          rewind(file);
+          c = fgetc(file);
+          if (c == EOF)
+          {
+            break;
+          }
+        }
+        if (_rx.size() >= _rxBufferSize)
+        {
+          overflow = true;
+          continue;
+        }
+        _rx.push_back((uint8_t)c);
+      }
+    }
+    if (overflow && _onReceiveError)
+    {
+      _onReceiveError(UART_BUFFER_FULL_ERROR);
+    }
+    if (_onReceive)
+    {
+      _onReceive();
+    }
+  }
+  fclose(file);
+}
+
+int HardwareSerial::available()
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  return (int)_rx.size();
+}
+
+int HardwareSerial::read()
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  if (_rx.empty())
+  {
+    return -1;
+  }
+  uint8_t c = _rx.front();
+  _rx.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek()
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  return _rx.empty() ? -1 : _rx.front();
+}
+
+size_t HardwareSerial::read(uint8_t *buffer, size_t size)
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  size_t count = 0;
+  while (count < size && !_rx.empty())
+  {
+    buffer[count++] = _rx.front();
+    _rx.pop_front();
+  }
+  return count;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  if (_uart == 0 && consoleOutput)
+  {
+    fwrite(buffer, 1, size, stdout);
+  }
+  return size;
+}
+
+void HardwareSerial::flush()
+{
+  if (_uart == 0)
+  {
+    fflush(stdout);
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef NATIVE_HARDWARE_SERIAL_H
+#define NATIVE_HARDWARE_SERIAL_H
+
+#include <functional>
+#include <deque>
+#include <mutex>
+#include "Stream.h"
+
+#define SERIAL_8N1 0x800001c
+
+typedef enum
+{
+  UART_NO_ERROR,
+  UART_BREAK_ERROR,
+  UART_BUFFER_FULL_ERROR,
+  UART_FIFO_OVF_ERROR,
+  UART_FRAME_ERROR,
+  UART_PARITY_ERROR
+} hardwareSerial_error_t;
+
+typedef std::function<void(void)> OnReceiveCb;
+typedef std::function<void(hardwareSerial_error_t)> OnReceiveErrorCb;
+
+/**
+ * @brief UART stand-in.
+ *
+ * Port 0 is the console: writes go to stdout. Other ports are fed from the
+ * file named by NATIVE_UART<n> (e.g. a recorded NMEA log), paced at the
+ * configured baud rate and replayed in a loop; what the firmware writes to
+ * them is discarded.
+ */
+class HardwareSerial : public Stream
+{
+public:
+  explicit HardwareSerial(int uartNumber);
+  ~HardwareSerial();
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+  void end();
+  void updateBaudRate(unsigned long baud);
+  size_t setRxBufferSize(size_t size);
+  void onReceive(OnReceiveCb function, bool onlyOnTimeout = false);
+  void onReceiveError(OnReceiveErrorCb function);
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t *buffer, size_t size);
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  void flush() override;
+  operator bool() const { return true; }
+
+private:
+  void feed();
+
+  int _uart;
+  unsigned long _baud;
+  size_t _rxBufferSize;
+  std::deque<uint8_t> _rx;
+  std::mutex _lock;
+  OnReceiveCb _onReceive;
+  OnReceiveErrorCb _onReceiveError;
+  void *_feeder;
+  bool _running;
+};
+
+extern HardwareSerial Serial;
+
+#endif
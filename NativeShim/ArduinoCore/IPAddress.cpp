@@ -0,0 +1,36 @@
+#include "IPAddress.h"
+#include "Print.h"
+#include <stdio.h>
+#include <arpa/inet.h>
+
+IPAddress::IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+  uint8_t *octets = (uint8_t *)&_address;
+  octets[0] = a;
+  octets[1] = b;
+  octets[2] = c;
+  octets[3] = d;
+}
+
+bool IPAddress::fromString(const char *text)
+{
+  struct in_addr address;
+  if (inet_pton(AF_INET, text, &address) != 1)
+  {
+    return false;
+  }
+  _address = address.s_addr;
+  return true;
+}
+
+String IPAddress::toString() const
+{
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(text);
+}
+
+size_t IPAddress::printTo(Print &p) const
+{
+  return p.print(toString());
+}
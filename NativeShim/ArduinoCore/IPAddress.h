@@ -0,0 +1,34 @@
+#ifndef NATIVE_IP_ADDRESS_H
+#define NATIVE_IP_ADDRESS_H
+
+#include <stdint.h>
+#include "Printable.h"
+#include "WString.h"
+
+/**
+ * @brief IPv4 address; as on the device the uint32_t form holds the octets
+ * in memory order (network byte order).
+ */
+class IPAddress : public Printable
+{
+public:
+  IPAddress() : _address(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d);
+  IPAddress(uint32_t address) : _address(address) {}
+
+  operator uint32_t() const { return _address; }
+  uint8_t operator[](int index) const { return ((const uint8_t *)&_address)[index]; }
+  bool operator==(const IPAddress &other) const { return _address == other._address; }
+  bool operator!=(const IPAddress &other) const { return _address != other._address; }
+
+  bool fromString(const char *text);
+  String toString() const;
+  size_t printTo(Print &p) const override;
+
+private:
+  uint32_t _address;
+};
+
+#define INADDR_NONE IPAddress((uint32_t)0)
+
+#endif
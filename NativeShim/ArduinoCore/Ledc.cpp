@@ -0,0 +1,113 @@
+#include "Arduino.h"
+#include "driver/ledc.h"
+
+struct NativeLedcChannel
+{
+  int pin;       // -1 until configured
+  uint32_t duty; // Applied
+  uint32_t next; // Set, waiting for an update or fade start
+};
+
+static bool ledcTimers[LEDC_SPEED_MODE_MAX][LEDC_TIMER_MAX];
+static NativeLedcChannel ledcChannels[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX] = {
+    {{-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}},
+    {{-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}}};
+static bool ledcFadeInstalled = false;
+
+static NativeLedcChannel *ledcChannel(ledc_mode_t mode, ledc_channel_t channel)
+{
+  if (mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX || ledcChannels[mode][channel].pin < 0)
+  {
+    return nullptr;
+  }
+  return &ledcChannels[mode][channel];
+}
+
+static void ledcApply(NativeLedcChannel &channel)
+{
+  channel.duty = channel.next;
+  digitalWrite(channel.pin, channel.duty > 0 ? HIGH : LOW);
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf)
+{
+  if (timer_conf == nullptr || timer_conf->speed_mode >= LEDC_SPEED_MODE_MAX ||
+      timer_conf->timer_num >= LEDC_TIMER_MAX || timer_conf->freq_hz == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  ledcTimers[timer_conf->speed_mode][timer_conf->timer_num] = true;
+  return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf)
+{
+  if (ledc_conf == nullptr || ledc_conf->speed_mode >= LEDC_SPEED_MODE_MAX || ledc_conf->channel >= LEDC_CHANNEL_MAX ||
+      ledc_conf->timer_sel >= LEDC_TIMER_MAX || !ledcTimers[ledc_conf->speed_mode][ledc_conf->timer_sel] ||
+      ledc_conf->gpio_num < 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  NativeLedcChannel &channel = ledcChannels[ledc_conf->speed_mode][ledc_conf->channel];
+  channel.pin = ledc_conf->gpio_num;
+  channel.next = ledc_conf->duty;
+  pinMode(channel.pin, OUTPUT);
+  ledcApply(channel);
+  return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty)
+{
+  NativeLedcChannel *state = ledcChannel(speed_mode, channel);
+  if (state == nullptr)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  state->next = duty;
+  return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+  NativeLedcChannel *state = ledcChannel(speed_mode, channel);
+  if (state == nullptr)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  ledcApply(*state);
+  return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+  NativeLedcChannel *state = ledcChannel(speed_mode, channel);
+  return state != nullptr ? state->duty : 0;
+}
+
+esp_err_t ledc_fade_func_install(int)
+{
+  if (ledcFadeInstalled)
+  {
+    return ESP_ERR_INVALID_STATE; // As on the device
+  }
+  ledcFadeInstalled = true;
+  return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty, int)
+{
+  if (!ledcFadeInstalled)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  return ledc_set_duty(speed_mode, channel, target_duty);
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_fade_mode_t)
+{
+  if (!ledcFadeInstalled)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  return ledc_update_duty(speed_mode, channel);
+}
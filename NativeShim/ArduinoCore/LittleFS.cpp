@@ -0,0 +1,33 @@
+#include "LittleFS.h"
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+
+LittleFSFS LittleFS;
+
+static std::string fsRoot()
+{
+  const char *root = getenv("NATIVE_FS_ROOT");
+  return root != nullptr ? root : "native_fs";
+}
+
+LittleFSFS::LittleFSFS() : fs::FS(fsRoot())
+{
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char *, uint8_t, const char *)
+{
+  _root = fsRoot(); // At mount time, so a test runner can set it first
+  struct stat info;
+  if (stat(_root.c_str(), &info) == 0)
+  {
+    return S_ISDIR(info.st_mode);
+  }
+  return formatOnFail && format();
+}
+
+bool LittleFSFS::format()
+{
+  // Only an empty root can be made; an existing one is left alone
+  return ::mkdir(_root.c_str(), 0755) == 0;
+}
@@ -0,0 +1,25 @@
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+#include "FS.h"
+
+/**
+ * @brief LittleFS on a host directory: $NATIVE_FS_ROOT, else ./native_fs.
+ *
+ * Put the files of the project's data/ folder there to stand in for an
+ * uploaded file system image.
+ */
+class LittleFSFS : public fs::FS
+{
+public:
+  LittleFSFS();
+
+  bool begin(bool formatOnFail = false, const char *basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+             const char *partitionLabel = "spiffs");
+  void end() {}
+  bool format();
+};
+
+extern LittleFSFS LittleFS;
+
+#endif
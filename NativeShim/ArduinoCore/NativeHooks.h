@@ -0,0 +1,66 @@
+#ifndef NATIVE_HOOKS_H
+#define NATIVE_HOOKS_H
+
+#include <stdint.h>
+
+// Controls for host runs and benchmarks; nothing here exists on the device.
+
+/**
+ * @brief Level digitalRead() returns for `pin` (default HIGH, as with a pull-up).
+ *
+ * A change runs the pin's interrupt handler, in the calling thread.
+ */
+void nativeSetDigitalInput(uint8_t pin, int value);
+
+/**
+ * @brief Value analogRead() returns for `pin` (default 0).
+ */
+void nativeSetAnalogInput(uint8_t pin, int value);
+
+/**
+ * @brief Last level written to `pin` with digitalWrite().
+ */
+int nativeGetPinOutput(uint8_t pin);
+
+/**
+ * @brief Move millis() and micros() forward by `ms`, e.g. past a warm-up.
+ *
+ * Sleeps and timeouts still run on the host clock.
+ */
+void nativeAdvanceClock(unsigned long ms);
+
+/**
+ * @brief Run `function` between loop() passes, standing in for a timer interrupt.
+ */
+void nativeAttachTicker(void (*function)());
+void nativeDetachTicker(void (*function)());
+void nativeRunTickers();
+
+/**
+ * @brief Make WiFi.status() report an association (true) or an outage.
+ */
+void nativeSetWifiAvailable(bool available);
+bool nativeWifiAvailable();
+
+/**
+ * @brief Address the access point hands out over DHCP (default "127.0.0.1").
+ *
+ * With WiFi.config() set to any other address, DNS and connects fail.
+ */
+void nativeSetDhcpAddress(const char *address);
+
+/**
+ * @brief Send Serial output to stdout (default) or drop it.
+ */
+void nativeSetConsoleOutput(bool enabled);
+
+/**
+ * @brief Run loop() and the tickers, as main() does, until `done` returns true.
+ *
+ * With `done` null it runs for the whole `timeoutMs`.
+ *
+ * @return false if `timeoutMs` ran out first.
+ */
+bool nativeLoopUntil(bool (*done)(), unsigned long timeoutMs);
+
+#endif
@@ -0,0 +1,105 @@
+#include "Preferences.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool Preferences::begin(const char *name, bool readOnly, const char *)
+{
+  const char *root = getenv("NATIVE_NVS_ROOT");
+  std::string base = root != nullptr ? root : "native_nvs";
+  _directory = base + "/" + name;
+  _readOnly = readOnly;
+  if (!readOnly)
+  {
+    ::mkdir(base.c_str(), 0755);
+    ::mkdir(_directory.c_str(), 0755);
+  }
+  _open = true;
+  return true;
+}
+
+void Preferences::end()
+{
+  _open = false;
+}
+
+bool Preferences::clear()
+{
+  if (!_open || _readOnly)
+  {
+    return false;
+  }
+  DIR *dir = opendir(_directory.c_str());
+  if (dir == nullptr)
+  {
+    return true;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != nullptr)
+  {
+    if (entry->d_name[0] != '.')
+    {
+      unlink((_directory + "/" + entry->d_name).c_str());
+    }
+  }
+  closedir(dir);
+  return true;
+}
+
+bool Preferences::remove(const char *key)
+{
+  return _open && !_readOnly && unlink(keyPath(key).c_str()) == 0;
+}
+
+bool Preferences::isKey(const char *key)
+{
+  struct stat info;
+  return _open && stat(keyPath(key).c_str(), &info) == 0;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+  struct stat info;
+  return _open && stat(keyPath(key).c_str(), &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t maxLength)
+{
+  size_t length = getBytesLength(key);
+  if (length == 0 || length > maxLength)
+  {
+    return 0; // NVS refuses a short buffer rather than truncating
+  }
+  FILE *file = fopen(keyPath(key).c_str(), "rb");
+  if (file == nullptr)
+  {
+    return 0;
+  }
+  length = fread(buffer, 1, length, file);
+  fclose(file);
+  return length;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length)
+{
+  if (!_open || _readOnly)
+  {
+    return 0;
+  }
+  FILE *file = fopen(keyPath(key).c_str(), "wb");
+  if (file == nullptr)
+  {
+    return 0;
+  }
+  length = fwrite(value, 1, length, file);
+  fclose(file);
+  return length;
+}
+
+std::string Preferences::keyPath(const char *key) const
+{
+  return _directory + "/" + key;
+}
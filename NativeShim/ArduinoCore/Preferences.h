@@ -0,0 +1,33 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include <stddef.h>
+#include <string>
+
+/**
+ * @brief NVS on the host: one file per key under $NATIVE_NVS_ROOT/<namespace>,
+ * else ./native_nvs/<namespace>.
+ */
+class Preferences
+{
+public:
+  Preferences() : _open(false), _readOnly(false) {}
+
+  bool begin(const char *name, bool readOnly = false, const char *partitionLabel = nullptr);
+  void end();
+  bool clear();
+  bool remove(const char *key);
+  bool isKey(const char *key);
+  size_t getBytesLength(const char *key);
+  size_t getBytes(const char *key, void *buffer, size_t maxLength);
+  size_t putBytes(const char *key, const void *value, size_t length);
+
+private:
+  std::string keyPath(const char *key) const;
+
+  std::string _directory;
+  bool _open;
+  bool _readOnly;
+};
+
+#endif
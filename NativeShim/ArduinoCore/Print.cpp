@@ -0,0 +1,51 @@
+#include "Print.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (size-- > 0)
+  {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::write(const char *text)
+{
+  return text != nullptr ? write((const uint8_t *)text, strlen(text)) : 0;
+}
+
+size_t Print::print(const char *text) { return write(text); }
+size_t Print::print(const String &text) { return write(text.c_str()); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char value, int base) { return print((unsigned long long)value, base); }
+size_t Print::print(int value, int base) { return print((long long)value, base); }
+size_t Print::print(unsigned int value, int base) { return print((unsigned long long)value, base); }
+size_t Print::print(long value, int base) { return print((long long)value, base); }
+size_t Print::print(unsigned long value, int base) { return print((unsigned long long)value, base); }
+size_t Print::print(long long value, int base) { return print(String(value, (unsigned char)base)); }
+size_t Print::print(unsigned long long value, int base) { return print(String(value, (unsigned char)base)); }
+size_t Print::print(double value, int decimals) { return print(String(value, (unsigned int)decimals)); }
+size_t Print::print(const Printable &value) { return value.printTo(*this); }
+
+size_t Print::println()
+{
+  return write("\r\n");
+}
+
+size_t Print::printf(const char *format, ...)
+{
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length < 0)
+  {
+    return 0;
+  }
+  return write((const uint8_t *)buffer, (size_t)length < sizeof(buffer) ? (size_t)length : sizeof(buffer) - 1);
+}
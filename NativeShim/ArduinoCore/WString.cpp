@@ -0,0 +1,192 @@
+#include "WString.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+
+bool String::reserve(unsigned int size)
+{
+  _text.reserve(size);
+  return true;
+}
+
+String &String::operator+=(const String &other)
+{
+  _text += other._text;
+  return *this;
+}
+
+String &String::operator+=(const char *text)
+{
+  if (text != nullptr)
+  {
+    _text += text;
+  }
+  return *this;
+}
+
+String &String::operator+=(char c)
+{
+  _text += c;
+  return *this;
+}
+
+String &String::operator+=(int value) { return *this += (long long)value; }
+String &String::operator+=(long value) { return *this += (long long)value; }
+String &String::operator+=(unsigned int value) { return *this += (unsigned long long)value; }
+String &String::operator+=(unsigned long value) { return *this += (unsigned long long)value; }
+
+String &String::operator+=(long long value)
+{
+  _text += formatSigned(value, DEC);
+  return *this;
+}
+
+String &String::operator+=(unsigned long long value)
+{
+  _text += formatUnsigned(value, DEC);
+  return *this;
+}
+
+String &String::operator+=(float value) { return *this += (double)value; }
+
+String &String::operator+=(double value)
+{
+  _text += formatFloat(value, 2);
+  return *this;
+}
+
+bool String::concat(const String &other)
+{
+  _text += other._text;
+  return true;
+}
+
+bool String::startsWith(const String &prefix) const
+{
+  return _text.compare(0, prefix._text.length(), prefix._text) == 0;
+}
+
+bool String::endsWith(const String &suffix) const
+{
+  return _text.length() >= suffix._text.length() &&
+         _text.compare(_text.length() - suffix._text.length(), suffix._text.length(), suffix._text) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const
+{
+  size_t found = _text.find(c, from);
+  return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::indexOf(const String &text, unsigned int from) const
+{
+  size_t found = _text.find(text._text, from);
+  return found == std::string::npos ? -1 : (int)found;
+}
+
+String String::substring(unsigned int from) const
+{
+  return from < _text.length() ? String(_text.substr(from)) : String();
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+  if (from > to)
+  {
+    unsigned int swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from >= _text.length())
+  {
+    return String();
+  }
+  return String(_text.substr(from, to - from));
+}
+
+void String::trim()
+{
+  size_t start = 0;
+  while (start < _text.length() && isspace((unsigned char)_text[start]))
+  {
+    start++;
+  }
+  size_t end = _text.length();
+  while (end > start && isspace((unsigned char)_text[end - 1]))
+  {
+    end--;
+  }
+  _text = _text.substr(start, end - start);
+}
+
+long String::toInt() const
+{
+  return strtol(_text.c_str(), nullptr, 10);
+}
+
+float String::toFloat() const
+{
+  return strtof(_text.c_str(), nullptr);
+}
+
+void String::toCharArray(char *buffer, unsigned int size) const
+{
+  if (size == 0)
+  {
+    return;
+  }
+  size_t length = _text.length() < size - 1 ? _text.length() : size - 1;
+  memcpy(buffer, _text.c_str(), length);
+  buffer[length] = '\0';
+}
+
+String operator+(const String &left, const String &right)
+{
+  return String(left._text + right._text);
+}
+
+String operator+(const String &left, const char *right)
+{
+  return String(left._text + (right != nullptr ? right : ""));
+}
+
+String operator+(const char *left, const String &right)
+{
+  return String((left != nullptr ? left : "") + right._text);
+}
+
+std::string String::formatSigned(long long value, unsigned char base)
+{
+  if (base == DEC)
+  {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "%lld", value);
+    return buffer;
+  }
+  return formatUnsigned((unsigned long long)value, base);
+}
+
+std::string String::formatUnsigned(unsigned long long value, unsigned char base)
+{
+  if (base < 2 || base > 16)
+  {
+    base = DEC;
+  }
+  char buffer[65];
+  char *cursor = buffer + sizeof(buffer) - 1;
+  *cursor = '\0';
+  do
+  {
+    *--cursor = "0123456789abcdef"[value % base];
+    value /= base;
+  } while (value != 0);
+  return cursor;
+}
+
+std::string String::formatFloat(double value, unsigned int decimals)
+{
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+  return buffer;
+}
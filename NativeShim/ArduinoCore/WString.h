@@ -0,0 +1,82 @@
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+/**
+ * @brief Arduino String on top of std::string.
+ *
+ * Allocates like the real one does, which is what the host benchmarks
+ * want to see.
+ */
+class String
+{
+public:
+  String(const char *text = "") : _text(text != nullptr ? text : "") {}
+  String(const std::string &text) : _text(text) {}
+  explicit String(char c) : _text(1, c) {}
+  explicit String(int value, unsigned char base = DEC) : _text(formatSigned(value, base)) {}
+  explicit String(long value, unsigned char base = DEC) : _text(formatSigned(value, base)) {}
+  explicit String(long long value, unsigned char base = DEC) : _text(formatSigned(value, base)) {}
+  explicit String(unsigned int value, unsigned char base = DEC) : _text(formatUnsigned(value, base)) {}
+  explicit String(unsigned long value, unsigned char base = DEC) : _text(formatUnsigned(value, base)) {}
+  explicit String(unsigned long long value, unsigned char base = DEC) : _text(formatUnsigned(value, base)) {}
+  explicit String(float value, unsigned int decimals = 2) : _text(formatFloat(value, decimals)) {}
+  explicit String(double value, unsigned int decimals = 2) : _text(formatFloat(value, decimals)) {}
+
+  const char *c_str() const { return _text.c_str(); }
+  unsigned int length() const { return (unsigned int)_text.length(); }
+  bool reserve(unsigned int size);
+  char charAt(unsigned int index) const { return index < _text.length() ? _text[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+
+  String &operator+=(const String &other);
+  String &operator+=(const char *text);
+  String &operator+=(char c);
+  String &operator+=(int value);
+  String &operator+=(long value);
+  String &operator+=(unsigned int value);
+  String &operator+=(unsigned long value);
+  String &operator+=(long long value);
+  String &operator+=(unsigned long long value);
+  String &operator+=(float value);
+  String &operator+=(double value);
+  bool concat(const String &other);
+
+  bool operator==(const String &other) const { return _text == other._text; }
+  bool operator==(const char *text) const { return _text == (text != nullptr ? text : ""); }
+  bool operator!=(const String &other) const { return !(*this == other); }
+  bool operator!=(const char *text) const { return !(*this == text); }
+  bool equals(const String &other) const { return *this == other; }
+  bool startsWith(const String &prefix) const;
+  bool endsWith(const String &suffix) const;
+
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String &text, unsigned int from = 0) const;
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+  void trim();
+  long toInt() const;
+  float toFloat() const;
+  void toCharArray(char *buffer, unsigned int size) const;
+
+  friend String operator+(const String &left, const String &right);
+  friend String operator+(const String &left, const char *right);
+  friend String operator+(const char *left, const String &right);
+
+private:
+  static std::string formatSigned(long long value, unsigned char base);
+  static std::string formatUnsigned(unsigned long long value, unsigned char base);
+  static std::string formatFloat(double value, unsigned int decimals);
+
+  std::string _text;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "WiFi.h"
+#include "NativeHooks.h"
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+WiFiClass WiFi;
+
+static bool wifiAvailable = true;
+static IPAddress dhcpAddress(127, 0, 0, 1);
+
+void nativeSetWifiAvailable(bool available)
+{
+  wifiAvailable = available;
+}
+
+bool nativeWifiAvailable()
+{
+  return wifiAvailable;
+}
+
+void nativeSetDhcpAddress(const char *address)
+{
+  dhcpAddress.fromString(address);
+}
+
+WiFiClass::WiFiClass() : _mode(WIFI_OFF), _begun(false), _bssid{0x02, 0, 0, 0, 0, 0x01}, _channel(1)
+{
+}
+
+wl_status_t WiFiClass::begin(const char *, const char *, int32_t channel, const uint8_t *bssid, bool connect)
+{
+  if (channel > 0)
+  {
+    _channel = channel;
+  }
+  if (bssid != nullptr)
+  {
+    memcpy(_bssid, bssid, sizeof(_bssid));
+  }
+  _begun = connect;
+  return status();
+}
+
+bool WiFiClass::config(IPAddress localIP, IPAddress, IPAddress, IPAddress, IPAddress)
+{
+  _staticIP = localIP;
+  return true;
+}
+
+bool WiFiClass::disconnect(bool, bool)
+{
+  _begun = false;
+  return true;
+}
+
+wl_status_t WiFiClass::status()
+{
+  if (!_begun)
+  {
+    return WL_DISCONNECTED;
+  }
+  return wifiAvailable ? WL_CONNECTED : WL_CONNECTION_LOST;
+}
+
+IPAddress WiFiClass::localIP() const
+{
+  return (uint32_t)_staticIP != 0 ? _staticIP : dhcpAddress;
+}
+
+bool WiFiClass::nativeRoutable() const
+{
+  return (uint32_t)_staticIP == 0 || _staticIP == dhcpAddress;
+}
+
+IPAddress WiFiClass::gatewayIP() const
+{
+  return IPAddress(127, 0, 0, 1);
+}
+
+IPAddress WiFiClass::subnetMask() const
+{
+  return IPAddress(255, 0, 0, 0);
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t) const
+{
+  return IPAddress(127, 0, 0, 1);
+}
+
+int WiFiClass::hostByName(const char *host, IPAddress &result)
+{
+  if (!wifiAvailable || !nativeRoutable())
+  {
+    return 0;
+  }
+  const char *broker = getenv("NATIVE_BROKER");
+  if (broker != nullptr)
+  {
+    host = broker;
+  }
+  if (result.fromString(host))
+  {
+    return 1;
+  }
+
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  addrinfo *found = nullptr;
+  if (getaddrinfo(host, nullptr, &hints, &found) != 0 || found == nullptr)
+  {
+    return 0;
+  }
+  result = IPAddress((uint32_t)((sockaddr_in *)found->ai_addr)->sin_addr.s_addr);
+  freeaddrinfo(found);
+  return 1;
+}
+
+int WiFiClass::hostByName(const char *host, IPAddress &result, uint32_t)
+{
+  return hostByName(host, result);
+}
+
+bool WiFiClass::setSleepMode(WiFiSleepType_t, uint8_t)
+{
+  return true;
+}
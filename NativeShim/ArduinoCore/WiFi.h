@@ -0,0 +1,88 @@
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include <stdint.h>
+#include "IPAddress.h"
+#include "WiFiClient.h"
+
+typedef enum
+{
+  WL_NO_SHIELD = 255,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum
+{
+  WIFI_NONE_SLEEP = 0,
+  WIFI_LIGHT_SLEEP = 1,
+  WIFI_MODEM_SLEEP = 2
+} WiFiSleepType_t;
+
+/**
+ * @brief Station interface backed by the host's network.
+ *
+ * begin() associates at once unless nativeSetWifiAvailable(false) holds
+ * the link down. The host's own address is reported as 127.0.0.1, or as
+ * set with nativeSetDhcpAddress(), and hostByName() returns
+ * $NATIVE_BROKER, when set, for every name. A static address other than
+ * the DHCP one still associates but reaches nothing, like a stale lease.
+ */
+class WiFiClass
+{
+public:
+  WiFiClass();
+
+  bool mode(wifi_mode_t mode) { _mode = mode; return true; }
+  wifi_mode_t getMode() const { return _mode; }
+  void persistent(bool) {}
+  bool setAutoReconnect(bool) { return true; }
+  wl_status_t begin(const char *ssid, const char *password = nullptr, int32_t channel = 0,
+                    const uint8_t *bssid = nullptr, bool connect = true);
+  bool config(IPAddress localIP, IPAddress gateway, IPAddress subnet, IPAddress dns1 = (uint32_t)0,
+              IPAddress dns2 = (uint32_t)0);
+  bool disconnect(bool wifiOff = false, bool eraseAp = false);
+  wl_status_t status();
+
+  uint8_t *BSSID() { return _bssid; }
+  int32_t channel() const { return _channel; }
+  int8_t RSSI() const { return -50; }
+  IPAddress localIP() const;
+  IPAddress gatewayIP() const;
+  IPAddress subnetMask() const;
+  IPAddress dnsIP(uint8_t index = 0) const;
+  String macAddress() const { return String("02:00:00:00:00:01"); }
+
+  int hostByName(const char *host, IPAddress &result);
+  int hostByName(const char *host, IPAddress &result, uint32_t timeoutMs);
+
+  bool setSleepMode(WiFiSleepType_t type, uint8_t listenInterval = 0);
+  bool setSleep(bool enabled) { return setSleepMode(enabled ? WIFI_MODEM_SLEEP : WIFI_NONE_SLEEP); }
+
+  // Host only: false while a static address the network does not route is set
+  bool nativeRoutable() const;
+
+private:
+  wifi_mode_t _mode;
+  bool _begun;
+  uint8_t _bssid[6];
+  int32_t _channel;
+  IPAddress _staticIP;
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,166 @@
+#include "WiFiClient.h"
+#include "WiFi.h"
+#include "NativeHooks.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+int WiFiClient::connect(IPAddress ip, uint16_t port)
+{
+  stop();
+  if (!nativeWifiAvailable() || !WiFi.nativeRoutable())
+  {
+    return 0;
+  }
+  const char *brokerPort = getenv("NATIVE_BROKER_PORT");
+  if (brokerPort != nullptr && port == 1883)
+  {
+    port = (uint16_t)atoi(brokerPort);
+  }
+  _socket = socket(AF_INET, SOCK_STREAM, 0);
+  if (_socket < 0)
+  {
+    return 0;
+  }
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = (uint32_t)ip;
+
+  // Non-blocking connect so that the handshake honours the timeout
+  int flags = fcntl(_socket, F_GETFL, 0);
+  fcntl(_socket, F_SETFL, flags | O_NONBLOCK);
+  int result = ::connect(_socket, (sockaddr *)&address, sizeof(address));
+  if (result < 0 && errno == EINPROGRESS)
+  {
+    pollfd waiting = {_socket, POLLOUT, 0};
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (poll(&waiting, 1, _timeoutS * 1000) == 1 &&
+        getsockopt(_socket, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0)
+    {
+      result = 0;
+    }
+  }
+  if (result < 0)
+  {
+    stop();
+    return 0;
+  }
+  fcntl(_socket, F_SETFL, flags);
+  setNoDelay(true);
+  return 1;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+  IPAddress ip;
+  return WiFi.hostByName(host, ip) == 1 ? connect(ip, port) : 0;
+}
+
+size_t WiFiClient::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size)
+{
+  if (!connected())
+  {
+    return 0;
+  }
+  size_t sent = 0;
+  while (sent < size)
+  {
+    ssize_t result = send(_socket, buffer + sent, size - sent, MSG_NOSIGNAL);
+    if (result <= 0)
+    {
+      stop();
+      break;
+    }
+    sent += result;
+  }
+  return sent;
+}
+
+int WiFiClient::available()
+{
+  int pending = 0;
+  if (_socket < 0 || ioctl(_socket, FIONREAD, &pending) < 0)
+  {
+    return 0;
+  }
+  return pending;
+}
+
+int WiFiClient::read()
+{
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size)
+{
+  if (available() == 0)
+  {
+    return -1; // Never blocks, as on the device
+  }
+  ssize_t result = recv(_socket, buffer, size, MSG_DONTWAIT);
+  return result > 0 ? (int)result : -1;
+}
+
+int WiFiClient::peek()
+{
+  uint8_t c;
+  return _socket >= 0 && recv(_socket, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? c : -1;
+}
+
+void WiFiClient::stop()
+{
+  if (_socket >= 0)
+  {
+    close(_socket);
+    _socket = -1;
+  }
+}
+
+uint8_t WiFiClient::connected()
+{
+  if (_socket < 0)
+  {
+    return 0;
+  }
+  if (!nativeWifiAvailable())
+  {
+    stop(); // The link went with the association
+    return 0;
+  }
+  uint8_t c;
+  ssize_t result = recv(_socket, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (result == 0 || (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+  {
+    stop(); // Closed by the peer
+    return 0;
+  }
+  return 1;
+}
+
+int WiFiClient::setTimeout(uint32_t seconds)
+{
+  _timeoutS = seconds;
+  Stream::setTimeout(seconds * 1000);
+  return 0;
+}
+
+int WiFiClient::setNoDelay(bool noDelay)
+{
+  int value = noDelay ? 1 : 0;
+  return _socket >= 0 ? setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value)) : -1;
+}
@@ -0,0 +1,41 @@
+#ifndef NATIVE_WIFI_CLIENT_H
+#define NATIVE_WIFI_CLIENT_H
+
+#include "Client.h"
+
+/**
+ * @brief TCP client on a host socket.
+ */
+class WiFiClient : public Client
+{
+public:
+  WiFiClient() : _socket(-1), _timeoutS(3) {}
+  ~WiFiClient() override { stop(); }
+  WiFiClient(const WiFiClient &) = delete;
+  WiFiClient &operator=(const WiFiClient &) = delete;
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char *host, uint16_t port) override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t *buffer, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return _socket >= 0; }
+
+  /**
+   * @brief Bound on connect and on each read; seconds, as on the ESP32 core.
+   */
+  int setTimeout(uint32_t seconds);
+  int setNoDelay(bool noDelay);
+
+private:
+  int _socket;
+  uint32_t _timeoutS;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+// FreeRTOS on top of host threads: tasks are std::threads, pinning and
+// priorities are recorded but not enforced, ticks are milliseconds.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_FULL 0
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms) * configTICK_RATE_HZ / 1000)
+#define tskNO_AFFINITY 0x7fffffff
+#define portNUM_PROCESSORS 2
+
+// Critical sections: one process-wide recursive lock, so code that expects
+// to exclude an interrupt handler also excludes the simulated one
+typedef struct
+{
+  int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+void nativeEnterCritical();
+void nativeExitCritical();
+#define portENTER_CRITICAL(mux) nativeEnterCritical()
+#define portEXIT_CRITICAL(mux) nativeExitCritical()
+#define portENTER_CRITICAL_ISR(mux) nativeEnterCritical()
+#define portEXIT_CRITICAL_ISR(mux) nativeExitCritical()
+#define portYIELD_FROM_ISR(...) ((void)0)
+
+BaseType_t xPortGetCoreID();
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef NATIVE_DHTESP_H
+#define NATIVE_DHTESP_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Host stand-in for DHTesp with no sensor attached.
+ */
+class DHTesp
+{
+public:
+  enum DHT_MODEL_t
+  {
+    AUTO_DETECT,
+    DHT11,
+    DHT22,
+    AM2302,
+    RHT03
+  };
+
+  void setup(uint8_t pin, DHT_MODEL_t model = AUTO_DETECT) { (void)pin; (void)model; }
+  float getTemperature() { return NAN; }
+  float getHumidity() { return NAN; }
+};
+
+#endif
@@ -0,0 +1,171 @@
+#include "NativeBench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+// Counted for every thread; the firmware's background tasks show up too
+static std::atomic<uint64_t> allocationCount(0);
+static std::atomic<uint64_t> allocationBytes(0);
+
+static void *countedAlloc(size_t size)
+{
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  allocationBytes.fetch_add(size, std::memory_order_relaxed);
+  return malloc(size > 0 ? size : 1);
+}
+
+void *operator new(size_t size)
+{
+  void *block = countedAlloc(size);
+  if (block == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return block;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+  return countedAlloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+  return countedAlloc(size);
+}
+
+void operator delete(void *block) noexcept
+{
+  free(block);
+}
+
+void operator delete[](void *block) noexcept
+{
+  free(block);
+}
+
+void operator delete(void *block, size_t) noexcept
+{
+  free(block);
+}
+
+void operator delete[](void *block, size_t) noexcept
+{
+  free(block);
+}
+
+BenchAllocations benchAllocations()
+{
+  return {allocationCount.load(std::memory_order_relaxed), allocationBytes.load(std::memory_order_relaxed)};
+}
+
+uint64_t benchNowNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+size_t BenchClient::write(const uint8_t *buffer, size_t size)
+{
+  if (!_open || size == 0)
+  {
+    return 0;
+  }
+  _bytesWritten += size;
+  _publishes += (buffer[0] & 0xF0) == MQTTPUBLISH ? 1 : 0;
+  // PubSubClient sends each packet with a single write
+  if ((buffer[0] & 0xF0) == MQTTCONNECT)
+  {
+    const uint8_t connack[] = {MQTTCONNACK, 2, 0, 0};
+    _reply.insert(_reply.end(), connack, connack + sizeof(connack));
+  }
+  else if ((buffer[0] & 0xF0) == MQTTPINGREQ)
+  {
+    _reply.push_back(MQTTPINGRESP);
+    _reply.push_back(0);
+  }
+  return size;
+}
+
+int BenchClient::read()
+{
+  if (_reply.empty())
+  {
+    return -1;
+  }
+  uint8_t c = _reply.front();
+  _reply.pop_front();
+  return c;
+}
+
+int BenchClient::read(uint8_t *buffer, size_t size)
+{
+  size_t count = 0;
+  while (count < size && !_reply.empty())
+  {
+    buffer[count++] = _reply.front();
+    _reply.pop_front();
+  }
+  return count > 0 ? (int)count : -1;
+}
+
+bool NativeBench::connect(PubSubClient &client, BenchClient &sink)
+{
+  _sink = &sink;
+  client.setClient(sink);
+  client.setServer(IPAddress(127, 0, 0, 1), 1883);
+  return client.connect("bench");
+}
+
+/**
+ * @brief Print a name as a JSON string; bench names are plain ASCII.
+ */
+static void printJsonString(const char *text)
+{
+  putchar('"');
+  for (; *text != '\0'; text++)
+  {
+    if (*text == '"' || *text == '\\')
+    {
+      putchar('\\');
+    }
+    putchar(*text);
+  }
+  putchar('"');
+}
+
+int NativeBench::finish()
+{
+  Serial.flush();
+  printf("{\"suite\": ");
+  printJsonString(_suite);
+  printf(", \"benchmarks\": [");
+  for (size_t i = 0; i < _results.size(); i++)
+  {
+    const Result &result = _results[i];
+    printf(i == 0 ? "\n  {\"name\": " : ",\n  {\"name\": ");
+    printJsonString(result.name);
+    printf(", \"iterations\": %u, \"ns_per_op\": %.1f, \"min_ns_per_op\": %.1f, \"allocs_per_op\": %.3f, "
+           "\"bytes_per_op\": %.1f, \"mqtt_bytes_per_op\": %.1f, \"mqtt_bytes_per_s\": %.0f, "
+           "\"mqtt_publishes_per_op\": %.3f",
+           result.iterations, result.nsPerOp, result.minNsPerOp, result.allocsPerOp, result.bytesPerOp,
+           result.mqttBytesPerOp, result.nsPerOp > 0 ? result.mqttBytesPerOp * 1e9 / result.nsPerOp : 0.0,
+           result.mqttPublishesPerOp);
+    if (result.opsPerMinute > 0)
+    {
+      printf(", \"mqtt_publishes_per_min\": %.1f, \"mqtt_bytes_per_min\": %.0f",
+             result.mqttPublishesPerOp * result.opsPerMinute, result.mqttBytesPerOp * result.opsPerMinute);
+    }
+    putchar('}');
+  }
+  printf("\n]}\n");
+  fflush(stdout);
+  return 0;
+}
@@ -0,0 +1,164 @@
+#ifndef NATIVE_BENCH_H
+#define NATIVE_BENCH_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <PubSubClient.h>
+#include <NativeHooks.h>
+#include <deque>
+#include <vector>
+
+#define BENCH_BATCHES 10 // Timed batches per benchmark; the fastest gives min_ns_per_op
+
+/**
+ * @brief Heap traffic through operator new since start-up.
+ */
+struct BenchAllocations
+{
+  uint64_t count;
+  uint64_t bytes;
+};
+
+BenchAllocations benchAllocations();
+uint64_t benchNowNs();
+
+/**
+ * @brief Client that swallows everything sent to it.
+ *
+ * Answers CONNECT and PINGREQ itself, so a PubSubClient set on it is
+ * connected and publish() runs in full without a socket or a broker.
+ */
+class BenchClient : public Client
+{
+public:
+  BenchClient() : _open(false), _bytesWritten(0), _publishes(0) {}
+
+  int connect(IPAddress, uint16_t) override { _open = true; return 1; }
+  int connect(const char *, uint16_t) override { _open = true; return 1; }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override;
+  int available() override { return (int)_reply.size(); }
+  int read() override;
+  int read(uint8_t *buffer, size_t size) override;
+  int peek() override { return _reply.empty() ? -1 : _reply.front(); }
+  void flush() override {}
+  void stop() override { _open = false; _reply.clear(); }
+  uint8_t connected() override { return _open; }
+  operator bool() override { return _open; }
+
+  uint64_t bytesWritten() const { return _bytesWritten; }
+  uint64_t publishes() const { return _publishes; }
+
+private:
+  bool _open;
+  uint64_t _bytesWritten;
+  uint64_t _publishes;
+  std::deque<uint8_t> _reply;
+};
+
+/**
+ * @brief Times hot paths and counts their allocations, then prints JSON.
+ *
+ * Serial output is dropped while a benchmark runs, so the numbers are the
+ * firmware's formatting and logic rather than the host terminal. The
+ * results go to stdout as one JSON object:
+ *
+ *   {"suite": "...", "benchmarks": [{"name": "...", "iterations": N,
+ *    "ns_per_op": x, "min_ns_per_op": x, "allocs_per_op": x,
+ *    "bytes_per_op": x, "mqtt_bytes_per_op": x, "mqtt_bytes_per_s": x,
+ *    "mqtt_publishes_per_op": x}, ...]}
+ *
+ * mqtt_bytes_per_s is the MQTT throughput one core would sustain if it did
+ * nothing but the benchmarked path. After perMinute() a result also has
+ * "mqtt_publishes_per_min" and "mqtt_bytes_per_min" at the given op rate.
+ */
+class NativeBench
+{
+public:
+  explicit NativeBench(const char *suite) : _suite(suite), _sink(nullptr) {}
+
+  /**
+   * @brief Point `client` at a BenchClient and open an MQTT session on it.
+   */
+  bool connect(PubSubClient &client, BenchClient &sink);
+
+  /**
+   * @brief Run `body` `iterations` times (after a 10% warm-up) and record it.
+   */
+  template <typename Body>
+  void run(const char *name, uint32_t iterations, Body body)
+  {
+    uint32_t perBatch = iterations / BENCH_BATCHES > 0 ? iterations / BENCH_BATCHES : 1;
+    nativeSetConsoleOutput(false);
+    for (uint32_t i = 0; i < perBatch; i++)
+    {
+      body();
+    }
+
+    uint64_t totalNs = 0;
+    uint64_t minBatchNs = UINT64_MAX;
+    uint64_t mqttStart = _sink != nullptr ? _sink->bytesWritten() : 0;
+    uint64_t publishesStart = _sink != nullptr ? _sink->publishes() : 0;
+    BenchAllocations start = benchAllocations();
+    for (uint8_t batch = 0; batch < BENCH_BATCHES; batch++)
+    {
+      uint64_t batchStart = benchNowNs();
+      for (uint32_t i = 0; i < perBatch; i++)
+      {
+        body();
+      }
+      uint64_t batchNs = benchNowNs() - batchStart;
+      totalNs += batchNs;
+      if (batchNs < minBatchNs)
+      {
+        minBatchNs = batchNs;
+      }
+    }
+    BenchAllocations end = benchAllocations();
+    nativeSetConsoleOutput(true);
+
+    double ops = (double)perBatch * BENCH_BATCHES;
+    _results.push_back({name, perBatch * BENCH_BATCHES, totalNs / ops, (double)minBatchNs / perBatch,
+                        (end.count - start.count) / ops, (end.bytes - start.bytes) / ops,
+                        ((_sink != nullptr ? _sink->bytesWritten() : 0) - mqttStart) / ops,
+                        ((_sink != nullptr ? _sink->publishes() : 0) - publishesStart) / ops, 0});
+  }
+
+  /**
+   * @brief Give the last benchmark's real-world rate, e.g. fixes per minute.
+   */
+  void perMinute(double opsPerMinute)
+  {
+    if (!_results.empty())
+    {
+      _results.back().opsPerMinute = opsPerMinute;
+    }
+  }
+
+  /**
+   * @brief Print the JSON report.
+   *
+   * @return Exit status for main().
+   */
+  int finish();
+
+private:
+  struct Result
+  {
+    const char *name;
+    uint32_t iterations;
+    double nsPerOp;
+    double minNsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+    double mqttBytesPerOp;
+    double mqttPublishesPerOp;
+    double opsPerMinute; // 0 unless perMinute() was called
+  };
+
+  const char *_suite;
+  BenchClient *_sink;
+  std::vector<Result> _results;
+};
+
+#endif
@@ -0,0 +1,480 @@
+#include "NativeBroker.h"
+#include <errno.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define PACKET_CONNECT 0x10
+#define PACKET_CONNACK 0x20
+#define PACKET_PUBLISH 0x30
+#define PACKET_PUBACK 0x40
+#define PACKET_SUBSCRIBE 0x80
+#define PACKET_SUBACK 0x90
+#define PACKET_UNSUBSCRIBE 0xA0
+#define PACKET_UNSUBACK 0xB0
+#define PACKET_PINGREQ 0xC0
+#define PACKET_PINGRESP 0xD0
+#define PACKET_DISCONNECT 0xE0
+
+static bool receiveAll(int socket, void *buffer, size_t size)
+{
+  uint8_t *bytes = (uint8_t *)buffer;
+  while (size > 0)
+  {
+    ssize_t result = recv(socket, bytes, size, 0);
+    if (result <= 0)
+    {
+      return false;
+    }
+    bytes += result;
+    size -= result;
+  }
+  return true;
+}
+
+static std::string packet(uint8_t header, const std::string &body)
+{
+  std::string out(1, (char)header);
+  size_t length = body.size();
+  do
+  {
+    uint8_t digit = length % 128;
+    length /= 128;
+    out += (char)(length > 0 ? digit | 0x80 : digit);
+  } while (length > 0);
+  return out + body;
+}
+
+static std::string lengthPrefixed(const std::string &text)
+{
+  std::string out;
+  out += (char)(text.size() >> 8);
+  out += (char)(text.size() & 0xFF);
+  return out + text;
+}
+
+static bool readString(const std::string &body, size_t &offset, std::string &text)
+{
+  if (offset + 2 > body.size())
+  {
+    return false;
+  }
+  size_t length = ((uint8_t)body[offset] << 8) | (uint8_t)body[offset + 1];
+  offset += 2;
+  if (offset + length > body.size())
+  {
+    return false;
+  }
+  text = body.substr(offset, length);
+  offset += length;
+  return true;
+}
+
+NativeBroker::NativeBroker() : _listener(-1), _port(0), _connects(0)
+{
+}
+
+NativeBroker::~NativeBroker()
+{
+  stop();
+}
+
+bool NativeBroker::start(uint16_t port)
+{
+  stop();
+  if (port == 0)
+  {
+    port = _port;
+  }
+
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0)
+  {
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  if (bind(listener, (sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 8) < 0 ||
+      getsockname(listener, (sockaddr *)&address, &length) < 0)
+  {
+    close(listener);
+    return false;
+  }
+  _port = ntohs(address.sin_port);
+  _listener = listener;
+  _acceptor = std::thread(&NativeBroker::acceptSessions, this);
+  return true;
+}
+
+void NativeBroker::stop()
+{
+  if (_listener < 0)
+  {
+    return;
+  }
+  // Wakes accept() and every recv() with an error
+  shutdown(_listener, SHUT_RDWR);
+  _acceptor.join();
+  close(_listener);
+  _listener = -1;
+
+  std::vector<Session *> sessions;
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    sessions.swap(_sessions);
+    for (size_t i = 0; i < sessions.size(); i++)
+    {
+      shutdown(sessions[i]->socket, SHUT_RDWR);
+    }
+  }
+  for (size_t i = 0; i < sessions.size(); i++)
+  {
+    sessions[i]->thread.join();
+    close(sessions[i]->socket);
+    delete sessions[i];
+  }
+}
+
+uint32_t NativeBroker::connects() const
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  return _connects;
+}
+
+std::vector<NativeBrokerMessage> NativeBroker::messages() const
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  return _messages;
+}
+
+size_t NativeBroker::count(const char *topic) const
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  size_t found = 0;
+  for (size_t i = 0; i < _messages.size(); i++)
+  {
+    found += _messages[i].topic == topic ? 1 : 0;
+  }
+  return found;
+}
+
+std::string NativeBroker::last(const char *topic) const
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  for (size_t i = _messages.size(); i > 0; i--)
+  {
+    if (_messages[i - 1].topic == topic)
+    {
+      return _messages[i - 1].payload;
+    }
+  }
+  return std::string();
+}
+
+bool NativeBroker::subscribed(const char *topic) const
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  for (size_t i = 0; i < _sessions.size(); i++)
+  {
+    for (size_t j = 0; j < _sessions[i]->filters.size(); j++)
+    {
+      if (!_sessions[i]->done && matches(_sessions[i]->filters[j].c_str(), topic))
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void NativeBroker::publish(const char *topic, const std::string &payload, bool retained)
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  route(topic, payload, retained);
+}
+
+void NativeBroker::clear()
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  _messages.clear();
+}
+
+bool NativeBroker::matches(const char *filter, const char *topic)
+{
+  while (*filter != '\0')
+  {
+    if (*filter == '#')
+    {
+      return true;
+    }
+    if (*filter == '+')
+    {
+      while (*topic != '\0' && *topic != '/')
+      {
+        topic++;
+      }
+      filter++;
+      continue;
+    }
+    if (*filter != *topic)
+    {
+      // "a/#" also matches "a"
+      return *topic == '\0' && filter[0] == '/' && filter[1] == '#' && filter[2] == '\0';
+    }
+    filter++;
+    topic++;
+  }
+  return *topic == '\0';
+}
+
+void NativeBroker::acceptSessions()
+{
+  while (true)
+  {
+    int socket = accept(_listener, nullptr, nullptr);
+    if (socket < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return; // stop() shut the listener down
+    }
+    int noDelay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    std::lock_guard<std::mutex> guard(_lock);
+    reapSessions();
+    Session *session = new Session();
+    session->socket = socket;
+    session->done = false;
+    _sessions.push_back(session);
+    session->thread = std::thread(&NativeBroker::serve, this, session);
+  }
+}
+
+void NativeBroker::serve(Session *session)
+{
+  while (true)
+  {
+    uint8_t header;
+    if (!receiveAll(session->socket, &header, 1))
+    {
+      break;
+    }
+    size_t length = 0;
+    uint32_t multiplier = 1;
+    uint8_t digit;
+    do
+    {
+      if (!receiveAll(session->socket, &digit, 1) || multiplier > 128 * 128 * 128)
+      {
+        digit = 0xFF;
+        break;
+      }
+      length += (digit & 0x7F) * multiplier;
+      multiplier *= 128;
+    } while (digit & 0x80);
+    if (digit == 0xFF)
+    {
+      break;
+    }
+
+    std::string body(length, '\0');
+    if (length > 0 && !receiveAll(session->socket, &body[0], length))
+    {
+      break;
+    }
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!handle(session, header, body))
+    {
+      break;
+    }
+  }
+
+  // The session ends; its subscriptions go with it
+  std::lock_guard<std::mutex> guard(_lock);
+  shutdown(session->socket, SHUT_RDWR);
+  session->done = true;
+}
+
+/**
+ * @brief Act on one packet, under the lock.
+ *
+ * @return false to close the session.
+ */
+bool NativeBroker::handle(Session *session, uint8_t header, const std::string &body)
+{
+  switch (header & 0xF0)
+  {
+  case PACKET_CONNECT:
+    _connects++;
+    return send(session->socket, packet(PACKET_CONNACK, std::string("\0\0", 2)));
+
+  case PACKET_PUBLISH:
+  {
+    size_t offset = 0;
+    std::string topic;
+    if (!readString(body, offset, topic))
+    {
+      return false;
+    }
+    uint8_t qos = (header >> 1) & 0x03;
+    std::string id;
+    if (qos > 0)
+    {
+      id = body.substr(offset, 2);
+      offset += 2;
+    }
+    bool retained = (header & 0x01) != 0;
+    std::string payload = offset < body.size() ? body.substr(offset) : std::string();
+    _messages.push_back({topic, payload, retained});
+    route(topic, payload, retained);
+    return qos == 0 || send(session->socket, packet(PACKET_PUBACK, id));
+  }
+
+  case PACKET_SUBSCRIBE:
+  {
+    if (body.size() < 2)
+    {
+      return false;
+    }
+    std::string granted = body.substr(0, 2); // Packet id
+    size_t offset = 2;
+    std::vector<std::string> added;
+    std::string filter;
+    while (offset < body.size() && readString(body, offset, filter))
+    {
+      offset++; // Requested QoS
+      session->filters.push_back(filter);
+      added.push_back(filter);
+      granted += '\0'; // Everything is forwarded at QoS 0
+    }
+    if (!send(session->socket, packet(PACKET_SUBACK, granted)))
+    {
+      return false;
+    }
+    for (size_t i = 0; i < _retained.size(); i++)
+    {
+      for (size_t j = 0; j < added.size(); j++)
+      {
+        if (matches(added[j].c_str(), _retained[i].topic.c_str()))
+        {
+          send(session->socket, packet(PACKET_PUBLISH | 0x01,
+                                       lengthPrefixed(_retained[i].topic) + _retained[i].payload));
+          break;
+        }
+      }
+    }
+    return true;
+  }
+
+  case PACKET_UNSUBSCRIBE:
+  {
+    size_t offset = 2;
+    std::string filter;
+    while (offset < body.size() && readString(body, offset, filter))
+    {
+      for (size_t i = 0; i < session->filters.size(); i++)
+      {
+        if (session->filters[i] == filter)
+        {
+          session->filters.erase(session->filters.begin() + i);
+          break;
+        }
+      }
+    }
+    return send(session->socket, packet(PACKET_UNSUBACK, body.substr(0, 2)));
+  }
+
+  case PACKET_PINGREQ:
+    return send(session->socket, packet(PACKET_PINGRESP, std::string()));
+
+  case PACKET_DISCONNECT:
+    return false;
+
+  default:
+    return true; // PUBACK and the like from the client
+  }
+}
+
+/**
+ * @brief Keep a retained message and forward to matching sessions, under the lock.
+ */
+void NativeBroker::route(const std::string &topic, const std::string &payload, bool retained)
+{
+  if (retained)
+  {
+    for (size_t i = 0; i < _retained.size(); i++)
+    {
+      if (_retained[i].topic == topic)
+      {
+        _retained.erase(_retained.begin() + i);
+        break;
+      }
+    }
+    if (!payload.empty()) // An empty retained payload clears the topic
+    {
+      _retained.push_back({topic, payload, true});
+    }
+  }
+
+  std::string forwarded = packet(PACKET_PUBLISH, lengthPrefixed(topic) + payload);
+  for (size_t i = 0; i < _sessions.size(); i++)
+  {
+    Session *session = _sessions[i];
+    for (size_t j = 0; j < session->filters.size(); j++)
+    {
+      if (!session->done && matches(session->filters[j].c_str(), topic.c_str()))
+      {
+        send(session->socket, forwarded);
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Free sessions whose client went away, under the lock.
+ */
+void NativeBroker::reapSessions()
+{
+  for (size_t i = 0; i < _sessions.size();)
+  {
+    if (_sessions[i]->done)
+    {
+      _sessions[i]->thread.join(); // Only the final unlock is left to run
+      close(_sessions[i]->socket);
+      delete _sessions[i];
+      _sessions.erase(_sessions.begin() + i);
+    }
+    else
+    {
+      i++;
+    }
+  }
+}
+
+bool NativeBroker::send(int socket, const std::string &packet)
+{
+  size_t sent = 0;
+  while (sent < packet.size())
+  {
+    ssize_t result = ::send(socket, packet.data() + sent, packet.size() - sent, MSG_NOSIGNAL);
+    if (result <= 0)
+    {
+      return false;
+    }
+    sent += result;
+  }
+  return true;
+}
@@ -0,0 +1,125 @@
+#ifndef NATIVE_BROKER_H
+#define NATIVE_BROKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A message the broker received from a client.
+ */
+struct NativeBrokerMessage
+{
+  std::string topic;
+  std::string payload; // May hold binary data
+  bool retained;
+};
+
+/**
+ * @brief MQTT 3.1.1 broker on 127.0.0.1 for host tests.
+ *
+ * Enough of a broker for the firmware's own traffic: CONNECT, PUBLISH at
+ * QoS 0 and 1 (acknowledged, forwarded at QoS 0), retained messages,
+ * SUBSCRIBE with + and # wildcards, UNSUBSCRIBE, PINGREQ. It records every
+ * publish, so a test can check what a firmware sent. Each session runs on
+ * its own thread; all calls are thread-safe.
+ *
+ * Firmware connects to port 1883. Set NATIVE_BROKER=127.0.0.1 and
+ * NATIVE_BROKER_PORT to port() to send it here instead.
+ */
+class NativeBroker
+{
+public:
+  NativeBroker();
+  ~NativeBroker();
+
+  /**
+   * @brief Listen on `port`, or on a free port when 0.
+   *
+   * After stop(), start() with no argument reopens the previous port, as a
+   * restarted broker would.
+   *
+   * @return false if the port could not be bound.
+   */
+  bool start(uint16_t port = 0);
+
+  /**
+   * @brief Close the listener and drop every session without a DISCONNECT.
+   *
+   * Retained messages are kept, like a broker with persistence.
+   */
+  void stop();
+
+  bool running() const { return _listener >= 0; }
+  uint16_t port() const { return _port; }
+
+  /**
+   * @brief Sessions accepted with a CONNACK since start-up.
+   */
+  uint32_t connects() const;
+
+  /**
+   * @brief Everything published to the broker, oldest first.
+   */
+  std::vector<NativeBrokerMessage> messages() const;
+
+  /**
+   * @brief Number of publishes received on `topic`.
+   */
+  size_t count(const char *topic) const;
+
+  /**
+   * @brief Payload of the newest publish on `topic`, empty if none.
+   */
+  std::string last(const char *topic) const;
+
+  /**
+   * @brief Whether a session holds a subscription that matches `topic`.
+   */
+  bool subscribed(const char *topic) const;
+
+  /**
+   * @brief Publish as a client would, to every matching subscription.
+   */
+  void publish(const char *topic, const std::string &payload, bool retained = false);
+
+  /**
+   * @brief Forget the recorded messages; retained ones stay.
+   */
+  void clear();
+
+  /**
+   * @brief Whether MQTT topic filter `filter` matches `topic`.
+   */
+  static bool matches(const char *filter, const char *topic);
+
+private:
+  struct Session
+  {
+    int socket;
+    std::thread thread;
+    std::vector<std::string> filters;
+    bool done;
+  };
+
+  void acceptSessions();
+  void serve(Session *session);
+  bool handle(Session *session, uint8_t header, const std::string &body);
+  void route(const std::string &topic, const std::string &payload, bool retained);
+  void reapSessions();
+  static bool send(int socket, const std::string &packet);
+
+  mutable std::mutex _lock;
+  int _listener;
+  uint16_t _port;
+  std::thread _acceptor;
+  std::vector<Session *> _sessions;
+  std::vector<NativeBrokerMessage> _messages;
+  std::vector<NativeBrokerMessage> _retained;
+  uint32_t _connects;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "NewPingESP8266.h"
+#include <NativeHooks.h>
+
+#define NATIVE_SONAR_PINS 64
+
+static unsigned int distances[NATIVE_SONAR_PINS];
+static void (*timerFunction)(void) = nullptr;
+
+NewPingESP8266::NewPingESP8266(uint8_t triggerPin, uint8_t, unsigned int maxCmDistance)
+    : ping_result(0), _triggerPin(triggerPin),
+      _maxEchoTime(min(maxCmDistance, (unsigned int)MAX_SENSOR_DISTANCE) * US_ROUNDTRIP_CM + US_ROUNDTRIP_CM / 2),
+      _pingStart(0)
+{
+}
+
+unsigned int NewPingESP8266::ping(unsigned int maxCmDistance)
+{
+  if (maxCmDistance > 0)
+  {
+    _maxEchoTime = min(maxCmDistance, (unsigned int)MAX_SENSOR_DISTANCE) * US_ROUNDTRIP_CM + US_ROUNDTRIP_CM / 2;
+  }
+  unsigned int echo = echoMicros();
+  if (echo == NO_ECHO || echo > _maxEchoTime)
+  {
+    delayMicroseconds(_maxEchoTime);
+    return NO_ECHO;
+  }
+  delayMicroseconds(echo);
+  return echo;
+}
+
+unsigned long NewPingESP8266::ping_cm(unsigned int maxCmDistance)
+{
+  return ping(maxCmDistance) / US_ROUNDTRIP_CM;
+}
+
+void NewPingESP8266::ping_timer(void (*userFunc)(void), unsigned int maxCmDistance)
+{
+  if (maxCmDistance > 0)
+  {
+    _maxEchoTime = min(maxCmDistance, (unsigned int)MAX_SENSOR_DISTANCE) * US_ROUNDTRIP_CM + US_ROUNDTRIP_CM / 2;
+  }
+  _pingStart = micros();
+  timer_us(ECHO_TIMER_FREQ, userFunc);
+}
+
+bool NewPingESP8266::check_timer()
+{
+  unsigned long elapsed = micros() - _pingStart;
+  if (elapsed > _maxEchoTime)
+  {
+    timer_stop(); // Out of range, as the library does
+    return false;
+  }
+  unsigned int echo = echoMicros();
+  if (echo != NO_ECHO && echo <= _maxEchoTime && elapsed >= echo)
+  {
+    timer_stop();
+    ping_result = echo;
+    return true;
+  }
+  return false;
+}
+
+void NewPingESP8266::timer_us(unsigned int, void (*userFunc)(void))
+{
+  timer_stop();
+  timerFunction = userFunc;
+  nativeAttachTicker(userFunc);
+}
+
+void NewPingESP8266::timer_ms(unsigned long frequency, void (*userFunc)(void))
+{
+  timer_us(frequency * 1000, userFunc);
+}
+
+void NewPingESP8266::timer_stop()
+{
+  if (timerFunction != nullptr)
+  {
+    nativeDetachTicker(timerFunction);
+    timerFunction = nullptr;
+  }
+}
+
+void NewPingESP8266::nativeSetDistance(uint8_t triggerPin, unsigned int cm)
+{
+  if (triggerPin < NATIVE_SONAR_PINS)
+  {
+    distances[triggerPin] = cm;
+  }
+}
+
+unsigned int NewPingESP8266::echoMicros() const
+{
+  unsigned int cm = _triggerPin < NATIVE_SONAR_PINS ? distances[_triggerPin] : 0;
+  return cm * US_ROUNDTRIP_CM;
+}
@@ -0,0 +1,48 @@
+#ifndef NATIVE_NEW_PING_ESP8266_H
+#define NATIVE_NEW_PING_ESP8266_H
+
+#include <Arduino.h>
+
+#define MAX_SENSOR_DISTANCE 500
+#define US_ROUNDTRIP_CM 57
+#define US_ROUNDTRIP_IN 146
+#define NO_ECHO 0
+#define ECHO_TIMER_FREQ 24
+
+/**
+ * @brief Host stand-in for NewPing with timer-driven pings.
+ *
+ * The echo arrives after the round trip for the distance set with
+ * nativeSetDistance() on the sensor's trigger pin; 0 means nothing in
+ * range. The echo timer runs between loop() passes (see NativeHooks.h),
+ * so the callback cadence is the host loop's, not 24 us.
+ */
+class NewPingESP8266
+{
+public:
+  NewPingESP8266(uint8_t triggerPin, uint8_t echoPin, unsigned int maxCmDistance = MAX_SENSOR_DISTANCE);
+
+  unsigned int ping(unsigned int maxCmDistance = 0);
+  unsigned long ping_cm(unsigned int maxCmDistance = 0);
+  void ping_timer(void (*userFunc)(void), unsigned int maxCmDistance = 0);
+  bool check_timer();
+  static void timer_us(unsigned int frequency, void (*userFunc)(void));
+  static void timer_ms(unsigned long frequency, void (*userFunc)(void));
+  static void timer_stop();
+
+  /**
+   * @brief Host only: distance the sensor on `triggerPin` will see.
+   */
+  static void nativeSetDistance(uint8_t triggerPin, unsigned int cm);
+
+  unsigned long ping_result;
+
+private:
+  unsigned int echoMicros() const;
+
+  uint8_t _triggerPin;
+  unsigned int _maxEchoTime;
+  unsigned long _pingStart;
+};
+
+#endif
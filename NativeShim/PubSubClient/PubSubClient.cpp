@@ -0,0 +1,475 @@
+#include "PubSubClient.h"
+
+PubSubClient::PubSubClient()
+    : _client(nullptr), _buffer(nullptr), _bufferSize(0), _keepAlive(MQTT_KEEPALIVE),
+      _socketTimeout(MQTT_SOCKET_TIMEOUT), _messageId(0), _lastOutActivity(0), _lastInActivity(0),
+      _pingOutstanding(false), callback(nullptr), _domain(nullptr), _port(0), _state(MQTT_DISCONNECTED)
+{
+  setBufferSize(MQTT_MAX_PACKET_SIZE);
+}
+
+PubSubClient::PubSubClient(Client &client) : PubSubClient()
+{
+  setClient(client);
+}
+
+PubSubClient::~PubSubClient()
+{
+  free(_buffer);
+}
+
+PubSubClient &PubSubClient::setServer(IPAddress ip, uint16_t port)
+{
+  _ip = ip;
+  _port = port;
+  _domain = nullptr;
+  return *this;
+}
+
+PubSubClient &PubSubClient::setServer(const char *domain, uint16_t port)
+{
+  _domain = domain;
+  _port = port;
+  return *this;
+}
+
+PubSubClient &PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE)
+{
+  this->callback = callback;
+  return *this;
+}
+
+PubSubClient &PubSubClient::setClient(Client &client)
+{
+  _client = &client;
+  return *this;
+}
+
+PubSubClient &PubSubClient::setKeepAlive(uint16_t keepAlive)
+{
+  _keepAlive = keepAlive;
+  return *this;
+}
+
+PubSubClient &PubSubClient::setSocketTimeout(uint16_t timeout)
+{
+  _socketTimeout = timeout;
+  return *this;
+}
+
+bool PubSubClient::setBufferSize(uint16_t size)
+{
+  if (size == 0)
+  {
+    return false;
+  }
+  uint8_t *buffer = (uint8_t *)realloc(_buffer, size);
+  if (buffer == nullptr)
+  {
+    return false;
+  }
+  _buffer = buffer;
+  _bufferSize = size;
+  return true;
+}
+
+bool PubSubClient::connect(const char *id)
+{
+  return connect(id, nullptr, nullptr, nullptr, 0, false, nullptr, true);
+}
+
+bool PubSubClient::connect(const char *id, const char *user, const char *pass)
+{
+  return connect(id, user, pass, nullptr, 0, false, nullptr, true);
+}
+
+bool PubSubClient::connect(const char *id, const char *willTopic, uint8_t willQos, bool willRetain,
+                           const char *willMessage)
+{
+  return connect(id, nullptr, nullptr, willTopic, willQos, willRetain, willMessage, true);
+}
+
+bool PubSubClient::connect(const char *id, const char *user, const char *pass, const char *willTopic,
+                           uint8_t willQos, bool willRetain, const char *willMessage, bool cleanSession)
+{
+  if (connected())
+  {
+    return true;
+  }
+  if (_client == nullptr)
+  {
+    return false;
+  }
+  int opened = _domain != nullptr ? _client->connect(_domain, _port) : _client->connect(_ip, _port);
+  if (opened != 1)
+  {
+    _state = MQTT_CONNECT_FAILED;
+    return false;
+  }
+
+  _messageId = 0;
+  uint16_t length = MQTT_MAX_HEADER_SIZE;
+  const uint8_t protocol[] = {0x00, 0x04, 'M', 'Q', 'T', 'T', MQTT_VERSION};
+  memcpy(_buffer + length, protocol, sizeof(protocol));
+  length += sizeof(protocol);
+
+  uint8_t flags = cleanSession ? 0x02 : 0x00;
+  if (willTopic != nullptr)
+  {
+    flags |= 0x04 | (willQos << 3) | (willRetain ? 0x20 : 0x00);
+  }
+  if (user != nullptr)
+  {
+    flags |= 0x80;
+    if (pass != nullptr)
+    {
+      flags |= 0x40;
+    }
+  }
+  _buffer[length++] = flags;
+  _buffer[length++] = _keepAlive >> 8;
+  _buffer[length++] = _keepAlive & 0xFF;
+
+  // writeString() returns 0 once the buffer is full, and keeps returning it
+  length = writeString(id, length);
+  if (willTopic != nullptr)
+  {
+    length = writeString(willTopic, length);
+    length = writeString(willMessage, length);
+  }
+  if (user != nullptr)
+  {
+    length = writeString(user, length);
+    if (pass != nullptr)
+    {
+      length = writeString(pass, length);
+    }
+  }
+  if (length == 0 || !sendPacket(MQTTCONNECT, length - MQTT_MAX_HEADER_SIZE))
+  {
+    stopSession(MQTT_CONNECT_FAILED);
+    return false;
+  }
+
+  // Blocks for the CONNACK, as the library does
+  unsigned long start = millis();
+  while (_client->available() == 0)
+  {
+    if (millis() - start >= _socketTimeout * 1000UL || !_client->connected())
+    {
+      stopSession(MQTT_CONNECTION_TIMEOUT);
+      return false;
+    }
+    delay(1);
+  }
+  uint8_t header;
+  if (readPacket(&header) == 2 && header == MQTTCONNACK)
+  {
+    if (_buffer[1] == 0)
+    {
+      _lastInActivity = millis();
+      _pingOutstanding = false;
+      _state = MQTT_CONNECTED;
+      return true;
+    }
+    stopSession(_buffer[1]);
+    return false;
+  }
+  stopSession(MQTT_CONNECT_FAILED);
+  return false;
+}
+
+void PubSubClient::disconnect()
+{
+  if (_client != nullptr && _client->connected())
+  {
+    const uint8_t packet[] = {MQTTDISCONNECT, 0};
+    _client->write(packet, sizeof(packet));
+  }
+  stopSession(MQTT_DISCONNECTED);
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload)
+{
+  return publish(topic, (const uint8_t *)payload, payload != nullptr ? strlen(payload) : 0, false);
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool retained)
+{
+  return publish(topic, (const uint8_t *)payload, payload != nullptr ? strlen(payload) : 0, retained);
+}
+
+bool PubSubClient::publish(const char *topic, const uint8_t *payload, unsigned int length)
+{
+  return publish(topic, payload, length, false);
+}
+
+bool PubSubClient::publish(const char *topic, const uint8_t *payload, unsigned int length, bool retained)
+{
+  if (!connected())
+  {
+    return false;
+  }
+  // Same limit as the library: the whole packet has to fit the buffer
+  if ((size_t)_bufferSize < MQTT_MAX_HEADER_SIZE + 2 + strnlen(topic, _bufferSize) + length)
+  {
+    return false;
+  }
+  uint16_t position = writeString(topic, MQTT_MAX_HEADER_SIZE);
+  if (length > 0)
+  {
+    memcpy(_buffer + position, payload, length);
+  }
+  return sendPacket(MQTTPUBLISH | (retained ? 1 : 0), position + length - MQTT_MAX_HEADER_SIZE);
+}
+
+bool PubSubClient::subscribe(const char *topic, uint8_t qos)
+{
+  if (topic == nullptr || qos > 1 || !connected() ||
+      (size_t)_bufferSize < MQTT_MAX_HEADER_SIZE + 2 + 2 + strnlen(topic, _bufferSize) + 1)
+  {
+    return false;
+  }
+  uint16_t id = nextMessageId();
+  uint16_t position = MQTT_MAX_HEADER_SIZE;
+  _buffer[position++] = id >> 8;
+  _buffer[position++] = id & 0xFF;
+  position = writeString(topic, position);
+  _buffer[position++] = qos;
+  return sendPacket(MQTTSUBSCRIBE | MQTTQOS1, position - MQTT_MAX_HEADER_SIZE);
+}
+
+bool PubSubClient::unsubscribe(const char *topic)
+{
+  if (topic == nullptr || !connected() ||
+      (size_t)_bufferSize < MQTT_MAX_HEADER_SIZE + 2 + 2 + strnlen(topic, _bufferSize))
+  {
+    return false;
+  }
+  uint16_t id = nextMessageId();
+  uint16_t position = MQTT_MAX_HEADER_SIZE;
+  _buffer[position++] = id >> 8;
+  _buffer[position++] = id & 0xFF;
+  position = writeString(topic, position);
+  return sendPacket(MQTTUNSUBSCRIBE | MQTTQOS1, position - MQTT_MAX_HEADER_SIZE);
+}
+
+bool PubSubClient::loop()
+{
+  if (!connected())
+  {
+    return false;
+  }
+
+  unsigned long now = millis();
+  unsigned long keepAliveMs = _keepAlive * 1000UL;
+  if (keepAliveMs > 0 && (now - _lastInActivity > keepAliveMs || now - _lastOutActivity > keepAliveMs))
+  {
+    if (_pingOutstanding)
+    {
+      stopSession(MQTT_CONNECTION_TIMEOUT);
+      return false;
+    }
+    if (!sendPacket(MQTTPINGREQ, 0))
+    {
+      return false;
+    }
+    _lastInActivity = now;
+    _pingOutstanding = true;
+  }
+
+  if (_client->available() == 0)
+  {
+    return true;
+  }
+  uint8_t header;
+  int32_t length = readPacket(&header);
+  if (length < 0)
+  {
+    return connected();
+  }
+  _lastInActivity = millis();
+
+  switch (header & 0xF0)
+  {
+  case MQTTPUBLISH:
+  {
+    if (length < 2)
+    {
+      break;
+    }
+    uint16_t topicLength = (_buffer[0] << 8) | _buffer[1];
+    uint16_t payloadStart = 2 + topicLength;
+    uint16_t messageId = 0;
+    bool qos1 = (header & 0x06) == MQTTQOS1;
+    if (qos1)
+    {
+      messageId = (_buffer[payloadStart] << 8) | _buffer[payloadStart + 1];
+      payloadStart += 2;
+    }
+    if (payloadStart > length)
+    {
+      break;
+    }
+    // Shift the topic down a byte to make room for its terminator
+    memmove(_buffer + 1, _buffer + 2, topicLength);
+    _buffer[1 + topicLength] = '\0';
+    if (callback)
+    {
+      callback((char *)_buffer + 1, _buffer + payloadStart, length - payloadStart);
+    }
+    if (qos1)
+    {
+      _buffer[MQTT_MAX_HEADER_SIZE] = messageId >> 8;
+      _buffer[MQTT_MAX_HEADER_SIZE + 1] = messageId & 0xFF;
+      sendPacket(MQTTPUBACK, 2);
+    }
+    break;
+  }
+  case MQTTPINGREQ:
+    sendPacket(MQTTPINGRESP, 0);
+    break;
+  case MQTTPINGRESP:
+    _pingOutstanding = false;
+    break;
+  default:
+    break; // SUBACK, UNSUBACK, PUBACK: nothing is waiting for them
+  }
+  return connected();
+}
+
+bool PubSubClient::connected()
+{
+  if (_client == nullptr)
+  {
+    return false;
+  }
+  if (_client->connected())
+  {
+    return _state == MQTT_CONNECTED;
+  }
+  if (_state == MQTT_CONNECTED)
+  {
+    stopSession(MQTT_CONNECTION_LOST);
+  }
+  return false;
+}
+
+bool PubSubClient::readByte(uint8_t *result)
+{
+  unsigned long start = millis();
+  while (_client->available() == 0)
+  {
+    if (millis() - start >= _socketTimeout * 1000UL || !_client->connected())
+    {
+      return false;
+    }
+    yield();
+  }
+  int c = _client->read();
+  if (c < 0)
+  {
+    return false;
+  }
+  *result = (uint8_t)c;
+  return true;
+}
+
+/**
+ * @brief Read one packet; the body goes to the start of the buffer.
+ *
+ * @return Body length, or -1 if the read failed or the packet did not fit
+ * (it is then read and dropped, as the library does).
+ */
+int32_t PubSubClient::readPacket(uint8_t *header)
+{
+  if (!readByte(header))
+  {
+    return -1;
+  }
+  uint32_t length = 0;
+  uint32_t multiplier = 1;
+  uint8_t digit;
+  do
+  {
+    if (multiplier > 128 * 128 * 128 || !readByte(&digit))
+    {
+      return -1;
+    }
+    length += (digit & 0x7F) * multiplier;
+    multiplier *= 128;
+  } while (digit & 0x80);
+
+  bool fits = length <= _bufferSize;
+  for (uint32_t i = 0; i < length; i++)
+  {
+    if (!readByte(&digit))
+    {
+      return -1;
+    }
+    if (fits)
+    {
+      _buffer[i] = digit;
+    }
+  }
+  return fits ? (int32_t)length : -1;
+}
+
+/**
+ * @brief Send the body staged at MQTT_MAX_HEADER_SIZE under a fixed header.
+ */
+bool PubSubClient::sendPacket(uint8_t header, uint32_t length)
+{
+  uint8_t encoded[4];
+  uint8_t digits = 0;
+  uint32_t remaining = length;
+  do
+  {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    encoded[digits++] = digit | (remaining > 0 ? 0x80 : 0x00);
+  } while (remaining > 0 && digits < sizeof(encoded));
+
+  uint8_t *start = _buffer + MQTT_MAX_HEADER_SIZE - 1 - digits;
+  start[0] = header;
+  memcpy(start + 1, encoded, digits);
+  size_t total = 1 + digits + length;
+  if (_client->write(start, total) != total)
+  {
+    stopSession(MQTT_CONNECTION_LOST);
+    return false;
+  }
+  _lastOutActivity = millis();
+  return true;
+}
+
+uint16_t PubSubClient::writeString(const char *text, uint16_t position)
+{
+  size_t length = text != nullptr ? strlen(text) : 0;
+  if (position == 0 || position + 2 + length > _bufferSize)
+  {
+    return 0;
+  }
+  _buffer[position++] = length >> 8;
+  _buffer[position++] = length & 0xFF;
+  memcpy(_buffer + position, text, length);
+  return position + length;
+}
+
+uint16_t PubSubClient::nextMessageId()
+{
+  if (++_messageId == 0)
+  {
+    _messageId = 1;
+  }
+  return _messageId;
+}
+
+void PubSubClient::stopSession(int state)
+{
+  if (_client != nullptr)
+  {
+    _client->stop();
+  }
+  _state = state;
+}
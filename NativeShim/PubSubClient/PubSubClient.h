@@ -0,0 +1,117 @@
+#ifndef NATIVE_PUB_SUB_CLIENT_H
+#define NATIVE_PUB_SUB_CLIENT_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <functional>
+
+#define MQTT_VERSION_3_1_1 4
+#define MQTT_VERSION MQTT_VERSION_3_1_1
+
+#ifndef MQTT_MAX_PACKET_SIZE
+#define MQTT_MAX_PACKET_SIZE 256
+#endif
+#ifndef MQTT_KEEPALIVE
+#define MQTT_KEEPALIVE 15
+#endif
+#ifndef MQTT_SOCKET_TIMEOUT
+#define MQTT_SOCKET_TIMEOUT 15
+#endif
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+#define MQTT_CONNECT_BAD_PROTOCOL 1
+#define MQTT_CONNECT_BAD_CLIENT_ID 2
+#define MQTT_CONNECT_UNAVAILABLE 3
+#define MQTT_CONNECT_BAD_CREDENTIALS 4
+#define MQTT_CONNECT_UNAUTHORIZED 5
+
+#define MQTTCONNECT (1 << 4)
+#define MQTTCONNACK (2 << 4)
+#define MQTTPUBLISH (3 << 4)
+#define MQTTPUBACK (4 << 4)
+#define MQTTSUBSCRIBE (8 << 4)
+#define MQTTSUBACK (9 << 4)
+#define MQTTUNSUBSCRIBE (10 << 4)
+#define MQTTUNSUBACK (11 << 4)
+#define MQTTPINGREQ (12 << 4)
+#define MQTTPINGRESP (13 << 4)
+#define MQTTDISCONNECT (14 << 4)
+
+#define MQTTQOS0 (0 << 1)
+#define MQTTQOS1 (1 << 1)
+
+#define MQTT_MAX_HEADER_SIZE 5
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char *, uint8_t *, unsigned int)> callback
+
+/**
+ * @brief MQTT 3.1.1 client with the PubSubClient API, for host builds.
+ *
+ * Written for the native environment rather than taken from the library:
+ * same calls, same blocking behaviour (connect() waits for CONNACK up to
+ * the socket timeout, everything else is one pass per loop()), same
+ * buffer-size limits on publish and receive.
+ */
+class PubSubClient
+{
+public:
+  PubSubClient();
+  explicit PubSubClient(Client &client);
+  ~PubSubClient();
+
+  PubSubClient &setServer(IPAddress ip, uint16_t port);
+  PubSubClient &setServer(const char *domain, uint16_t port);
+  PubSubClient &setCallback(MQTT_CALLBACK_SIGNATURE);
+  PubSubClient &setClient(Client &client);
+  PubSubClient &setKeepAlive(uint16_t keepAlive);
+  PubSubClient &setSocketTimeout(uint16_t timeout);
+  bool setBufferSize(uint16_t size);
+  uint16_t getBufferSize() const { return _bufferSize; }
+
+  bool connect(const char *id);
+  bool connect(const char *id, const char *user, const char *pass);
+  bool connect(const char *id, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage);
+  bool connect(const char *id, const char *user, const char *pass, const char *willTopic, uint8_t willQos,
+               bool willRetain, const char *willMessage, bool cleanSession = true);
+  void disconnect();
+
+  bool publish(const char *topic, const char *payload);
+  bool publish(const char *topic, const char *payload, bool retained);
+  bool publish(const char *topic, const uint8_t *payload, unsigned int length);
+  bool publish(const char *topic, const uint8_t *payload, unsigned int length, bool retained);
+
+  bool subscribe(const char *topic, uint8_t qos = 0);
+  bool unsubscribe(const char *topic);
+  bool loop();
+  bool connected();
+  int state() const { return _state; }
+
+private:
+  bool readByte(uint8_t *result);
+  int32_t readPacket(uint8_t *header);
+  bool sendPacket(uint8_t header, uint32_t length);
+  uint16_t writeString(const char *text, uint16_t position);
+  uint16_t nextMessageId();
+  void stopSession(int state);
+
+  Client *_client;
+  uint8_t *_buffer;
+  uint16_t _bufferSize;
+  uint16_t _keepAlive;
+  uint16_t _socketTimeout;
+  uint16_t _messageId;
+  unsigned long _lastOutActivity;
+  unsigned long _lastInActivity;
+  bool _pingOutstanding;
+  MQTT_CALLBACK_SIGNATURE;
+  IPAddress _ip;
+  const char *_domain;
+  uint16_t _port;
+  int _state;
+};
+
+#endif
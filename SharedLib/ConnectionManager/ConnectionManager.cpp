@@ -0,0 +1,390 @@
+#include "ConnectionManager.h"
+#if !defined(ESP8266)
+#include <esp_attr.h>
+#endif
+
+#define BACKOFF_MAX_DOUBLINGS 16
+
+#if !defined(ESP8266)
+// Not cleared at boot; the CRC tells a kept cache from power-on garbage
+RTC_NOINIT_ATTR static FastJoinCache rtcCache;
+#endif
+
+static uint32_t crc32Update(uint32_t crc, const void *data, size_t length)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc ^= bytes[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+  }
+  return crc;
+}
+
+ConnectionManager::ConnectionManager(PubSubClient &mqtt, WiFiClient &net)
+    : _mqtt(mqtt), _net(net), _config(), _callback(nullptr), _state(NET_WIFI_DOWN),
+      _stateMillis(0), _retryMillis(0), _retryDelayMs(0), _wifiFailures(0), _mqttFailures(0),
+      _resolved(false), _cache(), _cacheValid(false), _fastJoin(false), _staticConfig(false),
+      _joinMillis(0), _lastJoinMs(0), _bootToOnlineMs(0), _stats(), _windowMillis(0), _offlineMillis(0),
+      _blockedUs(0), _blockedMaxUs(0)
+{
+}
+
+void ConnectionManager::begin(const ConnectionConfig &config)
+{
+  _config = config;
+
+  // Retries are paced by the backoff here, not by the SDK, and must not
+  // rewrite the stored credentials in flash on every attempt
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false);
+  _cacheValid = loadCache();
+
+  // Bound the broker connect: TCP handshake, then the wait for CONNACK
+  uint16_t timeoutS = (_config.connectTimeoutMs + 999) / 1000;
+#if defined(ESP8266)
+  _net.setTimeout(_config.connectTimeoutMs);
+#else
+  _net.setTimeout(timeoutS); // Seconds on the ESP32 core
+#endif
+  _mqtt.setSocketTimeout(timeoutS);
+
+  _windowMillis = millis();
+  _offlineMillis = _windowMillis;
+  joinWifi();
+}
+
+void ConnectionManager::setStateCallback(void (*callback)(ConnectionState state))
+{
+  _callback = callback;
+}
+
+bool ConnectionManager::loop()
+{
+  unsigned long now = millis();
+  wl_status_t status = WiFi.status();
+  bool retryDue = now - _retryMillis >= _retryDelayMs;
+
+  switch (_state)
+  {
+  case NET_WIFI_DOWN:
+    if (status == WL_CONNECTED)
+    {
+      setState(NET_MQTT_DOWN);
+    }
+    else if (retryDue)
+    {
+      joinWifi();
+    }
+    break;
+
+  case NET_WIFI_JOINING:
+    if (status == WL_CONNECTED)
+    {
+      _lastJoinMs = now - _joinMillis;
+      _wifiFailures = 0;
+      _retryDelayMs = 0;
+      if (!_fastJoin)
+      {
+        saveCache();
+      }
+      setState(NET_MQTT_DOWN);
+    }
+    else if (status == WL_CONNECT_FAILED ||
+             now - _stateMillis >= (_fastJoin ? CONN_FAST_JOIN_TIMEOUT_MS : _config.joinTimeoutMs))
+    {
+      WiFi.disconnect();
+      if (_fastJoin)
+      {
+        // AP moved or the lease is gone: scan and use DHCP straight away
+        dropCache();
+        _retryDelayMs = 0;
+        _retryMillis = now;
+      }
+      else
+      {
+        scheduleRetry(_wifiFailures);
+      }
+      setState(NET_WIFI_DOWN);
+    }
+    break;
+
+  case NET_MQTT_DOWN:
+    if (status != WL_CONNECTED)
+    {
+      _resolved = false;
+      scheduleRetry(_wifiFailures);
+      setState(NET_WIFI_DOWN);
+    }
+    else if (retryDue)
+    {
+      connectMqtt();
+    }
+    break;
+
+  case NET_ONLINE:
+    if (_mqtt.loop())
+    {
+      return true;
+    }
+    // Session lost; the first retry is jittered too so that a fleet does
+    // not hit a restarted broker all at once
+    _mqttFailures = 0;
+    if (status == WL_CONNECTED)
+    {
+      scheduleRetry(_mqttFailures);
+      setState(NET_MQTT_DOWN);
+    }
+    else
+    {
+      _resolved = false;
+      scheduleRetry(_wifiFailures);
+      setState(NET_WIFI_DOWN);
+    }
+    break;
+  }
+  return false;
+}
+
+ConnectionStats ConnectionManager::takeStats()
+{
+  unsigned long now = millis();
+  if (_state != NET_ONLINE)
+  {
+    _stats.offlineMs += now - _offlineMillis;
+    _offlineMillis = now;
+  }
+  _stats.windowMs = now - _windowMillis;
+  _stats.blockedMs = (uint32_t)(_blockedUs / 1000);
+  _stats.blockedMaxMs = _blockedMaxUs / 1000;
+
+  ConnectionStats stats = _stats;
+  _stats = ConnectionStats();
+  _windowMillis = now;
+  _blockedUs = 0;
+  _blockedMaxUs = 0;
+  return stats;
+}
+
+void ConnectionManager::setState(ConnectionState state)
+{
+  if (state == _state)
+  {
+    return;
+  }
+  unsigned long now = millis();
+  if (_state == NET_ONLINE)
+  {
+    _offlineMillis = now;
+  }
+  else if (state == NET_ONLINE)
+  {
+    _stats.offlineMs += now - _offlineMillis;
+    if (_bootToOnlineMs == 0)
+    {
+      _bootToOnlineMs = now;
+    }
+  }
+  _state = state;
+  _stateMillis = now;
+
+  if (_callback != nullptr)
+  {
+    _callback(state);
+  }
+}
+
+/**
+ * @brief Issue an association request; WiFi.begin() returns straight away.
+ *
+ * With a valid cache the request names the access point and channel, so
+ * no scan is needed, and the cached address skips the DHCP exchange.
+ */
+void ConnectionManager::joinWifi()
+{
+  unsigned long start = micros();
+  _stats.wifiAttempts++;
+  _fastJoin = _cacheValid;
+  if (_fastJoin)
+  {
+    WiFi.config(IPAddress(_cache.ip), IPAddress(_cache.gateway), IPAddress(_cache.subnet), IPAddress(_cache.dns));
+    _staticConfig = true;
+    WiFi.begin(_config.ssid, _config.password, _cache.channel, _cache.bssid);
+  }
+  else
+  {
+    if (_staticConfig)
+    {
+      // All zero turns DHCP back on
+      WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+      _staticConfig = false;
+    }
+    WiFi.begin(_config.ssid, _config.password);
+  }
+  _joinMillis = millis();
+  setState(NET_WIFI_JOINING);
+  recordBlocked(start);
+}
+
+/**
+ * @brief Make one bounded broker attempt.
+ *
+ * The broker address is resolved once per association and again after a
+ * failure, so a moved broker is found without a DNS lookup per attempt.
+ * The first attempt after a reset uses the cached address instead.
+ */
+void ConnectionManager::connectMqtt()
+{
+  unsigned long start = micros();
+  _stats.mqttAttempts++;
+
+  bool fromCache = !_resolved && _cacheValid && _cache.broker != 0;
+  if (fromCache)
+  {
+    _brokerAddress = IPAddress(_cache.broker);
+    _resolved = true;
+    _mqtt.setServer(_brokerAddress, _config.mqttPort);
+  }
+  else if (!_resolved)
+  {
+#if defined(ESP8266)
+    _resolved = WiFi.hostByName(_config.mqttHost, _brokerAddress, _config.connectTimeoutMs) == 1;
+#else
+    _resolved = WiFi.hostByName(_config.mqttHost, _brokerAddress) == 1;
+#endif
+    if (_resolved)
+    {
+      _mqtt.setServer(_brokerAddress, _config.mqttPort);
+    }
+  }
+
+  if (_resolved && _mqtt.connect(_config.clientId))
+  {
+    _mqttFailures = 0;
+    _stats.connects++;
+    if (_cacheValid && _cache.broker != (uint32_t)_brokerAddress)
+    {
+      _cache.broker = (uint32_t)_brokerAddress;
+      storeCache();
+    }
+    setState(NET_ONLINE); // Subscriptions made by the callback count as blocked time too
+  }
+  else if (fromCache)
+  {
+    // Try the name on the next pass, without backing off
+    _resolved = false;
+    _cache.broker = 0;
+    storeCache();
+  }
+  else if (_staticConfig)
+  {
+    // Associated on the cached address, but nothing answers: the lease is
+    // likely stale. Rejoin with a scan and DHCP instead of backing off
+    // on an address that will never route.
+    _resolved = false;
+    dropCache();
+    WiFi.disconnect();
+    _retryDelayMs = 0;
+    _retryMillis = millis();
+    setState(NET_WIFI_DOWN);
+  }
+  else
+  {
+    _resolved = false;
+    scheduleRetry(_mqttFailures);
+  }
+  recordBlocked(start);
+}
+
+/**
+ * @brief Wait a jittered, exponentially growing delay before the next attempt.
+ *
+ * Half the delay is fixed and half random ("equal jitter"), which keeps
+ * retries spread out without ever retrying almost immediately.
+ */
+void ConnectionManager::scheduleRetry(uint8_t &failures)
+{
+  uint8_t doublings = failures < BACKOFF_MAX_DOUBLINGS ? failures : BACKOFF_MAX_DOUBLINGS;
+  uint64_t ceiling = (uint64_t)_config.backoffMinMs << doublings;
+  if (ceiling > _config.backoffMaxMs)
+  {
+    ceiling = _config.backoffMaxMs;
+  }
+  if (failures < 255)
+  {
+    failures++;
+  }
+
+  uint32_t half = (uint32_t)ceiling / 2;
+  _retryDelayMs = half + random(half + 1);
+  _retryMillis = millis();
+}
+
+void ConnectionManager::recordBlocked(unsigned long startMicros)
+{
+  uint32_t elapsed = micros() - startMicros;
+  _blockedUs += elapsed;
+  if (elapsed > _blockedMaxUs)
+  {
+    _blockedMaxUs = elapsed;
+  }
+}
+
+/**
+ * @brief Read the cache kept across the last reset.
+ *
+ * @return true if it is intact and was made for the current SSID and broker.
+ */
+bool ConnectionManager::loadCache()
+{
+#if defined(ESP8266)
+  ESP.rtcUserMemoryRead(CONN_RTC_OFFSET, (uint32_t *)&_cache, sizeof(_cache));
+#else
+  memcpy(&_cache, &rtcCache, sizeof(_cache));
+#endif
+  return _cache.crc == cacheCrc() && _cache.ip != 0;
+}
+
+/**
+ * @brief Record the access point and lease of the association just made.
+ */
+void ConnectionManager::saveCache()
+{
+  memcpy(_cache.bssid, WiFi.BSSID(), sizeof(_cache.bssid));
+  _cache.channel = WiFi.channel();
+  _cache.ip = (uint32_t)WiFi.localIP();
+  _cache.gateway = (uint32_t)WiFi.gatewayIP();
+  _cache.subnet = (uint32_t)WiFi.subnetMask();
+  _cache.dns = (uint32_t)WiFi.dnsIP(0);
+  storeCache();
+}
+
+void ConnectionManager::storeCache()
+{
+  _cache.crc = cacheCrc();
+  _cacheValid = _cache.ip != 0;
+#if defined(ESP8266)
+  ESP.rtcUserMemoryWrite(CONN_RTC_OFFSET, (uint32_t *)&_cache, sizeof(_cache));
+#else
+  memcpy(&rtcCache, &_cache, sizeof(_cache));
+#endif
+}
+
+void ConnectionManager::dropCache()
+{
+  _cache = FastJoinCache();
+  storeCache();
+}
+
+uint32_t ConnectionManager::cacheCrc() const
+{
+  uint32_t crc = 0xFFFFFFFFUL;
+  crc = crc32Update(crc, (const uint8_t *)&_cache + sizeof(_cache.crc), sizeof(_cache) - sizeof(_cache.crc));
+  crc = crc32Update(crc, _config.ssid, strlen(_config.ssid));
+  crc = crc32Update(crc, _config.mqttHost, strlen(_config.mqttHost));
+  return ~crc;
+}
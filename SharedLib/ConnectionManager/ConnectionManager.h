@@ -0,0 +1,191 @@
+#ifndef CONNECTION_MANAGER_H
+#define CONNECTION_MANAGER_H
+
+#include <Arduino.h>
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+#include <PubSubClient.h>
+
+// A join using the cached BSSID/channel/address that has not associated
+// after this long falls back to a full scan with DHCP
+#define CONN_FAST_JOIN_TIMEOUT_MS 3000
+
+// Where the ESP8266 keeps the cache in RTC user memory (4-byte blocks)
+#ifndef CONN_RTC_OFFSET
+#define CONN_RTC_OFFSET 0
+#endif
+
+enum ConnectionState
+{
+  NET_WIFI_DOWN,    // Not associated, waiting for the next attempt
+  NET_WIFI_JOINING, // WiFi.begin() issued, waiting for an address
+  NET_MQTT_DOWN,    // Associated, waiting for the next broker attempt
+  NET_ONLINE        // MQTT session up
+};
+
+/**
+ * @brief Settings for ConnectionManager.
+ */
+struct ConnectionConfig
+{
+  const char *ssid;
+  const char *password;
+  const char *mqttHost;      // Host name or dotted IP
+  uint16_t mqttPort;
+  const char *clientId;
+  uint32_t joinTimeoutMs;    // Give up on an association attempt after this
+  uint16_t connectTimeoutMs; // Bound on the TCP connect and on the CONNACK wait
+  uint32_t backoffMinMs;     // First retry delay, doubled on each failure
+  uint32_t backoffMaxMs;     // ...up to this
+};
+
+/**
+ * @brief Counters reported by ConnectionManager::takeStats().
+ *
+ * Everything covers the window since the previous takeStats() call.
+ */
+struct ConnectionStats
+{
+  uint32_t windowMs;
+  uint32_t wifiAttempts;
+  uint32_t mqttAttempts;
+  uint32_t connects;     // MQTT sessions established
+  uint32_t blockedMs;    // Time loop() spent inside connect calls
+  uint32_t blockedMaxMs; // Longest single connect step
+  uint32_t offlineMs;    // Time without an MQTT session
+
+  /**
+   * @brief blockedMs scaled to one hour of uptime.
+   */
+  uint32_t blockedMsPerHour() const
+  {
+    return windowMs > 0 ? (uint32_t)((uint64_t)blockedMs * 3600000UL / windowMs) : 0;
+  }
+};
+
+/**
+ * @brief Last association and broker address, kept across resets.
+ *
+ * Lives in RTC memory, which survives resets and deep sleep but not a
+ * power cycle. That bounds how stale the DHCP lease can get.
+ */
+struct FastJoinCache
+{
+  uint32_t crc; // Over the rest, the SSID and the broker host
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint32_t broker; // 0 until a broker connect succeeded
+};
+
+/**
+ * @brief Keeps WiFi and the MQTT session up without stalling loop().
+ *
+ * loop() does at most one short step per call: it polls the association,
+ * makes a single broker attempt when one is due, or services the session.
+ * Failed attempts back off exponentially from backoffMinMs to backoffMaxMs
+ * with random jitter, so nodes rebooting together do not retry in step.
+ * The only blocking left is the broker connect itself, which is bounded by
+ * connectTimeoutMs and reported as blocked time.
+ *
+ * After a reset the first join goes straight to the cached access point
+ * and channel with the cached address instead of scanning and asking for
+ * a DHCP lease, and the broker is tried at its cached address before DNS.
+ * Any failure drops the cache and falls back to the full sequence,
+ * including a broker that cannot be resolved or reached from the cached
+ * address, which is how a stale lease shows up.
+ */
+class ConnectionManager
+{
+public:
+  ConnectionManager(PubSubClient &mqtt, WiFiClient &net);
+
+  /**
+   * @brief Start the first association; call once from setup().
+   */
+  void begin(const ConnectionConfig &config);
+
+  /**
+   * @brief Called on every state change, e.g. to subscribe on NET_ONLINE.
+   */
+  void setStateCallback(void (*callback)(ConnectionState state));
+
+  /**
+   * @brief Advance the state machine and service the MQTT session.
+   *
+   * @return true while the MQTT session is up.
+   */
+  bool loop();
+
+  ConnectionState state() const { return _state; }
+  bool wifiConnected() const { return _state >= NET_MQTT_DOWN; }
+  bool connected() const { return _state == NET_ONLINE; }
+
+  /**
+   * @brief Return the counters for the current window and start a new one.
+   */
+  ConnectionStats takeStats();
+
+  /**
+   * @brief Time from WiFi.begin() to an address for the last association.
+   */
+  uint32_t lastJoinMs() const { return _lastJoinMs; }
+
+  /**
+   * @brief Whether the last association used the fast-join cache.
+   */
+  bool lastJoinFast() const { return _fastJoin; }
+
+  /**
+   * @brief Time from boot to the first MQTT session, 0 until there is one.
+   */
+  uint32_t bootToOnlineMs() const { return _bootToOnlineMs; }
+
+private:
+  void setState(ConnectionState state);
+  void joinWifi();
+  void connectMqtt();
+  void scheduleRetry(uint8_t &failures);
+  void recordBlocked(unsigned long startMicros);
+  bool loadCache();
+  void saveCache();
+  void storeCache();
+  void dropCache();
+  uint32_t cacheCrc() const;
+
+  PubSubClient &_mqtt;
+  WiFiClient &_net;
+  ConnectionConfig _config;
+  void (*_callback)(ConnectionState state);
+  ConnectionState _state;
+  unsigned long _stateMillis; // When the current state was entered
+  unsigned long _retryMillis;  // When the current retry delay started
+  uint32_t _retryDelayMs;
+  uint8_t _wifiFailures;       // Consecutive failures, drive the backoff
+  uint8_t _mqttFailures;
+  IPAddress _brokerAddress;
+  bool _resolved;
+
+  FastJoinCache _cache;
+  bool _cacheValid;
+  bool _fastJoin;     // Current/last join used the cache
+  bool _staticConfig; // Cached address applied, DHCP off
+  unsigned long _joinMillis;
+  uint32_t _lastJoinMs;
+  uint32_t _bootToOnlineMs;
+
+  ConnectionStats _stats;
+  unsigned long _windowMillis;
+  unsigned long _offlineMillis; // Start of the offline time not yet counted
+  uint64_t _blockedUs;
+  uint32_t _blockedMaxUs;
+};
+
+#endif
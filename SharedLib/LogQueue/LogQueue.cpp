@@ -0,0 +1,30 @@
+#include "LogQueue.h"
+#include <stdarg.h>
+
+LogQueue::LogQueue(Print &out) : _out(out), _dropped(0)
+{
+}
+
+bool LogQueue::printf(const char *format, ...)
+{
+  Line line;
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line.text, sizeof(line.text), format, args);
+  va_end(args);
+  if (!_lines.push(line))
+  {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void LogQueue::flush()
+{
+  Line line;
+  while (_lines.pop(line))
+  {
+    _out.println(line.text);
+  }
+}
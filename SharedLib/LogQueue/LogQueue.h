@@ -0,0 +1,53 @@
+#ifndef LOG_QUEUE_H
+#define LOG_QUEUE_H
+
+#include <Arduino.h>
+#include <SpscRing.h>
+#include <atomic>
+
+#define LOG_LINE_SIZE 192 // Longer lines are cut short
+#define LOG_QUEUE_SIZE 8  // Lines waiting for the printing task (power of two)
+
+/**
+ * @brief Console lines handed from one task to the task that owns Serial.
+ *
+ * Two tasks printing to Serial at once interleave their output, and a full
+ * TX buffer stalls whichever task is printing. So only one task prints:
+ * the other formats a line with printf() into this queue, and the owner
+ * prints the queued lines with flush() on each of its passes. A line that
+ * finds the queue full is dropped and counted, so the producer never waits.
+ */
+class LogQueue
+{
+public:
+  LogQueue(Print &out);
+
+  /**
+   * @brief Producer side: format one line (no newline needed) and queue it.
+   *
+   * @return false if the queue was full and the line was dropped.
+   */
+  bool printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+  /**
+   * @brief Owner side: print every queued line.
+   */
+  void flush();
+
+  /**
+   * @brief Lines dropped on a full queue since boot.
+   */
+  uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+  struct Line
+  {
+    char text[LOG_LINE_SIZE];
+  };
+
+  Print &_out;
+  SpscRing<Line, LOG_QUEUE_SIZE> _lines;
+  std::atomic<uint32_t> _dropped;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring buffer.
+ *
+ * One task may call push() while another calls pop() without any mutex.
+ * Capacity must be a power of two; all N slots are usable.
+ */
+template <typename T, size_t N>
+class SpscRing
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+  SpscRing() : _head(0), _tail(0) {}
+
+  /**
+   * @brief Producer side. Returns false if the ring is full.
+   */
+  bool push(const T &item)
+  {
+    size_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= N)
+    {
+      return false;
+    }
+    _items[head & (N - 1)] = item;
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Consumer side. Returns false if the ring is empty.
+   */
+  bool pop(T &item)
+  {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    item = _items[tail & (N - 1)];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Number of queued items. Exact only when called from either end.
+   */
+  size_t size() const
+  {
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t capacity() { return N; }
+
+private:
+  std::atomic<size_t> _head;
+  std::atomic<size_t> _tail;
+  T _items[N];
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "TaskMetrics.h"
+
+TaskMetrics::TaskMetrics(const char *name)
+    : _name(name), _task(nullptr), _core(-1), _passMicros(0), _passes(0), _busyUs(0), _passMaxUs(0),
+      _takeMillis(0), _takenPasses(0), _takenBusyUs(0)
+{
+}
+
+void TaskMetrics::attach()
+{
+  _task = xTaskGetCurrentTaskHandle();
+  _core.store((int8_t)xPortGetCoreID(), std::memory_order_release);
+}
+
+void TaskMetrics::beginPass()
+{
+  _passMicros = micros();
+}
+
+void TaskMetrics::endPass()
+{
+  uint32_t elapsed = micros() - _passMicros;
+
+  // Single writer: plain read-modify-write is enough for the totals
+  _busyUs.store(_busyUs.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+  _passes.store(_passes.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+  // The maximum is also cleared by take(), so it needs a compare-exchange
+  uint32_t seen = _passMaxUs.load(std::memory_order_relaxed);
+  while (elapsed > seen && !_passMaxUs.compare_exchange_weak(seen, elapsed, std::memory_order_relaxed))
+  {
+  }
+}
+
+TaskUsage TaskMetrics::take()
+{
+  TaskUsage usage = TaskUsage();
+  usage.name = _name;
+  usage.core = _core.load(std::memory_order_acquire);
+
+  unsigned long now = millis();
+  usage.windowMs = now - _takeMillis;
+  _takeMillis = now;
+
+  // Totals wrap; the differences stay right as long as a window is under
+  // ~70 minutes of busy time
+  uint32_t passes = _passes.load(std::memory_order_acquire);
+  uint32_t busyUs = _busyUs.load(std::memory_order_relaxed);
+  usage.passes = passes - _takenPasses;
+  usage.busyUs = busyUs - _takenBusyUs;
+  _takenPasses = passes;
+  _takenBusyUs = busyUs;
+  usage.passMaxUs = _passMaxUs.exchange(0, std::memory_order_relaxed);
+
+  // Bytes on the ESP32, words on vanilla FreeRTOS
+  if (usage.core >= 0)
+  {
+    usage.stackFree = uxTaskGetStackHighWaterMark(_task);
+  }
+  return usage;
+}
+
+size_t formatTaskUsage(char *buffer, size_t size, const TaskUsage *usage, size_t count)
+{
+  size_t length = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    uint32_t permille = usage[i].cpuPermille();
+    int written = snprintf(buffer + length, size - length,
+                           "%s\"%s\": {\"core\": %d,\"cpuPct\": %lu.%lu,\"passes\": %lu,\"passMaxUs\": %lu,"
+                           "\"stackFree\": %lu}",
+                           i == 0 ? "{" : ",", usage[i].name, usage[i].core, (unsigned long)(permille / 10),
+                           (unsigned long)(permille % 10), (unsigned long)usage[i].passes,
+                           (unsigned long)usage[i].passMaxUs, (unsigned long)usage[i].stackFree);
+    if (written < 0 || (size_t)written >= size - length)
+    {
+      return 0;
+    }
+    length += written;
+  }
+  if (count == 0 || length + 2 > size)
+  {
+    return 0;
+  }
+  buffer[length++] = '}';
+  buffer[length] = '\0';
+  return length;
+}
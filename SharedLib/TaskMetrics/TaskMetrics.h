@@ -0,0 +1,89 @@
+#ifndef TASK_METRICS_H
+#define TASK_METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * @brief Counters reported by TaskMetrics::take().
+ *
+ * Rates and maxima cover the window since the previous take() call.
+ */
+struct TaskUsage
+{
+  const char *name;
+  int8_t core;         // Core the task runs on, -1 before attach()
+  uint32_t windowMs;
+  uint32_t passes;     // Wake-ups handled
+  uint32_t busyUs;     // Time between beginPass() and endPass()
+  uint32_t passMaxUs;  // Longest single pass
+  uint32_t stackFree;  // Least stack left since the task started, bytes
+
+  /**
+   * @brief Share of one core the task kept busy, in tenths of a percent.
+   */
+  uint32_t cpuPermille() const
+  {
+    return windowMs > 0 ? (uint32_t)((uint64_t)busyUs / windowMs) : 0;
+  }
+};
+
+/**
+ * @brief CPU time and stack use of one task.
+ *
+ * The task marks the stretch it works between wake-ups with beginPass()
+ * and endPass(); any other task may call take(). The time is measured by
+ * the task itself rather than read from the FreeRTOS run-time stats, which
+ * the Arduino core builds without, so time taken by interrupts and higher
+ * priority tasks during a pass counts as the task's own.
+ */
+class TaskMetrics
+{
+public:
+  TaskMetrics(const char *name);
+
+  /**
+   * @brief Bind to the calling task. Call first thing in the task.
+   */
+  void attach();
+
+  /**
+   * @brief The task woke up and starts working.
+   */
+  void beginPass();
+
+  /**
+   * @brief The task is about to block again.
+   */
+  void endPass();
+
+  /**
+   * @brief Usage since the previous call, from a single reader task.
+   */
+  TaskUsage take();
+
+private:
+  const char *_name;
+  TaskHandle_t _task;
+  std::atomic<int8_t> _core;
+
+  // Written by the task only, read by take()
+  unsigned long _passMicros;
+  std::atomic<uint32_t> _passes;
+  std::atomic<uint32_t> _busyUs;
+  std::atomic<uint32_t> _passMaxUs; // Cleared by take()
+
+  // Reader side
+  unsigned long _takeMillis;
+  uint32_t _takenPasses;
+  uint32_t _takenBusyUs;
+};
+
+/**
+ * @brief Write task usage as JSON, one object per task keyed by its name.
+ *
+ * @return Length written, 0 if it did not fit.
+ */
+size_t formatTaskUsage(char *buffer, size_t size, const TaskUsage *usage, size_t count);
+
+#endif
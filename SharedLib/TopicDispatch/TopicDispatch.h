@@ -0,0 +1,324 @@
+#ifndef TOPIC_DISPATCH_H
+#define TOPIC_DISPATCH_H
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ------------------- Topic Hashing -------------------
+
+/**
+ * @brief Final avalanche step (MurmurHash3 fmix64).
+ *
+ * FNV-1a alone leaves topics that differ in their last character with
+ * nearly identical high bits, which the lookup below relies on.
+ */
+constexpr uint64_t topicMix(uint64_t hash)
+{
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+/**
+ * @brief 64-bit FNV-1a over `length` bytes, mixed.
+ *
+ * The low and high halves are used as two independent hashes, so one pass
+ * over the topic is enough for the two-level lookup below.
+ */
+constexpr uint64_t topicHash(const char *text, size_t length)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; i++)
+  {
+    hash ^= (uint8_t)text[i];
+    hash *= 1099511628211ULL;
+  }
+  return topicMix(hash);
+}
+
+constexpr size_t topicLength(const char *text)
+{
+  size_t length = 0;
+  while (text[length] != '\0')
+  {
+    length++;
+  }
+  return length;
+}
+
+constexpr size_t topicSlotCount(size_t topics)
+{
+  // Power of two, at most half full
+  size_t slots = 1;
+  while (slots < 2 * topics)
+  {
+    slots <<= 1;
+  }
+  return slots;
+}
+
+// ------------------- Topic Table -------------------
+
+/**
+ * @brief Deliberately not constexpr; see TopicTable::placeBucket().
+ */
+inline void topicTableHasDuplicates()
+{
+}
+
+/**
+ * @brief Compile-time perfect hash over a fixed list of MQTT topics.
+ *
+ * Built with hash-and-displace: each topic falls into a bucket by the low
+ * hash, and every bucket gets a displacement chosen at compile time so
+ * that low + displacement * high lands every topic in its own slot. A
+ * lookup is therefore one pass over the incoming topic plus one memcmp.
+ *
+ *   constexpr const char *kTopics[] = {"lawn/light1", "lawn/light2"};
+ *   constexpr TopicTable<2> lights(kTopics);
+ *   int index = lights.find(topic); // -1 if not in the table
+ *
+ * A table that cannot be built fails to compile when declared constexpr.
+ */
+template <size_t N>
+class TopicTable
+{
+public:
+  static constexpr size_t SLOTS = topicSlotCount(N);
+
+  constexpr TopicTable(const char *const (&topics)[N])
+      : _topics(), _lengths(), _displace(), _slots()
+  {
+    uint64_t hashes[N] = {};
+    uint16_t bucketSize[N] = {};
+    for (size_t i = 0; i < N; i++)
+    {
+      _topics[i] = topics[i];
+      _lengths[i] = topicLength(topics[i]);
+      hashes[i] = topicHash(topics[i], _lengths[i]);
+      bucketSize[bucket(hashes[i])]++;
+    }
+    for (size_t s = 0; s < SLOTS; s++)
+    {
+      _slots[s] = -1;
+    }
+
+    // Place the largest buckets first, while the table is still empty
+    uint16_t members[N] = {};
+    for (uint16_t size = N; size > 0; size--)
+    {
+      for (size_t b = 0; b < N; b++)
+      {
+        if (bucketSize[b] != size)
+          continue;
+        uint16_t count = 0;
+        for (size_t i = 0; i < N; i++)
+        {
+          if (bucket(hashes[i]) == b)
+            members[count++] = (uint16_t)i;
+        }
+        placeBucket(b, hashes, members, count);
+      }
+    }
+  }
+
+  /**
+   * @brief Index of `topic` in the table, or -1.
+   */
+  int find(const char *topic) const
+  {
+    // Hash and length in a single pass
+    uint64_t hash = 14695981039346656037ULL;
+    size_t length = 0;
+    for (; topic[length] != '\0'; length++)
+    {
+      hash ^= (uint8_t)topic[length];
+      hash *= 1099511628211ULL;
+    }
+
+    hash = topicMix(hash);
+    int16_t index = _slots[slot(hash, _displace[bucket(hash)])];
+    if (index < 0 || _lengths[index] != length || memcmp(_topics[index], topic, length) != 0)
+    {
+      return -1;
+    }
+    return index;
+  }
+
+  const char *topic(size_t index) const { return _topics[index]; }
+  constexpr size_t size() const { return N; }
+
+private:
+  static constexpr size_t bucket(uint64_t hash)
+  {
+    return (size_t)((uint32_t)hash % N);
+  }
+
+  static constexpr size_t slot(uint64_t hash, uint16_t displace)
+  {
+    uint32_t low = (uint32_t)hash;
+    uint32_t high = (uint32_t)(hash >> 32) | 1;
+    return (size_t)((low + (uint32_t)displace * high) & (SLOTS - 1));
+  }
+
+  constexpr void placeBucket(size_t b, const uint64_t *hashes, const uint16_t *members, uint16_t count)
+  {
+    for (uint32_t d = 0; d <= 0xFFFF; d++)
+    {
+      // All keys of the bucket must land in distinct free slots
+      bool fits = true;
+      for (uint16_t m = 0; m < count && fits; m++)
+      {
+        size_t s = slot(hashes[members[m]], (uint16_t)d);
+        fits = _slots[s] < 0;
+        for (uint16_t k = 0; k < m && fits; k++)
+        {
+          fits = slot(hashes[members[k]], (uint16_t)d) != s;
+        }
+      }
+      if (!fits)
+        continue;
+
+      _displace[b] = (uint16_t)d;
+      for (uint16_t m = 0; m < count; m++)
+      {
+        _slots[slot(hashes[members[m]], (uint16_t)d)] = (int16_t)members[m];
+      }
+      return;
+    }
+    // Duplicate topics end up here. The call is not a constant
+    // expression, so a constexpr table stops the build.
+    topicTableHasDuplicates();
+  }
+
+  const char *_topics[N];
+  size_t _lengths[N];
+  uint16_t _displace[N];
+  int16_t _slots[SLOTS];
+};
+
+// ------------------- Payload Parsing -------------------
+
+/**
+ * @brief Parse a decimal integer straight from an MQTT payload.
+ *
+ * The payload is not null-terminated and is not copied. Accepts an
+ * optional sign followed by digits only.
+ *
+ * @return false if the payload is empty, not a plain integer, or out of
+ * range for a long.
+ */
+inline bool parsePayloadInt(const uint8_t *payload, unsigned int length, long &value)
+{
+  unsigned int i = 0;
+  bool negative = false;
+  if (length > 0 && (payload[0] == '-' || payload[0] == '+'))
+  {
+    negative = payload[0] == '-';
+    i++;
+  }
+  if (i == length)
+  {
+    return false;
+  }
+
+  long result = 0;
+  for (; i < length; i++)
+  {
+    if (payload[i] < '0' || payload[i] > '9')
+    {
+      return false;
+    }
+    int digit = payload[i] - '0';
+    if (result > (LONG_MAX - digit) / 10)
+    {
+      return false; // Would overflow
+    }
+    result = result * 10 + digit;
+  }
+  value = negative ? -result : result;
+  return true;
+}
+
+/**
+ * @brief Parse a decimal number such as "23.45" into fixed point.
+ *
+ * The result is the value times 10^decimals; extra fraction digits are
+ * truncated, so decimals = 0 reads "23.7" as 23. Values whose result would
+ * not fit a long are rejected.
+ */
+inline bool parsePayloadDecimal(const uint8_t *payload, unsigned int length, long &value, uint8_t decimals)
+{
+  unsigned int i = 0;
+  bool negative = false;
+  if (length > 0 && (payload[0] == '-' || payload[0] == '+'))
+  {
+    negative = payload[0] == '-';
+    i++;
+  }
+
+  long result = 0;
+  bool digits = false;
+  bool fraction = false;
+  uint8_t fractionDigits = 0;
+  for (; i < length; i++)
+  {
+    if (payload[i] == '.' && !fraction)
+    {
+      fraction = true;
+      continue;
+    }
+    if (payload[i] < '0' || payload[i] > '9')
+    {
+      return false;
+    }
+    digits = true;
+    if (fraction)
+    {
+      if (fractionDigits == decimals)
+        continue;
+      fractionDigits++;
+    }
+    int digit = payload[i] - '0';
+    if (result > (LONG_MAX - digit) / 10)
+    {
+      return false; // Would overflow
+    }
+    result = result * 10 + digit;
+  }
+  if (!digits)
+  {
+    return false;
+  }
+
+  for (; fractionDigits < decimals; fractionDigits++)
+  {
+    if (result > LONG_MAX / 10)
+    {
+      return false;
+    }
+    result *= 10;
+  }
+  value = negative ? -result : result;
+  return true;
+}
+
+/**
+ * @brief Parse a "0"/"1" switch payload.
+ */
+inline bool parsePayloadBool(const uint8_t *payload, unsigned int length, bool &value)
+{
+  if (length != 1 || (payload[0] != '0' && payload[0] != '1'))
+  {
+    return false;
+  }
+  value = payload[0] == '1';
+  return true;
+}
+
+#endif
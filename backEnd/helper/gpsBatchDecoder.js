@@ -0,0 +1,140 @@
+// Reference decoder for the binary track frames published by GPS_NEO6 on
+// "gps/batch". The layout is documented in GPS_NEO6/lib/TrackBatch/TrackBatch.h.
+
+const TRACK_BATCH_VERSION = 2;
+
+// Time tag in front of each fix (version 2)
+const TIME_NONE = 0;
+const TIME_ABSOLUTE = 1;
+const TIME_DELTA = 2;
+
+// Read an unsigned LEB128 varint, returning the value and the next offset
+function readVarint(buffer, offset) {
+  let value = 0;
+  let shift = 0;
+  for (;;) {
+    if (offset >= buffer.length) {
+      throw new Error("Truncated GPS batch frame");
+    }
+    const byte = buffer[offset++];
+    value += (byte & 0x7f) * 2 ** shift;
+    if ((byte & 0x80) === 0) {
+      return [value, offset];
+    }
+    shift += 7;
+  }
+}
+
+// Read a zigzag encoded signed varint
+function readZigzag(buffer, offset) {
+  const [raw, next] = readVarint(buffer, offset);
+  const value = raw % 2 === 0 ? raw / 2 : -(raw + 1) / 2;
+  return [value, next];
+}
+
+// Coordinate deltas are modulo 2^32: wrap the running sum back into int32,
+// so a track crossing the antimeridian stays within +-1.8e9
+function wrapInt32(value) {
+  return value | 0;
+}
+
+/**
+ * Decode a GPS batch frame into an array of fixes.
+ *
+ * @param {Buffer} buffer Raw MQTT payload
+ * @returns {Array<{latitude: number, longitude: number, altitude: number,
+ *   satellites: number, hdop: number, speed: number, course: number,
+ *   time: number|null}>} Fixes with time in Unix milliseconds (null if unknown)
+ */
+function decodeGpsBatch(buffer) {
+  if (buffer.length < 3 || (buffer[0] !== TRACK_BATCH_VERSION && buffer[0] !== 1)) {
+    throw new Error("Unsupported GPS batch frame");
+  }
+
+  const version = buffer[0];
+  const count = buffer.readUInt16LE(1);
+  const fixes = [];
+  let offset = 3;
+  let timeMs = null;
+  let lastTimeMs = null; // Of the last fix that had a time
+  let latE7 = 0;
+  let lngE7 = 0;
+  let altCm = 0;
+
+  for (let i = 0; i < count; i++) {
+    let value;
+    if (version === 1) {
+      // Version 1 frames carry no marker for a missing time
+      if (i === 0) {
+        let seconds;
+        let millis;
+        [seconds, offset] = readVarint(buffer, offset);
+        [millis, offset] = readVarint(buffer, offset);
+        timeMs = seconds === 0 ? null : seconds * 1000 + millis;
+      } else {
+        [value, offset] = readZigzag(buffer, offset);
+        timeMs = timeMs === null ? null : timeMs + value;
+      }
+    } else {
+      let tag;
+      [tag, offset] = readVarint(buffer, offset);
+      if (tag === TIME_NONE) {
+        timeMs = null;
+      } else if (tag === TIME_ABSOLUTE) {
+        let seconds;
+        let millis;
+        [seconds, offset] = readVarint(buffer, offset);
+        [millis, offset] = readVarint(buffer, offset);
+        timeMs = seconds * 1000 + millis;
+      } else {
+        if (lastTimeMs === null) {
+          throw new Error("GPS batch frame has a time delta without a reference");
+        }
+        const raw = tag - TIME_DELTA;
+        timeMs = lastTimeMs + (raw % 2 === 0 ? raw / 2 : -(raw + 1) / 2);
+      }
+      if (timeMs !== null) {
+        lastTimeMs = timeMs;
+      }
+    }
+
+    if (i === 0) {
+      [latE7, offset] = readZigzag(buffer, offset);
+      [lngE7, offset] = readZigzag(buffer, offset);
+      [altCm, offset] = readZigzag(buffer, offset);
+    } else {
+      [value, offset] = readZigzag(buffer, offset);
+      latE7 = wrapInt32(latE7 + value);
+      [value, offset] = readZigzag(buffer, offset);
+      lngE7 = wrapInt32(lngE7 + value);
+      [value, offset] = readZigzag(buffer, offset);
+      altCm = wrapInt32(altCm + value);
+    }
+
+    let hdop;
+    let speedCms;
+    let courseCd;
+    [hdop, offset] = readVarint(buffer, offset);
+    if (offset >= buffer.length) {
+      throw new Error("Truncated GPS batch frame");
+    }
+    const satellites = buffer[offset++];
+    [speedCms, offset] = readVarint(buffer, offset);
+    [courseCd, offset] = readVarint(buffer, offset);
+
+    fixes.push({
+      latitude: latE7 / 1e7,
+      longitude: lngE7 / 1e7,
+      altitude: altCm / 100,
+      satellites,
+      hdop: hdop / 100,
+      speed: speedCms / 100,
+      course: courseCd / 100,
+      time: timeMs,
+    });
+  }
+
+  return fixes;
+}
+
+module.exports = { decodeGpsBatch, TRACK_BATCH_VERSION };
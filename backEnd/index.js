@@ -23,6 +23,7 @@ app.use("/api/v1", require("./routes/llmChat"));
 app.use("/api/v2", require("./routes/automationPanel"));
 app.use("/api/v3", require("./routes/history"));
 app.use("/api/v4", require("./routes/cctvChat"));
+app.use("/api/v5", require("./routes/gpsTrack"));
 
 app.listen(2500, "0.0.0.0", () => {
   console.log(`Server is online at port ${port}!`);
@@ -0,0 +1,104 @@
+// Import necessary modules
+const express = require("express");
+const router = express.Router();
+const cors = require("cors");
+const mqtt = require("mqtt");
+const { decodeGpsBatch } = require("../helper/gpsBatchDecoder");
+
+// Middleware setup
+router.use(express.json());
+router.use(cors());
+
+// Binary multi-fix frames from GPS_NEO6 in batch mode
+const BATCH_TOPIC = "gps/batch";
+const MAX_FIXES = 10000; // Newest fixes kept in memory
+
+const client = mqtt.connect("mqtt://localhost:1883"); // Update the broker URL if different
+
+// Decoded fixes, oldest first, each with the time the frame arrived
+const fixes = [];
+const stats = { frames: 0, bytes: 0, fixes: 0, errors: 0 };
+
+client.on("connect", () => {
+  client.subscribe(BATCH_TOPIC, { qos: 1 }, (err) => {
+    if (err) {
+      console.error("GPS batch subscription error:", err);
+    }
+  });
+});
+
+client.on("message", (topic, message) => {
+  if (topic !== BATCH_TOPIC) {
+    return;
+  }
+
+  let decoded;
+  try {
+    decoded = decodeGpsBatch(message);
+  } catch (error) {
+    stats.errors++;
+    console.error(`Dropping GPS batch frame (${message.length} bytes):`, error.message);
+    return;
+  }
+
+  const receivedAt = Date.now();
+  decoded.forEach((fix) => fixes.push({ ...fix, receivedAt }));
+  if (fixes.length > MAX_FIXES) {
+    fixes.splice(0, fixes.length - MAX_FIXES);
+  }
+  stats.frames++;
+  stats.bytes += message.length;
+  stats.fixes += decoded.length;
+});
+
+client.on("error", (err) => {
+  console.error("GPS batch MQTT error:", err);
+});
+
+// Route to get decoded fixes, optionally only those after a time
+// Example: GET /api/v5/track?since=1760000000000&limit=100
+router.get("/track", (req, res) => {
+  const since = req.query.since !== undefined ? Number(req.query.since) : null;
+  const limit = req.query.limit !== undefined ? Number(req.query.limit) : MAX_FIXES;
+
+  if ((since !== null && isNaN(since)) || isNaN(limit) || limit < 1) {
+    return res.status(400).json({ error: "Invalid since or limit." });
+  }
+
+  // Fixes without a receiver time are placed by their arrival time
+  const selected = fixes.filter((fix) => since === null || (fix.time ?? fix.receivedAt) > since);
+  res.json({ data: selected.slice(-limit) });
+});
+
+// Route to get the newest decoded fix
+router.get("/track/latest", (req, res) => {
+  if (fixes.length === 0) {
+    return res.status(404).json({ error: "No GPS fixes received yet." });
+  }
+  res.json(fixes[fixes.length - 1]);
+});
+
+// Route to get frame counters: bytes per fix shows how well the deltas pack
+router.get("/track/stats", (req, res) => {
+  res.json({
+    ...stats,
+    bytesPerFix: stats.fixes > 0 ? stats.bytes / stats.fixes : null,
+  });
+});
+
+// Route to decode a frame by hand, e.g. one captured with mosquitto_sub
+// Example: POST /api/v5/track/decode {"payload": "<base64>"}
+router.post("/track/decode", (req, res) => {
+  const { payload } = req.body;
+  if (typeof payload !== "string") {
+    return res.status(400).json({ error: "payload (base64) is required." });
+  }
+
+  try {
+    res.json({ data: decodeGpsBatch(Buffer.from(payload, "base64")) });
+  } catch (error) {
+    res.status(400).json({ error: error.message });
+  }
+});
+
+module.exports = router;
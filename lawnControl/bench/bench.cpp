@@ -0,0 +1,31 @@
+#include <Arduino.h>
+#include <NativeBench.h>
+
+// Host-only benchmark runner, built by the native_bench environment.
+// Prints JSON results; see NativeShim/NativeBench/NativeBench.h.
+
+extern PubSubClient client;
+extern TaskHandle_t ioTaskHandle;
+void callback(char *topic, byte *payload, unsigned int length);
+void applyLightCommands();
+
+int main()
+{
+  NativeBench bench("lawnControl");
+  BenchClient sink;
+  bench.connect(client, sink);
+  ioTaskHandle = xTaskGetCurrentTaskHandle(); // As setup() does
+
+  char lightTopic[] = "lawn/light3";
+  char otherTopic[] = "hall/light1";
+  byte on[] = "1";
+
+  // The command is applied as loop() would, so the queue never fills up
+  bench.run("callback/light", 200000, [&]() {
+    callback(lightTopic, on, 1);
+    applyLightCommands();
+  });
+  bench.run("callback/unmatched", 200000, [&]() { callback(otherTopic, on, 1); });
+
+  return bench.finish();
+}
@@ -0,0 +1,195 @@
+#include "EncoderInput.h"
+
+#define QUADRATURE_REST 0x03 // Both contacts open, pulled high
+
+// Quarter step for each (previous << 2 | current) A/B state pair: 0 for
+// no change and for the double changes that only bounce can produce
+static const int8_t quadratureSteps[16] = {0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0};
+
+EncoderInput::EncoderInput()
+    : _config(), _notifyTask(nullptr), _quadrature(QUADRATURE_REST), _quarters(0), _dropped(0),
+      _edgeLost(false), _lastDetentUs(0), _lastDirection(0), _button(BUTTON_UP), _buttonChangeUs(0),
+      _buttonDownUs(0)
+{
+}
+
+void EncoderInput::begin(const EncoderConfig &config)
+{
+  _config = config;
+  pinMode(_config.pinA, INPUT_PULLUP);
+  pinMode(_config.pinB, INPUT_PULLUP);
+  pinMode(_config.buttonPin, INPUT_PULLUP);
+  _quadrature = (digitalRead(_config.pinA) << 1) | digitalRead(_config.pinB);
+  _button = digitalRead(_config.buttonPin) == LOW ? BUTTON_DOWN : BUTTON_UP;
+
+  attachInterruptArg(digitalPinToInterrupt(_config.pinA), onQuadrature, this, CHANGE);
+  attachInterruptArg(digitalPinToInterrupt(_config.pinB), onQuadrature, this, CHANGE);
+  attachInterruptArg(digitalPinToInterrupt(_config.buttonPin), onButton, this, CHANGE);
+}
+
+bool EncoderInput::poll(EncoderEvent &event)
+{
+  RawInput input;
+  if (_detents.pop(input))
+  {
+    event = {ENCODER_TURN, accelerate(input), 0};
+    return true;
+  }
+  while (_edges.pop(input))
+  {
+    if (buttonEdge(input, event))
+    {
+      return true;
+    }
+  }
+  if (_edgeLost)
+  {
+    // Carry on from the level the pin has now
+    _edgeLost = false;
+    if (buttonEdge({(int8_t)digitalRead(_config.buttonPin), (uint32_t)micros()}, event))
+    {
+      return true;
+    }
+  }
+  return buttonSettled(micros(), event);
+}
+
+void IRAM_ATTR EncoderInput::onQuadrature(void *arg)
+{
+  EncoderInput *self = (EncoderInput *)arg;
+  uint8_t state = (digitalRead(self->_config.pinA) << 1) | digitalRead(self->_config.pinB);
+  int8_t quarters = self->_quarters + quadratureSteps[(self->_quadrature << 2) | state];
+  self->_quadrature = state;
+  if (state != QUADRATURE_REST)
+  {
+    self->_quarters = quarters;
+    return;
+  }
+
+  // Back at rest: a detent if most of a cycle went one way, which still
+  // counts it when one edge was missed
+  self->_quarters = 0;
+  if (quarters >= 2 || quarters <= -2)
+  {
+    if (!self->_detents.push({(int8_t)(quarters > 0 ? 1 : -1), (uint32_t)micros()}))
+    {
+      self->_dropped = self->_dropped + 1;
+    }
+    self->wake();
+  }
+}
+
+void IRAM_ATTR EncoderInput::onButton(void *arg)
+{
+  EncoderInput *self = (EncoderInput *)arg;
+  if (!self->_edges.push({(int8_t)digitalRead(self->_config.buttonPin), (uint32_t)micros()}))
+  {
+    self->_dropped = self->_dropped + 1;
+    self->_edgeLost = true;
+  }
+  self->wake();
+}
+
+void IRAM_ATTR EncoderInput::wake()
+{
+  if (_notifyTask != nullptr)
+  {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(_notifyTask, &woken);
+    if (woken)
+    {
+      portYIELD_FROM_ISR();
+    }
+  }
+}
+
+/**
+ * @brief Scale a detent by the turning speed.
+ *
+ * The gain rises linearly from 1 at accelSlowMs between detents to
+ * accelMax at accelFastMs. A change of direction starts again at 1.
+ */
+int16_t EncoderInput::accelerate(const RawInput &detent)
+{
+  uint32_t intervalMs = (detent.us - _lastDetentUs) / 1000;
+  bool sameWay = detent.value == _lastDirection;
+  _lastDetentUs = detent.us;
+  _lastDirection = detent.value;
+
+  if (!sameWay || intervalMs >= _config.accelSlowMs || _config.accelMax <= 1)
+  {
+    return detent.value;
+  }
+  if (intervalMs <= _config.accelFastMs)
+  {
+    return detent.value * _config.accelMax;
+  }
+  uint32_t span = _config.accelSlowMs - _config.accelFastMs;
+  uint32_t gain = 1 + (uint32_t)(_config.accelMax - 1) * (_config.accelSlowMs - intervalMs) / span;
+  return detent.value * (int16_t)gain;
+}
+
+/**
+ * @brief Feed one recorded button edge to the debounce state machine.
+ *
+ * A level that held from its edge to this one for debounceMs is accepted
+ * first, so presses made while loop() was blocked still count.
+ */
+bool EncoderInput::buttonEdge(const RawInput &edge, EncoderEvent &event)
+{
+  bool accepted = buttonSettled(edge.us, event);
+  bool low = edge.value == LOW;
+  switch (_button)
+  {
+  case BUTTON_UP:
+    if (low)
+    {
+      _button = BUTTON_PRESSING;
+      _buttonChangeUs = edge.us;
+    }
+    break;
+  case BUTTON_PRESSING:
+    if (!low)
+    {
+      _button = BUTTON_UP; // Bounce
+    }
+    break;
+  case BUTTON_DOWN:
+    if (!low)
+    {
+      _button = BUTTON_RELEASING;
+      _buttonChangeUs = edge.us;
+    }
+    break;
+  case BUTTON_RELEASING:
+    if (low)
+    {
+      _button = BUTTON_DOWN; // Bounce
+    }
+    break;
+  }
+  return accepted;
+}
+
+/**
+ * @brief Accept the settling level if it has held for debounceMs by `nowUs`.
+ */
+bool EncoderInput::buttonSettled(uint32_t nowUs, EncoderEvent &event)
+{
+  if (!settling() || nowUs - _buttonChangeUs < _config.debounceMs * 1000UL)
+  {
+    return false;
+  }
+  if (_button == BUTTON_PRESSING)
+  {
+    _button = BUTTON_DOWN;
+    _buttonDownUs = _buttonChangeUs;
+    event = {ENCODER_PRESS, 0, 0};
+  }
+  else
+  {
+    _button = BUTTON_UP;
+    event = {ENCODER_RELEASE, 0, (_buttonChangeUs - _buttonDownUs) / 1000};
+  }
+  return true;
+}
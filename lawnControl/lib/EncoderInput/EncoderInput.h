@@ -0,0 +1,130 @@
+#ifndef ENCODER_INPUT_H
+#define ENCODER_INPUT_H
+
+#include <Arduino.h>
+#include <SpscRing.h>
+
+// Raw inputs held between the interrupts and loop(). 64 detents cover a
+// fast spin through a full NET_CONNECT_TIMEOUT_MS stall.
+#define ENCODER_DETENT_QUEUE_SIZE 64
+#define ENCODER_BUTTON_QUEUE_SIZE 16
+
+enum EncoderEventType
+{
+  ENCODER_TURN,    // steps detents, after acceleration
+  ENCODER_PRESS,   // Button down (debounced)
+  ENCODER_RELEASE  // Button up (debounced), after heldMs
+};
+
+struct EncoderEvent
+{
+  EncoderEventType type;
+  int16_t steps;   // ENCODER_TURN: signed, sign depends on the A/B wiring
+  uint32_t heldMs; // ENCODER_RELEASE: how long the button was down
+};
+
+/**
+ * @brief Tuning for EncoderInput.
+ */
+struct EncoderConfig
+{
+  uint8_t pinA;
+  uint8_t pinB;
+  uint8_t buttonPin;     // Active low
+  uint16_t debounceMs;   // A button level must hold this long to count
+  uint16_t accelSlowMs;  // Detents further apart than this move by 1
+  uint16_t accelFastMs;  // ...and this close together by accelMax
+  uint8_t accelMax;
+};
+
+/**
+ * @brief Rotary encoder and its push button as a stream of events.
+ *
+ * Pin change interrupts decode the quadrature signal and time-stamp each
+ * detent and button edge into lock-free queues, so nothing is lost while
+ * loop() is blocked, e.g. in a broker connect. poll() then turns them into
+ * events: detents are scaled by how fast the knob turns, and button edges
+ * go through a debounce state machine that works on the recorded edge
+ * times rather than on when loop() got to them.
+ *
+ * Turns and button events each come out in order, but not interleaved
+ * by time.
+ *
+ * A detent is counted when both contacts open again (the rest position of
+ * the usual EC11/KY-040 parts), so contact bounce and half turns that
+ * return never produce a step.
+ */
+class EncoderInput
+{
+public:
+  EncoderInput();
+
+  /**
+   * @brief Configure the pins and attach the interrupts.
+   */
+  void begin(const EncoderConfig &config);
+
+  /**
+   * @brief Wake `task` from ulTaskNotifyTake() on every detent and edge.
+   */
+  void setNotifyTask(TaskHandle_t task) { _notifyTask = task; }
+
+  /**
+   * @brief Take the next event.
+   *
+   * @return false when nothing happened since the last call.
+   */
+  bool poll(EncoderEvent &event);
+
+  /**
+   * @brief Whether a button level is still settling, so poll() is due again soon.
+   */
+  bool settling() const { return _button == BUTTON_PRESSING || _button == BUTTON_RELEASING; }
+
+  /**
+   * @brief Detents and button edges dropped on a full queue since begin().
+   */
+  uint32_t dropped() const { return _dropped; }
+
+private:
+  enum ButtonState
+  {
+    BUTTON_UP,
+    BUTTON_PRESSING,  // Went low, waiting for it to hold
+    BUTTON_DOWN,
+    BUTTON_RELEASING  // Went high, waiting for it to hold
+  };
+
+  struct RawInput
+  {
+    int8_t value; // Detent: +1/-1, button: pin level
+    uint32_t us;  // micros() in the interrupt
+  };
+
+  static void IRAM_ATTR onQuadrature(void *arg);
+  static void IRAM_ATTR onButton(void *arg);
+  void IRAM_ATTR wake();
+  int16_t accelerate(const RawInput &detent);
+  bool buttonEdge(const RawInput &edge, EncoderEvent &event);
+  bool buttonSettled(uint32_t nowUs, EncoderEvent &event);
+
+  EncoderConfig _config;
+  TaskHandle_t _notifyTask;
+
+  // Interrupt side
+  SpscRing<RawInput, ENCODER_DETENT_QUEUE_SIZE> _detents;
+  SpscRing<RawInput, ENCODER_BUTTON_QUEUE_SIZE> _edges;
+  volatile uint8_t _quadrature; // Last A/B state
+  volatile int8_t _quarters;    // Quarter steps since the last rest position
+  volatile uint32_t _dropped;
+  volatile bool _edgeLost; // A button edge did not fit the queue
+
+  // loop() side
+  uint32_t _lastDetentUs;
+  int8_t _lastDirection;
+  ButtonState _button;
+  uint32_t _buttonChangeUs; // Time of the edge being debounced
+  uint32_t _buttonDownUs;   // Time the current press was accepted
+};
+
+#endif
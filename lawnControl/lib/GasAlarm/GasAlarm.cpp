@@ -0,0 +1,72 @@
+#include "GasAlarm.h"
+
+GasAlarm::GasAlarm()
+    : _config(), _history(), _head(0), _count(0), _rise(0), _active(false), _cause(GAS_ALARM_NONE),
+      _quiet(false), _quietMillis(0)
+{
+}
+
+void GasAlarm::begin(const GasAlarmConfig &config)
+{
+  _config = config;
+}
+
+bool GasAlarm::update(float ppm, unsigned long readingMillis)
+{
+  // Rate against the oldest reading still inside the window
+  _rise = 0;
+  for (uint8_t i = _count; i > 0; i--)
+  {
+    const Reading &reading = _history[(_head + GAS_ALARM_HISTORY - i) % GAS_ALARM_HISTORY];
+    if (readingMillis - reading.millis <= _config.riseWindowMs)
+    {
+      _rise = riseSince({ppm, readingMillis}, reading);
+      break;
+    }
+  }
+  _history[_head] = {ppm, readingMillis};
+  _head = (_head + 1) % GAS_ALARM_HISTORY;
+  if (_count < GAS_ALARM_HISTORY)
+  {
+    _count++;
+  }
+
+  bool level = ppm >= _config.triggerPpm;
+  bool rising = _rise >= _config.risePpmPerS;
+
+  if (!_active)
+  {
+    if (level || rising)
+    {
+      _active = true;
+      _cause = level ? GAS_ALARM_LEVEL : GAS_ALARM_RISE;
+      _quiet = false;
+      return true;
+    }
+    return false;
+  }
+
+  if (ppm >= _config.clearPpm || rising)
+  {
+    _quiet = false;
+    return false;
+  }
+  if (!_quiet)
+  {
+    _quiet = true;
+    _quietMillis = readingMillis;
+  }
+  if (readingMillis - _quietMillis < _config.clearHoldMs)
+  {
+    return false;
+  }
+  _active = false;
+  _cause = GAS_ALARM_NONE;
+  return true;
+}
+
+float GasAlarm::riseSince(const Reading &latest, const Reading &earlier) const
+{
+  unsigned long elapsedMs = latest.millis - earlier.millis;
+  return elapsedMs > 0 ? (latest.ppm - earlier.ppm) * 1000.0f / elapsedMs : 0;
+}
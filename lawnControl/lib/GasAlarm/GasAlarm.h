@@ -0,0 +1,83 @@
+#ifndef GAS_ALARM_H
+#define GAS_ALARM_H
+
+#include <Arduino.h>
+
+// Readings kept for the rate of rise; must cover riseWindowMs at the
+// reading interval
+#define GAS_ALARM_HISTORY 16
+
+enum GasAlarmCause
+{
+  GAS_ALARM_NONE,
+  GAS_ALARM_LEVEL, // Reading at or above triggerPpm
+  GAS_ALARM_RISE   // Rising faster than risePpmPerS
+};
+
+/**
+ * @brief Thresholds for GasAlarm.
+ */
+struct GasAlarmConfig
+{
+  float triggerPpm;      // Alarm at or above this level...
+  float risePpmPerS;     // ...or when rising at least this fast
+  uint16_t riseWindowMs; // Span the rate of rise is measured over
+  float clearPpm;        // Clears below this, with the rise gone too...
+  uint32_t clearHoldMs;  // ...for this long
+};
+
+/**
+ * @brief Alarm decision over successive gas readings.
+ *
+ * Trips on either an absolute level or a fast rise, so a leak close to
+ * the sensor is caught before the level gets there. Clearing needs the
+ * level below clearPpm and no fast rise for clearHoldMs, so a reading
+ * hovering at the threshold does not toggle the alarm.
+ */
+class GasAlarm
+{
+public:
+  GasAlarm();
+
+  void begin(const GasAlarmConfig &config);
+
+  /**
+   * @brief Evaluate a new reading taken at `readingMillis`.
+   *
+   * @return true if the alarm went on or off.
+   */
+  bool update(float ppm, unsigned long readingMillis);
+
+  bool active() const { return _active; }
+
+  /**
+   * @brief What tripped the current alarm; GAS_ALARM_NONE while clear.
+   */
+  GasAlarmCause cause() const { return _cause; }
+
+  /**
+   * @brief Rate of rise over the last riseWindowMs, in ppm per second.
+   */
+  float rise() const { return _rise; }
+
+private:
+  struct Reading
+  {
+    float ppm;
+    unsigned long millis;
+  };
+
+  float riseSince(const Reading &latest, const Reading &earlier) const;
+
+  GasAlarmConfig _config;
+  Reading _history[GAS_ALARM_HISTORY];
+  uint8_t _head; // Next slot to write
+  uint8_t _count;
+  float _rise;
+  bool _active;
+  GasAlarmCause _cause;
+  bool _quiet;                // Below clearPpm and not rising...
+  unsigned long _quietMillis; // ...since this reading
+};
+
+#endif
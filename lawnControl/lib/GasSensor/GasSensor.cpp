@@ -0,0 +1,139 @@
+#include "GasSensor.h"
+
+#define GAS_ADC_MAX_RAW 4095
+
+GasSensor::GasSensor()
+    : _config(), _characteristics(), _calibration(ESP_ADC_CAL_VAL_DEFAULT_VREF), _running(false), _sum(0),
+      _count(0), _windowMillis(0), _readingMillis(0), _millivolts(0), _ppm(0), _samples(0)
+{
+}
+
+bool GasSensor::begin(const GasSensorConfig &config)
+{
+  _config = config;
+
+  // 11 dB covers roughly 150-2450 mV linearly, beyond that it compresses
+  _calibration = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, GAS_ADC_DEFAULT_VREF_MV,
+                                          &_characteristics);
+
+  adc_digi_init_config_t init = {};
+  init.max_store_buf_size = GAS_ADC_BUFFER_BYTES;
+  init.conv_num_each_intr = GAS_ADC_FRAME_BYTES;
+  init.adc1_chan_mask = 1UL << _config.channel;
+  init.adc2_chan_mask = 0;
+  if (adc_digi_initialize(&init) != ESP_OK)
+  {
+    return false;
+  }
+
+  adc_digi_pattern_config_t pattern = {};
+  pattern.atten = ADC_ATTEN_DB_11;
+  pattern.channel = _config.channel;
+  pattern.unit = 0; // ADC1
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+  adc_digi_configuration_t digi = {};
+  digi.conv_limit_en = true; // Required for the ESP32's single unit mode
+  digi.conv_limit_num = 250;
+  digi.pattern_num = 1;
+  digi.adc_pattern = &pattern;
+  digi.sample_freq_hz = _config.sampleRateHz;
+  digi.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digi.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  if (adc_digi_controller_configure(&digi) != ESP_OK || adc_digi_start() != ESP_OK)
+  {
+    adc_digi_deinitialize();
+    return false;
+  }
+
+  _running = true;
+  _windowMillis = millis();
+  return true;
+}
+
+bool GasSensor::poll()
+{
+  if (!_running)
+  {
+    return false;
+  }
+
+  // Take everything buffered without waiting; ESP_ERR_INVALID_STATE still
+  // returns data, it only means the buffer overflowed at some point
+  uint8_t frame[GAS_ADC_FRAME_BYTES];
+  uint32_t length = 0;
+  esp_err_t result;
+  while ((result = adc_digi_read_bytes(frame, sizeof(frame), &length, 0)) == ESP_OK ||
+         result == ESP_ERR_INVALID_STATE)
+  {
+    if (length == 0)
+    {
+      break;
+    }
+    for (uint32_t i = 0; i + sizeof(adc_digi_output_data_t) <= length; i += sizeof(adc_digi_output_data_t))
+    {
+      const adc_digi_output_data_t *sample = (const adc_digi_output_data_t *)&frame[i];
+      if (sample->type1.channel == _config.channel)
+      {
+        _sum += sample->type1.data;
+        _count++;
+      }
+    }
+  }
+
+  unsigned long now = millis();
+  if (now - _windowMillis < _config.windowMs || _count == 0)
+  {
+    return false;
+  }
+  _readingMillis = _windowMillis + _config.windowMs;
+  _windowMillis = now;
+
+  _millivolts = toMillivolts(_sum, _count);
+  _ppm = toPpm(_millivolts);
+  _samples = _count;
+  _sum = 0;
+  _count = 0;
+  return true;
+}
+
+/**
+ * @brief Calibrated voltage of the mean conversion.
+ *
+ * The mean keeps its fraction: the calibration is applied to the raw codes
+ * either side of it and interpolated, so averaging is not thrown away by
+ * rounding back to a 12-bit code.
+ */
+float GasSensor::toMillivolts(uint32_t sum, uint32_t count) const
+{
+  float mean = (float)sum / count;
+  uint32_t low = (uint32_t)mean;
+  if (low >= GAS_ADC_MAX_RAW)
+  {
+    return esp_adc_cal_raw_to_voltage(GAS_ADC_MAX_RAW, &_characteristics);
+  }
+  float lowMv = esp_adc_cal_raw_to_voltage(low, &_characteristics);
+  float highMv = esp_adc_cal_raw_to_voltage(low + 1, &_characteristics);
+  return lowMv + (highMv - lowMv) * (mean - low);
+}
+
+/**
+ * @brief Concentration from the sensor's resistance.
+ *
+ * The sensor and RL divide the supply, so Rs = RL * (Vc - Vout) / Vout,
+ * and the datasheet curve is a straight line on log-log axes.
+ */
+float GasSensor::toPpm(float millivolts) const
+{
+  float outputMv = millivolts * _config.inputScale;
+  if (outputMv <= 0)
+  {
+    return 0;
+  }
+  if (outputMv >= _config.supplyMv)
+  {
+    outputMv = _config.supplyMv - 1; // Rs cannot reach 0
+  }
+  float rs = _config.loadKohm * (_config.supplyMv - outputMv) / outputMv;
+  return _config.curveA * powf(rs / _config.r0Kohm, _config.curveB);
+}
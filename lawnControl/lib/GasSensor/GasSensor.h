@@ -0,0 +1,108 @@
+#ifndef GAS_SENSOR_H
+#define GAS_SENSOR_H
+
+#include <Arduino.h>
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+
+// DMA conversion frame handed over per interrupt, and how much the driver
+// buffers between poll() calls: 4096 bytes are ~100 ms at 20 kHz
+#define GAS_ADC_FRAME_BYTES 256
+#define GAS_ADC_BUFFER_BYTES 4096
+
+// Reference used when the chip has no calibration burnt into eFuse
+#define GAS_ADC_DEFAULT_VREF_MV 1100
+
+/**
+ * @brief Settings for GasSensor.
+ */
+struct GasSensorConfig
+{
+  adc1_channel_t channel; // ADC1 only, ADC2 is unusable while WiFi runs
+  uint32_t sampleRateHz;  // Conversion rate of the DMA controller
+  uint16_t windowMs;      // Samples averaged into one reading
+  uint16_t supplyMv;      // Voltage across the sensor and its load resistor
+  float inputScale;       // Sensor output over ADC pin voltage, >1 with a divider on AO
+  float loadKohm;         // RL on the module
+  float r0Kohm;           // Sensor resistance at 1000 ppm LPG, from calibration
+  float curveA;           // ppm = curveA * (Rs / R0) ^ curveB
+  float curveB;
+};
+
+/**
+ * @brief MQ-series gas sensor sampled by the ADC in continuous (DMA) mode.
+ *
+ * The ADC converts at sampleRateHz without the CPU; poll() drains what the
+ * DMA collected and sums it. Each windowMs the mean is turned into
+ * millivolts with the chip's eFuse calibration, then into the sensor
+ * resistance Rs and an estimated concentration from the datasheet's
+ * log-log curve. Averaging thousands of conversions takes out the ADC's
+ * own noise, which a single analogRead() shows in full.
+ */
+class GasSensor
+{
+public:
+  GasSensor();
+
+  /**
+   * @brief Characterise the ADC and start the conversions.
+   *
+   * @return false if the ADC driver could not be set up.
+   */
+  bool begin(const GasSensorConfig &config);
+
+  /**
+   * @brief Drain the DMA buffer; call from loop().
+   *
+   * @return true when a new reading is ready.
+   */
+  bool poll();
+
+  /**
+   * @brief Last reading at the ADC pin, in millivolts.
+   */
+  float millivolts() const { return _millivolts; }
+
+  /**
+   * @brief Last reading as an estimated concentration in ppm.
+   */
+  float ppm() const { return _ppm; }
+
+  /**
+   * @brief When the last reading's window was due to close.
+   *
+   * poll() may get to it later; the difference is how long the reading
+   * waited for loop().
+   */
+  unsigned long readingMillis() const { return _readingMillis; }
+
+  /**
+   * @brief Conversions averaged into the last reading.
+   */
+  uint32_t samples() const { return _samples; }
+
+  /**
+   * @brief Where the millivolt conversion comes from (eFuse Two Point, eFuse Vref or the default).
+   */
+  esp_adc_cal_value_t calibration() const { return _calibration; }
+
+private:
+  float toMillivolts(uint32_t sum, uint32_t count) const;
+  float toPpm(float millivolts) const;
+
+  GasSensorConfig _config;
+  esp_adc_cal_characteristics_t _characteristics;
+  esp_adc_cal_value_t _calibration;
+  bool _running;
+
+  uint32_t _sum; // Raw conversions in the current window
+  uint32_t _count;
+  unsigned long _windowMillis;
+  unsigned long _readingMillis;
+
+  float _millivolts;
+  float _ppm;
+  uint32_t _samples;
+};
+
+#endif
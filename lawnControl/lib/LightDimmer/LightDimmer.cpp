@@ -0,0 +1,107 @@
+#include "LightDimmer.h"
+
+#define DIMMER_MODE LEDC_HIGH_SPEED_MODE
+#define DIMMER_TIMER LEDC_TIMER_0
+
+// The fade's end as seen from millis() is approximate; a little slack
+// keeps the next fade from waiting on the driver
+#define DIMMER_FADE_SLACK_MS 2
+
+LightDimmer::LightDimmer() : _count(0), _fadeMs(0), _duty(), _levels(), _pending(), _fadeMillis()
+{
+}
+
+bool LightDimmer::begin(const int *pins, uint8_t count, uint16_t fadeMs)
+{
+  _count = count < DIMMER_MAX_CHANNELS ? count : DIMMER_MAX_CHANNELS;
+  _fadeMs = fadeMs;
+
+  uint32_t maxDuty = (1UL << DIMMER_RESOLUTION) - 1;
+  for (uint8_t percent = 0; percent <= 100; percent++)
+  {
+    _duty[percent] = (uint16_t)lroundf(powf(percent / 100.0f, DIMMER_GAMMA) * maxDuty);
+    if (percent > 0 && _duty[percent] == 0)
+    {
+      _duty[percent] = 1; // The low end of the curve rounds to 0; on stays on
+    }
+  }
+
+  ledc_timer_config_t timer = {};
+  timer.speed_mode = DIMMER_MODE;
+  timer.duty_resolution = DIMMER_RESOLUTION;
+  timer.timer_num = DIMMER_TIMER;
+  timer.freq_hz = DIMMER_FREQ_HZ;
+  timer.clk_cfg = LEDC_AUTO_CLK;
+  if (ledc_timer_config(&timer) != ESP_OK)
+  {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    ledc_channel_config_t channel = {};
+    channel.gpio_num = pins[i];
+    channel.speed_mode = DIMMER_MODE;
+    channel.channel = (ledc_channel_t)i;
+    channel.intr_type = LEDC_INTR_DISABLE;
+    channel.timer_sel = DIMMER_TIMER;
+    channel.duty = 0;
+    channel.hpoint = 0;
+    if (ledc_channel_config(&channel) != ESP_OK)
+    {
+      return false;
+    }
+    _levels[i] = 0;
+    _pending[i] = -1;
+  }
+
+  // Fades report their end through the LEDC interrupt
+  return ledc_fade_func_install(0) == ESP_OK;
+}
+
+void LightDimmer::set(uint8_t index, uint8_t percent)
+{
+  if (index >= _count)
+  {
+    return;
+  }
+  percent = percent < 100 ? percent : 100;
+  _levels[index] = percent;
+
+  if (fading(index, millis()))
+  {
+    _pending[index] = percent;
+    return;
+  }
+  _pending[index] = -1;
+  startFade(index, percent);
+}
+
+void LightDimmer::loop()
+{
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_pending[i] >= 0 && !fading(i, now))
+    {
+      uint8_t percent = _pending[i];
+      _pending[i] = -1;
+      startFade(i, percent);
+    }
+  }
+}
+
+void LightDimmer::startFade(uint8_t index, uint8_t percent)
+{
+  ledc_channel_t channel = (ledc_channel_t)index;
+  if (ledc_set_fade_with_time(DIMMER_MODE, channel, _duty[percent], _fadeMs) == ESP_OK &&
+      ledc_fade_start(DIMMER_MODE, channel, LEDC_FADE_NO_WAIT) == ESP_OK)
+  {
+    _fadeMillis[index] = millis();
+  }
+}
+
+bool LightDimmer::fading(uint8_t index, unsigned long now) const
+{
+  return now - _fadeMillis[index] < (unsigned long)_fadeMs + DIMMER_FADE_SLACK_MS;
+}
@@ -0,0 +1,63 @@
+#ifndef LIGHT_DIMMER_H
+#define LIGHT_DIMMER_H
+
+#include <Arduino.h>
+#include <driver/ledc.h>
+
+#define DIMMER_MAX_CHANNELS 8 // One LEDC speed mode
+#define DIMMER_FREQ_HZ 5000   // Above visible flicker, and 13 bits still fit the 80 MHz clock
+#define DIMMER_RESOLUTION LEDC_TIMER_13_BIT
+#define DIMMER_GAMMA 2.2f
+
+/**
+ * @brief Dimmable outputs on the LEDC peripheral with hardware fades.
+ *
+ * Levels are in percent and go through a gamma curve, so equal steps look
+ * equally bright. A change starts a hardware fade to the new duty; the
+ * LEDC walks the duty by itself, so a ramp costs no CPU time.
+ *
+ * The driver blocks a new fade on a channel until the running one has
+ * finished. To keep callers from waiting, a level set mid-fade is held
+ * and started by loop() once the fade is over; only the latest one is
+ * kept.
+ */
+class LightDimmer
+{
+public:
+  LightDimmer();
+
+  /**
+   * @brief Put `count` pins on LEDC channels 0.. and switch them off.
+   *
+   * @return false if the LEDC could not be set up.
+   */
+  bool begin(const int *pins, uint8_t count, uint16_t fadeMs);
+
+  /**
+   * @brief Fade light `index` to `percent` (0-100).
+   */
+  void set(uint8_t index, uint8_t percent);
+
+  /**
+   * @brief Last level set for light `index`, in percent.
+   */
+  uint8_t level(uint8_t index) const { return index < _count ? _levels[index] : 0; }
+
+  /**
+   * @brief Start held fades whose channel has become free; call from loop().
+   */
+  void loop();
+
+private:
+  void startFade(uint8_t index, uint8_t percent);
+  bool fading(uint8_t index, unsigned long now) const;
+
+  uint8_t _count;
+  uint16_t _fadeMs;
+  uint16_t _duty[101]; // Gamma-corrected duty for each percent
+  uint8_t _levels[DIMMER_MAX_CHANNELS];
+  int8_t _pending[DIMMER_MAX_CHANNELS]; // Level waiting for the fade to end, -1 if none
+  unsigned long _fadeMillis[DIMMER_MAX_CHANNELS]; // Start of the last fade
+};
+
+#endif
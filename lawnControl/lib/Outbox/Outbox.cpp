@@ -0,0 +1,188 @@
+#include "Outbox.h"
+
+Outbox::Outbox(PubSubClient &mqtt) : _mqtt(mqtt), _alerts(), _telemetry(), _lastAlertConfirmMs(0), _dropped(0)
+{
+}
+
+bool Outbox::queue(const char *topic, const char *payload)
+{
+  if (!fits(topic, payload))
+  {
+    return false;
+  }
+  Message *slot = slotFor(_telemetry, OUTBOX_TELEMETRY_SLOTS, topic, true);
+  if (!slot->used)
+  {
+    slot->used = true;
+    slot->queuedMillis = millis();
+    strcpy(slot->topic, topic);
+  }
+  strcpy(slot->payload, payload);
+  return true;
+}
+
+bool Outbox::queueAlert(const char *topic, const char *payload)
+{
+  if (!fits(topic, payload))
+  {
+    return false;
+  }
+  Message *slot = slotFor(_alerts, OUTBOX_ALERT_SLOTS, topic, false);
+  slot->used = true;
+  slot->queuedMillis = millis();
+  slot->sentMillis = 0;
+  slot->tries = 0;
+  strcpy(slot->topic, topic);
+  strcpy(slot->payload, payload);
+  return true;
+}
+
+bool Outbox::confirm(const char *topic, const byte *payload, unsigned int length)
+{
+  for (uint8_t i = 0; i < OUTBOX_ALERT_SLOTS; i++)
+  {
+    Message &alert = _alerts[i];
+    if (alert.used && strcmp(alert.topic, topic) == 0 && strlen(alert.payload) == length &&
+        memcmp(alert.payload, payload, length) == 0)
+    {
+      alert.used = false;
+      _lastAlertConfirmMs = millis() - alert.queuedMillis;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Outbox::loop()
+{
+  if (!_mqtt.connected())
+  {
+    return;
+  }
+  unsigned long now = millis();
+  if (sendAlerts(now))
+  {
+    sendTelemetry();
+  }
+}
+
+bool Outbox::fits(const char *topic, const char *payload)
+{
+  return strlen(topic) < OUTBOX_TOPIC_SIZE && strlen(payload) < OUTBOX_PAYLOAD_SIZE;
+}
+
+/**
+ * @brief Pick the slot for a new message in `lane`.
+ *
+ * With `coalesce`, a waiting message on the same topic is reused. A full
+ * lane gives up its oldest message.
+ */
+Outbox::Message *Outbox::slotFor(Message *lane, uint8_t size, const char *topic, bool coalesce)
+{
+  Message *empty = nullptr;
+  Message *oldest = &lane[0];
+  for (uint8_t i = 0; i < size; i++)
+  {
+    if (!lane[i].used)
+    {
+      empty = empty != nullptr ? empty : &lane[i];
+      continue;
+    }
+    if (coalesce && strcmp(lane[i].topic, topic) == 0)
+    {
+      return &lane[i];
+    }
+    if (lane[i].queuedMillis - oldest->queuedMillis > 0x7FFFFFFFUL)
+    {
+      oldest = &lane[i]; // Queued before the current oldest
+    }
+  }
+  if (empty != nullptr)
+  {
+    return empty;
+  }
+  _dropped++;
+  oldest->used = false;
+  return oldest;
+}
+
+/**
+ * @brief Send every alert that is new or due for a retry, oldest first.
+ *
+ * @return true if every alert has gone out at least once, so telemetry may follow.
+ */
+bool Outbox::sendAlerts(unsigned long now)
+{
+  while (true)
+  {
+    Message *due = nullptr;
+    for (uint8_t i = 0; i < OUTBOX_ALERT_SLOTS; i++)
+    {
+      Message &alert = _alerts[i];
+      if (alert.used && (alert.tries == 0 || now - alert.sentMillis >= OUTBOX_ALERT_RETRY_MS) &&
+          (due == nullptr || alert.queuedMillis - due->queuedMillis > 0x7FFFFFFFUL))
+      {
+        due = &alert;
+      }
+    }
+    if (due == nullptr)
+    {
+      return true;
+    }
+    if (due->tries >= OUTBOX_ALERT_TRIES)
+    {
+      due->used = false; // The broker never echoed it
+      _dropped++;
+      continue;
+    }
+    if (!_mqtt.publish(due->topic, due->payload))
+    {
+      if (!rejected(*due))
+      {
+        return false;
+      }
+      continue; // Dropped; the slot is free now
+    }
+    due->tries++;
+    due->sentMillis = now;
+  }
+}
+
+void Outbox::sendTelemetry()
+{
+  while (true)
+  {
+    Message *next = nullptr;
+    for (uint8_t i = 0; i < OUTBOX_TELEMETRY_SLOTS; i++)
+    {
+      Message &message = _telemetry[i];
+      if (message.used && (next == nullptr || message.queuedMillis - next->queuedMillis > 0x7FFFFFFFUL))
+      {
+        next = &message;
+      }
+    }
+    if (next == nullptr || (!_mqtt.publish(next->topic, next->payload) && !rejected(*next)))
+    {
+      return;
+    }
+    next->used = false;
+  }
+}
+
+/**
+ * @brief Sort out a failed publish.
+ *
+ * @return true if the session is still up, so the message itself was
+ * refused (e.g. larger than the client's buffer) and has been dropped
+ * rather than left to block the lane.
+ */
+bool Outbox::rejected(Message &message)
+{
+  if (!_mqtt.connected())
+  {
+    return false;
+  }
+  message.used = false;
+  _dropped++;
+  return true;
+}
@@ -0,0 +1,100 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+
+#define OUTBOX_TOPIC_SIZE 32
+#define OUTBOX_PAYLOAD_SIZE 320 // Room for the stats report
+#define OUTBOX_ALERT_SLOTS 4
+#define OUTBOX_TELEMETRY_SLOTS 6
+
+// Unconfirmed alerts are sent again this often, up to OUTBOX_ALERT_TRIES times
+#define OUTBOX_ALERT_RETRY_MS 1000
+#define OUTBOX_ALERT_TRIES 10
+
+/**
+ * @brief Outbound MQTT messages in two lanes: alerts ahead of telemetry.
+ *
+ * Nothing is published from where it is produced; Outbox::loop() sends queued
+ * messages while the session is up, all pending alerts before any
+ * telemetry. So an alert raised while offline or behind a backlog goes
+ * out first once the broker is reachable.
+ *
+ * Telemetry is latest-value-wins: queuing a topic that is still waiting
+ * replaces its payload in place, and a full lane drops its oldest entry.
+ *
+ * PubSubClient only publishes at QoS 0, so alerts get at-least-once
+ * delivery the way QoS 1 would: the node subscribes to the alert topic
+ * and sends an alert again every OUTBOX_ALERT_RETRY_MS until the broker
+ * echoes it back (see confirm()). Alert payloads must be unique, e.g. by
+ * carrying the client id and a sequence number.
+ */
+class Outbox
+{
+public:
+  Outbox(PubSubClient &mqtt);
+
+  /**
+   * @brief Queue routine telemetry.
+   *
+   * @return false if the topic or payload does not fit a slot.
+   */
+  bool queue(const char *topic, const char *payload);
+
+  /**
+   * @brief Queue an alert, sent before any telemetry until confirmed.
+   *
+   * @return false if the topic or payload does not fit a slot.
+   */
+  bool queueAlert(const char *topic, const char *payload);
+
+  /**
+   * @brief Check an incoming message against the alerts awaiting their echo.
+   *
+   * Call from the MQTT callback before anything else.
+   *
+   * @return true if it was the echo of one of our alerts.
+   */
+  bool confirm(const char *topic, const byte *payload, unsigned int length);
+
+  /**
+   * @brief Publish what is due; call after the connection manager, from the same task.
+   */
+  void loop();
+
+  /**
+   * @brief Time from queueAlert() to the echo, for the last confirmed alert.
+   */
+  uint32_t lastAlertConfirmMs() const { return _lastAlertConfirmMs; }
+
+  /**
+   * @brief Messages dropped (lane full, or an alert never confirmed) since boot.
+   */
+  uint32_t dropped() const { return _dropped; }
+
+private:
+  struct Message
+  {
+    bool used;
+    char topic[OUTBOX_TOPIC_SIZE];
+    char payload[OUTBOX_PAYLOAD_SIZE];
+    unsigned long queuedMillis;
+    unsigned long sentMillis; // Alerts: last attempt
+    uint8_t tries;            // Alerts: attempts so far
+  };
+
+  static bool fits(const char *topic, const char *payload);
+  Message *slotFor(Message *lane, uint8_t size, const char *topic, bool coalesce);
+  bool sendAlerts(unsigned long now);
+  void sendTelemetry();
+  bool rejected(Message &message);
+
+  PubSubClient &_mqtt;
+  Message _alerts[OUTBOX_ALERT_SLOTS];
+  Message _telemetry[OUTBOX_TELEMETRY_SLOTS];
+  uint32_t _lastAlertConfirmMs;
+  uint32_t _dropped;
+};
+
+#endif
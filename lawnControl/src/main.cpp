@@ -1,6 +1,16 @@
 #include <WiFi.h>
 #include <PubSubClient.h>
-#include <ESP32Encoder.h>
+#include <TopicDispatch.h>
+#include <ConnectionManager.h>
+#include <EncoderInput.h>
+#include <GasSensor.h>
+#include <GasAlarm.h>
+#include <Outbox.h>
+#include <LightDimmer.h>
+#include <SpscRing.h>
+#include <TaskMetrics.h>
+#include <LogQueue.h>
+#include <atomic>
 
 // WiFi credentials
 const char *ssid = "ConForNode1";
@@ -9,265 +19,579 @@ const char *password = "12345678";
 // MQTT Broker
 const char *mqtt_server = "ec2-3-86-53-202.compute-1.amazonaws.com";
 
+// Connection handling: failed attempts back off from NET_BACKOFF_MIN_MS to
+// NET_BACKOFF_MAX_MS with jitter. Attempts run in the network task, so
+// they never hold up the encoder, gas sensor or lights
+#define NET_JOIN_TIMEOUT_MS 15000
+#define NET_CONNECT_TIMEOUT_MS 2000
+#define NET_BACKOFF_MIN_MS 1000
+#define NET_BACKOFF_MAX_MS 60000
+
+// Encoder: a detent moves the value by 1, or by up to ENCODER_ACCEL_MAX
+// when the knob is spun fast
+#define ENCODER_DEBOUNCE_MS 20
+#define ENCODER_ACCEL_SLOW_MS 80
+#define ENCODER_ACCEL_FAST_MS 15
+#define ENCODER_ACCEL_MAX 5
+
+// MQ6: ADC1 converts continuously and GAS_WINDOW_MS of conversions make one
+// reading. The curve is the datasheet's LPG line; set GAS_R0_KOHM from a
+// reading at a known concentration and GAS_INPUT_SCALE to the divider on AO
+#define GAS_SAMPLE_RATE_HZ 20000 // Slowest rate of the ESP32's DMA mode
+#define GAS_WINDOW_MS 500
+#define GAS_SUPPLY_MV 5000
+#define GAS_INPUT_SCALE 1.0f
+#define GAS_LOAD_KOHM 20.0f
+#define GAS_R0_KOHM 10.0f
+#define GAS_CURVE_A 1009.2f
+#define GAS_CURVE_B -2.35f
+
+// hall/gas is only published once the estimate leaves a band around the
+// last published value: GAS_HYSTERESIS_PPM or GAS_HYSTERESIS_PCT of the
+// value, whichever is wider
+#define GAS_HYSTERESIS_PPM 20
+#define GAS_HYSTERESIS_PCT 10
+
+// Local gas alarm: trips at GAS_ALARM_TRIGGER_PPM or on a rise of
+// GAS_ALARM_RISE_PPM_S over GAS_ALARM_RISE_WINDOW_MS, clears after
+// GAS_ALARM_CLEAR_HOLD_MS below GAS_ALARM_CLEAR_PPM. Readings taken while
+// the heater warms up (high for the first minute or so) are not judged.
+#define GAS_ALARM_TRIGGER_PPM 1000
+#define GAS_ALARM_CLEAR_PPM 700
+#define GAS_ALARM_RISE_PPM_S 100
+#define GAS_ALARM_RISE_WINDOW_MS 3000
+#define GAS_ALARM_CLEAR_HOLD_MS 10000
+#define GAS_WARMUP_MS 60000
+
+// Lights: a new level fades in over LIGHT_FADE_MS
+#define LIGHT_FADE_MS 400
+
+#define MQTT_BUFFER_SIZE 512 // lawn/control/stats does not fit the library's default 256
+
+// With nothing to do, loop() sleeps this long; encoder input and light
+// commands wake it early
+#define LOOP_IDLE_MS 10
+
+// Networking task: WiFi, MQTT and the outbox run on core 0 next to the
+// WiFi stack, while loop() keeps the encoder, gas sensor, alarm and lights
+// on core 1. It sleeps NET_IDLE_MS between passes unless loop() hands it
+// a message.
+#define NET_TASK_CORE 0
+#define NET_TASK_PRIORITY 1
+#define NET_TASK_STACK_SIZE 6144
+#define NET_IDLE_MS 10
+#define CORE_QUEUE_SIZE 8 // Messages in flight between the tasks, each way (power of two)
+#define ALERT_QUEUE_SIZE 4
+
+// Connection statistics
+const char *statsTopic = "lawn/control/stats";
+
+// CPU and stack use of the two tasks
+const char *tasksTopic = "lawn/control/tasks";
+
+// Gas alarms, confirmed by the broker echoing them back
+const char *alertTopic = "hall/alert";
+const unsigned long statsInterval = 60000; // milliseconds
+
 // Create WiFi and MQTT clients
 WiFiClient espClient;
 PubSubClient client(espClient);
+ConnectionManager net(client, espClient);
+Outbox outbox(client); // Everything published goes through here, alerts first
+char clientId[24]; // Random per boot
+
+// A message published on behalf of loop()
+struct CoreMessage
+{
+  char topic[OUTBOX_TOPIC_SIZE];
+  char payload[OUTBOX_PAYLOAD_SIZE];
+};
+
+// A light level received from the broker, applied by loop()
+struct LightCommand
+{
+  uint8_t index;
+  uint8_t percent;
+};
+
+// loop() to the network task, alerts kept apart so telemetry cannot hold
+// them back, and the network task to loop()
+SpscRing<CoreMessage, ALERT_QUEUE_SIZE> alertQueue;
+SpscRing<CoreMessage, CORE_QUEUE_SIZE> telemetryQueue;
+SpscRing<LightCommand, CORE_QUEUE_SIZE> lightQueue;
+volatile uint32_t coreQueueFull = 0; // Messages loop() could not hand over, written by loop() only
+volatile uint32_t lightQueueFull = 0; // Light commands the callback could not hand over, network task only
+
+// An alert the alert queue had no room for, handed over again by loop()
+CoreMessage pendingAlert;
+bool alertPending = false;
+
+TaskHandle_t netTaskHandle = NULL;
+TaskHandle_t ioTaskHandle = NULL; // Arduino's loop() task
+TaskMetrics netMetrics("net");
+TaskMetrics ioMetrics("io");
+
+// Once the network task runs it is the only one printing; loop() queues
+// its lines here
+LogQueue ioLog(Serial);
 
 // Light output pins
 const int lightPins[4] = {16, 17, 18, 19}; // Adjust these GPIO pins as needed
 
+// Light control topics, same order as lightPins. lawn/lightN is the on/off
+// switch the dashboard and the lawn sensor node share: "0" is off, "1"
+// fully on, anything else is ignored. lawn/lightN/level dims in plain
+// percent, 0-100, with values beyond that clamped.
+constexpr const char *lightTopics[4] = {"lawn/light1", "lawn/light2", "lawn/light3", "lawn/light4"};
+constexpr TopicTable<4> lightTopicTable(lightTopics);
+constexpr const char *lightLevelTopics[4] = {"lawn/light1/level", "lawn/light2/level", "lawn/light3/level",
+                                             "lawn/light4/level"};
+constexpr TopicTable<4> lightLevelTopicTable(lightLevelTopics);
+
+LightDimmer lights;
+
 // Rotary encoder pins
 const int encoderPinA = 32; // Adjust these GPIO pins as needed
 const int encoderPinB = 33;
 const int encoderButtonPin = 25;
 
-ESP32Encoder encoder;
+EncoderInput encoder;
 
 // For selecting between ultrasonic1 and ultrasonic2
 bool selectUltrasonic1 = true;
 
-// MQ6 sensor pin (analog pin)
-const int mq6Pin = 34; // Adjust the analog pin as needed
+// MQ6 sensor input, must be on ADC1
+const adc1_channel_t mq6Channel = ADC1_CHANNEL_6; // GPIO34
 
-// Variables for encoder value
-int lastEncoderValue = 0;
-int currentEncoderValue = 0;
+GasSensor gasSensor;
+GasAlarm gasAlarm;
+
+// Alarm output (buzzer or relay), active high
+const int gasAlarmPin = 26;
+
+// Encoder value, 1-100
+int encoderValue = 1;
 
 // Variables for encoder timing
 unsigned long lastEncoderChangeTime = 0;
 const unsigned long encoderPublishDelay = 500; // milliseconds
 int lastPublishedEncoderValue = -1;            // Initialize to an invalid value
 
-// Variable to store the last published gas value
-int lastGasValue = 0;
+// Last gas estimate published, negative until the first one
+float lastGasPpm = -1;
+
+// Worst time from a gas reading being due to the alarm output following
+// it, since the last stats report (which clears it from the other task)
+std::atomic<uint32_t> alarmLatencyMaxMs(0);
 
 // Function prototypes
-void setup_wifi();
+void netTask(void *parameter);
+bool sendToNet(const char *topic, const char *payload, bool alert);
+void retryPendingAlert();
+void applyLightCommands();
+void onConnectionChange(ConnectionState state);
 void callback(char *topic, byte *payload, unsigned int length);
-void reconnect();
 void readMQ6();
+void onGasAlarm(float ppm);
 void handleEncoder();
+void publishStats();
 
 void setup()
 {
   Serial.begin(115200);
 
-  // Initialize output pins
-  for (int i = 0; i < 4; i++)
+  // Initialize the light outputs as PWM channels, all off
+  if (!lights.begin(lightPins, 4, LIGHT_FADE_MS))
   {
-    pinMode(lightPins[i], OUTPUT);
+    Serial.println("Light PWM setup failed");
   }
 
-  // Initialize rotary encoder
-  ESP32Encoder::useInternalWeakPullResistors = puType::up; // Use internal pull-ups
-  ESP32Encoder::isrServiceCpuCore = ISR_CORE_USE_DEFAULT;  // Use default ISR core
-  encoder.clearCount();                                    // Clear the encoder count
-  encoder.attachHalfQuad(encoderPinA, encoderPinB);        // Attach encoder in half quadrature mode
-  encoder.setCount(0);                                     // Set initial count to 0
-
-  lastEncoderValue = 0;
-
-  // Initialize button pin
-  pinMode(encoderButtonPin, INPUT_PULLUP);
-
-  // Initialize MQ6 pin
-  // No need to set pinMode for analogRead
+  // Initialize rotary encoder and its button (interrupt driven, with pull-ups)
+  encoder.begin({encoderPinA, encoderPinB, encoderButtonPin, ENCODER_DEBOUNCE_MS, ENCODER_ACCEL_SLOW_MS,
+                 ENCODER_ACCEL_FAST_MS, ENCODER_ACCEL_MAX});
+  ioTaskHandle = xTaskGetCurrentTaskHandle();
+  ioMetrics.attach();
+  encoder.setNotifyTask(ioTaskHandle);
+
+  pinMode(gasAlarmPin, OUTPUT);
+  digitalWrite(gasAlarmPin, LOW);
+  gasAlarm.begin({GAS_ALARM_TRIGGER_PPM, GAS_ALARM_RISE_PPM_S, GAS_ALARM_RISE_WINDOW_MS, GAS_ALARM_CLEAR_PPM,
+                  GAS_ALARM_CLEAR_HOLD_MS});
+
+  // Start the MQ6 conversions
+  if (gasSensor.begin({mq6Channel, GAS_SAMPLE_RATE_HZ, GAS_WINDOW_MS, GAS_SUPPLY_MV, GAS_INPUT_SCALE, GAS_LOAD_KOHM,
+                       GAS_R0_KOHM, GAS_CURVE_A, GAS_CURVE_B}))
+  {
+    Serial.print("MQ6 ADC calibration: ");
+    Serial.println(gasSensor.calibration() == ESP_ADC_CAL_VAL_EFUSE_TP     ? "eFuse two point"
+                   : gasSensor.calibration() == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse Vref"
+                                                                           : "default Vref");
+  }
+  else
+  {
+    Serial.println("MQ6 ADC failed to start");
+  }
 
-  setup_wifi();
-  client.setServer(mqtt_server, 1883);
+  // WiFi and MQTT are brought up by the network task
+  snprintf(clientId, sizeof(clientId), "ESP32Client-%lx", (unsigned long)random(0xffff));
+  client.setBufferSize(MQTT_BUFFER_SIZE);
   client.setCallback(callback);
+  net.setStateCallback(onConnectionChange);
+  net.begin({ssid, password, mqtt_server, 1883, clientId, NET_JOIN_TIMEOUT_MS,
+             NET_CONNECT_TIMEOUT_MS, NET_BACKOFF_MIN_MS, NET_BACKOFF_MAX_MS});
+  xTaskCreatePinnedToCore(netTask, "netTask", NET_TASK_STACK_SIZE, NULL, NET_TASK_PRIORITY, &netTaskHandle,
+                          NET_TASK_CORE);
 }
 
 void loop()
 {
-  if (!client.connected())
-  {
-    reconnect();
-  }
-  client.loop();
-
+  ioMetrics.beginPass();
+  retryPendingAlert();
+  applyLightCommands();
   handleEncoder();
   readMQ6();
+  lights.loop();
+  ioMetrics.endPass();
 
-  // Remove delay to make loop non-blocking and use timing control within functions
-  // delay(100); // Adjust as needed
+  // Sleep until the encoder or the broker has something, or briefly while
+  // the button settles
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(encoder.settling() ? 1 : LOOP_IDLE_MS));
 }
 
-void setup_wifi()
+/**
+ * @brief Keep WiFi and MQTT up and publish what loop() queued.
+ *
+ * Runs pinned to NET_TASK_CORE. Connection attempts, socket writes and the
+ * MQTT callback all happen here, so a stalled broker only delays this task.
+ * It also prints the console lines loop() queued, so a slow Serial never
+ * stalls loop() either.
+ */
+void netTask(void *parameter)
 {
-  delay(10);
-  // Connect to Wi-Fi
-  Serial.println();
-  Serial.print("Connecting to ");
-  Serial.println(ssid);
+  netMetrics.attach();
+  for (;;)
+  {
+    netMetrics.beginPass();
+
+    // Keep WiFi and MQTT up, one short step per pass
+    net.loop();
+
+    static CoreMessage message; // Only this task uses it; keeps it off the stack
+    while (alertQueue.pop(message))
+    {
+      outbox.queueAlert(message.topic, message.payload);
+    }
+    while (telemetryQueue.pop(message))
+    {
+      outbox.queue(message.topic, message.payload);
+    }
 
-  WiFi.mode(WIFI_STA); // Station mode
-  WiFi.begin(ssid, password);
+    ioLog.flush();
+    publishStats();
+    outbox.loop();
+    netMetrics.endPass();
+
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NET_IDLE_MS));
+  }
+}
 
-  while (WiFi.status() != WL_CONNECTED)
+/**
+ * @brief Hand a message to the network task for the outbox.
+ *
+ * @return false if it does not fit or the queue is full; try again later.
+ */
+bool sendToNet(const char *topic, const char *payload, bool alert)
+{
+  CoreMessage message;
+  int topicLength = snprintf(message.topic, sizeof(message.topic), "%s", topic);
+  int payloadLength = snprintf(message.payload, sizeof(message.payload), "%s", payload);
+  if (topicLength >= (int)sizeof(message.topic) || payloadLength >= (int)sizeof(message.payload))
+  {
+    return false;
+  }
+  if (!(alert ? alertQueue.push(message) : telemetryQueue.push(message)))
   {
-    delay(500);
-    Serial.print(".");
+    coreQueueFull++;
+    return false;
   }
+  xTaskNotifyGive(netTaskHandle);
+  return true;
+}
 
-  Serial.println("");
-  Serial.print("WiFi connected. IP address: ");
-  Serial.println(WiFi.localIP());
+/**
+ * @brief Hand over an alert that found the alert queue full.
+ *
+ * Called on every loop() pass until the network task has taken it.
+ */
+void retryPendingAlert()
+{
+  if (alertPending && alertQueue.push(pendingAlert))
+  {
+    alertPending = false;
+    xTaskNotifyGive(netTaskHandle);
+  }
+}
+
+/**
+ * @brief Fade the lights to the levels the callback received.
+ */
+void applyLightCommands()
+{
+  LightCommand command;
+  while (lightQueue.pop(command))
+  {
+    lights.set(command.index, command.percent);
+    ioLog.printf("Fading pin %d to %u%%", lightPins[command.index], command.percent);
+  }
+}
+
+void onConnectionChange(ConnectionState state)
+{
+  switch (state)
+  {
+  case NET_WIFI_JOINING:
+    Serial.print("Connecting to ");
+    Serial.println(ssid);
+    break;
+  case NET_MQTT_DOWN:
+    Serial.print("WiFi up, IP address ");
+    Serial.print(WiFi.localIP());
+    Serial.println(", connecting to MQTT");
+    break;
+  case NET_ONLINE:
+    Serial.println("MQTT connected");
+
+    // Subscribe to topics; our own alerts come back as their confirmation
+    for (int i = 0; i < 4; i++)
+    {
+      client.subscribe(lightTopics[i]);
+      client.subscribe(lightLevelTopics[i]);
+    }
+    client.subscribe(alertTopic);
+    break;
+  case NET_WIFI_DOWN:
+    Serial.println("WiFi down, retrying with backoff");
+    break;
+  }
 }
 
 void callback(char *topic, byte *payload, unsigned int length)
 {
+  if (outbox.confirm(topic, payload, length))
+  {
+    return;
+  }
+
   // Handle incoming messages
   Serial.print("Message arrived [");
   Serial.print(topic);
   Serial.print("] ");
 
-  // Convert payload to string
-  String message;
-  for (unsigned int i = 0; i < length; i++)
+  Serial.write(payload, length);
+  Serial.println();
+
+  // Handle messages for light1 to light4: the switch, then the level
+  long value;
+  if (!parsePayloadInt(payload, length, value))
   {
-    message += (char)payload[i];
+    return;
   }
-  Serial.println(message);
-
-  // Handle messages for light1 to light4
-  for (int i = 1; i <= 4; i++)
+  LightCommand command;
+  int i = lightTopicTable.find(topic);
+  if (i >= 0 && (value == 0 || value == 1))
   {
-    String lightTopic = "lawn/light" + String(i);
-    if (String(topic) == lightTopic)
-    {
-      int value = message.toInt();
-      digitalWrite(lightPins[i - 1], value);
-      Serial.print("Set pin ");
-      Serial.print(lightPins[i - 1]);
-      Serial.print(" to ");
-      Serial.println(value);
-    }
+    command = {(uint8_t)i, (uint8_t)(value * 100)};
+  }
+  else if ((i = lightLevelTopicTable.find(topic)) >= 0)
+  {
+    command = {(uint8_t)i, (uint8_t)constrain(value, 0, 100)};
+  }
+  else
+  {
+    return;
+  }
+  if (lightQueue.push(command))
+  {
+    xTaskNotifyGive(ioTaskHandle);
+  }
+  else
+  {
+    lightQueueFull++;
   }
 }
 
-void reconnect()
+void handleEncoder()
 {
-  // Loop until we're reconnected
-  while (!client.connected())
+  // Consume what the interrupts recorded since the last pass
+  EncoderEvent event;
+  while (encoder.poll(event))
   {
-    Serial.print("Attempting MQTT connection...");
-    // Attempt to connect
-    String clientId = "ESP32Client-";
-    clientId += String(random(0xffff), HEX);
-    if (client.connect(clientId.c_str()))
+    switch (event.type)
     {
-      Serial.println("connected");
-
-      // Subscribe to topics
-      client.subscribe("lawn/light1");
-      client.subscribe("lawn/light2");
-      client.subscribe("lawn/light3");
-      client.subscribe("lawn/light4");
+    case ENCODER_TURN:
+      // Clamped here, the detents themselves are never rewritten
+      encoderValue = constrain(encoderValue + event.steps, 1, 100);
+      lastEncoderChangeTime = millis();
+      ioLog.printf("Encoder value changed to %d", encoderValue);
+      break;
+
+    case ENCODER_PRESS:
+      selectUltrasonic1 = !selectUltrasonic1;
+      ioLog.printf("Switched to %s", selectUltrasonic1 ? "lawn/ultrasonic1" : "lawn/ultrasonic2");
+      break;
+
+    case ENCODER_RELEASE:
+      break;
     }
-    else
-    {
-      Serial.print("failed, rc=");
-      Serial.print(client.state());
-      Serial.println(" try again in 5 seconds");
+  }
 
-      // Wait 5 seconds before retrying
-      delay(5000);
+  // Publish the final value once the knob has been still for encoderPublishDelay
+  if (encoderValue != lastPublishedEncoderValue && millis() - lastEncoderChangeTime >= encoderPublishDelay)
+  {
+    const char *topic = selectUltrasonic1 ? "lawn/ultrasonic1" : "lawn/ultrasonic2";
+    String message = String(encoderValue);
+    if (sendToNet(topic, message.c_str(), false))
+    {
+      ioLog.printf("Queued final value %d to topic %s", encoderValue, topic);
+      lastPublishedEncoderValue = encoderValue;
     }
   }
 }
 
-void handleEncoder()
+void readMQ6()
 {
-  // Read encoder value
-  currentEncoderValue = (int)encoder.getCount();
-
-  // Constrain value between 1 and 100
-  int value = constrain(currentEncoderValue, 1, 100);
-
-  if (currentEncoderValue != lastEncoderValue)
+  // A reading is ready every GAS_WINDOW_MS
+  if (!gasSensor.poll())
   {
-    // Encoder value has changed
-    lastEncoderValue = currentEncoderValue;
-
-    // Update encoder count to constrained value
-    encoder.setCount(value);
-
-    // Update last change time
-    lastEncoderChangeTime = millis();
+    return;
+  }
+  float ppm = gasSensor.ppm();
 
-    Serial.print("Encoder value changed to ");
-    Serial.println(value);
+  // The alarm comes first and does not wait for the network
+  if (millis() >= GAS_WARMUP_MS && gasAlarm.update(ppm, gasSensor.readingMillis()))
+  {
+    onGasAlarm(ppm);
   }
-  else
+
+  // Movement inside the band is noise or drift, not a change worth sending
+  if (lastGasPpm >= 0)
   {
-    // Encoder value hasn't changed
-    // Check if enough time has passed since last change to publish value
-    if (millis() - lastEncoderChangeTime >= encoderPublishDelay)
+    float band = max((float)GAS_HYSTERESIS_PPM, lastGasPpm * GAS_HYSTERESIS_PCT / 100.0f);
+    if (fabsf(ppm - lastGasPpm) < band)
     {
-      // Time to publish the value
-      // Check if we haven't already published this value
-      if (lastPublishedEncoderValue != value)
-      {
-        // Publish value to selected topic
-        String topic = selectUltrasonic1 ? "lawn/ultrasonic1" : "lawn/ultrasonic2";
-        String message = String(value);
-        client.publish(topic.c_str(), message.c_str());
-
-        Serial.print("Published final value ");
-        Serial.print(value);
-        Serial.print(" to topic ");
-        Serial.println(topic);
-
-        // Update last published value
-        lastPublishedEncoderValue = value;
-      }
+      return;
     }
   }
 
-  // Check if button is pressed
-  static bool lastButtonState = HIGH;
-  bool buttonState = digitalRead(encoderButtonPin);
-
-  // Detect falling edge
-  if (lastButtonState == HIGH && buttonState == LOW)
+  // Publish to "hall/gas"; while offline only the latest estimate is kept
+  String message = String(lroundf(ppm));
+  if (sendToNet("hall/gas", message.c_str(), false))
   {
-    // Button pressed
-    selectUltrasonic1 = !selectUltrasonic1;
-    Serial.print("Switched to ");
-    Serial.println(selectUltrasonic1 ? "lawn/ultrasonic1" : "lawn/ultrasonic2");
+    ioLog.printf("Queued gas estimate %s ppm (%.1f mV)", message.c_str(), gasSensor.millivolts());
+    lastGasPpm = ppm;
   }
-  lastButtonState = buttonState;
 }
 
-void readMQ6()
+/**
+ * @brief Drive the alarm output, then queue a hall/alert ahead of all telemetry.
+ *
+ * If the alert queue is full the alert stays pending and loop() hands it
+ * over on a later pass.
+ *
+ * The output follows a reading within one loop() pass; the latency from
+ * the reading being due to the output is measured here and reported in
+ * the stats. Detection itself lags the gas by up to GAS_WINDOW_MS.
+ */
+void onGasAlarm(float ppm)
 {
-  static unsigned long lastReadTime = 0;
-  const unsigned long readInterval = 500; // Read every 500 ms (adjust as needed)
+  static const char *causes[] = {"none", "level", "rise"};
+  static unsigned long alertSequence = 0;
 
-  // Check if it's time to read the sensor
-  if (millis() - lastReadTime >= readInterval)
+  digitalWrite(gasAlarmPin, gasAlarm.active() ? HIGH : LOW);
+  uint32_t latencyMs = millis() - gasSensor.readingMillis();
+  uint32_t seen = alarmLatencyMaxMs.load();
+  while (latencyMs > seen && !alarmLatencyMaxMs.compare_exchange_weak(seen, latencyMs))
   {
-    lastReadTime = millis();
-
-    // Read analog value from MQ6 sensor
-    int gasValue = analogRead(mq6Pin);
+  }
 
-    // Define a threshold for significant change
-    const int gasThreshold = 5; // Adjust as needed
+  // Client id and sequence number make each alert's echo unambiguous. One
+  // still waiting for the queue is replaced: the newer state supersedes it
+  char *alert = pendingAlert.payload;
+  snprintf(pendingAlert.topic, sizeof(pendingAlert.topic), "%s", alertTopic);
+  snprintf(alert, sizeof(pendingAlert.payload),
+           "{\"node\": \"%s\",\"seq\": %lu,\"state\": \"%s\",\"cause\": \"%s\",\"ppm\": %ld,"
+           "\"risePpmPerS\": %.1f,\"latencyMs\": %lu}",
+           clientId, ++alertSequence, gasAlarm.active() ? "alarm" : "clear", causes[gasAlarm.cause()], lroundf(ppm),
+           gasAlarm.rise(), (unsigned long)latencyMs);
+  alertPending = true;
+  retryPendingAlert();
+  if (alertPending)
+  {
+    coreQueueFull++; // Counted once, however many passes the retry takes
+  }
 
-    // Check if the change is significant
-    if (abs(gasValue - lastGasValue) >= gasThreshold)
-    {
-      // Publish to "hall/gas"
-      String message = String(gasValue);
-      client.publish("hall/gas", message.c_str());
+  ioLog.printf("Gas alarm %s", alert);
+}
 
-      Serial.print("Published gas value ");
-      Serial.println(gasValue);
+void publishStats()
+{
+  static unsigned long lastStatsTime = 0;
+  unsigned long now = millis();
+  if (now - lastStatsTime < statsInterval)
+  {
+    return;
+  }
+  lastStatsTime = now;
 
-      // Update lastGasValue
-      lastGasValue = gasValue;
-    }
+  // Both tasks' CPU share, longest pass and least free stack
+  TaskUsage usage[2] = {netMetrics.take(), ioMetrics.take()};
+  char tasks[OUTBOX_PAYLOAD_SIZE];
+  if (formatTaskUsage(tasks, sizeof(tasks), usage, 2) > 0)
+  {
+    outbox.queue(tasksTopic, tasks);
   }
+
+  // Time connection attempts held up the network task, time offline, and how
+  // fast the last join was (fastJoin: straight to the cached AP and lease)
+  ConnectionStats netStats = net.takeStats();
+  String message = "{\"netBlockedMs\": ";
+  message += netStats.blockedMs;
+  message += ",\"netBlockedMaxMs\": ";
+  message += netStats.blockedMaxMs;
+  message += ",\"netBlockedMsPerHour\": ";
+  message += netStats.blockedMsPerHour();
+  message += ",\"netOfflineMs\": ";
+  message += netStats.offlineMs;
+  message += ",\"wifiJoinMs\": ";
+  message += net.lastJoinMs();
+  message += ",\"fastJoin\": ";
+  message += net.lastJoinFast() ? "true" : "false";
+  message += ",\"bootToOnlineMs\": ";
+  message += net.bootToOnlineMs();
+
+  // Loop rate shows how much the idle wait saves; dropped encoder input
+  // means the queues are too short for how long the loop was blocked, a
+  // full core or log queue that the network task fell behind, and a full
+  // light queue that loop() did
+  message += ",\"loopHz\": ";
+  message += String(usage[1].windowMs > 0 ? usage[1].passes * 1000.0f / usage[1].windowMs : 0, 1);
+  message += ",\"encoderDropped\": ";
+  message += encoder.dropped();
+  message += ",\"coreQueueFull\": ";
+  message += coreQueueFull;
+  message += ",\"lightQueueFull\": ";
+  message += lightQueueFull;
+  message += ",\"logDropped\": ";
+  message += ioLog.dropped();
+
+  // Gas alarm reaction time, and how long the last alert took to be
+  // confirmed by the broker
+  message += ",\"alarmLatencyMs\": ";
+  message += alarmLatencyMaxMs.exchange(0);
+  message += ",\"alertConfirmMs\": ";
+  message += outbox.lastAlertConfirmMs();
+  message += ",\"outboxDropped\": ";
+  message += outbox.dropped();
+  message += "}";
+  outbox.queue(statsTopic, message.c_str());
 }
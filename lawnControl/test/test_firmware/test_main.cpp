@@ -0,0 +1,172 @@
+#include <Arduino.h>
+#include <LightDimmer.h>
+#include <NativeBroker.h>
+#include <NativeHooks.h>
+#include <unity.h>
+
+// Host tests of the whole firmware, built by the native environment:
+//   pio test -e native
+// setup() runs once; each test drives loop() against an in-process broker
+// while the network task runs on its own thread, as on the device.
+
+#define ENCODER_PIN_A 32
+#define ENCODER_PIN_B 33
+#define ENCODER_BUTTON_PIN 25
+#define MQ6_PIN 34
+
+extern LightDimmer lights;
+
+static NativeBroker broker;
+
+static bool subscribed()
+{
+  return broker.subscribed("lawn/light1") && broker.subscribed("lawn/light4") &&
+         broker.subscribed("lawn/light4/level") && broker.subscribed("hall/alert");
+}
+
+/**
+ * @brief One detent in the direction that counts up, with the pauses a hand makes.
+ */
+static void turnEncoder()
+{
+  static const int levels[4][2] = {{LOW, HIGH}, {LOW, LOW}, {HIGH, LOW}, {HIGH, HIGH}};
+  for (int i = 0; i < 4; i++)
+  {
+    nativeSetDigitalInput(ENCODER_PIN_A, levels[i][0]);
+    nativeSetDigitalInput(ENCODER_PIN_B, levels[i][1]);
+  }
+  nativeLoopUntil(nullptr, 100); // Slower than the acceleration threshold
+}
+
+static void pressButton()
+{
+  nativeSetDigitalInput(ENCODER_BUTTON_PIN, LOW);
+  nativeLoopUntil(nullptr, 50);
+  nativeSetDigitalInput(ENCODER_BUTTON_PIN, HIGH);
+  nativeLoopUntil(nullptr, 50);
+}
+
+void setUp()
+{
+  broker.clear();
+}
+
+void tearDown()
+{
+}
+
+void test_connects_and_subscribes()
+{
+  TEST_ASSERT_TRUE(nativeLoopUntil(subscribed, 5000));
+  TEST_ASSERT_EQUAL_UINT32(1, broker.connects());
+
+  // The knob's starting value goes out once at boot
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("lawn/ultrasonic1") > 0; }, 2000));
+  TEST_ASSERT_EQUAL_STRING("1", broker.last("lawn/ultrasonic1").c_str());
+}
+
+void test_publishes_gas_estimate_on_change()
+{
+  // The first estimate went out at boot; a steady reading sends nothing more
+  nativeLoopUntil(nullptr, 1200);
+  TEST_ASSERT_EQUAL(0, broker.count("hall/gas"));
+
+  nativeSetAnalogInput(MQ6_PIN, 2500); // Some tens of ppm
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("hall/gas") > 0; }, 3000));
+  TEST_ASSERT_TRUE(atol(broker.last("hall/gas").c_str()) > 0);
+}
+
+void test_light_command_sets_level()
+{
+  broker.publish("lawn/light3/level", "40");
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return lights.level(2) == 40; }, 2000));
+  TEST_ASSERT_EQUAL_UINT8(0, lights.level(0));
+
+  // Plain percent all the way down: 1 is nearly off, not fully on, and not off
+  broker.publish("lawn/light3/level", "1");
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return lights.level(2) == 1; }, 2000));
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return ledc_get_duty(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_2) == 1; }, 2000));
+
+  broker.publish("lawn/light3/level", "0");
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return lights.level(2) == 0; }, 2000));
+}
+
+void test_light_switch_turns_fully_on_and_off()
+{
+  broker.publish("lawn/light2", "1");
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return lights.level(1) == 100; }, 2000));
+
+  // The switch takes only 0 and 1; levels go to the level topic
+  broker.publish("lawn/light2", "40");
+  nativeLoopUntil(nullptr, 300);
+  TEST_ASSERT_EQUAL_UINT8(100, lights.level(1));
+
+  broker.publish("lawn/light2", "0");
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return lights.level(1) == 0; }, 2000));
+}
+
+void test_malformed_light_command_ignored()
+{
+  broker.publish("lawn/light1/level", "50");
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return lights.level(0) == 50; }, 2000));
+  broker.publish("lawn/light1/level", "bright");
+  nativeLoopUntil(nullptr, 300);
+  TEST_ASSERT_EQUAL_UINT8(50, lights.level(0));
+}
+
+void test_encoder_publishes_settled_value()
+{
+  for (int i = 0; i < 3; i++)
+  {
+    turnEncoder();
+  }
+  // Nothing while the knob moves, one message once it has been still
+  TEST_ASSERT_EQUAL(0, broker.count("lawn/ultrasonic1"));
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("lawn/ultrasonic1") > 0; }, 2000));
+  TEST_ASSERT_EQUAL(1, broker.count("lawn/ultrasonic1"));
+  TEST_ASSERT_EQUAL_STRING("4", broker.last("lawn/ultrasonic1").c_str());
+}
+
+void test_button_switches_topic()
+{
+  pressButton();
+  turnEncoder();
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("lawn/ultrasonic2") > 0; }, 2000));
+  TEST_ASSERT_EQUAL_STRING("5", broker.last("lawn/ultrasonic2").c_str());
+  TEST_ASSERT_EQUAL(0, broker.count("lawn/ultrasonic1"));
+}
+
+void test_reconnects_after_broker_restart()
+{
+  broker.stop();
+  nativeLoopUntil(nullptr, 500);
+  TEST_ASSERT_TRUE(broker.start());
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.connects() == 2 && subscribed(); }, 10000));
+
+  broker.publish("lawn/light4/level", "75");
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return lights.level(3) == 75; }, 2000));
+}
+
+int main()
+{
+  nativeSetConsoleOutput(false);
+  if (!broker.start())
+  {
+    return 1;
+  }
+  setenv("NATIVE_BROKER", "127.0.0.1", 1);
+  setenv("NATIVE_BROKER_PORT", String(broker.port()).c_str(), 1);
+  nativeSetAnalogInput(MQ6_PIN, 600); // Clean air, well below the alarm
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_connects_and_subscribes);
+  RUN_TEST(test_publishes_gas_estimate_on_change);
+  RUN_TEST(test_light_command_sets_level);
+  RUN_TEST(test_light_switch_turns_fully_on_and_off);
+  RUN_TEST(test_malformed_light_command_ignored);
+  RUN_TEST(test_encoder_publishes_settled_value);
+  RUN_TEST(test_button_switches_topic);
+  RUN_TEST(test_reconnects_after_broker_restart);
+  return UNITY_END();
+}
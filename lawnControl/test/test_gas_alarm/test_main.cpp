@@ -0,0 +1,293 @@
+#include <Arduino.h>
+#include <GasAlarm.h>
+#include <GasSensor.h>
+#include <NativeBroker.h>
+#include <NativeHooks.h>
+#include <Outbox.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <atomic>
+#include <set>
+#include <string>
+#include <unity.h>
+
+// The gas safety path: GasAlarm's trip and clear rules, the outbox's alert
+// lane, then the whole firmware from an ADC ramp to the alarm output and
+// the hall/alert on the broker. Built by the native environment:
+//   pio test -e native
+
+#define MQ6_PIN 34
+#define GAS_ALARM_PIN 26
+#define GAS_WINDOW_MS 500
+#define GAS_WARMUP_MS 60000
+
+// loop() passes from the tripping reading to the alarm output, counting
+// the pass that took the reading
+#define ALARM_MAX_PASSES 1
+
+extern GasSensor gasSensor;
+extern Outbox outbox;
+extern std::atomic<uint32_t> alarmLatencyMaxMs;
+
+static NativeBroker broker;
+
+static const GasAlarmConfig alarmConfig = {1000, 100, 3000, 700, 10000};
+
+// A second session on the broker for the outbox on its own
+static WiFiClient testSocket;
+static PubSubClient testClient(testSocket);
+static Outbox testOutbox(testClient);
+static bool testAlertEchoed = false;
+
+static void testCallback(char *topic, byte *payload, unsigned int length)
+{
+  testAlertEchoed = testOutbox.confirm(topic, payload, length) || testAlertEchoed;
+}
+
+static bool subscribed()
+{
+  return broker.subscribed("hall/alert") && broker.subscribed("lawn/light4/level");
+}
+
+static int firstIndex(const std::vector<NativeBrokerMessage> &messages, const char *topic)
+{
+  for (size_t i = 0; i < messages.size(); i++)
+  {
+    if (messages[i].topic == topic)
+    {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+// Counted by a ticker after every loop() pass
+static uint32_t passes = 0;
+static uint32_t readingPass = 0; // Pass that took the latest gas reading
+static uint32_t alarmPass = 0;   // Pass after which the output was first high
+static unsigned long lastReadingMillis = 0;
+
+static void watchAlarm()
+{
+  passes++;
+  if (gasSensor.readingMillis() != lastReadingMillis)
+  {
+    lastReadingMillis = gasSensor.readingMillis();
+    readingPass = passes;
+  }
+  if (alarmPass == 0 && nativeGetPinOutput(GAS_ALARM_PIN) == HIGH)
+  {
+    alarmPass = passes;
+  }
+}
+
+void setUp()
+{
+  broker.clear();
+}
+
+void tearDown()
+{
+}
+
+void test_level_trips()
+{
+  GasAlarm alarm;
+  alarm.begin(alarmConfig);
+  TEST_ASSERT_FALSE(alarm.update(990, 1000));
+  TEST_ASSERT_FALSE(alarm.active());
+  TEST_ASSERT_TRUE(alarm.update(1000, 11000)); // Slow enough not to count as a rise
+  TEST_ASSERT_TRUE(alarm.active());
+  TEST_ASSERT_EQUAL(GAS_ALARM_LEVEL, alarm.cause());
+  TEST_ASSERT_FALSE(alarm.update(1200, 11500)); // Already on
+}
+
+void test_rise_trips_below_level()
+{
+  GasAlarm alarm;
+  alarm.begin(alarmConfig);
+  alarm.update(10, 1000);
+  alarm.update(80, 2000);
+  TEST_ASSERT_FALSE(alarm.active()); // 70 ppm/s
+
+  // 10 to 320 ppm over three seconds, 103 ppm/s
+  alarm.update(170, 3000);
+  TEST_ASSERT_TRUE(alarm.update(320, 4000));
+  TEST_ASSERT_EQUAL(GAS_ALARM_RISE, alarm.cause());
+  TEST_ASSERT_FLOAT_WITHIN(1, 103.3f, alarm.rise());
+
+  // A jump from before the window does not count
+  GasAlarm late;
+  late.begin(alarmConfig);
+  late.update(0, 1000);
+  TEST_ASSERT_FALSE(late.update(350, 4500));
+}
+
+void test_clears_only_after_quiet_hold()
+{
+  GasAlarm alarm;
+  alarm.begin(alarmConfig);
+  alarm.update(1100, 1000);
+  TEST_ASSERT_TRUE(alarm.active());
+
+  // Between clearPpm and the trigger keeps it on however long it lasts
+  TEST_ASSERT_FALSE(alarm.update(800, 20000));
+  TEST_ASSERT_FALSE(alarm.update(800, 40000));
+
+  // Quiet from 41 s, interrupted at 45.5 s, so the hold starts again at 46 s
+  TEST_ASSERT_FALSE(alarm.update(600, 41000));
+  TEST_ASSERT_FALSE(alarm.update(650, 45000));
+  TEST_ASSERT_FALSE(alarm.update(710, 45500));
+  TEST_ASSERT_FALSE(alarm.update(600, 46000));
+  TEST_ASSERT_FALSE(alarm.update(600, 55999));
+  TEST_ASSERT_TRUE(alarm.active());
+  TEST_ASSERT_TRUE(alarm.update(600, 56000));
+  TEST_ASSERT_FALSE(alarm.active());
+  TEST_ASSERT_EQUAL(GAS_ALARM_NONE, alarm.cause());
+
+  // A fast rise below clearPpm also holds it on
+  alarm.update(1100, 60000);
+  alarm.update(600, 61000);
+  TEST_ASSERT_FALSE(alarm.update(600, 70000));
+  TEST_ASSERT_FALSE(alarm.update(690, 70900)); // 100 ppm/s
+  TEST_ASSERT_FALSE(alarm.update(600, 71000));
+  TEST_ASSERT_TRUE(alarm.active());
+}
+
+void test_outbox_sends_alert_ahead_of_telemetry_until_echoed()
+{
+  testClient.setServer("127.0.0.1", broker.port());
+  testClient.setCallback(testCallback);
+  TEST_ASSERT_TRUE(testClient.connect("gasAlarmTest"));
+  TEST_ASSERT_TRUE(testClient.subscribe("test/alert"));
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.subscribed("test/alert"); }, 2000));
+
+  // Queued after the telemetry, published before it
+  TEST_ASSERT_TRUE(testOutbox.queue("test/gas", "12"));
+  TEST_ASSERT_TRUE(testOutbox.queue("test/gas", "15")); // Replaces the waiting one
+  TEST_ASSERT_TRUE(testOutbox.queueAlert("test/alert", "{\"seq\": 1}"));
+  testOutbox.loop();
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("test/gas") > 0; }, 2000));
+  std::vector<NativeBrokerMessage> messages = broker.messages();
+  TEST_ASSERT_EQUAL(0, firstIndex(messages, "test/alert"));
+  TEST_ASSERT_EQUAL(1, firstIndex(messages, "test/gas"));
+  TEST_ASSERT_EQUAL(1, broker.count("test/gas"));
+  TEST_ASSERT_EQUAL_STRING("15", broker.last("test/gas").c_str());
+
+  // Once echoed it is not sent again
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() {
+    testClient.loop();
+    return testAlertEchoed;
+  }, 2000));
+  nativeAdvanceClock(OUTBOX_ALERT_RETRY_MS);
+  testOutbox.loop();
+  nativeLoopUntil(nullptr, 100);
+  TEST_ASSERT_EQUAL(1, broker.count("test/alert"));
+  TEST_ASSERT_EQUAL_UINT32(0, testOutbox.dropped());
+}
+
+void test_outbox_drops_alert_never_echoed()
+{
+  // Nobody subscribes to this one, so no echo comes back
+  TEST_ASSERT_TRUE(testOutbox.queueAlert("test/unheard", "{\"seq\": 2}"));
+  for (int i = 0; i <= OUTBOX_ALERT_TRIES; i++)
+  {
+    testOutbox.loop();
+    testClient.loop();
+    nativeAdvanceClock(OUTBOX_ALERT_RETRY_MS);
+  }
+  testOutbox.loop();
+  nativeLoopUntil(nullptr, 100);
+  TEST_ASSERT_EQUAL(OUTBOX_ALERT_TRIES, broker.count("test/unheard"));
+  TEST_ASSERT_EQUAL_UINT32(1, testOutbox.dropped());
+
+  // Nothing left to retry
+  nativeAdvanceClock(OUTBOX_ALERT_RETRY_MS);
+  testOutbox.loop();
+  nativeLoopUntil(nullptr, 100);
+  TEST_ASSERT_EQUAL(OUTBOX_ALERT_TRIES, broker.count("test/unheard"));
+  testClient.disconnect();
+}
+
+void test_gas_ramp_raises_alarm_output()
+{
+  TEST_ASSERT_TRUE(nativeLoopUntil(subscribed, 5000));
+  nativeAdvanceClock(GAS_WARMUP_MS); // Readings before this are not judged
+  nativeLoopUntil(nullptr, 1200);    // Clean air readings for the rise to start from
+  TEST_ASSERT_EQUAL(LOW, nativeGetPinOutput(GAS_ALARM_PIN));
+
+  // Offline, so the alert and the gas estimates queue up behind it
+  broker.stop();
+  alarmLatencyMaxMs = 0;
+  nativeAttachTicker(watchAlarm);
+
+  // About 11, 61, 128, 264 and 625 ppm, half a second apart
+  static const int ramp[] = {1500, 2500, 3000, 3500, 4095};
+  unsigned long rampEnd = 0;
+  for (int raw : ramp)
+  {
+    nativeSetAnalogInput(MQ6_PIN, raw);
+    rampEnd = millis();
+    if (nativeLoopUntil([]() { return alarmPass != 0; }, GAS_WINDOW_MS))
+    {
+      break;
+    }
+  }
+  if (alarmPass == 0)
+  {
+    nativeLoopUntil([]() { return alarmPass != 0; }, 2 * GAS_WINDOW_MS);
+  }
+  nativeDetachTicker(watchAlarm);
+
+  TEST_ASSERT_NOT_EQUAL(0, alarmPass);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(ALARM_MAX_PASSES, alarmPass - readingPass + 1);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(2 * GAS_WINDOW_MS, millis() - rampEnd);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(100, alarmLatencyMaxMs.load());
+}
+
+void test_alert_reaches_broker_before_gas_telemetry()
+{
+  TEST_ASSERT_TRUE(broker.start());
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return broker.count("hall/alert") > 0 && broker.count("hall/gas") > 0; },
+                                   10000));
+  std::vector<NativeBrokerMessage> messages = broker.messages();
+  int alert = firstIndex(messages, "hall/alert");
+  TEST_ASSERT_TRUE(alert >= 0 && alert < firstIndex(messages, "hall/gas"));
+  TEST_ASSERT_NOT_NULL(strstr(messages[alert].payload.c_str(), "\"state\": \"alarm\""));
+  TEST_ASSERT_NOT_NULL(strstr(messages[alert].payload.c_str(), "\"cause\": \"rise\""));
+
+  // The echo confirms it, so it is not sent again
+  TEST_ASSERT_TRUE(nativeLoopUntil([]() { return outbox.lastAlertConfirmMs() > 0; }, 2000));
+  nativeLoopUntil(nullptr, 2 * OUTBOX_ALERT_RETRY_MS + 200);
+  std::set<std::string> alerts;
+  for (const NativeBrokerMessage &message : broker.messages())
+  {
+    if (message.topic == "hall/alert")
+    {
+      TEST_ASSERT_TRUE(alerts.insert(message.payload).second);
+    }
+  }
+}
+
+int main()
+{
+  nativeSetConsoleOutput(false);
+  if (!broker.start())
+  {
+    return 1;
+  }
+  setenv("NATIVE_BROKER", "127.0.0.1", 1);
+  setenv("NATIVE_BROKER_PORT", String(broker.port()).c_str(), 1);
+  nativeSetAnalogInput(MQ6_PIN, 600); // Clean air
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_level_trips);
+  RUN_TEST(test_rise_trips_below_level);
+  RUN_TEST(test_clears_only_after_quiet_hold);
+  RUN_TEST(test_outbox_sends_alert_ahead_of_telemetry_until_echoed);
+  RUN_TEST(test_outbox_drops_alert_never_echoed);
+  RUN_TEST(test_gas_ramp_raises_alarm_output);
+  RUN_TEST(test_alert_reaches_broker_before_gas_telemetry);
+  return UNITY_END();
+}